@@ -0,0 +1,1328 @@
+/*
+ * File:   BitcodeWriter.cpp
+ * Author: Michael Goulet
+ * Implements: BitcodeWriter.hpp
+ */
+
+#include <string.h>
+#include <unordered_map>
+#include "BitcodeWriter.hpp"
+
+// -- BLOCK, RECORD AND CODE NUMBERS OF THE BITCODE FORMAT (see llvm/Bitcode/LLVMBitCodes.h) -- //
+#define MODULE_BLOCK_ID             8
+#define PARAMATTR_BLOCK_ID          9
+#define PARAMATTR_GROUP_BLOCK_ID    10
+#define CONSTANTS_BLOCK_ID          11
+#define FUNCTION_BLOCK_ID           12
+#define VALUE_SYMTAB_BLOCK_ID       14
+#define TYPE_BLOCK_ID               17
+#define STRTAB_BLOCK_ID             23
+
+#define MODULE_CODE_VERSION         1
+#define MODULE_CODE_GLOBALVAR       7
+#define MODULE_CODE_FUNCTION        8
+#define PARAMATTR_CODE_ENTRY        2
+#define PARAMATTR_GRP_CODE_ENTRY    3
+#define STRTAB_BLOB                 1
+
+#define TYPE_CODE_NUMENTRY          1
+#define TYPE_CODE_VOID              2
+#define TYPE_CODE_DOUBLE            4
+#define TYPE_CODE_LABEL             5
+#define TYPE_CODE_OPAQUE            6
+#define TYPE_CODE_INTEGER           7
+#define TYPE_CODE_POINTER           8
+#define TYPE_CODE_ARRAY             11
+#define TYPE_CODE_STRUCT_ANON       18
+#define TYPE_CODE_STRUCT_NAME       19
+#define TYPE_CODE_STRUCT_NAMED      20
+#define TYPE_CODE_FUNCTION          21
+#define TYPE_CODE_OPAQUE_POINTER    25
+
+#define CST_CODE_SETTYPE            1
+#define CST_CODE_NULL               2
+#define CST_CODE_INTEGER            4
+#define CST_CODE_FLOAT              6
+#define CST_CODE_AGGREGATE          7
+#define CST_CODE_STRING             8
+#define CST_CODE_CE_CAST            11
+
+#define FUNC_CODE_DECLAREBLOCKS     1
+#define FUNC_CODE_INST_BINOP        2
+#define FUNC_CODE_INST_CAST         3
+#define FUNC_CODE_INST_RET          10
+#define FUNC_CODE_INST_BR           11
+#define FUNC_CODE_INST_PHI          16
+#define FUNC_CODE_INST_ALLOCA       19
+#define FUNC_CODE_INST_LOAD         20
+#define FUNC_CODE_INST_CMP2         28
+#define FUNC_CODE_INST_CALL         34
+#define FUNC_CODE_INST_GEP          43
+#define FUNC_CODE_INST_STORE        44
+#define FUNC_CODE_INST_UNOP         56
+
+#define VST_CODE_ENTRY              1
+#define VST_CODE_BBENTRY            2
+
+#define CALL_TAIL                   0
+#define CALL_CCONV                  1
+#define CALL_MUSTTAIL               14
+#define CALL_EXPLICIT_TYPE          15
+#define ALLOCA_EXPLICIT_TYPE        (1 << 6)
+
+#define ABBREV_WIDTH                4
+#define TOP_ABBREV_WIDTH            2
+
+namespace bitcode {
+
+    //////////////// TYPES /////////////////
+
+    LLVMContext::LLVMContext() {
+        voidTy = getType(VoidTyID, 0, NULL, std::vector<Type*>());
+        labelTy = getType(LabelTyID, 0, NULL, std::vector<Type*>());
+        doubleTy = getType(DoubleTyID, 0, NULL, std::vector<Type*>());
+        int1Ty = getType(IntegerTyID, 1, NULL, std::vector<Type*>());
+        int8Ty = getType(IntegerTyID, 8, NULL, std::vector<Type*>());
+        int16Ty = getType(IntegerTyID, 16, NULL, std::vector<Type*>());
+        int32Ty = getType(IntegerTyID, 32, NULL, std::vector<Type*>());
+        int64Ty = getType(IntegerTyID, 64, NULL, std::vector<Type*>());
+        opaquePointerTy = NULL;
+    }
+
+    void LLVMContext::enableOpaquePointers() {
+        opaquePointerTy = getType(PointerTyID, 0, NULL, std::vector<Type*>());
+    }
+
+    LLVMContext::~LLVMContext() {
+        for (auto i = ints.begin(); i != ints.end(); ++i)
+            delete i->second;
+
+        for (auto i = decimals.begin(); i != decimals.end(); ++i)
+            delete i->second;
+
+        for (auto i = nulls.begin(); i != nulls.end(); ++i)
+            delete i->second;
+
+        for (size_t i = 0; i < strings.size(); i++)
+            delete strings[i];
+
+        for (size_t i = 0; i < aggregates.size(); i++)
+            delete aggregates[i];
+
+        for (auto i = types.begin(); i != types.end(); ++i)
+            delete i->second;
+
+        for (size_t i = 0; i < namedStructs.size(); i++)
+            delete namedStructs[i];
+    }
+
+    Type* LLVMContext::getType(TypeID id, uint64_t size, Type* element, const std::vector<Type*>& elements) {
+        std::vector<uintptr_t> key;
+        key.push_back(id);
+        key.push_back(size);
+        key.push_back((uintptr_t) element);
+
+        for (size_t i = 0; i < elements.size(); i++)
+            key.push_back((uintptr_t) elements[i]);
+
+        auto found = types.find(key);
+
+        if (found != types.end())
+            return found->second;
+
+        Type* type;
+
+        switch (id) {
+            case IntegerTyID:
+                type = new IntegerType(*this);
+                break;
+            case PointerTyID:
+                type = new PointerType(*this);
+                break;
+            case ArrayTyID:
+                type = new ArrayType(*this);
+                break;
+            case StructTyID:
+                type = new StructType(*this);
+                break;
+            case FunctionTyID:
+                type = new FunctionType(*this);
+                break;
+            default:
+                type = new Type(*this, id);
+                break;
+        }
+
+        type->size = size;
+        type->element = element;
+        type->elements = elements;
+        types[key] = type;
+        return type;
+    }
+
+    StructType* LLVMContext::createNamedStruct(const std::string& name) {
+        StructType* type = new StructType(*this);
+        type->name = name;
+        type->literal = false;
+        type->opaque = true;
+        namedStructs.push_back(type);
+        return type;
+    }
+
+    ConstantInt* LLVMContext::getConstantInt(Type* type, int64_t value) {
+        std::pair<Type*, int64_t> key(type, value);
+        auto found = ints.find(key);
+
+        if (found != ints.end())
+            return found->second;
+
+        return ints[key] = new ConstantInt(type, value);
+    }
+
+    ConstantFP* LLVMContext::getConstantFP(Type* type, double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof (bits));
+        std::pair<Type*, uint64_t> key(type, bits);
+        auto found = decimals.find(key);
+
+        if (found != decimals.end())
+            return found->second;
+
+        return decimals[key] = new ConstantFP(type, value);
+    }
+
+    Constant* LLVMContext::getNullValue(Type* type) {
+        switch (type->id) {
+            case IntegerTyID:
+                return getConstantInt(type, 0);
+            case DoubleTyID:
+                return getConstantFP(type, 0.0);
+            default:
+                break;
+        }
+
+        auto found = nulls.find(type);
+
+        if (found != nulls.end())
+            return found->second;
+
+        return nulls[type] = new ConstantPointerNull(type); //doubles as the zeroinitializer of structs and arrays.
+    }
+
+    Constant* LLVMContext::getString(const std::string& data) {
+        Type* type = ArrayType::get(int8Ty, data.size());
+        ConstantDataArray* string = new ConstantDataArray(type, data);
+        strings.push_back(string);
+        return string;
+    }
+
+    Constant* LLVMContext::getStruct(Type* type, const std::vector<Constant*>& elements) {
+        ConstantStruct* aggregate = new ConstantStruct(type, elements);
+        aggregates.push_back(aggregate);
+        return aggregate;
+    }
+
+    Constant* LLVMContext::getBitCast(Constant* operand, Type* type) {
+        if (operand->getType() == type)
+            return operand;
+
+        ConstantExpr* cast = new ConstantExpr(type, operand);
+        aggregates.push_back(cast);
+        return cast;
+    }
+
+    PointerType* PointerType::getUnqual(Type* element) {
+        if (element->context.opaquePointerTy != NULL)
+            return (PointerType*) element->context.opaquePointerTy;
+
+        if (element->pointerTo == NULL)
+            element->pointerTo = element->context.getType(PointerTyID, 0, element, std::vector<Type*>());
+
+        return (PointerType*) element->pointerTo;
+    }
+
+    ArrayType* ArrayType::get(Type* element, uint64_t count) {
+        return (ArrayType*) element->context.getType(ArrayTyID, count, element, std::vector<Type*>());
+    }
+
+    StructType* StructType::create(LLVMContext& context, const std::string& name) {
+        return context.createNamedStruct(name);
+    }
+
+    StructType* StructType::get(LLVMContext& context, const std::vector<Type*>& elements) {
+        return (StructType*) context.getType(StructTyID, 0, NULL, elements);
+    }
+
+    void StructType::setBody(const std::vector<Type*>& elements) {
+        this->elements = elements;
+        opaque = false;
+    }
+
+    FunctionType* FunctionType::get(Type* returnType, const std::vector<Type*>& params, bool isVarArg) {
+        return (FunctionType*) returnType->context.getType(FunctionTyID, isVarArg, returnType, params);
+    }
+
+    //////////////// VALUES /////////////////
+
+    Constant* Constant::getNullValue(Type* type) {
+        return type->context.getNullValue(type);
+    }
+
+    ConstantInt* ConstantInt::get(Type* type, uint64_t value, bool isSigned) {
+        unsigned shift = 64 - type->size;
+        int64_t extended = shift == 0 ? (int64_t) value : ((int64_t) (value << shift)) >> shift;
+        return type->context.getConstantInt(type, extended);
+    }
+
+    Constant* ConstantFP::get(Type* type, double value) {
+        return type->context.getConstantFP(type, value);
+    }
+
+    ConstantPointerNull* ConstantPointerNull::get(PointerType* type) {
+        return (ConstantPointerNull*) type->context.getNullValue(type);
+    }
+
+    Constant* ConstantDataArray::getString(LLVMContext& context, const std::string& string, bool addNull) {
+        return context.getString(addNull ? string + '\0' : string);
+    }
+
+    Constant* ConstantStruct::get(StructType* type, const std::vector<Constant*>& elements) {
+        return type->context.getStruct(type, elements);
+    }
+
+    Constant* ConstantArray::get(ArrayType* type, const std::vector<Constant*>& elements) {
+        return type->context.getStruct(type, elements);
+    }
+
+    Constant* ConstantExpr::getBitCast(Constant* operand, Type* type) {
+        return type->context.getBitCast(operand, type);
+    }
+
+    GlobalValue::GlobalValue(ValueKind kind, Type* valueType, LinkageTypes linkage, Module* parent)
+    : Constant(kind, PointerType::getUnqual(valueType)), linkage(linkage), unnamedAddr(UnnamedAddr::None), valueType(valueType), parent(parent) {
+    }
+
+    GlobalVariable::GlobalVariable(Module& module, Type* valueType, bool isConstant, LinkageTypes linkage, Constant* initializer, const std::string& name)
+    : GlobalValue(GlobalVariableVal, valueType, linkage, &module), constant(isConstant), initializer(initializer), alignment(0) {
+        setName(module.uniqueName(name));
+        module.globals.push_back(this);
+    }
+
+    Function::Function(FunctionType* type, LinkageTypes linkage, Module* module)
+    : GlobalValue(FunctionVal, type, linkage, module), callingConv(CallingConv::C) {
+        arguments.reserve(type->getNumParams()); //arguments are handed out by address, so never reallocate.
+
+        for (unsigned i = 0; i < type->getNumParams(); i++)
+            arguments.push_back(Argument(type->getParamType(i), this, i));
+    }
+
+    Function* Function::Create(FunctionType* type, LinkageTypes linkage, const std::string& name, Module* module) {
+        Function* function = new Function(type, linkage, module);
+        function->setName(module->uniqueName(name));
+        module->functions.push_back(function);
+        module->functionNames[function->getName()] = function;
+        return function;
+    }
+
+    void Function::addAttribute(unsigned index, Attribute::AttrKind kind) {
+        attributes[index].push_back(0); //an enum attribute.
+        attributes[index].push_back(kind);
+    }
+
+    void Function::addDereferenceableParamAttr(unsigned argNo, uint64_t bytes) {
+        std::vector<uint64_t>& encoded = attributes[Attribute::FirstArgIndex + argNo];
+        encoded.push_back(1); //an integer attribute.
+        encoded.push_back(Attribute::Dereferenceable);
+        encoded.push_back(bytes);
+    }
+
+    Function::~Function() {
+        for (size_t i = 0; i < blocks.size(); i++)
+            delete blocks[i];
+    }
+
+    BasicBlock* BasicBlock::Create(LLVMContext& context, const std::string& name, Function* parent) {
+        BasicBlock* block = new BasicBlock(context.labelTy);
+        block->setName(name);
+        block->parent = parent;
+
+        if (parent != NULL)
+            parent->blocks.push_back(block);
+
+        return block;
+    }
+
+    Instruction* BasicBlock::getTerminator() const {
+        if (instructions.empty() || !instructions.back()->isTerminator())
+            return NULL;
+
+        return instructions.back();
+    }
+
+    BasicBlock::~BasicBlock() {
+        for (size_t i = 0; i < instructions.size(); i++)
+            delete instructions[i];
+    }
+
+    Function* Module::getFunction(const std::string& name) const {
+        auto found = functionNames.find(name);
+        return found == functionNames.end() ? NULL : found->second;
+    }
+
+    std::string Module::uniqueName(const std::string& name) {
+        auto found = symbols.find(name);
+
+        if (found == symbols.end()) {
+            symbols[name] = 0;
+            return name;
+        }
+
+        std::string renamed;
+
+        do {
+            renamed = name + "." + std::to_string(++found->second);
+        } while (symbols.count(renamed));
+
+        symbols[renamed] = 0;
+        return renamed;
+    }
+
+    Module::~Module() {
+        for (size_t i = 0; i < globals.size(); i++)
+            delete globals[i];
+
+        for (size_t i = 0; i < functions.size(); i++)
+            delete functions[i];
+    }
+
+    //////////////// BUILDER /////////////////
+
+    Instruction* IRBuilder::insert(Instruction* instruction) {
+        instruction->parent = block;
+        block->instructions.push_back(instruction);
+        return instruction;
+    }
+
+    Instruction* IRBuilder::CreateRetVoid() {
+        return insert(new Instruction(Instruction::Ret, context.voidTy));
+    }
+
+    Instruction* IRBuilder::CreateRet(Value* value) {
+        Instruction* ret = new Instruction(Instruction::Ret, context.voidTy);
+        ret->operands.push_back(value);
+        return insert(ret);
+    }
+
+    Instruction* IRBuilder::CreateBr(BasicBlock* target) {
+        Instruction* br = new Instruction(Instruction::Br, context.voidTy);
+        br->blocks.push_back(target);
+        return insert(br);
+    }
+
+    Instruction* IRBuilder::CreateCondBr(Value* condition, BasicBlock* iftrue, BasicBlock* iffalse) {
+        Instruction* br = new Instruction(Instruction::Br, context.voidTy);
+        br->operands.push_back(condition);
+        br->blocks.push_back(iftrue);
+        br->blocks.push_back(iffalse);
+        return insert(br);
+    }
+
+    Value* IRBuilder::binary(Instruction::Opcode opcode, Value* a, Value* b) {
+        Instruction* binop = new Instruction(opcode, a->getType());
+        binop->operands.push_back(a);
+        binop->operands.push_back(b);
+        return insert(binop);
+    }
+
+    Value* IRBuilder::CreateFNeg(Value* v) {
+        Instruction* fneg = new Instruction(Instruction::FNeg, v->getType());
+        fneg->operands.push_back(v);
+        return insert(fneg);
+    }
+
+    Value* IRBuilder::compare(Instruction::Opcode opcode, unsigned predicate, Value* a, Value* b) {
+        Instruction* cmp = new Instruction(opcode, getInt1Ty());
+        cmp->predicate = predicate;
+        cmp->operands.push_back(a);
+        cmp->operands.push_back(b);
+        return insert(cmp);
+    }
+
+    Value* IRBuilder::cast(Instruction::Opcode opcode, Value* v, Type* type) {
+        if (v->getType() == type)
+            return v; //no cast
+
+        Instruction* cast = new Instruction(opcode, type);
+        cast->operands.push_back(v);
+        return insert(cast);
+    }
+
+    Value* IRBuilder::CreateAlloca(Type* type, Value* arraySize, const std::string& name) {
+        Instruction* alloca = new Instruction(Instruction::Alloca, PointerType::getUnqual(type));
+        alloca->explicitType = type;
+        alloca->operands.push_back(arraySize == NULL ? getInt32(1) : arraySize);
+        alloca->setName(name);
+        return insert(alloca);
+    }
+
+    Value* IRBuilder::CreateLoad(Type* type, Value* pointer) {
+        Instruction* load = new Instruction(Instruction::Load, type);
+        load->operands.push_back(pointer);
+        return insert(load);
+    }
+
+    Instruction* IRBuilder::CreateStore(Value* value, Value* pointer) {
+        Instruction* store = new Instruction(Instruction::Store, context.voidTy);
+        store->operands.push_back(value);
+        store->operands.push_back(pointer);
+        return insert(store);
+    }
+
+    Value* IRBuilder::gep(Type* source, Value* pointer, const std::vector<Value*>& indices, bool inBounds) {
+        Type* indexed = source;
+
+        for (size_t i = 1; i < indices.size(); i++) { //the first index only steps over the pointer.
+            if (indexed->isStructTy())
+                indexed = indexed->elements[((ConstantInt*) indices[i])->value];
+            else
+                indexed = indexed->element;
+        }
+
+        Instruction* gep = new Instruction(Instruction::GetElementPtr, PointerType::getUnqual(indexed));
+        gep->explicitType = source;
+        gep->inBounds = inBounds;
+        gep->operands.push_back(pointer);
+        gep->operands.insert(gep->operands.end(), indices.begin(), indices.end());
+        return insert(gep);
+    }
+
+    Value* IRBuilder::CreateGEP(Type* source, Value* pointer, Value* index) {
+        return gep(source, pointer, std::vector<Value*>(1, index), false);
+    }
+
+    Value* IRBuilder::CreateGEP(Type* source, Value* pointer, const std::vector<Value*>& indices) {
+        return gep(source, pointer, indices, false);
+    }
+
+    Value* IRBuilder::CreateInBoundsGEP(Type* source, Value* pointer, const std::vector<Value*>& indices) {
+        return gep(source, pointer, indices, true);
+    }
+
+    Value* IRBuilder::CreateStructGEP(Type* source, Value* pointer, unsigned index) {
+        return gep(source, pointer, {getInt32(0), getInt32(index)}, true);
+    }
+
+    CallInst* IRBuilder::CreateCall(FunctionType* type, Value* callee, const std::vector<Value*>& arguments) {
+        CallInst* call = new CallInst(type->getReturnType());
+        call->explicitType = type;
+        call->operands.push_back(callee);
+        call->operands.insert(call->operands.end(), arguments.begin(), arguments.end());
+        insert(call);
+        return call;
+    }
+
+    CallInst* IRBuilder::lifetime(const std::string& intrinsic, Value* pointer, ConstantInt* size) {
+        Module* module = block->getParent()->getParent();
+        Type* bytePointer = PointerType::getUnqual(getInt8Ty());
+        std::string name = intrinsic + (context.opaquePointerTy != NULL ? ".p0" : ".p0i8"); //overloaded on the pointer type.
+        Function* function = module->getFunction(name);
+
+        if (function == NULL)
+            function = Function::Create(FunctionType::get(getVoidTy(), {getInt64Ty(), bytePointer}, false), Function::ExternalLinkage, name, module);
+
+        if (size == NULL)
+            size = ConstantInt::get(getInt64Ty(), -1); //the whole object, like LLVM's IRBuilder.
+
+        return CreateCall(function->getFunctionType(), function, {size, CreateBitCast(pointer, bytePointer)});
+    }
+
+    CallInst* IRBuilder::CreateMemCpy(Value* destination, MaybeAlign, Value* source, MaybeAlign, Value* size) {
+        Module* module = block->getParent()->getParent();
+        Type* bytePointer = PointerType::getUnqual(getInt8Ty());
+        std::string name = context.opaquePointerTy != NULL ? "llvm.memcpy.p0.p0.i32" : "llvm.memcpy.p0i8.p0i8.i32";
+        Function* function = module->getFunction(name);
+
+        if (function == NULL)
+            function = Function::Create(FunctionType::get(getVoidTy(), {bytePointer, bytePointer, getInt32Ty(), getInt1Ty()}, false), Function::ExternalLinkage, name, module);
+
+        return CreateCall(function->getFunctionType(), function, {CreateBitCast(destination, bytePointer), CreateBitCast(source, bytePointer), size, getInt1(false)});
+    }
+
+    CallInst* IRBuilder::CreateMemSet(Value* destination, Value* value, Value* size, MaybeAlign) {
+        Module* module = block->getParent()->getParent();
+        Type* bytePointer = PointerType::getUnqual(getInt8Ty());
+        std::string name = context.opaquePointerTy != NULL ? "llvm.memset.p0.i32" : "llvm.memset.p0i8.i32";
+        Function* function = module->getFunction(name);
+
+        if (function == NULL)
+            function = Function::Create(FunctionType::get(getVoidTy(), {bytePointer, getInt8Ty(), getInt32Ty(), getInt1Ty()}, false), Function::ExternalLinkage, name, module);
+
+        return CreateCall(function->getFunctionType(), function, {CreateBitCast(destination, bytePointer), value, size, getInt1(false)});
+    }
+
+    PHINode* IRBuilder::CreatePHI(Type* type, unsigned reservedValues) {
+        PHINode* phi = new PHINode(type);
+        phi->operands.reserve(reservedValues);
+        insert(phi);
+        return phi;
+    }
+
+    //////////////// BITSTREAM /////////////////
+
+    class BitstreamWriter {
+    public:
+        BitstreamWriter() : current(0), bits(0), abbrevWidth(TOP_ABBREV_WIDTH) {}
+
+        void emit(uint32_t value, unsigned width) {
+            current |= (uint64_t) value << bits;
+            bits += width;
+
+            if (bits >= 32) {
+                writeWord((uint32_t) current);
+                current >>= 32;
+                bits -= 32;
+            }
+        }
+
+        void emitVBR(uint64_t value, unsigned width) {
+            uint64_t threshold = 1ULL << (width - 1);
+
+            while (value >= threshold) {
+                emit((uint32_t) ((value & (threshold - 1)) | threshold), width);
+                value >>= width - 1;
+            }
+
+            emit((uint32_t) value, width);
+        }
+
+        void alignToWord() {
+            if (bits > 0)
+                emit(0, 32 - bits);
+        }
+
+        void enterBlock(unsigned blockID, unsigned newAbbrevWidth) {
+            emit(1, abbrevWidth); //ENTER_SUBBLOCK
+            emitVBR(blockID, 8);
+            emitVBR(newAbbrevWidth, 4);
+            alignToWord();
+            blocks.push_back(std::make_pair(abbrevWidth, bytes.size() / 4));
+            writeWord(0); //block length in words, patched by exitBlock.
+            abbrevWidth = newAbbrevWidth;
+        }
+
+        void exitBlock() {
+            emit(0, abbrevWidth); //END_BLOCK
+            alignToWord();
+            std::pair<unsigned, size_t> block = blocks.back();
+            blocks.pop_back();
+            uint32_t length = bytes.size() / 4 - block.second - 1;
+
+            for (int i = 0; i < 4; i++)
+                bytes[block.second * 4 + i] = (uint8_t) (length >> (8 * i));
+
+            abbrevWidth = block.first;
+        }
+
+        void emitRecord(unsigned code, const std::vector<uint64_t>& operands) {
+            emit(3, abbrevWidth); //UNABBREV_RECORD
+            emitVBR(code, 6);
+            emitVBR(operands.size(), 6);
+
+            for (size_t i = 0; i < operands.size(); i++)
+                emitVBR(operands[i], 6);
+        }
+
+        void emitBlobRecord(unsigned code, const std::string& blob) { //defines the abbreviation [literal code, blob] and uses it.
+            emit(2, abbrevWidth); //DEFINE_ABBREV
+            emitVBR(2, 5);
+            emit(1, 1);
+            emitVBR(code, 8);
+            emit(0, 1);
+            emit(5, 3); //blob encoding
+            emit(4, abbrevWidth); //the first application-defined abbreviation id
+            emitVBR(blob.size(), 6);
+            alignToWord();
+
+            for (size_t i = 0; i < blob.size(); i++)
+                emit((uint8_t) blob[i], 8);
+
+            alignToWord();
+        }
+
+        void writeTo(FILE* out) {
+            alignToWord();
+            fwrite(&bytes[0], 1, bytes.size(), out);
+        }
+    private:
+        void writeWord(uint32_t word) {
+            for (int i = 0; i < 4; i++)
+                bytes.push_back((uint8_t) (word >> (8 * i)));
+        }
+
+        std::vector<uint8_t> bytes;
+        std::vector<std::pair<unsigned, size_t> > blocks;
+        uint64_t current;
+        unsigned bits, abbrevWidth;
+    };
+
+    //////////////// MODULE ENCODING /////////////////
+
+    class ModuleWriter {
+    public:
+        ModuleWriter(const Module& module) : module(module) {}
+        void write(FILE* out);
+    private:
+        void enumerateType(Type*);
+        void enumerateConstantType(Constant*);
+        void enumerateTypes();
+        void enumerateConstant(Constant*, unsigned& nextID);
+        void enumerateAttributes();
+        void writeTypeTable();
+        void writeAttributes();
+        unsigned getAttributeGroup(unsigned index, const std::vector<uint64_t>& encoded);
+        unsigned getAttributeList(const std::map<unsigned, std::vector<uint64_t> >& attributes);
+        void writeGlobals();
+        void writeConstants(const std::vector<Constant*>&);
+        void writeFunction(Function*);
+        void writeInstruction(Instruction*, unsigned instID);
+        void writeName(unsigned code, unsigned id, const std::string& name);
+
+        void pushValue(std::vector<uint64_t>& record, Value* value, unsigned instID) {
+            record.push_back((uint32_t) (instID - valueIDs[value]));
+        }
+
+        void pushValueAndType(std::vector<uint64_t>& record, Value* value, unsigned instID) {
+            unsigned id = valueIDs[value];
+            record.push_back((uint32_t) (instID - id));
+
+            if (id >= instID) //forward references need their type spelled out.
+                record.push_back(typeIDs[value->getType()]);
+        }
+
+        void pushSigned(std::vector<uint64_t>& record, int64_t value) {
+            record.push_back(value >= 0 ? (uint64_t) value << 1 : ((uint64_t) - value << 1) | 1);
+        }
+
+        const Module& module;
+        BitstreamWriter stream;
+        std::vector<Type*> types;
+        std::unordered_map<Type*, unsigned> typeIDs;
+        std::unordered_map<Value*, unsigned> valueIDs;
+        std::unordered_map<BasicBlock*, unsigned> blockIDs;
+        std::vector<Constant*> moduleConstants;
+        std::map<std::pair<unsigned, std::vector<uint64_t> >, unsigned> attributeGroups;
+        std::map<std::vector<unsigned>, unsigned> attributeLists;
+        std::unordered_map<Function*, unsigned> functionAttributes;
+        std::unordered_map<Instruction*, unsigned> callAttributes;
+        std::string strtab;
+    };
+
+    void ModuleWriter::enumerateType(Type* type) {
+        if (typeIDs.count(type))
+            return; //done already, or a named struct we are in the middle of.
+
+        if (!type->literal)
+            typeIDs[type] = ~0U; //named structs may be forward referenced, which breaks cycles.
+
+        if (type->element != NULL)
+            enumerateType(type->element);
+
+        for (size_t i = 0; i < type->elements.size(); i++)
+            enumerateType(type->elements[i]);
+
+        auto found = typeIDs.find(type);
+
+        if (found != typeIDs.end() && found->second != ~0U)
+            return;
+
+        typeIDs[type] = types.size();
+        types.push_back(type);
+    }
+
+    void ModuleWriter::enumerateConstantType(Constant* constant) {
+        enumerateType(constant->getType());
+
+        if (constant->kind == ConstantStructVal) {
+            for (size_t i = 0; i < ((ConstantStruct*) constant)->elements.size(); i++)
+                enumerateConstantType(((ConstantStruct*) constant)->elements[i]);
+        } else if (constant->kind == ConstantExprVal)
+            enumerateConstantType(((ConstantExpr*) constant)->operand);
+    }
+
+    void ModuleWriter::enumerateTypes() {
+        for (size_t i = 0; i < module.globals.size(); i++) {
+            enumerateType(module.globals[i]->getType());
+            enumerateType(module.globals[i]->getValueType()); //not reachable from an opaque pointer.
+
+            if (module.globals[i]->initializer != NULL)
+                enumerateConstantType(module.globals[i]->initializer);
+        }
+
+        for (size_t i = 0; i < module.functions.size(); i++) {
+            Function* function = module.functions[i];
+            enumerateType(function->getType());
+            enumerateType(function->getValueType());
+
+            for (size_t b = 0; b < function->blocks.size(); b++) {
+                BasicBlock* block = function->blocks[b];
+
+                for (size_t n = 0; n < block->instructions.size(); n++) {
+                    Instruction* instruction = block->instructions[n];
+                    enumerateType(instruction->getType());
+
+                    if (instruction->explicitType != NULL)
+                        enumerateType(instruction->explicitType);
+
+                    for (size_t o = 0; o < instruction->operands.size(); o++)
+                        enumerateType(instruction->operands[o]->getType());
+                }
+            }
+        }
+    }
+
+    unsigned ModuleWriter::getAttributeGroup(unsigned index, const std::vector<uint64_t>& encoded) {
+        std::pair<unsigned, std::vector<uint64_t> > key(index, encoded);
+
+        if (!attributeGroups.count(key)) {
+            unsigned id = attributeGroups.size() + 1;
+            attributeGroups[key] = id;
+        }
+
+        return attributeGroups[key];
+    }
+
+    unsigned ModuleWriter::getAttributeList(const std::map<unsigned, std::vector<uint64_t> >& attributes) { //0 for none.
+        std::vector<unsigned> groups;
+
+        for (auto a = attributes.begin(); a != attributes.end(); ++a)
+            groups.push_back(getAttributeGroup(a->first, a->second));
+
+        if (groups.empty())
+            return 0;
+
+        if (!attributeLists.count(groups)) {
+            unsigned id = attributeLists.size() + 1;
+            attributeLists[groups] = id;
+        }
+
+        return attributeLists[groups];
+    }
+
+    void ModuleWriter::enumerateAttributes() {
+        for (size_t i = 0; i < module.functions.size(); i++) {
+            Function* function = module.functions[i];
+            functionAttributes[function] = getAttributeList(function->attributes);
+
+            for (size_t b = 0; b < function->blocks.size(); b++) {
+                BasicBlock* block = function->blocks[b];
+
+                for (size_t n = 0; n < block->instructions.size(); n++) {
+                    if (block->instructions[n]->opcode == Instruction::Call)
+                        callAttributes[block->instructions[n]] = getAttributeList(((CallInst*) block->instructions[n])->attributes);
+                }
+            }
+        }
+    }
+
+    void ModuleWriter::writeTypeTable() {
+        stream.enterBlock(TYPE_BLOCK_ID, ABBREV_WIDTH);
+        stream.emitRecord(TYPE_CODE_NUMENTRY, {types.size()});
+
+        for (size_t i = 0; i < types.size(); i++) {
+            Type* type = types[i];
+            std::vector<uint64_t> record;
+
+            switch (type->id) {
+                case VoidTyID:
+                    stream.emitRecord(TYPE_CODE_VOID, record);
+                    break;
+                case LabelTyID:
+                    stream.emitRecord(TYPE_CODE_LABEL, record);
+                    break;
+                case DoubleTyID:
+                    stream.emitRecord(TYPE_CODE_DOUBLE, record);
+                    break;
+                case IntegerTyID:
+                    stream.emitRecord(TYPE_CODE_INTEGER, {type->size});
+                    break;
+                case PointerTyID:
+                    if (type->element == NULL)
+                        stream.emitRecord(TYPE_CODE_OPAQUE_POINTER, {0});
+                    else
+                        stream.emitRecord(TYPE_CODE_POINTER, {typeIDs[type->element], 0});
+
+                    break;
+                case ArrayTyID:
+                    stream.emitRecord(TYPE_CODE_ARRAY, {type->size, typeIDs[type->element]});
+                    break;
+                case FunctionTyID:
+                    record.push_back(type->size); //vararg
+                    record.push_back(typeIDs[type->element]);
+
+                    for (size_t p = 0; p < type->elements.size(); p++)
+                        record.push_back(typeIDs[type->elements[p]]);
+
+                    stream.emitRecord(TYPE_CODE_FUNCTION, record);
+                    break;
+                case StructTyID: {
+                    if (!type->literal) {
+                        std::vector<uint64_t> name(type->name.begin(), type->name.end());
+                        stream.emitRecord(TYPE_CODE_STRUCT_NAME, name);
+
+                        if (type->opaque) {
+                            stream.emitRecord(TYPE_CODE_OPAQUE, {0});
+                            break;
+                        }
+                    }
+
+                    record.push_back(0); //packed
+
+                    for (size_t e = 0; e < type->elements.size(); e++)
+                        record.push_back(typeIDs[type->elements[e]]);
+
+                    stream.emitRecord(type->literal ? TYPE_CODE_STRUCT_ANON : TYPE_CODE_STRUCT_NAMED, record);
+                }
+                break;
+            }
+        }
+
+        stream.exitBlock();
+    }
+
+    void ModuleWriter::writeAttributes() {
+        if (attributeLists.empty())
+            return;
+
+        stream.enterBlock(PARAMATTR_GROUP_BLOCK_ID, ABBREV_WIDTH);
+
+        for (auto i = attributeGroups.begin(); i != attributeGroups.end(); ++i) {
+            std::vector<uint64_t> record = {i->second, i->first.first};
+            record.insert(record.end(), i->first.second.begin(), i->first.second.end());
+
+            stream.emitRecord(PARAMATTR_GRP_CODE_ENTRY, record);
+        }
+
+        stream.exitBlock();
+        std::vector<std::vector<unsigned> > lists(attributeLists.size());
+
+        for (auto i = attributeLists.begin(); i != attributeLists.end(); ++i)
+            lists[i->second - 1] = i->first;
+
+        stream.enterBlock(PARAMATTR_BLOCK_ID, ABBREV_WIDTH);
+
+        for (size_t i = 0; i < lists.size(); i++)
+            stream.emitRecord(PARAMATTR_CODE_ENTRY, std::vector<uint64_t>(lists[i].begin(), lists[i].end()));
+
+        stream.exitBlock();
+    }
+
+    static unsigned encodeLinkage(GlobalValue::LinkageTypes linkage) {
+        switch (linkage) {
+            case GlobalValue::InternalLinkage:
+                return 3;
+            case GlobalValue::CommonLinkage:
+                return 8;
+            case GlobalValue::PrivateLinkage:
+                return 9;
+            default:
+                return 0;
+        }
+    }
+
+    static unsigned encodeAlignment(unsigned alignment) {
+        unsigned log = 0;
+
+        if (alignment == 0)
+            return 0;
+
+        while ((1U << log) < alignment)
+            log++;
+
+        return log + 1;
+    }
+
+    void ModuleWriter::writeGlobals() {
+        for (size_t i = 0; i < module.globals.size(); i++) {
+            GlobalVariable* global = module.globals[i];
+            uint64_t init = global->initializer == NULL ? 0 : valueIDs[global->initializer] + 1;
+            stream.emitRecord(MODULE_CODE_GLOBALVAR, {strtab.size(), global->getName().size(), typeIDs[global->getValueType()],
+                2 | (uint64_t) global->constant, init, encodeLinkage(global->linkage), encodeAlignment(global->alignment), 0, 0, 0,
+                global->unnamedAddr == GlobalValue::UnnamedAddr::Global ? 1ULL : global->unnamedAddr == GlobalValue::UnnamedAddr::Local ? 2ULL : 0ULL});
+            strtab += global->getName();
+        }
+
+        for (size_t i = 0; i < module.functions.size(); i++) {
+            Function* function = module.functions[i];
+            stream.emitRecord(MODULE_CODE_FUNCTION, {strtab.size(), function->getName().size(), typeIDs[function->getValueType()],
+                function->callingConv, function->isDeclaration(), encodeLinkage(function->linkage), functionAttributes[function], 0, 0, 0, 0, 0});
+            strtab += function->getName();
+        }
+    }
+
+    static unsigned encodeCastOpcode(Instruction::Opcode opcode) {
+        switch (opcode) {
+            case Instruction::Trunc:
+                return 0;
+            case Instruction::SExt:
+                return 2;
+            case Instruction::FPToSI:
+                return 4;
+            case Instruction::SIToFP:
+                return 6;
+            case Instruction::PtrToInt:
+                return 9;
+            default: //BitCast
+                return 11;
+        }
+    }
+
+    void ModuleWriter::writeConstants(const std::vector<Constant*>& constants) {
+        if (constants.empty())
+            return;
+
+        stream.enterBlock(CONSTANTS_BLOCK_ID, ABBREV_WIDTH);
+        Type* type = NULL;
+
+        for (size_t i = 0; i < constants.size(); i++) {
+            Constant* constant = constants[i];
+
+            if (constant->getType() != type) {
+                type = constant->getType();
+                stream.emitRecord(CST_CODE_SETTYPE, {typeIDs[type]});
+            }
+
+            switch (constant->kind) {
+                case ConstantIntVal: {
+                    std::vector<uint64_t> record;
+                    pushSigned(record, ((ConstantInt*) constant)->value);
+                    stream.emitRecord(CST_CODE_INTEGER, record);
+                }
+                break;
+                case ConstantFPVal: {
+                    uint64_t bits;
+                    memcpy(&bits, &((ConstantFP*) constant)->value, sizeof (bits));
+                    stream.emitRecord(CST_CODE_FLOAT, {bits});
+                }
+                break;
+                case ConstantDataArrayVal: {
+                    const std::string& data = ((ConstantDataArray*) constant)->data;
+
+                    if (data.empty()) {
+                        stream.emitRecord(CST_CODE_NULL, {});
+                    } else {
+                        std::vector<uint64_t> record;
+
+                        for (size_t c = 0; c < data.size(); c++)
+                            record.push_back((uint8_t) data[c]);
+
+                        stream.emitRecord(CST_CODE_STRING, record);
+                    }
+                }
+                break;
+                case ConstantStructVal: {
+                    std::vector<Constant*>& elements = ((ConstantStruct*) constant)->elements;
+                    std::vector<uint64_t> record;
+
+                    for (size_t e = 0; e < elements.size(); e++)
+                        record.push_back(valueIDs[elements[e]]); //absolute ids, unlike instruction operands.
+
+                    if (record.empty())
+                        stream.emitRecord(CST_CODE_NULL, {});
+                    else
+                        stream.emitRecord(CST_CODE_AGGREGATE, record);
+                }
+                break;
+                case ConstantExprVal: {
+                    Constant* operand = ((ConstantExpr*) constant)->operand;
+                    stream.emitRecord(CST_CODE_CE_CAST, {encodeCastOpcode(Instruction::BitCast), typeIDs[operand->getType()], valueIDs[operand]});
+                }
+                break;
+                default:
+                    stream.emitRecord(CST_CODE_NULL, {});
+                    break;
+            }
+        }
+
+        stream.exitBlock();
+    }
+
+    void ModuleWriter::writeName(unsigned code, unsigned id, const std::string& name) {
+        std::vector<uint64_t> record(1, id);
+        record.insert(record.end(), name.begin(), name.end());
+        stream.emitRecord(code, record);
+    }
+
+    void ModuleWriter::writeFunction(Function* function) {
+        unsigned nextID = valueIDs.size(); //function-local values come right after the module-level ones.
+        std::vector<Value*> locals;
+        std::vector<Constant*> constants;
+
+        for (Function::arg_iterator a = function->arg_begin(); a != function->arg_end(); ++a) {
+            valueIDs[&*a] = nextID++;
+            locals.push_back(&*a);
+        }
+
+        for (size_t b = 0; b < function->blocks.size(); b++) {
+            blockIDs[function->blocks[b]] = b;
+            std::vector<Instruction*>& instructions = function->blocks[b]->instructions;
+
+            for (size_t i = 0; i < instructions.size(); i++) {
+                for (size_t o = 0; o < instructions[i]->operands.size(); o++) {
+                    Value* operand = instructions[i]->operands[o];
+
+                    if (operand->kind != InstructionVal && operand->kind != ArgumentVal && !valueIDs.count(operand)) {
+                        valueIDs[operand] = nextID++;
+                        constants.push_back((Constant*) operand);
+                        locals.push_back(operand);
+                    }
+                }
+            }
+        }
+
+        unsigned firstInstID = nextID;
+
+        for (size_t b = 0; b < function->blocks.size(); b++) { //number everything up front, phis may refer forward.
+            std::vector<Instruction*>& instructions = function->blocks[b]->instructions;
+
+            for (size_t i = 0; i < instructions.size(); i++) {
+                if (!instructions[i]->getType()->isVoidTy()) {
+                    valueIDs[instructions[i]] = nextID++;
+                    locals.push_back(instructions[i]);
+                }
+            }
+        }
+
+        stream.enterBlock(FUNCTION_BLOCK_ID, ABBREV_WIDTH);
+        stream.emitRecord(FUNC_CODE_DECLAREBLOCKS, {function->blocks.size()});
+        writeConstants(constants);
+        unsigned instID = firstInstID;
+
+        for (size_t b = 0; b < function->blocks.size(); b++) {
+            std::vector<Instruction*>& instructions = function->blocks[b]->instructions;
+
+            for (size_t i = 0; i < instructions.size(); i++) {
+                writeInstruction(instructions[i], instID);
+
+                if (!instructions[i]->getType()->isVoidTy())
+                    instID++;
+            }
+        }
+
+        stream.enterBlock(VALUE_SYMTAB_BLOCK_ID, ABBREV_WIDTH);
+
+        for (size_t i = 0; i < locals.size(); i++) {
+            if (!locals[i]->getName().empty())
+                writeName(VST_CODE_ENTRY, valueIDs[locals[i]], locals[i]->getName());
+        }
+
+        for (size_t b = 0; b < function->blocks.size(); b++) {
+            if (!function->blocks[b]->getName().empty())
+                writeName(VST_CODE_BBENTRY, b, function->blocks[b]->getName());
+        }
+
+        stream.exitBlock();
+        stream.exitBlock();
+
+        for (size_t i = 0; i < locals.size(); i++)
+            valueIDs.erase(locals[i]);
+
+        blockIDs.clear();
+    }
+
+    static unsigned encodeBinaryOpcode(Instruction::Opcode opcode) {
+        switch (opcode) {
+            case Instruction::Add:
+            case Instruction::FAdd:
+                return 0;
+            case Instruction::Sub:
+            case Instruction::FSub:
+                return 1;
+            case Instruction::Mul:
+            case Instruction::FMul:
+                return 2;
+            case Instruction::SDiv:
+            case Instruction::FDiv:
+                return 4;
+            case Instruction::SRem:
+            case Instruction::FRem:
+                return 6;
+            default: //Xor
+                return 12;
+        }
+    }
+
+    void ModuleWriter::writeInstruction(Instruction* instruction, unsigned instID) {
+        std::vector<uint64_t> record;
+        std::vector<Value*>& operands = instruction->operands;
+
+        switch (instruction->opcode) {
+            case Instruction::Ret:
+                if (!operands.empty())
+                    pushValueAndType(record, operands[0], instID);
+
+                stream.emitRecord(FUNC_CODE_INST_RET, record);
+                break;
+            case Instruction::Br:
+                record.push_back(blockIDs[instruction->blocks[0]]);
+
+                if (!operands.empty()) {
+                    record.push_back(blockIDs[instruction->blocks[1]]);
+                    pushValue(record, operands[0], instID);
+                }
+
+                stream.emitRecord(FUNC_CODE_INST_BR, record);
+                break;
+            case Instruction::FNeg:
+                pushValueAndType(record, operands[0], instID);
+                record.push_back(0);
+                stream.emitRecord(FUNC_CODE_INST_UNOP, record);
+                break;
+            case Instruction::Add:
+            case Instruction::FAdd:
+            case Instruction::Sub:
+            case Instruction::FSub:
+            case Instruction::Mul:
+            case Instruction::FMul:
+            case Instruction::SDiv:
+            case Instruction::FDiv:
+            case Instruction::SRem:
+            case Instruction::FRem:
+            case Instruction::Xor:
+                pushValueAndType(record, operands[0], instID);
+                pushValue(record, operands[1], instID);
+                record.push_back(encodeBinaryOpcode(instruction->opcode));
+                stream.emitRecord(FUNC_CODE_INST_BINOP, record);
+                break;
+            case Instruction::ICmp:
+            case Instruction::FCmp:
+                pushValueAndType(record, operands[0], instID);
+                pushValue(record, operands[1], instID);
+                record.push_back(instruction->predicate);
+                stream.emitRecord(FUNC_CODE_INST_CMP2, record);
+                break;
+            case Instruction::Trunc:
+            case Instruction::SExt:
+            case Instruction::FPToSI:
+            case Instruction::SIToFP:
+            case Instruction::PtrToInt:
+            case Instruction::BitCast:
+                pushValueAndType(record, operands[0], instID);
+                record.push_back(typeIDs[instruction->getType()]);
+                record.push_back(encodeCastOpcode(instruction->opcode));
+                stream.emitRecord(FUNC_CODE_INST_CAST, record);
+                break;
+            case Instruction::Alloca:
+                record.push_back(typeIDs[instruction->explicitType]);
+                record.push_back(typeIDs[operands[0]->getType()]);
+                record.push_back(valueIDs[operands[0]]); //the array size is an absolute id.
+                record.push_back(ALLOCA_EXPLICIT_TYPE);
+                stream.emitRecord(FUNC_CODE_INST_ALLOCA, record);
+                break;
+            case Instruction::Load:
+                pushValueAndType(record, operands[0], instID);
+                record.push_back(typeIDs[instruction->getType()]);
+                record.push_back(0); //alignment, the reader takes it from the data layout.
+                record.push_back(0); //volatile
+                stream.emitRecord(FUNC_CODE_INST_LOAD, record);
+                break;
+            case Instruction::Store:
+                pushValueAndType(record, operands[1], instID);
+                pushValueAndType(record, operands[0], instID);
+                record.push_back(0);
+                record.push_back(0);
+                stream.emitRecord(FUNC_CODE_INST_STORE, record);
+                break;
+            case Instruction::GetElementPtr:
+                record.push_back(instruction->inBounds);
+                record.push_back(typeIDs[instruction->explicitType]);
+
+                for (size_t i = 0; i < operands.size(); i++)
+                    pushValueAndType(record, operands[i], instID);
+
+                stream.emitRecord(FUNC_CODE_INST_GEP, record);
+                break;
+            case Instruction::PHI:
+                record.push_back(typeIDs[instruction->getType()]);
+
+                for (size_t i = 0; i < operands.size(); i++) {
+                    pushSigned(record, (int32_t) instID - (int32_t) valueIDs[operands[i]]);
+                    record.push_back(blockIDs[instruction->blocks[i]]);
+                }
+
+                stream.emitRecord(FUNC_CODE_INST_PHI, record);
+                break;
+            case Instruction::Call:
+                record.push_back(callAttributes[instruction]);
+                record.push_back((instruction->tailCallKind != CallInst::TCK_None) << CALL_TAIL | instruction->callingConv << CALL_CCONV |
+                        (instruction->tailCallKind == CallInst::TCK_MustTail) << CALL_MUSTTAIL | 1 << CALL_EXPLICIT_TYPE);
+                record.push_back(typeIDs[instruction->explicitType]);
+                pushValueAndType(record, operands[0], instID);
+
+                for (size_t i = 1; i < operands.size(); i++)
+                    pushValue(record, operands[i], instID);
+
+                stream.emitRecord(FUNC_CODE_INST_CALL, record);
+                break;
+        }
+    }
+
+    void ModuleWriter::enumerateConstant(Constant* constant, unsigned& nextID) { //the operands of a constant come first.
+        if (valueIDs.count(constant))
+            return;
+
+        if (constant->kind == ConstantStructVal) {
+            for (size_t i = 0; i < ((ConstantStruct*) constant)->elements.size(); i++)
+                enumerateConstant(((ConstantStruct*) constant)->elements[i], nextID);
+        } else if (constant->kind == ConstantExprVal)
+            enumerateConstant(((ConstantExpr*) constant)->operand, nextID);
+
+        valueIDs[constant] = nextID++;
+        moduleConstants.push_back(constant);
+    }
+
+    void ModuleWriter::write(FILE* out) {
+        enumerateTypes();
+        enumerateAttributes();
+
+        unsigned nextID = 0;
+
+        for (size_t i = 0; i < module.globals.size(); i++)
+            valueIDs[module.globals[i]] = nextID++;
+
+        for (size_t i = 0; i < module.functions.size(); i++)
+            valueIDs[module.functions[i]] = nextID++;
+
+        for (size_t i = 0; i < module.globals.size(); i++) {
+            if (module.globals[i]->initializer != NULL)
+                enumerateConstant(module.globals[i]->initializer, nextID);
+        }
+
+        stream.emit('B', 8);
+        stream.emit('C', 8);
+        stream.emit(0x0, 4);
+        stream.emit(0xC, 4);
+        stream.emit(0xE, 4);
+        stream.emit(0xD, 4);
+        stream.enterBlock(MODULE_BLOCK_ID, 3);
+        stream.emitRecord(MODULE_CODE_VERSION, {2}); //relative value ids, names in the string table.
+        writeAttributes();
+        writeTypeTable();
+        writeGlobals();
+        writeConstants(moduleConstants);
+
+        for (size_t i = 0; i < module.functions.size(); i++) {
+            if (!module.functions[i]->isDeclaration())
+                writeFunction(module.functions[i]);
+        }
+
+        stream.exitBlock();
+        stream.enterBlock(STRTAB_BLOCK_ID, 3);
+        stream.emitBlobRecord(STRTAB_BLOB, strtab);
+        stream.exitBlock();
+        stream.writeTo(out);
+    }
+
+    void WriteBitcodeToFile(const Module& module, FILE* out) {
+        ModuleWriter(module).write(out);
+    }
+}
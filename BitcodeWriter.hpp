@@ -0,0 +1,482 @@
+/*
+ * File:   BitcodeWriter.hpp
+ * Author: Michael Goulet
+ * Implementation: BitcodeWriter.cpp
+ *
+ * BitcodeWriter.hpp is a small, self-contained stand-in for the part of the LLVM C++ API that LLVMEmitting.cpp
+ * uses (types, constants, globals, functions, and an IRBuilder that only appends), plus an encoder that writes the
+ * resulting module as LLVM bitcode. It lets "cheshirec -emit-bc" write .bc files without linking against LLVM.
+ * The names deliberately follow LLVM's, so the walker in LLVMEmitting.cpp compiles against either one.
+ */
+
+#ifndef BITCODEWRITER_HPP
+#define	BITCODEWRITER_HPP
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace bitcode {
+
+    class LLVMContext;
+    class Module;
+    class Function;
+    class BasicBlock;
+
+    // -------------------------- TYPES -------------------------- //
+
+    enum TypeID {
+        VoidTyID, LabelTyID, DoubleTyID, IntegerTyID, PointerTyID, StructTyID, FunctionTyID, ArrayTyID
+    };
+
+    class Type {
+    public:
+        TypeID getTypeID() const { return id; }
+        bool isVoidTy() const { return id == VoidTyID; }
+        bool isDoubleTy() const { return id == DoubleTyID; }
+        bool isIntegerTy() const { return id == IntegerTyID; }
+        bool isPointerTy() const { return id == PointerTyID; }
+        bool isStructTy() const { return id == StructTyID; }
+        bool isFunctionTy() const { return id == FunctionTyID; }
+        LLVMContext& getContext() const { return context; }
+        virtual ~Type() {}
+
+        LLVMContext& context;
+        TypeID id;
+        uint64_t size; //bit width of integers, element count of arrays.
+        Type* element; //pointee of typed pointers, element of arrays, return type of functions.
+        std::vector<Type*> elements; //fields of structs, parameters of functions.
+        std::string name; //only for named structs, literal structs are uniqued by their fields.
+        bool literal, opaque;
+        Type* pointerTo; //cached, pointer types are looked up far more than any other.
+    protected:
+        Type(LLVMContext& context, TypeID id) : context(context), id(id), size(0), element(NULL), literal(true), opaque(false), pointerTo(NULL) {}
+        friend class LLVMContext;
+    };
+
+    class IntegerType : public Type {
+    protected:
+        IntegerType(LLVMContext& context) : Type(context, IntegerTyID) {}
+        friend class LLVMContext;
+    };
+
+    class PointerType : public Type {
+    public:
+        static PointerType* getUnqual(Type* element);
+    protected:
+        PointerType(LLVMContext& context) : Type(context, PointerTyID) {}
+        friend class LLVMContext;
+    };
+
+    class ArrayType : public Type {
+    public:
+        static ArrayType* get(Type* element, uint64_t count);
+    protected:
+        ArrayType(LLVMContext& context) : Type(context, ArrayTyID) {}
+        friend class LLVMContext;
+    };
+
+    class StructType : public Type {
+    public:
+        static StructType* create(LLVMContext&, const std::string& name);
+        static StructType* get(LLVMContext&, const std::vector<Type*>& elements);
+        void setBody(const std::vector<Type*>& elements);
+    protected:
+        StructType(LLVMContext& context) : Type(context, StructTyID) {}
+        friend class LLVMContext;
+    };
+
+    class FunctionType : public Type {
+    public:
+        static FunctionType* get(Type* returnType, const std::vector<Type*>& params, bool isVarArg);
+        Type* getReturnType() const { return element; }
+        unsigned getNumParams() const { return elements.size(); }
+        Type* getParamType(unsigned i) const { return elements[i]; }
+    protected:
+        FunctionType(LLVMContext& context) : Type(context, FunctionTyID) {}
+        friend class LLVMContext;
+    };
+
+    // -------------------------- VALUES -------------------------- //
+
+    enum ValueKind {
+        ArgumentVal, BasicBlockVal, FunctionVal, GlobalVariableVal,
+        ConstantIntVal, ConstantFPVal, ConstantNullVal, ConstantDataArrayVal, ConstantStructVal, ConstantExprVal, InstructionVal
+    };
+
+    class Value {
+    public:
+        Type* getType() const { return type; }
+        ValueKind getValueKind() const { return kind; }
+        const std::string& getName() const { return name; }
+        void setName(const std::string& name) { this->name = name; }
+        virtual ~Value() {}
+
+        ValueKind kind;
+        Type* type;
+        std::string name;
+    protected:
+        Value(ValueKind kind, Type* type) : kind(kind), type(type) {}
+    };
+
+    class Constant : public Value {
+    public:
+        static Constant* getNullValue(Type*);
+        bool isGlobalValue() const { return kind == FunctionVal || kind == GlobalVariableVal; }
+    protected:
+        Constant(ValueKind kind, Type* type) : Value(kind, type) {}
+    };
+
+    class ConstantInt : public Constant {
+    public:
+        static ConstantInt* get(Type*, uint64_t value, bool isSigned = false);
+        int64_t value; //sign-extended from the width of the type.
+    protected:
+        ConstantInt(Type* type, int64_t value) : Constant(ConstantIntVal, type), value(value) {}
+        friend class LLVMContext;
+    };
+
+    class ConstantFP : public Constant {
+    public:
+        static Constant* get(Type*, double value);
+        double value;
+    protected:
+        ConstantFP(Type* type, double value) : Constant(ConstantFPVal, type), value(value) {}
+        friend class LLVMContext;
+    };
+
+    class ConstantPointerNull : public Constant {
+    public:
+        static ConstantPointerNull* get(PointerType*);
+    protected:
+        ConstantPointerNull(Type* type) : Constant(ConstantNullVal, type) {}
+        friend class LLVMContext;
+    };
+
+    class ConstantDataArray : public Constant {
+    public:
+        static Constant* getString(LLVMContext&, const std::string& string, bool addNull = true);
+        std::string data;
+    protected:
+        ConstantDataArray(Type* type, const std::string& data) : Constant(ConstantDataArrayVal, type), data(data) {}
+        friend class LLVMContext;
+    };
+
+    class ConstantStruct : public Constant {
+    public:
+        static Constant* get(StructType*, const std::vector<Constant*>& elements);
+        std::vector<Constant*> elements;
+    protected:
+        ConstantStruct(Type* type, const std::vector<Constant*>& elements) : Constant(ConstantStructVal, type), elements(elements) {}
+        friend class LLVMContext;
+    };
+
+    class ConstantArray : public Constant { //shares the aggregate representation of ConstantStruct.
+    public:
+        static Constant* get(ArrayType*, const std::vector<Constant*>& elements);
+    };
+
+    class ConstantExpr : public Constant { //only the casts of globals that initializers need.
+    public:
+        static Constant* getBitCast(Constant*, Type*);
+        Constant* operand;
+    protected:
+        ConstantExpr(Type* type, Constant* operand) : Constant(ConstantExprVal, type), operand(operand) {}
+        friend class LLVMContext;
+    };
+
+    struct MaybeAlign {
+        explicit MaybeAlign(unsigned value) : value(value) {}
+        unsigned value;
+    };
+
+    class GlobalValue : public Constant {
+    public:
+        enum LinkageTypes {
+            ExternalLinkage, InternalLinkage, PrivateLinkage, CommonLinkage
+        };
+
+        enum class UnnamedAddr {
+            None, Local, Global
+        };
+
+        void setLinkage(LinkageTypes linkage) { this->linkage = linkage; }
+        void setUnnamedAddr(UnnamedAddr unnamedAddr) { this->unnamedAddr = unnamedAddr; }
+        Type* getValueType() const { return valueType; }
+        Module* getParent() const { return parent; }
+
+        LinkageTypes linkage;
+        UnnamedAddr unnamedAddr;
+        Type* valueType;
+        Module* parent;
+    protected:
+        GlobalValue(ValueKind kind, Type* valueType, LinkageTypes linkage, Module* parent);
+    };
+
+    class GlobalVariable : public GlobalValue {
+    public:
+        GlobalVariable(Module&, Type* valueType, bool isConstant, LinkageTypes, Constant* initializer, const std::string& name);
+        void setInitializer(Constant* initializer) { this->initializer = initializer; }
+        void setAlignment(MaybeAlign alignment) { this->alignment = alignment.value; }
+
+        bool constant;
+        Constant* initializer;
+        unsigned alignment;
+    };
+
+    class Argument : public Value {
+    public:
+        Argument(Type* type, Function* parent, unsigned argNo) : Value(ArgumentVal, type), parent(parent), argNo(argNo) {}
+        Function* parent;
+        unsigned argNo;
+    };
+
+    class Attribute {
+    public:
+        enum AttrKind { //values are the attribute kind codes of the bitcode format.
+            Nest = 8, NoAlias = 9, NoInline = 14, NoUnwind = 18, ReadNone = 20, ReadOnly = 21, OptimizeNone = 37, NonNull = 39, Dereferenceable = 41
+        };
+
+        enum AttrIndex {
+            ReturnIndex = 0, FirstArgIndex = 1, FunctionIndex = ~0U
+        };
+    };
+
+    class Instruction : public Value {
+    public:
+        enum Opcode {
+            Ret, Br, FNeg, Add, FAdd, Sub, FSub, Mul, FMul, SDiv, FDiv, SRem, FRem, Xor,
+            Alloca, Load, Store, GetElementPtr, Trunc, SExt, FPToSI, SIToFP, PtrToInt, BitCast, ICmp, FCmp, PHI, Call
+        };
+
+        Instruction(Opcode opcode, Type* type) : Value(InstructionVal, type), opcode(opcode), explicitType(NULL), predicate(0), inBounds(false), callingConv(0), tailCallKind(0), parent(NULL) {}
+        bool isTerminator() const { return opcode == Ret || opcode == Br; }
+        BasicBlock* getParent() const { return parent; }
+
+        Opcode opcode;
+        std::vector<Value*> operands; //calls keep the callee in front of the arguments.
+        std::vector<BasicBlock*> blocks; //successors of branches, incoming blocks of phis.
+        Type* explicitType; //allocated type of allocas, source element type of GEPs, function type of calls.
+        unsigned predicate; //compare predicates use the bitcode encoding directly.
+        bool inBounds;
+        unsigned callingConv;
+        unsigned tailCallKind;
+        BasicBlock* parent;
+    };
+
+    class PHINode : public Instruction {
+    public:
+        PHINode(Type* type) : Instruction(PHI, type) {}
+
+        void addIncoming(Value* value, BasicBlock* block) {
+            operands.push_back(value);
+            blocks.push_back(block);
+        }
+    };
+
+    class CallInst : public Instruction {
+    public:
+        enum TailCallKind { TCK_None, TCK_Tail, TCK_MustTail };
+
+        CallInst(Type* type) : Instruction(Call, type) {}
+        void setCallingConv(unsigned callingConv) { this->callingConv = callingConv; }
+        void setTailCallKind(TailCallKind kind) { tailCallKind = kind; }
+        void setDoesNotAccessMemory() { addFnAttr(Attribute::ReadNone); }
+        void setOnlyReadsMemory() { addFnAttr(Attribute::ReadOnly); }
+        void addFnAttr(Attribute::AttrKind kind) { attributes[Attribute::FunctionIndex].insert(attributes[Attribute::FunctionIndex].end(), {0, kind}); }
+
+        std::map<unsigned, std::vector<uint64_t> > attributes; //as a function's.
+    };
+
+    class BasicBlock : public Value {
+    public:
+        static BasicBlock* Create(LLVMContext&, const std::string& name = "", Function* parent = NULL);
+        Instruction* getTerminator() const;
+        Function* getParent() const { return parent; }
+        ~BasicBlock();
+
+        std::vector<Instruction*> instructions;
+        Function* parent;
+    protected:
+        BasicBlock(Type* label) : Value(BasicBlockVal, label), parent(NULL) {}
+    };
+
+    namespace CallingConv {
+        typedef unsigned ID;
+
+        enum {
+            C = 0, Fast = 8
+        };
+    }
+
+    class Function : public GlobalValue {
+    public:
+        typedef std::vector<Argument>::iterator arg_iterator;
+
+        static Function* Create(FunctionType*, LinkageTypes, const std::string& name, Module*);
+        FunctionType* getFunctionType() const { return (FunctionType*) valueType; }
+        void setCallingConv(CallingConv::ID callingConv) { this->callingConv = callingConv; }
+        CallingConv::ID getCallingConv() const { return callingConv; }
+        void addFnAttr(Attribute::AttrKind kind) { addAttribute(Attribute::FunctionIndex, kind); }
+        void setDoesNotAccessMemory() { addFnAttr(Attribute::ReadNone); }
+        void setOnlyReadsMemory() { addFnAttr(Attribute::ReadOnly); }
+        void addRetAttr(Attribute::AttrKind kind) { addAttribute(Attribute::ReturnIndex, kind); }
+        void addParamAttr(unsigned argNo, Attribute::AttrKind kind) { addAttribute(Attribute::FirstArgIndex + argNo, kind); }
+        void addDereferenceableParamAttr(unsigned argNo, uint64_t bytes);
+        Argument* getArg(unsigned i) { return &arguments[i]; }
+        arg_iterator arg_begin() { return arguments.begin(); }
+        arg_iterator arg_end() { return arguments.end(); }
+        bool isDeclaration() const { return blocks.empty(); }
+        ~Function();
+
+        std::vector<Argument> arguments;
+        std::vector<BasicBlock*> blocks;
+        std::map<unsigned, std::vector<uint64_t> > attributes; //by attribute index, encoded as in attribute group records.
+        CallingConv::ID callingConv;
+    protected:
+        Function(FunctionType*, LinkageTypes, Module*);
+        void addAttribute(unsigned index, Attribute::AttrKind kind);
+    };
+
+    class Module {
+    public:
+        Module(const std::string& name, LLVMContext& context) : context(context), name(name) {}
+        Function* getFunction(const std::string& name) const;
+        LLVMContext& getContext() const { return context; }
+        std::string uniqueName(const std::string& name); //renames clashing symbols like LLVM's symbol table does.
+        ~Module();
+
+        LLVMContext& context;
+        std::string name;
+        std::vector<GlobalVariable*> globals;
+        std::vector<Function*> functions;
+        std::map<std::string, unsigned> symbols;
+        std::map<std::string, Function*> functionNames;
+    };
+
+    class LLVMContext {
+    public:
+        LLVMContext();
+        ~LLVMContext();
+
+        Type* getType(TypeID, uint64_t size, Type* element, const std::vector<Type*>& elements);
+        StructType* createNamedStruct(const std::string& name);
+        ConstantInt* getConstantInt(Type*, int64_t value);
+        ConstantFP* getConstantFP(Type*, double value);
+        Constant* getNullValue(Type*);
+        Constant* getString(const std::string& data);
+        Constant* getStruct(Type*, const std::vector<Constant*>& elements);
+        Constant* getBitCast(Constant*, Type*);
+        void enableOpaquePointers(); //every pointer type becomes the single "ptr", as in LLVM 15 onwards.
+
+        Type* opaquePointerTy;
+        Type* voidTy, * labelTy, * doubleTy, * int1Ty, * int8Ty, * int16Ty, * int32Ty, * int64Ty;
+    private:
+        std::map<std::vector<uintptr_t>, Type*> types;
+        std::vector<Type*> namedStructs;
+        std::map<std::pair<Type*, int64_t>, ConstantInt*> ints;
+        std::map<std::pair<Type*, uint64_t>, ConstantFP*> decimals; //keyed by bit pattern, so 0.0 and -0.0 stay apart.
+        std::map<Type*, Constant*> nulls;
+        std::vector<Constant*> strings;
+        std::vector<Constant*> aggregates; //structs, arrays and constant expressions, none is uniqued.
+    };
+
+    // -------------------------- BUILDER -------------------------- //
+
+    class IRBuilder {
+    public:
+        class InsertPoint {
+        public:
+            InsertPoint(BasicBlock* block = NULL) : block(block) {}
+            BasicBlock* getBlock() const { return block; }
+        private:
+            BasicBlock* block;
+        };
+
+        IRBuilder(LLVMContext& context) : context(context), block(NULL) {}
+
+        Type* getVoidTy() { return context.voidTy; }
+        Type* getDoubleTy() { return context.doubleTy; }
+        Type* getInt1Ty() { return context.int1Ty; }
+        Type* getInt8Ty() { return context.int8Ty; }
+        Type* getInt16Ty() { return context.int16Ty; }
+        Type* getInt32Ty() { return context.int32Ty; }
+        Type* getInt64Ty() { return context.int64Ty; }
+        ConstantInt* getInt1(bool value) { return ConstantInt::get(getInt1Ty(), value); }
+        ConstantInt* getInt8(uint8_t value) { return ConstantInt::get(getInt8Ty(), value); }
+        ConstantInt* getInt32(uint32_t value) { return ConstantInt::get(getInt32Ty(), value); }
+
+        BasicBlock* GetInsertBlock() const { return block; }
+        void SetInsertPoint(BasicBlock* block) { this->block = block; }
+        InsertPoint saveIP() const { return InsertPoint(block); }
+        void restoreIP(InsertPoint ip) { block = ip.getBlock(); }
+
+        Instruction* CreateRetVoid();
+        Instruction* CreateRet(Value*);
+        Instruction* CreateBr(BasicBlock*);
+        Instruction* CreateCondBr(Value*, BasicBlock* iftrue, BasicBlock* iffalse);
+
+        Value* CreateAdd(Value* a, Value* b) { return binary(Instruction::Add, a, b); }
+        Value* CreateSub(Value* a, Value* b) { return binary(Instruction::Sub, a, b); }
+        Value* CreateMul(Value* a, Value* b) { return binary(Instruction::Mul, a, b); }
+        Value* CreateSDiv(Value* a, Value* b) { return binary(Instruction::SDiv, a, b); }
+        Value* CreateSRem(Value* a, Value* b) { return binary(Instruction::SRem, a, b); }
+        Value* CreateXor(Value* a, Value* b) { return binary(Instruction::Xor, a, b); }
+        Value* CreateFAdd(Value* a, Value* b) { return binary(Instruction::FAdd, a, b); }
+        Value* CreateFSub(Value* a, Value* b) { return binary(Instruction::FSub, a, b); }
+        Value* CreateFMul(Value* a, Value* b) { return binary(Instruction::FMul, a, b); }
+        Value* CreateFDiv(Value* a, Value* b) { return binary(Instruction::FDiv, a, b); }
+        Value* CreateFRem(Value* a, Value* b) { return binary(Instruction::FRem, a, b); }
+        Value* CreateFNeg(Value*);
+
+        Value* CreateICmpEQ(Value* a, Value* b) { return compare(Instruction::ICmp, 32, a, b); }
+        Value* CreateICmpNE(Value* a, Value* b) { return compare(Instruction::ICmp, 33, a, b); }
+        Value* CreateICmpSGT(Value* a, Value* b) { return compare(Instruction::ICmp, 38, a, b); }
+        Value* CreateICmpSGE(Value* a, Value* b) { return compare(Instruction::ICmp, 39, a, b); }
+        Value* CreateICmpSLT(Value* a, Value* b) { return compare(Instruction::ICmp, 40, a, b); }
+        Value* CreateICmpSLE(Value* a, Value* b) { return compare(Instruction::ICmp, 41, a, b); }
+        Value* CreateFCmpOEQ(Value* a, Value* b) { return compare(Instruction::FCmp, 1, a, b); }
+        Value* CreateFCmpOGT(Value* a, Value* b) { return compare(Instruction::FCmp, 2, a, b); }
+        Value* CreateFCmpOGE(Value* a, Value* b) { return compare(Instruction::FCmp, 3, a, b); }
+        Value* CreateFCmpOLT(Value* a, Value* b) { return compare(Instruction::FCmp, 4, a, b); }
+        Value* CreateFCmpOLE(Value* a, Value* b) { return compare(Instruction::FCmp, 5, a, b); }
+        Value* CreateFCmpUNE(Value* a, Value* b) { return compare(Instruction::FCmp, 14, a, b); }
+
+        Value* CreateTrunc(Value* v, Type* type) { return cast(Instruction::Trunc, v, type); }
+        Value* CreateSExt(Value* v, Type* type) { return cast(Instruction::SExt, v, type); }
+        Value* CreateFPToSI(Value* v, Type* type) { return cast(Instruction::FPToSI, v, type); }
+        Value* CreateSIToFP(Value* v, Type* type) { return cast(Instruction::SIToFP, v, type); }
+        Value* CreatePtrToInt(Value* v, Type* type) { return cast(Instruction::PtrToInt, v, type); }
+        Value* CreateBitCast(Value* v, Type* type) { return cast(Instruction::BitCast, v, type); }
+
+        Value* CreateAlloca(Type*, Value* arraySize = NULL, const std::string& name = "");
+        Value* CreateLoad(Type*, Value* pointer);
+        Instruction* CreateStore(Value* value, Value* pointer);
+        Value* CreateGEP(Type* source, Value* pointer, Value* index);
+        Value* CreateGEP(Type* source, Value* pointer, const std::vector<Value*>& indices);
+        Value* CreateInBoundsGEP(Type* source, Value* pointer, const std::vector<Value*>& indices);
+        Value* CreateStructGEP(Type* source, Value* pointer, unsigned index);
+        CallInst* CreateCall(FunctionType*, Value* callee, const std::vector<Value*>& arguments);
+        PHINode* CreatePHI(Type*, unsigned reservedValues);
+        CallInst* CreateLifetimeStart(Value* pointer, ConstantInt* size = NULL) { return lifetime("llvm.lifetime.start", pointer, size); }
+        CallInst* CreateLifetimeEnd(Value* pointer, ConstantInt* size = NULL) { return lifetime("llvm.lifetime.end", pointer, size); }
+        CallInst* CreateMemCpy(Value* destination, MaybeAlign, Value* source, MaybeAlign, Value* size);
+        CallInst* CreateMemSet(Value* destination, Value* value, Value* size, MaybeAlign);
+    private:
+        Instruction* insert(Instruction*);
+        Value* binary(Instruction::Opcode, Value* a, Value* b);
+        Value* compare(Instruction::Opcode, unsigned predicate, Value* a, Value* b);
+        Value* cast(Instruction::Opcode, Value* v, Type* type);
+        Value* gep(Type* source, Value* pointer, const std::vector<Value*>& indices, bool inBounds);
+        CallInst* lifetime(const std::string& intrinsic, Value* pointer, ConstantInt* size);
+
+        LLVMContext& context;
+        BasicBlock* block;
+    };
+
+    void WriteBitcodeToFile(const Module&, FILE* out);
+}
+
+#endif	/* BITCODEWRITER_HPP */
@@ -4,9 +4,10 @@
  */
 
 #include "ParserNodes.h"
+#include "MemReport.h"
 
 static BlockList* allocBlockList(void) {
-    BlockList* node = (BlockList*) malloc(sizeof(BlockList));
+    BlockList* node = (BlockList*) memAlloc(MC_LIST_NODES, sizeof(BlockList));
 
     if (node == NULL)
         PANIC_OR_RETURN_NULL;
@@ -33,5 +34,5 @@ void deleteBlockList(BlockList* node) {
 
     deleteStatementNode(node->statement);
     deleteBlockList(node->next);
-    free(node);
+    memFree(node);
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "ParserEnums.h"
 #include "LexerUtilities.h"
+#include "MemReport.h"
 #include "CheshireParser.yy.h"
 #include "CheshireLexer.yy.h"
 
@@ -16,7 +17,7 @@ char* createDummyName(const char* prefix) {
     temp[99] = '\0';
 
     int stringlen = strlen(temp);
-    char* cpystring = malloc(sizeof(char) * (stringlen+1));
+    char* cpystring = memAlloc(MC_IDENTIFIERS, sizeof(char) * (stringlen+1));
     memcpy(cpystring, temp, stringlen);
     cpystring[stringlen] = '\0';
     return cpystring;
@@ -69,6 +70,7 @@ typedef void* yyscan_t;
 %token TOK_GLOBAL
 %token TOK_CLASS
 %token TOK_INHERITS
+%token TOK_FINAL
 %token TOK_DEFINE
 %token TOK_IF
 %token TOK_ELSE
@@ -131,6 +133,7 @@ typedef void* yyscan_t;
 %nonassoc TOK_LPAREN TOK_RPAREN
 
 %type <string> possible_objectname
+%type <string> identifier
 %type <expression> expression
 %type <expression> lval_expression
 %type <expression> expression_statement
@@ -153,13 +156,15 @@ typedef void* yyscan_t;
 %%
 
 input
-    : TOK_EXTERNAL TOK_DEFINE typename TOK_IDENTIFIER parameter_list TOK_LN  { *output = createMethodDeclaration( $3 , $4 , $5 ); YYACCEPT; }
+    : TOK_EXTERNAL TOK_DEFINE typename identifier parameter_list TOK_LN  { *output = createMethodDeclaration( $3 , $4 , $5 ); YYACCEPT; }
     | TOK_FWDECL possible_objectname TOK_LN  { reserveClassNameType( $2 ); *output = NULL; YYACCEPT; }
-    | TOK_DEFINE typename TOK_IDENTIFIER parameter_list block_or_pass  { *output = createMethodDefinition( $2 , $3 , $4 , $5 ); YYACCEPT; }
-    | TOK_EXTERNAL typename TOK_IDENTIFIER TOK_LN  { *output = createGlobalVariableDeclaration( $2 , $3 ); YYACCEPT; }
-    | TOK_GLOBAL typename TOK_IDENTIFIER TOK_LN  { *output = createGlobalVariableDefinition( $2 , $3 ); YYACCEPT; }
-    | TOK_CLASS possible_objectname class_list_or_pass  { CheshireType object = getNamedType("Object"); *output = createClassDefinition( $2 , $3 , object ); YYACCEPT; }
-    | TOK_CLASS possible_objectname TOK_INHERITS typename class_list_or_pass  { *output = createClassDefinition( $2 , $5 , $4 ); YYACCEPT; }
+    | TOK_DEFINE typename identifier parameter_list block_or_pass  { *output = createMethodDefinition( $2 , $3 , $4 , $5 ); YYACCEPT; }
+    | TOK_EXTERNAL typename identifier TOK_LN  { *output = createGlobalVariableDeclaration( $2 , $3 ); YYACCEPT; }
+    | TOK_GLOBAL typename identifier TOK_LN  { *output = createGlobalVariableDefinition( $2 , $3 ); YYACCEPT; }
+    | TOK_CLASS possible_objectname class_list_or_pass  { CheshireType object = getNamedType("Object"); *output = createClassDefinition( $2 , $3 , object , FALSE ); YYACCEPT; }
+    | TOK_CLASS possible_objectname TOK_INHERITS typename class_list_or_pass  { *output = createClassDefinition( $2 , $5 , $4 , FALSE ); YYACCEPT; }
+    | TOK_FINAL TOK_CLASS possible_objectname class_list_or_pass  { CheshireType object = getNamedType("Object"); *output = createClassDefinition( $3 , $4 , object , TRUE ); YYACCEPT; }
+    | TOK_FINAL TOK_CLASS possible_objectname TOK_INHERITS typename class_list_or_pass  { *output = createClassDefinition( $3 , $6 , $5 , TRUE ); YYACCEPT; }
     | TOK_EOF  { return -2; }
     ;
 
@@ -178,8 +183,9 @@ class_list
     ;
 
 class_list_contains
-    : typename TOK_IDENTIFIER TOK_SET expression TOK_LN class_list_contains  { $$ = linkClassVariable( $1 , $2 , $4 , $6 ); }
-    | TOK_DEFINE typename TOK_IDENTIFIER parameter_list block_or_pass class_list_contains  { $$ = linkClassMethod( $2 , $4 , $3 , $5 , $6 ); }
+    : typename identifier TOK_SET expression TOK_LN class_list_contains  { $$ = linkClassVariable( $1 , $2 , $4 , $6 ); }
+    | TOK_DEFINE typename identifier parameter_list block_or_pass class_list_contains  { $$ = linkClassMethod( $2 , $4 , $3 , $5 , FALSE , $6 ); }
+    | TOK_DEFINE TOK_FINAL typename identifier parameter_list block_or_pass class_list_contains  { $$ = linkClassMethod( $3 , $5 , $4 , $6 , TRUE , $7 ); }
     | TOK_DEFINE TOK_NEW parameter_list TOK_INHERITS expression_list block_or_pass class_list_contains { $$ = linkClassConstructor( $3 , $5, $6 , $7 ); }
     | TOK_DEFINE TOK_NEW parameter_list block_or_pass class_list_contains { $$ = linkClassConstructor( $3 , NULL , $4 , $5 ); }
     | TOK_RBRACE  { $$ = NULL; }
@@ -192,9 +198,9 @@ parameter_list
 
 parameter_list_contains
     : typename  { $$ = linkParameterList( $1 , createDummyName("param") , NULL ); }
-    | typename TOK_IDENTIFIER  { $$ = linkParameterList( $1 , $2 , NULL ); }
+    | typename identifier  { $$ = linkParameterList( $1 , $2 , NULL ); }
     | typename TOK_COMMA parameter_list_contains  { $$ = linkParameterList( $1 , createDummyName("param") , $3 ); }
-    | typename TOK_IDENTIFIER TOK_COMMA parameter_list_contains  { $$ = linkParameterList( $1 , $2 , $4 ); }
+    | typename identifier TOK_COMMA parameter_list_contains  { $$ = linkParameterList( $1 , $2 , $4 ); }
     ;
 
 named_parameter_list
@@ -203,8 +209,8 @@ named_parameter_list
     ;
 
 named_parameter_list_contains
-    : typename TOK_IDENTIFIER  { $$ = linkParameterList( $1 , $2 , NULL ); }
-    | typename TOK_IDENTIFIER TOK_COMMA parameter_list_contains  { $$ = linkParameterList( $1 , $2 , $4 ); }
+    : typename identifier  { $$ = linkParameterList( $1 , $2 , NULL ); }
+    | typename identifier TOK_COMMA parameter_list_contains  { $$ = linkParameterList( $1 , $2 , $4 ); }
     ;
 
 block_or_pass
@@ -215,15 +221,16 @@ block_or_pass
 statement
     : expression_statement TOK_LN  { $$ = createExpressionStatement( $1 ); }
     | TOK_ASSERT expression TOK_LN  { $$ = createAssertionStatement( $2 ); }
-    | typename TOK_IDENTIFIER TOK_SET expression TOK_LN  { $$ = createVariableDefinition( $1 , $2 , $4 ); }
-    | TOK_DEFINE typename TOK_IDENTIFIER parameter_list block_or_pass { $$ = createInferDefinition( $3 , createClosureNode( $2 , $4 , $5 ) ); }
-    | TOK_INFER TOK_IDENTIFIER TOK_SET expression TOK_LN  { $$ = createInferDefinition( $2 , $4 ); }
+    | typename identifier TOK_SET expression TOK_LN  { $$ = createVariableDefinition( $1 , $2 , $4 ); }
+    | TOK_DEFINE typename identifier parameter_list block_or_pass { $$ = createInferDefinition( $3 , createClosureNode( $2 , $4 , $5 ) ); }
+    | TOK_INFER identifier TOK_SET expression TOK_LN  { $$ = createInferDefinition( $2 , $4 ); }
     | block  { $$ = createBlockStatement( $1 ); }
     | TOK_IF TOK_LPAREN expression TOK_RPAREN statement_or_pass TOK_ELSE statement_or_pass %prec P_IFELSE  { $$ = createIfElseStatement( $3 , $5 , $7 ); }
     | TOK_IF TOK_LPAREN expression TOK_RPAREN statement_or_pass %prec P_IF  { $$ = createIfStatement( $3 , $5 ); }
     | TOK_WHILE TOK_LPAREN expression TOK_RPAREN statement_or_pass  { $$ = createWhileStatement( $3 , $5 ); }
     | TOK_RETURN expression TOK_LN  { $$ = createReturnStatement( $2 ); }
     | TOK_RETURN TOK_LN  { $$ = createReturnStatement( createReservedLiteralNode(RL_NULL) ); }
+    | TOK_DELETE expression TOK_LN  { $$ = createDeleteStatement( $2 ); }
     ;
 
 statement_or_pass
@@ -240,6 +247,11 @@ block_contains
     | TOK_RBRACE  { $$ = NULL; }
     ;
 
+identifier
+    : TOK_IDENTIFIER  { $$ = $1 ; }
+    | TOK_FINAL  { $$ = saveIdentifierReturn("final"); } /* only reserved in class and method headers. */
+    ;
+
 expression
     : expression_statement  { $$ = $1 ; }
     | lval_expression  { $$ = dereferenceExpression( $1 ); }
@@ -269,16 +281,16 @@ expression
     ;
 
 lval_expression
-    : TOK_IDENTIFIER  { $$ = createVariableAccess( $1 ); }
+    : identifier  { $$ = createVariableAccess( $1 ); }
     | expression TOK_LBRACKET expression TOK_RBRACKET  { $$ = createBinOperation( OP_ARRAY_ACCESS , $1 , $3 ); }
-    | expression TOK_COLON TOK_IDENTIFIER { $$ = createAccessNode( $1 , $3 ); }
+    | expression TOK_COLON identifier { $$ = createAccessNode( $1 , $3 ); }
     ;
 
 expression_statement
     : lval_expression TOK_SET expression  { $$ = createBinOperation( OP_SET , $1 , $3 ); }
     | lval_expression TOK_INCREMENT  { $$ = createIncrementOperation( $1 , $2 ); }
     | expression expression_list  { $$ = createMethodCall( $1 , $2 ); }
-    | expression TOK_COLONCOLON TOK_IDENTIFIER expression_list  { $$ = createObjectCall( $1 , $3 , $4 ); }
+    | expression TOK_COLONCOLON identifier expression_list  { $$ = createObjectCall( $1 , $3 , $4 ); }
     ;
 
 expression_list
@@ -4,9 +4,10 @@
  */
 
 #include "ParserNodes.h"
+#include "MemReport.h"
 
 static ClassList* allocClassList(void) {
-    ClassList* node = (ClassList*) malloc(sizeof(ClassList));
+    ClassList* node = (ClassList*) memAlloc(MC_LIST_NODES, sizeof(ClassList));
     
     if (node == NULL)
         PANIC_OR_RETURN_NULL;
@@ -28,7 +29,7 @@ ClassList* linkClassVariable(CheshireType type, char* name, ExpressionNode* defa
     return node;
 }
 
-ClassList* linkClassMethod(CheshireType returnType, ParameterList* params, char* name, BlockList* block, ClassList* next) {
+ClassList* linkClassMethod(CheshireType returnType, ParameterList* params, char* name, BlockList* block, Boolean final, ClassList* next) {
     ClassList* node = allocClassList();
     
     if (node == NULL)
@@ -39,6 +40,7 @@ ClassList* linkClassMethod(CheshireType returnType, ParameterList* params, char*
     node->method.params = params;
     node->method.block = block;
     node->method.name = name;
+    node->method.final = final;
     node->next = next;
     return node;
 }
@@ -63,11 +65,11 @@ void deleteClassList(ClassList* node) {
     
     switch (node->type) {
         case CLT_VARIABLE:
-            free(node->variable.name);
+            memFree(node->variable.name);
             deleteExpressionNode(node->variable.defaultValue);
             break;
         case CLT_METHOD:
-            free(node->method.name);
+            memFree(node->method.name);
             deleteBlockList(node->method.block);
             deleteParameterList(node->method.params);
             break;
@@ -78,5 +80,5 @@ void deleteClassList(ClassList* node) {
     }
     
     deleteClassList(node->next);
-    free(node);
+    memFree(node);
 }
\ No newline at end of file
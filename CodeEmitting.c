@@ -3,12 +3,17 @@
  * Implements:
  */
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include "CodeEmitting.h"
 #include "TypeSystem.h"
 #include "ParserEnums.h"
 #include "Structures.h"
+#include "MemReport.h"
+#include "MidLevelIR.h"
+#include "Escape.h"
+#include "DeadCode.h"
 
 #define PRINT(str, args...) fprintf(out, str , ##args)
 
@@ -58,9 +63,156 @@
         PRINT("\n"); \
     }
 
+#define LABEL(id) \
+    { \
+        PRINT("label%d:\n", id); \
+        current_label = id; \
+    }
+
 #define UNIQUE_IDENTIFIER (unique_identifier++)
 
+#ifndef CHESHIRE_OPAQUE_POINTERS
+#define CHESHIRE_OPAQUE_POINTERS TRUE
+#endif
+
+#define TRAMPOLINE_SIZE 32 //bytes llvm.init.trampoline may write, enough for x86-64 and AArch64.
+
 static int unique_identifier = 0;
+static int current_label = -1; //label of the block being emitted, for phi predecessors.
+static int runtime_declarations = 0;
+static Boolean opaque_pointers = CHESHIRE_OPAQUE_POINTERS;
+static int optimization_level = DEFAULT_OPTIMIZATION_LEVEL;
+
+void setOpaquePointers(Boolean opaque) {
+    opaque_pointers = opaque;
+}
+
+Boolean usingOpaquePointers(void) {
+    return opaque_pointers;
+}
+
+void setOptimizationLevel(int level) {
+    optimization_level = level;
+}
+
+int getOptimizationLevel(void) {
+    return optimization_level;
+}
+
+const char* getFunctionAttributes(MemoryEffects effects) { //Cheshire has no exceptions, so nothing unwinds.
+    if (getGarbageCollection()) //every function may collect, see setGarbageCollection.
+        return optimization_level == 0 ? " noinline nounwind optnone gc \"shadow-stack\"" : " nounwind gc \"shadow-stack\"";
+
+    if (optimization_level == 0)
+        return " noinline nounwind optnone";
+
+    if (effects == 0)
+        return " nounwind readnone";
+
+    return effects == ME_READS ? " nounwind readonly" : " nounwind";
+}
+
+void emitSelfAttributes(FILE* out, CheshireType type) {
+    if (optimization_level == 0)
+        return;
+
+    int size = getObjectSize(type);
+    PRINT(size > 0 ? " nonnull dereferenceable(%d)" : " nonnull", size);
+}
+
+void emitPointerType(FILE* out, CheshireType type) { //pointer to a value of the given type, e.g. for load and store.
+    if (opaque_pointers) {
+        PRINT("ptr");
+    } else {
+        emitType(out, type);
+        PRINT("*");
+    }
+}
+
+void emitNamedPointerType(FILE* out, const char* type) {
+    if (opaque_pointers) {
+        PRINT("ptr");
+    } else {
+        PRINT("%s*", type);
+    }
+}
+
+int newUniqueIdentifier(void) {
+    return UNIQUE_IDENTIFIER;
+}
+
+static void emitTypeDescriptorType(FILE* out) {
+    if (getGarbageCollection()) //the pointer map, at the same offset in every module, instead of @_Delete_.
+        PRINT("%%_TypeDescriptor = type {i32, %s, [%d x %s]}\n\n", opaque_pointers ? "ptr" : "i8*", getDisplaySize(), opaque_pointers ? "ptr" : "%_TypeDescriptor*");
+    else
+        PRINT("%%_TypeDescriptor = type {i32, [%d x %s], %s}\n\n", getDisplaySize(), opaque_pointers ? "ptr" : "%_TypeDescriptor*", opaque_pointers ? "ptr" : "void (i8*)*");
+}
+
+void declareRuntime(int function) { //declarations go to a preamble, once per module.
+    if (runtime_declarations & function)
+        return;
+
+    runtime_declarations |= function;
+    const char* bytePointer = opaque_pointers ? "ptr" : "i8*";
+    FILE* out = newPreamble();
+
+    switch (function) {
+        case RUNTIME_MALLOC:
+            PRINT("declare noalias %s @malloc(i32) nounwind\n\n", bytePointer);
+            break;
+        case RUNTIME_ALLOC:
+            PRINT("declare noalias %s @_cheshire_alloc(i32) nounwind\n\n", bytePointer);
+            break;
+        case RUNTIME_NEW_STRING:
+            PRINT("declare %s @_New_String(%s, i32)\n\n", opaque_pointers ? "ptr" : "%_Class_String*", bytePointer);
+            break;
+        case RUNTIME_ASSERT:
+            PRINT("declare fastcc void @_Assert(i1)\n\n");
+            break;
+        case RUNTIME_TRAMPOLINE:
+            PRINT("declare void @llvm.init.trampoline(%s, %s, %s)\n\n", bytePointer, bytePointer, bytePointer);
+            PRINT("declare %s @llvm.adjust.trampoline(%s)\n\n", bytePointer, bytePointer);
+            break;
+        case RUNTIME_NEW_OBJECT:
+            PRINT("declare fastcc void @_New_Object(%s)\n\n", opaque_pointers ? "ptr" : "%_Class_Object*");
+            break;
+        case RUNTIME_LIFETIME: {
+            const char* suffix = opaque_pointers ? "p0" : "p0i8";
+            PRINT("declare void @llvm.lifetime.start.%s(i64, %s nocapture)\n\n", suffix, bytePointer);
+            PRINT("declare void @llvm.lifetime.end.%s(i64, %s nocapture)\n\n", suffix, bytePointer);
+        }
+        break;
+        case RUNTIME_TYPE_DESCRIPTOR:
+            emitTypeDescriptorType(out);
+            break;
+        case RUNTIME_MEMSET:
+            if (opaque_pointers)
+                PRINT("declare void @llvm.memset.p0.i32(ptr, i8, i32, i1)\n\n");
+            else
+                PRINT("declare void @llvm.memset.p0i8.i32(i8*, i8, i32, i1)\n\n");
+
+            break;
+        case RUNTIME_MEMCPY:
+            if (opaque_pointers)
+                PRINT("declare void @llvm.memcpy.p0.p0.i32(ptr, ptr, i32, i1)\n\n");
+            else
+                PRINT("declare void @llvm.memcpy.p0i8.p0i8.i32(i8*, i8*, i32, i1)\n\n");
+
+            break;
+        case RUNTIME_GC:
+            PRINT("@_cheshire_gc_next = external global %s\n", bytePointer);
+            PRINT("@_cheshire_gc_limit = external global %s\n\n", bytePointer);
+            PRINT("declare noalias %s @_cheshire_gc_allocate(i32) nounwind\n\n", bytePointer);
+            PRINT("declare void @_cheshire_gc_add_roots(%s, %s) nounwind\n\n", bytePointer, bytePointer);
+            PRINT("declare void @_cheshire_gc_add_closure(%s, %s, %s, %s) nounwind\n\n", bytePointer, bytePointer, bytePointer, bytePointer);
+            PRINT("declare void @llvm.gcroot(%s, %s)\n\n", opaque_pointers ? "ptr" : "i8**", bytePointer);
+            break;
+        case RUNTIME_CLASSES: //bodies are provided by the runtime.
+            PRINT("%%_Class_Object = type opaque\n\n");
+            PRINT("%%_Class_String = type opaque\n\n");
+            break;
+    }
+}
 
 
 static inline LLVMValue getIntegerLiteral(int64_t literal) {
@@ -133,7 +285,9 @@ static inline LLVMValue getClassMethodStorage(char* classname, char* methodname)
 }
 
 static inline LLVMValue getDefaultReturnType(CheshireType t) {
-    if (isBoolean(t) || isNumericalType(t)) {
+    if (isDecimal(t)) {
+        return getDecimalLiteral(0);
+    } else if (isBoolean(t) || isNumericalType(t)) {
         return getIntegerLiteral(0);
     } else {
         LLVMValue l;
@@ -142,49 +296,1231 @@ static inline LLVMValue getDefaultReturnType(CheshireType t) {
     }
 }
 
-static inline LLVMValue emitSizeOfClass(FILE* out, CheshireType t) {
+static inline LLVMValue emitSizeOfClass(FILE* out, CheshireType t) {
+    LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    LLVMValue intval = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    PRINT("    ");
+    emitValue(out, l);
+    PRINT(" = getelementptr ");
+    emitStructType(out, t);
+    PRINT(", ");
+    emitType(out, t);
+    PRINT(" null, i32 1\n");
+    PRINT("    ");
+    emitValue(out, intval);
+    PRINT(" = ptrtoint ");
+    emitType(out, t);
+    PRINT(" ");
+    emitValue(out, l);
+    PRINT(" to i32\n");
+    return intval;
+}
+
+//an i8* from the runtime's allocator of the size class, or from malloc if it has none.
+static LLVMValue emitAllocation(FILE* out, int sizeClass, LLVMValue size) {
+    LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    PRINT("    ");
+    emitValue(out, l);
+    PRINT(" = call ");
+    emitNamedPointerType(out, "i8");
+
+    if (sizeClass >= 0) {
+        declareRuntime(RUNTIME_ALLOC);
+        PRINT(" @_cheshire_alloc(i32 %d)\n", sizeClass);
+        return l;
+    }
+
+    declareRuntime(RUNTIME_MALLOC);
+    PRINT(" @malloc(i32 ");
+    emitValue(out, size);
+    PRINT(")\n");
+    return l;
+}
+
+static inline void emitNonTypecheckedUpcast(FILE* out, LLVMValue* parameterValue, CheshireType* parameterType, LLVMValue givenValue, CheshireType selfType, CheshireType superType) {
+    if (equalTypes(superType, selfType)) {
+        *parameterValue = givenValue;
+        *parameterType = selfType;
+    } else if (opaque_pointers) { //every object is a ptr, so there is nothing to cast.
+        *parameterValue = givenValue;
+        *parameterType = superType;
+    } else {
+        LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER);
+        PRINT("    ");
+        emitValue(out, l);
+        PRINT(" = bitcast ");
+        emitType(out, selfType);
+        PRINT(" ");
+        emitValue(out, givenValue);
+        PRINT(" to ");
+        emitType(out, superType);
+        PRINT("\n");
+        *parameterValue = l;
+        *parameterType = superType;
+    }
+}
+
+static void emitVTableType(FILE* out, CheshireType type) {
+    char* name = getNamedTypeString(type);
+    PRINT("%%_VTable_%s", name);
+    free(name);
+}
+
+//the offsets and nestings of the traced elements of a struct, the first of which are of the given types, as the
+//constant @<name>; with no struct type, of the one pointer at the address. Returns the number of entries.
+static int emitPointerMap(FILE* out, const char* name, const char* structType, CheshireType* types, int count) {
+    int entries = 0, emitted = 0, i;
+
+    for (i = 0; i < count; i++)
+        entries += isTracedType(types[i]);
+
+    PRINT("@%s = private constant {i32, [%d x {i32, i32}]} {i32 %d, [%d x {i32, i32}] ", name, entries, entries, entries);
+
+    if (entries == 0) {
+        PRINT("zeroinitializer}\n\n");
+        return 0;
+    }
+
+    PRINT("[");
+
+    for (i = 0; i < count; i++) {
+        if (!isTracedType(types[i]))
+            continue;
+
+        if (structType == NULL)
+            PRINT("{i32, i32} {i32 0");
+        else if (opaque_pointers)
+            PRINT("{i32, i32} {i32 ptrtoint (ptr getelementptr (%s, ptr null, i32 0, i32 %d) to i32)", structType, i);
+        else {
+            PRINT("{i32, i32} {i32 ptrtoint (");
+            emitPointerType(out, types[i]);
+            PRINT(" getelementptr (%s, %s* null, i32 0, i32 %d) to i32)", structType, structType, i);
+        }
+
+        PRINT(", i32 %d}%s", getTracedNesting(types[i]), ++emitted < entries ? ", " : "");
+    }
+
+    PRINT("]}\n\n");
+    return entries;
+}
+
+//the pointer to a map of the given number of entries, in a type descriptor or passed to _cheshire_gc_add_roots.
+static void emitPointerMapReference(FILE* out, const char* name, int entries) {
+    if (opaque_pointers)
+        PRINT("ptr @%s", name);
+    else
+        PRINT("i8* bitcast ({i32, [%d x {i32, i32}]}* @%s to i8*)", entries, name);
+}
+
+//the depth of a class, the descriptors of it and its ancestors by depth, and its @_Delete_; with garbage collection,
+//its depth, pointer map and display.
+static void emitTypeDescriptor(FILE* out, CheshireType classType) {
+    int depth = getClassDepth(classType), size = getDisplaySize(), i;
+    char** display = memAlloc(MC_EMITTER_TEMPORARIES, sizeof(char*) * size);
+    char* name = getNamedTypeString(classType);
+    CheshireType t = classType;
+
+    if (!(runtime_declarations & RUNTIME_TYPE_DESCRIPTOR)) { //not in a preamble: the initializer needs the type's body.
+        runtime_declarations |= RUNTIME_TYPE_DESCRIPTOR;
+        emitTypeDescriptorType(out);
+    }
+
+    for (i = depth; i >= 0; i--, t = getParentClass(t))
+        display[i] = getNamedTypeString(t);
+
+    char* map = NULL;
+    int entries = 0;
+
+    if (getGarbageCollection()) {
+        ClassShape* c;
+        int count = 0;
+
+        for (c = getClassShape(classType); c != NULL; c = c->next)
+            count++;
+
+        CheshireType* types = memAlloc(MC_EMITTER_TEMPORARIES, sizeof(CheshireType) * count);
+        char* structType = memAlloc(MC_EMITTER_TEMPORARIES, strlen(name) + 9);
+        map = memAlloc(MC_EMITTER_TEMPORARIES, strlen(name) + 13);
+        sprintf(structType, "%%_Class_%s", name);
+        sprintf(map, "_PointerMap_%s", name);
+
+        for (c = getClassShape(classType), i = 0; c != NULL; c = c->next, i++)
+            types[i] = c->type;
+
+        entries = emitPointerMap(out, map, structType, types, count);
+        countPointerMap(FALSE, entries);
+        memFree(types);
+        memFree(structType);
+    }
+
+    PRINT("@_Type_%s = constant %%_TypeDescriptor {i32 %d, ", display[depth], depth);
+
+    if (map != NULL) {
+        emitPointerMapReference(out, map, entries);
+        PRINT(", ");
+        memFree(map);
+    }
+
+    PRINT("[%d x %s] [", size, opaque_pointers ? "ptr" : "%_TypeDescriptor*");
+
+    for (i = 0; i < size; i++) {
+        PRINT(opaque_pointers ? "ptr " : "%%_TypeDescriptor* ");
+
+        if (i <= depth) {
+            PRINT("@_Type_%s", display[i]);
+            free(display[i]);
+        } else
+            PRINT("null");
+
+        if (i != size - 1)
+            PRINT(", ");
+    }
+
+    if (getGarbageCollection())
+        PRINT("]}\n\n");
+    else if (isDeletedClass(classType))
+        PRINT("], %s @_Delete_%s}\n\n", opaque_pointers ? "ptr" : "void (i8*)*", name);
+    else //no delete can reach it.
+        PRINT("], %s null}\n\n", opaque_pointers ? "ptr" : "void (i8*)*");
+
+    memFree(display);
+    free(name);
+}
+
+//the type and the constant vtable of a class: after the type descriptor, each slot holds the implementation the class
+//inherits or overrides.
+static void emitVTable(FILE* out, CheshireType classType) {
+    ClassShape* shape = getVTableShape(classType);
+    ClassShape* slot;
+    emitTypeDescriptor(out, classType);
+    emitVTableType(out, classType);
+    PRINT(" = type {");
+
+    for (slot = shape; slot != NULL; slot = slot->next) {
+        emitType(out, slot->type);
+
+        if (slot->next != NULL)
+            PRINT(", ");
+    }
+
+    PRINT("}\n\n");
+    char* name = getNamedTypeString(classType);
+    PRINT("@_VTable_%s = constant ", name);
+    emitVTableType(out, classType);
+
+    if (opaque_pointers)
+        PRINT(" {ptr @_Type_%s", name);
+    else
+        PRINT(" {i8* bitcast (%%_TypeDescriptor* @_Type_%s to i8*)", name);
+
+    for (slot = shape->next; slot != NULL; slot = slot->next) {
+        CheshireType definer;
+        ClassList* method = getMethodImplementation(classType, slot->name, &definer);
+        CheshireType type = getLambdaType(method->method.returnType, method->method.params);
+        char* definerName = getNamedTypeString(definer);
+        PRINT(", ");
+        emitType(out, slot->type);
+        PRINT(" ");
+
+        if (!opaque_pointers && !equalTypes(type, slot->type)) { //an override takes its own class as self.
+            PRINT("bitcast (");
+            emitType(out, type);
+            PRINT(" ");
+            emitValue(out, getClassMethodStorage(definerName, method->method.name));
+            PRINT(" to ");
+            emitType(out, slot->type);
+            PRINT(")");
+        } else
+            emitValue(out, getClassMethodStorage(definerName, method->method.name));
+
+        free(definerName);
+    }
+
+    PRINT("}\n\n");
+    free(name);
+}
+
+//every constructor points the header at its class's vtable once the parent's has returned.
+static void emitVTableStore(FILE* out, LLVMValue self, CheshireType classType) {
+    LLVMValue header = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    char* name = getNamedTypeString(classType);
+    PRINT("    ");
+    emitValue(out, header);
+    PRINT(" = getelementptr ");
+    emitStructType(out, classType);
+    PRINT(", ");
+    emitType(out, classType);
+    PRINT(" ");
+    emitValue(out, self);
+    PRINT(", i32 0, i32 0\n");
+
+    if (opaque_pointers)
+        PRINT("    store ptr @_VTable_%s, ptr ", name);
+    else
+        PRINT("    store i8* bitcast (%%_VTable_%s* @_VTable_%s to i8*), i8** ", name, name);
+
+    emitValue(out, header);
+    PRINT("\n");
+    free(name);
+}
+
+LLVMValue emitMemberAddress(FILE* out, LLVMValue object, CheshireType type, const char* name) {
+    int slot = getVTableElement(type, name);
+    LLVMValue address = getTemporaryStorage(UNIQUE_IDENTIFIER);
+
+    if (slot < 0) {
+        PRINT("    ");
+        emitValue(out, address);
+        PRINT(" = getelementptr ");
+        emitStructType(out, type);
+        PRINT(", ");
+        emitType(out, type);
+        PRINT(" ");
+        emitValue(out, object);
+        PRINT(", i32 0, i32 %d\n", getObjectElement(type, name));
+        return address;
+    }
+
+    LLVMValue header = getTemporaryStorage(UNIQUE_IDENTIFIER), vtable = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    PRINT("    ");
+    emitValue(out, header);
+    PRINT(" = getelementptr ");
+    emitStructType(out, type);
+    PRINT(", ");
+    emitType(out, type);
+    PRINT(" ");
+    emitValue(out, object);
+    PRINT(", i32 0, i32 0\n");
+    PRINT("    ");
+    emitValue(out, vtable);
+    PRINT(" = load ");
+    emitType(out, TYPE_NULL);
+    PRINT(", ");
+    emitPointerType(out, TYPE_NULL);
+    PRINT(" ");
+    emitValue(out, header);
+    PRINT("\n");
+
+    if (!opaque_pointers) {
+        LLVMValue casted = getTemporaryStorage(UNIQUE_IDENTIFIER);
+        PRINT("    ");
+        emitValue(out, casted);
+        PRINT(" = bitcast i8* ");
+        emitValue(out, vtable);
+        PRINT(" to ");
+        emitVTableType(out, type);
+        PRINT("*\n");
+        vtable = casted;
+    }
+
+    PRINT("    ");
+    emitValue(out, address);
+    PRINT(" = getelementptr ");
+    emitVTableType(out, type);
+    PRINT(", ");
+
+    if (opaque_pointers)
+        PRINT("ptr");
+    else {
+        emitVTableType(out, type);
+        PRINT("*");
+    }
+
+    PRINT(" ");
+    emitValue(out, vtable);
+    PRINT(", i32 0, i32 %d\n", slot);
+    return address;
+}
+
+//the type descriptor of an object that is not null, through the first slot of its vtable.
+static LLVMValue emitDescriptorLoad(FILE* out, LLVMValue object, CheshireType from) {
+    LLVMValue vtable = getTemporaryStorage(UNIQUE_IDENTIFIER), descriptor = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    declareRuntime(RUNTIME_TYPE_DESCRIPTOR);
+
+    if (opaque_pointers) {
+        PRINT("    ");
+        emitValue(out, vtable);
+        PRINT(" = load ptr, ptr ");
+        emitValue(out, object);
+        PRINT("\n    ");
+        emitValue(out, descriptor);
+        PRINT(" = load ptr, ptr ");
+        emitValue(out, vtable);
+        PRINT("\n");
+    } else { //the header and the first slot of the vtable are both at offset 0.
+        LLVMValue header = getTemporaryStorage(UNIQUE_IDENTIFIER), uncast = getTemporaryStorage(UNIQUE_IDENTIFIER);
+        PRINT("    ");
+        emitValue(out, header);
+        PRINT(" = bitcast ");
+        emitType(out, from);
+        PRINT(" ");
+        emitValue(out, object);
+        PRINT(" to i8***\n    ");
+        emitValue(out, vtable);
+        PRINT(" = load i8**, i8*** ");
+        emitValue(out, header);
+        PRINT("\n    ");
+        emitValue(out, uncast);
+        PRINT(" = load i8*, i8** ");
+        emitValue(out, vtable);
+        PRINT("\n    ");
+        emitValue(out, descriptor);
+        PRINT(" = bitcast i8* ");
+        emitValue(out, uncast);
+        PRINT(" to %%_TypeDescriptor*\n");
+    }
+
+    return descriptor;
+}
+
+LLVMValue emitTypeTest(FILE* out, LLVMValue object, CheshireType from, CheshireType to) {
+    LLVMValue descriptor = emitDescriptorLoad(out, object, from);
+    LLVMValue entry = getTemporaryStorage(UNIQUE_IDENTIFIER), ancestor = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    char* name = getNamedTypeString(to);
+    PRINT("    ");
+    emitValue(out, entry);
+    PRINT(" = getelementptr %%_TypeDescriptor, ");
+    emitNamedPointerType(out, "%_TypeDescriptor");
+    PRINT(" ");
+    emitValue(out, descriptor);
+    PRINT(", i32 0, i32 %d, i32 %d\n    ", getGarbageCollection() ? 2 : 1, getClassDepth(to));
+    emitValue(out, ancestor);
+    PRINT(" = load ");
+    emitNamedPointerType(out, "%_TypeDescriptor");
+    PRINT(", ");
+    PRINT(opaque_pointers ? "ptr " : "%%_TypeDescriptor** ");
+    emitValue(out, entry);
+    PRINT("\n    ");
+    emitValue(out, l);
+    PRINT(" = icmp eq ");
+    emitNamedPointerType(out, "%_TypeDescriptor");
+    PRINT(" ");
+    emitValue(out, ancestor);
+    PRINT(", @_Type_%s\n", name);
+    free(name);
+    return l;
+}
+
+//the type test of an object that may be null, which is ifNull.
+static LLVMValue emitNullableTypeTest(FILE* out, LLVMValue object, CheshireType from, CheshireType to, Boolean ifNull) {
+    int enter = UNIQUE_IDENTIFIER, check = UNIQUE_IDENTIFIER, exit = UNIQUE_IDENTIFIER;
+    LLVMValue isnull = getTemporaryStorage(UNIQUE_IDENTIFIER), phi = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    PRINT("    br label %%label%d\n", enter);
+    LABEL(enter);
+    PRINT("    ");
+    emitValue(out, isnull);
+    PRINT(" = icmp eq ");
+    emitType(out, from);
+    PRINT(" ");
+    emitValue(out, object);
+    PRINT(", null\n    br i1 ");
+    emitValue(out, isnull);
+    PRINT(", label %%label%d, label %%label%d\n", exit, check);
+    LABEL(check);
+    LLVMValue test = emitTypeTest(out, object, from, to);
+    PRINT("    br label %%label%d\n", exit);
+    LABEL(exit);
+    PRINT("    ");
+    emitValue(out, phi);
+    PRINT(" = phi i1 [%d, %%label%d], [", ifNull == TRUE ? 1 : 0, enter);
+    emitValue(out, test);
+    PRINT(", %%label%d]\n", check);
+    return phi;
+}
+
+//the free list of a class holds the objects deleted, linked through their first word; @_Alloc_ takes from it before
+//allocating, and @_Delete_, which is also in the class's type descriptor, puts an object back. With poisoning, a deleted
+//object is filled with DELETED_POISON, and @_Alloc_ asserts the bytes after the link still are.
+static void emitFreeList(FILE* out, CheshireType classType) {
+    char* name = getNamedTypeString(classType);
+    const char* bytePointer = opaque_pointers ? "ptr" : "i8*";
+    const char* linkPointer = opaque_pointers ? "ptr" : "i8**";
+    int sizeClass = getSizeClass(getAllocationSize(classType));
+    int reuse = UNIQUE_IDENTIFIER, allocate = UNIQUE_IDENTIFIER;
+    LLVMValue head = getTemporaryStorage(UNIQUE_IDENTIFIER), empty = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    LLVMValue link = head, next = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    PRINT("@_FreeList_%s = global %s null\n\n", name, bytePointer);
+    PRINT("define fastcc noalias %s @_Alloc_%s()%s {\n", bytePointer, name, getFunctionAttributes(ME_UNKNOWN));
+    PRINT("    ");
+    emitValue(out, head);
+    PRINT(" = load %s, %s @_FreeList_%s\n    ", bytePointer, linkPointer, name);
+    emitValue(out, empty);
+    PRINT(" = icmp eq %s ", bytePointer);
+    emitValue(out, head);
+    PRINT(", null\n    br i1 ");
+    emitValue(out, empty);
+    PRINT(", label %%label%d, label %%label%d\n", allocate, reuse);
+    LABEL(reuse);
+
+    if (!opaque_pointers) {
+        link = getTemporaryStorage(UNIQUE_IDENTIFIER);
+        PRINT("    ");
+        emitValue(out, link);
+        PRINT(" = bitcast i8* ");
+        emitValue(out, head);
+        PRINT(" to i8**\n");
+    }
+
+    PRINT("    ");
+    emitValue(out, next);
+    PRINT(" = load %s, %s ", bytePointer, linkPointer);
+    emitValue(out, link);
+    PRINT("\n    store %s ", bytePointer);
+    emitValue(out, next);
+    PRINT(", %s @_FreeList_%s\n", linkPointer, name);
+
+    if (getPoisonDeleted()) { //for (i = 8; i < size; i++) assert head[i] == DELETED_POISON, past a link of up to 8 bytes.
+        LLVMValue size = emitSizeOfClass(out, classType);
+        LLVMValue index = getTemporaryStorage(UNIQUE_IDENTIFIER), more = getTemporaryStorage(UNIQUE_IDENTIFIER);
+        LLVMValue address = getTemporaryStorage(UNIQUE_IDENTIFIER), byte = getTemporaryStorage(UNIQUE_IDENTIFIER);
+        LLVMValue poisoned = getTemporaryStorage(UNIQUE_IDENTIFIER), increment = getTemporaryStorage(UNIQUE_IDENTIFIER);
+        int check = UNIQUE_IDENTIFIER, body = UNIQUE_IDENTIFIER, checked = UNIQUE_IDENTIFIER, entered = current_label;
+        declareRuntime(RUNTIME_ASSERT);
+        PRINT("    br label %%label%d\n", check);
+        LABEL(check);
+        PRINT("    ");
+        emitValue(out, index);
+        PRINT(" = phi i32 [8, %%label%d], [", entered);
+        emitValue(out, increment);
+        PRINT(", %%label%d]\n    ", body);
+        emitValue(out, more);
+        PRINT(" = icmp slt i32 ");
+        emitValue(out, index);
+        PRINT(", ");
+        emitValue(out, size);
+        PRINT("\n    br i1 ");
+        emitValue(out, more);
+        PRINT(", label %%label%d, label %%label%d\n", body, checked);
+        LABEL(body);
+        PRINT("    ");
+        emitValue(out, address);
+        PRINT(" = getelementptr i8, %s ", bytePointer);
+        emitValue(out, head);
+        PRINT(", i32 ");
+        emitValue(out, index);
+        PRINT("\n    ");
+        emitValue(out, byte);
+        PRINT(" = load i8, %s ", bytePointer);
+        emitValue(out, address);
+        PRINT("\n    ");
+        emitValue(out, poisoned);
+        PRINT(" = icmp eq i8 ");
+        emitValue(out, byte);
+        PRINT(", %d\n", (signed char) DELETED_POISON);
+        PRINT("    call fastcc void @_Assert(i1 ");
+        emitValue(out, poisoned);
+        PRINT(")\n    ");
+        emitValue(out, increment);
+        PRINT(" = add i32 ");
+        emitValue(out, index);
+        PRINT(", 1\n    br label %%label%d\n", check);
+        LABEL(checked);
+    }
+
+    PRINT("    ret %s ", bytePointer);
+    emitValue(out, head);
+    PRINT("\n");
+    LABEL(allocate);
+    LLVMValue allocated = emitAllocation(out, sizeClass, sizeClass < 0 ? emitSizeOfClass(out, classType) : getIntegerLiteral(0));
+    PRINT("    ret %s ", bytePointer);
+    emitValue(out, allocated);
+    PRINT("\n}\n\n");
+
+    LLVMValue object = getParameterStorage("object"), former = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    PRINT("define fastcc void @_Delete_%s(%s ", name, bytePointer);
+    emitValue(out, object);
+    PRINT(")%s {\n", getFunctionAttributes(ME_UNKNOWN));
+
+    if (getPoisonDeleted()) {
+        LLVMValue size = emitSizeOfClass(out, classType);
+        declareRuntime(RUNTIME_MEMSET);
+        PRINT("    call void @llvm.memset.%s.i32(%s ", opaque_pointers ? "p0" : "p0i8", bytePointer);
+        emitValue(out, object);
+        PRINT(", i8 %d, i32 ", (signed char) DELETED_POISON);
+        emitValue(out, size);
+        PRINT(", i1 false)\n");
+    }
+
+    link = object;
+
+    if (!opaque_pointers) {
+        link = getTemporaryStorage(UNIQUE_IDENTIFIER);
+        PRINT("    ");
+        emitValue(out, link);
+        PRINT(" = bitcast i8* ");
+        emitValue(out, object);
+        PRINT(" to i8**\n");
+    }
+
+    PRINT("    ");
+    emitValue(out, former);
+    PRINT(" = load %s, %s @_FreeList_%s\n", bytePointer, linkPointer, name);
+    PRINT("    store %s ", bytePointer);
+    emitValue(out, former);
+    PRINT(", %s ", linkPointer);
+    emitValue(out, link);
+    PRINT("\n    store %s ", bytePointer);
+    emitValue(out, object);
+    PRINT(", %s @_FreeList_%s\n", linkPointer, name);
+    PRINT("    ret void\n}\n\n");
+    free(name);
+}
+
+//a zeroed i8* bumped from the collected heap, after a header holding its size, or from _cheshire_gc_allocate if it
+//does not fit, see setGarbageCollection.
+static LLVMValue emitCollectedAllocation(FILE* out, LLVMValue size) {
+    const char* bytePointer = opaque_pointers ? "ptr" : "i8*";
+    const char* linkPointer = opaque_pointers ? "ptr" : "i8**";
+    LLVMValue padded = getTemporaryStorage(UNIQUE_IDENTIFIER), rounded = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    LLVMValue next = getTemporaryStorage(UNIQUE_IDENTIFIER), end = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    LLVMValue limit = getTemporaryStorage(UNIQUE_IDENTIFIER), fits = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    LLVMValue header = next, object = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    LLVMValue collected = getTemporaryStorage(UNIQUE_IDENTIFIER), l = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    int bump = UNIQUE_IDENTIFIER, collect = UNIQUE_IDENTIFIER, allocated = UNIQUE_IDENTIFIER;
+    declareRuntime(RUNTIME_GC);
+    PRINT("    ");
+    emitValue(out, padded);
+    PRINT(" = add i32 ");
+    emitValue(out, size);
+    PRINT(", %d\n    ", GC_HEADER_SIZE + 7);
+    emitValue(out, rounded);
+    PRINT(" = and i32 ");
+    emitValue(out, padded);
+    PRINT(", -8\n    ");
+    emitValue(out, next);
+    PRINT(" = load %s, %s @_cheshire_gc_next\n    ", bytePointer, linkPointer);
+    emitValue(out, end);
+    PRINT(" = getelementptr i8, %s ", bytePointer);
+    emitValue(out, next);
+    PRINT(", i32 ");
+    emitValue(out, rounded);
+    PRINT("\n    ");
+    emitValue(out, limit);
+    PRINT(" = load %s, %s @_cheshire_gc_limit\n    ", bytePointer, linkPointer);
+    emitValue(out, fits);
+    PRINT(" = icmp ule %s ", bytePointer);
+    emitValue(out, end);
+    PRINT(", ");
+    emitValue(out, limit);
+    PRINT("\n    br i1 ");
+    emitValue(out, fits);
+    PRINT(", label %%label%d, label %%label%d\n", bump, collect);
+    LABEL(bump);
+    PRINT("    store %s ", bytePointer);
+    emitValue(out, end);
+    PRINT(", %s @_cheshire_gc_next\n", linkPointer);
+    declareRuntime(RUNTIME_MEMSET); //the header and padding too, so the collector never reads stale words.
+    PRINT("    call void @llvm.memset.%s.i32(%s ", opaque_pointers ? "p0" : "p0i8", bytePointer);
+    emitValue(out, next);
+    PRINT(", i8 0, i32 ");
+    emitValue(out, rounded);
+    PRINT(", i1 false)\n");
+
+    if (!opaque_pointers) {
+        header = getTemporaryStorage(UNIQUE_IDENTIFIER);
+        PRINT("    ");
+        emitValue(out, header);
+        PRINT(" = bitcast i8* ");
+        emitValue(out, next);
+        PRINT(" to i32*\n");
+    }
+
+    PRINT("    store i32 ");
+    emitValue(out, size);
+    PRINT(", %s ", opaque_pointers ? "ptr" : "i32*");
+    emitValue(out, header);
+    PRINT("\n    ");
+    emitValue(out, object);
+    PRINT(" = getelementptr i8, %s ", bytePointer);
+    emitValue(out, next);
+    PRINT(", i32 %d\n    br label %%label%d\n", GC_HEADER_SIZE, allocated);
+    LABEL(collect);
+    PRINT("    ");
+    emitValue(out, collected);
+    PRINT(" = call %s @_cheshire_gc_allocate(i32 ", bytePointer);
+    emitValue(out, size);
+    PRINT(")\n    br label %%label%d\n", allocated);
+    LABEL(allocated);
+    PRINT("    ");
+    emitValue(out, l);
+    PRINT(" = phi %s [", bytePointer);
+    emitValue(out, object);
+    PRINT(", %%label%d], [", bump);
+    emitValue(out, collected);
+    PRINT(", %%label%d]\n", collect);
+    return l;
+}
+
+LLVMValue emitObjectAllocation(FILE* out, CheshireType type) {
+    if (getGarbageCollection())
+        return emitCollectedAllocation(out, emitSizeOfClass(out, type));
+
+    if (equalTypes(type, TYPE_OBJECT) || !isDeletedClass(type)) { //Object is laid out by the runtime, with no free list.
+        int sizeClass = getSizeClass(getAllocationSize(type));
+        return emitAllocation(out, sizeClass, sizeClass < 0 ? emitSizeOfClass(out, type) : getIntegerLiteral(0));
+    }
+
+    LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    char* name = getNamedTypeString(type);
+    PRINT("    ");
+    emitValue(out, l);
+    PRINT(" = call fastcc ");
+    emitNamedPointerType(out, "i8");
+    PRINT(" @_Alloc_%s()\n", name);
+    free(name);
+    return l;
+}
+
+void emitDelete(FILE* out, LLVMValue object, CheshireType type) {
+    LLVMValue bytes = object;
+    char* name = getNamedTypeString(type);
+
+    if (!opaque_pointers) {
+        bytes = getTemporaryStorage(UNIQUE_IDENTIFIER);
+        PRINT("    ");
+        emitValue(out, bytes);
+        PRINT(" = bitcast ");
+        emitType(out, type);
+        PRINT(" ");
+        emitValue(out, object);
+        PRINT(" to i8*\n");
+    }
+
+    if (isLeafClass(type)) //the object is of exactly this class.
+        PRINT("    call fastcc void @_Delete_%s(", name);
+    else { //the @_Delete_ of its class, from its type descriptor.
+        LLVMValue descriptor = emitDescriptorLoad(out, object, type);
+        LLVMValue slot = getTemporaryStorage(UNIQUE_IDENTIFIER), deleter = getTemporaryStorage(UNIQUE_IDENTIFIER);
+        PRINT("    ");
+        emitValue(out, slot);
+        PRINT(" = getelementptr %%_TypeDescriptor, ");
+        emitNamedPointerType(out, "%_TypeDescriptor");
+        PRINT(" ");
+        emitValue(out, descriptor);
+        PRINT(", i32 0, i32 2\n    ");
+        emitValue(out, deleter);
+        PRINT(" = load %s, %s ", opaque_pointers ? "ptr" : "void (i8*)*", opaque_pointers ? "ptr" : "void (i8*)**");
+        emitValue(out, slot);
+        PRINT("\n    call fastcc void ");
+        emitValue(out, deleter);
+        PRINT("(");
+    }
+
+    emitNamedPointerType(out, "i8");
+    PRINT(" ");
+    emitValue(out, bytes);
+    PRINT(")\n");
+    free(name);
+}
+
+//a call of an object's method, with the self argument already cast to the callee's self type.
+static LLVMValue emitObjectCallArm(FILE* out, ExpressionNode* node, LLVMValue callee, CheshireType calleeType, LLVMValue* parameters, CheshireType* parameterTypes, int paramLength) {
+    LLVMValue l;
+    int i;
+
+    if (isVoid(node->determinedType)) {
+        l.type = LVT_VOID;
+        PRINT("    ");
+    } else {
+        l = getTemporaryStorage(UNIQUE_IDENTIFIER);
+        PRINT("    ");
+        emitValue(out, l);
+        PRINT(" = ");
+    }
+
+    if (node->objectcall.tailCall != TC_NONE)
+        countTailCall();
+
+    PRINT("%scall fastcc ", getTailCallMarker(node->objectcall.tailCall));
+    emitFunctionType(out, calleeType);
+    PRINT(" ");
+    emitValue(out, callee);
+    PRINT("(");
+
+    for (i = 0; i < paramLength; i++) {
+        emitType(out, parameterTypes[i]);
+        PRINT(" ");
+        emitValue(out, parameters[i]);
+
+        if (i != paramLength - 1)
+            PRINT(", ");
+    }
+
+    PRINT(")%s\n", getMemoryAttribute(getCallEffects(node)));
+    return l;
+}
+
+LLVMValue getMethodExport(char* name) {
+    LLVMValue l;
+    l.type = LVT_METHOD_EXPORT;
+    l.name = name;
+    return l;
+}
+
+const char* getTailCallMarker(TailCallKind kind) {
+    switch (kind) {
+        case TC_TAIL:
+            return "tail ";
+        case TC_MUSTTAIL:
+            return "musttail ";
+        default:
+            return "";
+    }
+}
+
+//whether the name a callee reads is bound in the function, rather than to a global, see isDirectCall.
+static Boolean isShadowedCallee(ExpressionNode* callback) {
+    if (callback->type != OP_DEREFERENCE || callback->unaryChild->type != OP_VARIABLE)
+        return FALSE;
+
+    LLVMValueType type = fetchVariable(callback->unaryChild->string).type;
+    return type != LVT_GLOBAL_METHOD && type != LVT_GLOBAL_VARIABLE ? TRUE : FALSE;
+}
+
+void emitLifetimeMarker(FILE* out, Boolean start, LLVMValue slot, CheshireType type) { //the size is left to LLVM, as -1.
+    if (optimization_level == 0 || (getGarbageCollection() && isTracedType(type))) //a root is read until the function returns.
+        return;
+
+    declareRuntime(RUNTIME_LIFETIME);
+    const char* marker = start ? "start" : "end";
+
+    if (opaque_pointers) {
+        PRINT("    call void @llvm.lifetime.%s.p0(i64 -1, ptr ", marker);
+        emitValue(out, slot);
+        PRINT(")\n");
+        return;
+    }
+
+    LLVMValue bytes = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    PRINT("    ");
+    emitValue(out, bytes);
+    PRINT(" = bitcast ");
+    emitPointerType(out, type);
+    PRINT(" ");
+    emitValue(out, slot);
+    PRINT(" to i8*\n");
+    PRINT("    call void @llvm.lifetime.%s.p0i8(i64 -1, i8* ", marker);
+    emitValue(out, bytes);
+    PRINT(")\n");
+}
+
+//a parameter that is never assigned is used as it was passed, only the others are copied into a slot.
+static void bindParameter(FILE* out, ParameterList* p) {
+    LLVMValue l = getParameterStorage(p->name);
+
+    if (!p->assigned) {
+        registerVariableValue(p->name, l);
+        return;
+    }
+
+    PRINT("    ");
+    LLVMValue variable = getLocalVariableStorage(p->name);
+    emitValue(out, variable);
+    PRINT(" = alloca ");
+    emitType(out, p->type);
+    PRINT("\n");
+    PRINT("    store ");
+    emitType(out, p->type);
+    PRINT(" ");
+    emitValue(out, l);
+    PRINT(", ");
+    emitPointerType(out, p->type);
+    PRINT(" ");
+    emitValue(out, variable);
+    PRINT("\n");
+    registerVariable(p->name, variable);
+
+    if (getGarbageCollection() && isTracedType(p->type))
+        registerRoot(variable, p->type, RK_PARAMETER);
+}
+
+//allocates the slots of a body's assigned locals up front, in the entry block, so a loop does not grow the stack.
+static void emitEntrySlots(FILE* out, StatementNode* statement) {
+    BlockList* list;
+
+    switch (statement->type) {
+        case S_VARIABLE_DEF:
+        case S_INFER_DEF:
+            if (statement->varDefinition.assigned) {
+                LLVMValue variable = getLocalVariableStorage(statement->varDefinition.variable);
+                PRINT("    ");
+                emitValue(out, variable);
+                PRINT(" = alloca ");
+                emitType(out, statement->varDefinition.type);
+                PRINT("\n");
+                registerEntrySlot(statement, variable);
+
+                if (getGarbageCollection() && isTracedType(statement->varDefinition.type))
+                    registerRoot(variable, statement->varDefinition.type, RK_LOCAL);
+            }
+
+            break;
+        case S_BLOCK:
+            for (list = statement->block; list != NULL; list = list->next)
+                emitEntrySlots(out, list->statement);
+
+            break;
+        case S_IF:
+        case S_WHILE:
+            emitEntrySlots(out, statement->conditional.block);
+            break;
+        case S_IF_ELSE:
+            emitEntrySlots(out, statement->conditional.block);
+            emitEntrySlots(out, statement->conditional.elseBlock);
+            break;
+        default:
+            break;
+    }
+}
+
+LLVMValue emitStackObject(FILE* out, CheshireType type) {
+    LLVMValue object = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    PRINT("    ");
+    emitValue(out, object);
+    PRINT(" = alloca ");
+    emitStructType(out, type);
+    PRINT("\n");
+    return object;
+}
+
+static void emitStackObjectClear(FILE* out, LLVMValue object, CheshireType type) {
+    LLVMValue size = emitSizeOfClass(out, type), bytes = object;
+    declareRuntime(RUNTIME_MEMSET);
+
+    if (!opaque_pointers) {
+        bytes = getTemporaryStorage(UNIQUE_IDENTIFIER);
+        PRINT("    ");
+        emitValue(out, bytes);
+        PRINT(" = bitcast ");
+        emitType(out, type);
+        PRINT(" ");
+        emitValue(out, object);
+        PRINT(" to i8*\n");
+    }
+
+    PRINT("    call void @llvm.memset.%s.i32(%s ", opaque_pointers ? "p0" : "p0i8", opaque_pointers ? "ptr" : "i8*");
+    emitValue(out, bytes);
+    PRINT(", i8 0, i32 ");
+    emitValue(out, size);
+    PRINT(", i1 false)\n");
+}
+
+static void emitBodySlots(FILE* out, BlockList* body) {
+    int i, objects = getStackObjectCount(body);
+
+    for (i = 0; i < objects; i++) {
+        ExpressionNode* instantiation = getStackObject(body, i);
+        registerEntryObject(instantiation, emitStackObject(out, instantiation->instantiate.type));
+    }
+
+    for (; body != NULL; body = body->next)
+        emitEntrySlots(out, body->statement);
+}
+
+typedef struct {
+    int roots, body; //the labels of the block allocating a function's roots, emitted after its body, and of the body.
+} RootFrame;
+
+//with garbage collection, the roots of a function are only known once its body is emitted: its entry block branches
+//to a block after the body that allocates them, declares each to llvm.gcroot and nulls those not yet stored, which
+//branches back to the body. beginRoots follows the define line, enterRoots the parameters and slots.
+static RootFrame beginRoots(void) {
+    RootFrame frame = {0, 0};
+
+    if (getGarbageCollection()) {
+        raiseRootFrame();
+        frame.roots = UNIQUE_IDENTIFIER;
+        frame.body = UNIQUE_IDENTIFIER;
+    }
+
+    return frame;
+}
+
+static void enterRoots(FILE* out, RootFrame frame) {
+    if (!getGarbageCollection())
+        return;
+
+    PRINT("    br label %%label%d\n", frame.roots);
+    LABEL(frame.body);
+}
+
+static void endRoots(FILE* out, RootFrame frame) { //after the function's last return.
+    int count, i;
+    CheshireType type;
+    RootKind kind;
+
+    if (!getGarbageCollection())
+        return;
+
+    LABEL(frame.roots);
+    count = getRootCount();
+    ERROR_IF(count > 0 && getTailCallCount() > 0, "Fatal error: a tail call in a function with garbage collection roots!");
+
+    for (i = 0; i < count; i++) {
+        LLVMValue slot = getRoot(i, &type, &kind);
+
+        if (kind == RK_TEMPORARY) {
+            PRINT("    ");
+            emitValue(out, slot);
+            PRINT(" = alloca ");
+            emitType(out, type);
+            PRINT("\n");
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        LLVMValue slot = getRoot(i, &type, &kind), root = slot;
+
+        if (!opaque_pointers) {
+            root = getTemporaryStorage(UNIQUE_IDENTIFIER);
+            PRINT("    ");
+            emitValue(out, root);
+            PRINT(" = bitcast ");
+            emitPointerType(out, type);
+            PRINT(" ");
+            emitValue(out, slot);
+            PRINT(" to i8**\n");
+        }
+
+        PRINT("    call void @llvm.gcroot(%s ", opaque_pointers ? "ptr" : "i8**");
+        emitValue(out, root);
+
+        if (getTracedNesting(type) == 0)
+            PRINT(", %s null)\n", opaque_pointers ? "ptr" : "i8*");
+        else
+            PRINT(", %s inttoptr (i32 %d to %s))\n", opaque_pointers ? "ptr" : "i8*", getTracedNesting(type), opaque_pointers ? "ptr" : "i8*");
+
+        if (kind != RK_PARAMETER) {
+            PRINT("    store ");
+            emitType(out, type);
+            PRINT(" null, ");
+            emitPointerType(out, type);
+            PRINT(" ");
+            emitValue(out, slot);
+            PRINT("\n");
+        }
+    }
+
+    if (count > 0)
+        declareRuntime(RUNTIME_GC);
+
+    PRINT("    br label %%label%d\n", frame.body);
+    fallRootFrame();
+}
+
+//stores a value that a collection could otherwise lose into a temporary root.
+static void emitRootStore(FILE* out, LLVMValue value, CheshireType type) {
+    LLVMValue slot = getTemporaryStorage(UNIQUE_IDENTIFIER);
+    registerRoot(slot, type, RK_TEMPORARY);
+    PRINT("    store ");
+    emitType(out, type);
+    PRINT(" ");
+    emitValue(out, value);
+    PRINT(", ");
+    emitPointerType(out, type);
+    PRINT(" ");
+    emitValue(out, slot);
+    PRINT("\n");
+}
+
+static LLVMValue emitVariableRead(FILE* out, char* name, CheshireType type) {
+    LLVMValue variable = fetchVariable(name);
+
+    if (isVariableValue(name))
+        return variable;
+
     LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER);
-    LLVMValue intval = getTemporaryStorage(UNIQUE_IDENTIFIER);
     PRINT("    ");
     emitValue(out, l);
-    PRINT(" = getelementptr ");
-    emitType(out, t);
-    PRINT(" null, i32 1\n");
-    PRINT("    ");
-    emitValue(out, intval);
-    PRINT(" = ptrtoint ");
-    emitType(out, t);
+    PRINT(" = load ");
+    emitType(out, type);
+    PRINT(", ");
+    emitPointerType(out, type);
     PRINT(" ");
-    emitValue(out, l);
-    PRINT(" to i32\n");
-    return intval;
+    emitValue(out, variable);
+    PRINT("\n");
+    return l;
 }
 
-static inline void emitNonTypecheckedUpcast(FILE* out, LLVMValue* parameterValue, CheshireType* parameterType, LLVMValue givenValue, CheshireType selfType, CheshireType superType) {
-    if (equalTypes(superType, selfType)) {
-        *parameterValue = givenValue;
-        *parameterType = selfType;
+//the constant object each instance of a class with a prototype starts as, see hasPrototype.
+static void emitPrototype(FILE* out, CheshireType classType) {
+    char* name = getNamedTypeString(classType);
+    PRINT("@_Proto_%s = constant ", name);
+    emitStructType(out, classType);
+
+    if (opaque_pointers)
+        PRINT(" {ptr @_VTable_%s", name);
+    else
+        PRINT(" {i8* bitcast (%%_VTable_%s* @_VTable_%s to i8*)", name, name);
+
+    for (ClassShape* c = getClassShape(classType)->next; c != NULL; c = c->next) {
+        ExpressionNode* value = getPrototypeValue(classType, c->name);
+        PRINT(", ");
+        emitType(out, c->type);
+
+        if (value->type == OP_CAST || (value->type == OP_RESERVED_LITERAL && value->reserved == RL_NULL))
+            PRINT(" null");
+        else {
+            PRINT(" ");
+            emitValue(out, emitExpression(out, value)); //a literal, which prints nothing.
+        }
+    }
+
+    PRINT("}\n\n");
+    free(name);
+}
+
+static void emitConstructorHeader(FILE* out, const char* prefix, CheshireType classType, ParameterList* params) {
+    char* name = getNamedTypeString(classType);
+    PRINT("define fastcc void @_%s_%s(", prefix, name);
+    free(name);
+
+    if (params == NULL) { //no constructor, only self.
+        emitType(out, classType);
+        emitSelfAttributes(out, classType);
+        PRINT(" %%_Param_self");
+    }
+
+    for (ParameterList* p = params; p != NULL; p = p->next) {
+        emitType(out, p->type);
+
+        if (p == params)
+            emitSelfAttributes(out, p->type);
+
+        PRINT(" ");
+        emitValue(out, getParameterStorage(p->name));
+
+        if (p->next != NULL)
+            PRINT(", ");
+    }
+
+    PRINT(")%s {\n", getFunctionAttributes(ME_UNKNOWN));
+}
+
+//@_New_ of a class with a prototype: it copies the prototype, then @_Init_ runs the constructor bodies of the chain.
+static void emitPrototypeConstructor(FILE* out, ParserTopNode* node, ClassList* constructor) {
+    CheshireType classType = getNamedType(node->classdef.name);
+    ParameterList* params = constructor != NULL ? constructor->constructor.params : NULL;
+    LLVMValue self = getParameterStorage("self"), objectValue;
+    CheshireType objectType;
+    emitConstructorHeader(out, "New", classType, params);
+    declareRuntime(RUNTIME_NEW_OBJECT);
+    emitNonTypecheckedUpcast(out, &objectValue, &objectType, self, classType, TYPE_OBJECT);
+    PRINT("    call fastcc void @_New_Object(");
+    emitType(out, objectType);
+    PRINT(" ");
+    emitValue(out, objectValue);
+    PRINT(")\n");
+    LLVMValue size = emitSizeOfClass(out, classType);
+    declareRuntime(RUNTIME_MEMCPY);
+
+    if (opaque_pointers) {
+        PRINT("    call void @llvm.memcpy.p0.p0.i32(ptr ");
+        emitValue(out, self);
+        PRINT(", ptr @_Proto_%s, i32 ", node->classdef.name);
     } else {
-        LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER);
+        LLVMValue bytes = getTemporaryStorage(UNIQUE_IDENTIFIER);
         PRINT("    ");
-        emitValue(out, l);
+        emitValue(out, bytes);
         PRINT(" = bitcast ");
-        emitType(out, selfType);
+        emitType(out, classType);
         PRINT(" ");
-        emitValue(out, givenValue);
-        PRINT(" to ");
-        emitType(out, superType);
-        PRINT("\n");
-        *parameterValue = l;
-        *parameterType = superType;
+        emitValue(out, self);
+        PRINT(" to i8*\n");
+        PRINT("    call void @llvm.memcpy.p0i8.p0i8.i32(i8* ");
+        emitValue(out, bytes);
+        PRINT(", i8* bitcast (%%_Class_%s* @_Proto_%s to i8*), i32 ", node->classdef.name, node->classdef.name);
     }
-}
 
-static inline LLVMValue getMethodExport(char* name) {
-    LLVMValue l;
-    l.type = LVT_METHOD_EXPORT;
-    l.name = name;
-    return l;
+    emitValue(out, size);
+    PRINT(", i1 false)\n");
+
+    if (hasInitializer(classType)) {
+        PRINT("    call fastcc void @_Init_%s(", node->classdef.name);
+
+        if (params == NULL) {
+            emitType(out, classType);
+            PRINT(" ");
+            emitValue(out, self);
+        }
+
+        for (ParameterList* p = params; p != NULL; p = p->next) {
+            emitType(out, p->type);
+            PRINT(" ");
+            emitValue(out, getParameterStorage(p->name));
+
+            if (p->next != NULL)
+                PRINT(", ");
+        }
+
+        PRINT(")\n");
+    }
+
+    PRINT("    ret void\n");
+    PRINT("}\n\n");
+
+    if (!hasInitializer(classType))
+        return;
+
+    BlockList* block = constructor != NULL ? constructor->constructor.block : NULL;
+    Boolean parentInitializer = hasInitializer(node->classdef.parent);
+    emitConstructorHeader(out, "Init", classType, params);
+    RootFrame frame = beginRoots();
+    raiseVariableScope();
+
+    if (params == NULL)
+        registerVariableValue("self", self);
+
+    for (ParameterList* p = params; p != NULL; p = p->next)
+        bindParameter(out, p);
+
+    emitBodySlots(out, block);
+    enterRoots(out, frame);
+    self = emitVariableRead(out, "self", classType);
+
+    if (parentInitializer) {
+        int paramLength = 1, i;
+        ExpressionList* e;
+
+        for (e = constructor != NULL ? constructor->constructor.inheritsParams : NULL; e != NULL; e = e->next)
+            paramLength++;
+
+        LLVMValue* parameters = memAlloc(MC_EMITTER_TEMPORARIES, sizeof(LLVMValue) * paramLength);
+        CheshireType* parameterTypes = memAlloc(MC_EMITTER_TEMPORARIES, sizeof(CheshireType) * paramLength);
+        emitNonTypecheckedUpcast(out, &(parameters[0]), &(parameterTypes[0]), self, classType, node->classdef.parent);
+
+        for (e = constructor != NULL ? constructor->constructor.inheritsParams : NULL, i = 1; e != NULL; e = e->next, i++) {
+            parameters[i] = emitExpression(out, e->parameter);
+            parameterTypes[i] = e->parameter->determinedType;
+        }
+
+        char* superName = getNamedTypeString(node->classdef.parent);
+        PRINT("    call fastcc void @_Init_%s(", superName);
+        free(superName);
+
+        for (i = 0; i < paramLength; i++) {
+            emitType(out, parameterTypes[i]);
+            PRINT(" ");
+            emitValue(out, parameters[i]);
+
+            if (i != paramLength - 1)
+                PRINT(", ");
+        }
+
+        PRINT(")\n");
+        memFree(parameters);
+        memFree(parameterTypes);
+    }
+
+    if (parentInitializer || block != NULL) //the parent's bodies ran with their own vtables, and this one calls through it.
+        emitVTableStore(out, self, classType);
+
+    emitBlock(out, block);
+    fallVariableScope();
+    PRINT("    ret void\n");
+    endRoots(out, frame);
+    PRINT("}\n\n");
 }
 
 void forwardDefinition(ParserTopNode* node) {
@@ -207,16 +1543,28 @@ void forwardDefinition(ParserTopNode* node) {
 }
 
 void emitCode(FILE* out, ParserTopNode* node) {
+    if (!opaque_pointers)
+        declareRuntime(RUNTIME_CLASSES); //typed pointers need the builtin class types named.
+
     switch (node->type) {
         case PRT_NONE:
             break;
         case PRT_METHOD_DECLARATION: {
-            LLVMValue l = getMethodExport(node->method.functionName);
+            ParameterList* p;
             PRINT("@_M_%s = external constant ", node->method.functionName);
             emitType(out, getLambdaType(node->method.returnType, node->method.params));
-            PRINT(" ");
-            emitValue(out, l);
-            PRINT("\n\n");
+            PRINT("\ndeclare fastcc ");
+            emitType(out, node->method.returnType);
+            PRINT(" @_MethodImpl_%s(", node->method.functionName);
+
+            for (p = node->method.params; p != NULL; p = p->next) {
+                emitType(out, p->type);
+
+                if (p->next != NULL)
+                    PRINT(", ");
+            }
+
+            PRINT(") nounwind\n\n");
             break;
         }
         case PRT_METHOD_DEFINITION: {
@@ -226,6 +1574,10 @@ void emitCode(FILE* out, ParserTopNode* node) {
             PRINT(" ");
             emitValue(out, l);
             PRINT("\n\n");
+
+            if (usingMidLevelIR() && emitMethodMIR(out, l, getMethodEffects(node), node->method.returnType, node->method.params, node->method.body))
+                break;
+
             PRINT("define fastcc ");
             emitType(out, node->method.returnType);
             PRINT(" @_MethodImpl_%s(", node->method.functionName);
@@ -241,28 +1593,15 @@ void emitCode(FILE* out, ParserTopNode* node) {
                     PRINT(", ");
             }
 
-            PRINT(") {\n");
+            PRINT(")%s {\n", getFunctionAttributes(getMethodEffects(node)));
+            RootFrame frame = beginRoots();
             raiseVariableScope();
 
-            for (p = node->method.params; p != NULL; p = p->next) {
-                LLVMValue l = getParameterStorage(p->name);
-                PRINT("    ");
-                LLVMValue variable = getLocalVariableStorage(p->name);
-                emitValue(out, variable);
-                PRINT(" = alloca ");
-                emitType(out, p->type);
-                PRINT("\n");
-                PRINT("    store ");
-                emitType(out, p->type);
-                PRINT(" ");
-                emitValue(out, l);
-                PRINT(", ");
-                emitType(out, p->type);
-                PRINT("* ");
-                emitValue(out, variable);
-                PRINT("\n");
-                registerVariable(p->name, variable);
-            }
+            for (p = node->method.params; p != NULL; p = p->next)
+                bindParameter(out, p);
+
+            emitBodySlots(out, node->method.body);
+            enterRoots(out, frame);
 
             emitBlock(out, node->method.body);
             fallVariableScope();
@@ -273,6 +1612,7 @@ void emitCode(FILE* out, ParserTopNode* node) {
                 PRINT("    ret void\n");
             }
 
+            endRoots(out, frame);
             PRINT("}\n\n");
             break;
         }
@@ -283,6 +1623,9 @@ void emitCode(FILE* out, ParserTopNode* node) {
             break;
         }
         case PRT_VARIABLE_DEFINITION: {
+            if (getGarbageCollection() && isTracedType(node->variable.type))
+                registerGlobalRoot(node->variable.name, node->variable.type);
+
             PRINT("@%s = common global ", node->variable.name);
             emitType(out, node->variable.type);
             PRINT(" ");
@@ -311,18 +1654,35 @@ void emitCode(FILE* out, ParserTopNode* node) {
             }
 
             PRINT("}\n\n");
-            Boolean constructor = FALSE;
+            emitVTable(out, getNamedType(node->classdef.name));
+            Boolean constructor = FALSE, prototype = hasPrototype(getNamedType(node->classdef.name));
             ClassList* classnode;
 
+            if (!getGarbageCollection() && isDeletedClass(getNamedType(node->classdef.name)))
+                emitFreeList(out, getNamedType(node->classdef.name));
+
+            if (prototype)
+                emitPrototype(out, getNamedType(node->classdef.name));
+
             for (classnode = node->classdef.classlist; classnode != NULL; classnode = classnode->next) {
                 switch (classnode->type) {
                     case CLT_CONSTRUCTOR: {
                         constructor = TRUE;
+
+                        if (prototype) {
+                            emitPrototypeConstructor(out, node, classnode);
+                            break;
+                        }
+
                         PRINT("define fastcc void @_New_%s(", node->classdef.name);
                         ParameterList* p;
 
                         for (p = classnode->constructor.params; p != NULL; p = p->next) {
                             emitType(out, p->type);
+
+                            if (p == classnode->constructor.params)
+                                emitSelfAttributes(out, p->type);
+
                             PRINT(" ");
                             LLVMValue paramValue = getParameterStorage(p->name);
                             emitValue(out, paramValue);
@@ -331,28 +1691,15 @@ void emitCode(FILE* out, ParserTopNode* node) {
                                 PRINT(", ");
                         }
 
-                        PRINT(") {\n");
+                        PRINT(")%s {\n", getFunctionAttributes(ME_UNKNOWN));
+                        RootFrame frame = beginRoots();
                         raiseVariableScope();
 
-                        for (p = classnode->constructor.params; p != NULL; p = p->next) {
-                            LLVMValue l = getParameterStorage(p->name);
-                            PRINT("    ");
-                            LLVMValue variable = getLocalVariableStorage(p->name);
-                            emitValue(out, variable);
-                            PRINT(" = alloca ");
-                            emitType(out, p->type);
-                            PRINT("\n");
-                            PRINT("    store ");
-                            emitType(out, p->type);
-                            PRINT(" ");
-                            emitValue(out, l);
-                            PRINT(", ");
-                            emitType(out, p->type);
-                            PRINT("* ");
-                            emitValue(out, variable);
-                            PRINT("\n");
-                            registerVariable(p->name, variable);
-                        }
+                        for (p = classnode->constructor.params; p != NULL; p = p->next)
+                            bindParameter(out, p);
+
+                        emitBodySlots(out, classnode->constructor.block);
+                        enterRoots(out, frame);
 
                         int paramLength = 1;
                         ExpressionList* e;
@@ -360,17 +1707,9 @@ void emitCode(FILE* out, ParserTopNode* node) {
                         for (e = classnode->constructor.inheritsParams; e != NULL; e = e->next)
                             paramLength++;
 
-                        LLVMValue selfReference = fetchVariable("self");
-                        LLVMValue deallocatedSelf = getTemporaryStorage(UNIQUE_IDENTIFIER);
-                        PRINT("    ");
-                        emitValue(out, deallocatedSelf);
-                        PRINT(" = load ");
-                        emitType(out, getNamedType(node->classdef.name));
-                        PRINT("* ");
-                        emitValue(out, selfReference);
-                        PRINT("\n");
-                        LLVMValue* parameters = malloc(sizeof(LLVMValue) * paramLength);
-                        CheshireType* parameterTypes = malloc(sizeof(CheshireType) * paramLength);
+                        LLVMValue deallocatedSelf = emitVariableRead(out, "self", getNamedType(node->classdef.name));
+                        LLVMValue* parameters = memAlloc(MC_EMITTER_TEMPORARIES, sizeof(LLVMValue) * paramLength);
+                        CheshireType* parameterTypes = memAlloc(MC_EMITTER_TEMPORARIES, sizeof(CheshireType) * paramLength);
                         emitNonTypecheckedUpcast(out, &(parameters[0]), &(parameterTypes[0]), deallocatedSelf, getNamedType(node->classdef.name), node->classdef.parent);
                         int i;
 
@@ -380,6 +1719,10 @@ void emitCode(FILE* out, ParserTopNode* node) {
                         }
 
                         char* superName = getNamedTypeString(node->classdef.parent);
+
+                        if (equalTypes(node->classdef.parent, TYPE_OBJECT))
+                            declareRuntime(RUNTIME_NEW_OBJECT);
+
                         PRINT("    call fastcc void @_New_%s(", superName);
                         free(superName);
 
@@ -392,9 +1735,10 @@ void emitCode(FILE* out, ParserTopNode* node) {
                                 PRINT(", ");
                         }
 
-                        free(parameters);
-                        free(parameterTypes);
+                        memFree(parameters);
+                        memFree(parameterTypes);
                         PRINT(")\n");
+                        emitVTableStore(out, deallocatedSelf, getNamedType(node->classdef.name));
                         ClassList* subnode;
 
                         for (subnode = node->classdef.classlist; subnode != NULL; subnode = subnode->next) {
@@ -405,6 +1749,8 @@ void emitCode(FILE* out, ParserTopNode* node) {
                                     PRINT("    ");
                                     emitValue(out, var);
                                     PRINT(" = getelementptr ");
+                                    emitStructType(out, getNamedType(node->classdef.name));
+                                    PRINT(", ");
                                     emitType(out, getNamedType(node->classdef.name));
                                     PRINT(" ");
                                     emitValue(out, deallocatedSelf);
@@ -414,19 +1760,24 @@ void emitCode(FILE* out, ParserTopNode* node) {
                                     PRINT(" ");
                                     emitValue(out, defaultValue);
                                     PRINT(", ");
-                                    emitType(out, subnode->variable.defaultValue->determinedType);
-                                    PRINT("* ");
+                                    emitPointerType(out, subnode->variable.defaultValue->determinedType);
+                                    PRINT(" ");
                                     emitValue(out, var);
                                     PRINT("\n");
                                 }
                                 break;
                                 case CLT_METHOD: {
+                                    if (getVTableElement(getNamedType(node->classdef.name), subnode->method.name) >= 0)
+                                        break; //held by the vtable.
+
                                     LLVMValue defaultValue = getClassMethodStorage(node->classdef.name, subnode->method.name);
                                     LLVMValue classStorage = getTemporaryStorage(UNIQUE_IDENTIFIER);
                                     CheshireType type = getLambdaType(subnode->method.returnType, subnode->method.params);
                                     PRINT("    ");
                                     emitValue(out, classStorage);
                                     PRINT(" = getelementptr ");
+                                    emitStructType(out, getNamedType(node->classdef.name));
+                                    PRINT(", ");
                                     emitType(out, getNamedType(node->classdef.name));
                                     PRINT(" ");
                                     emitValue(out, deallocatedSelf);
@@ -441,8 +1792,8 @@ void emitCode(FILE* out, ParserTopNode* node) {
                                     PRINT(" ");
                                     emitValue(out, defaultValue);
                                     PRINT(", ");
-                                    emitType(out, type);
-                                    PRINT("* ");
+                                    emitPointerType(out, type);
+                                    PRINT(" ");
                                     emitValue(out, classStorage);
                                     PRINT("\n");
                                 }
@@ -455,10 +1806,16 @@ void emitCode(FILE* out, ParserTopNode* node) {
                         emitBlock(out, classnode->constructor.block);
                         fallVariableScope();
                         PRINT("    ret void\n");
+                        endRoots(out, frame);
                         PRINT("}\n\n");
                     }
                     break;
                     case CLT_METHOD: {
+                        LLVMValue method = getClassMethodStorage(node->classdef.name, classnode->method.name);
+
+                        if (usingMidLevelIR() && emitMethodMIR(out, method, getClassMethodEffects(classnode), classnode->method.returnType, classnode->method.params, classnode->method.block))
+                            break;
+
                         PRINT("define fastcc ");
                         emitType(out, classnode->method.returnType);
                         PRINT(" @_ClassMethod_%s_%s(", node->classdef.name, classnode->method.name);
@@ -466,6 +1823,10 @@ void emitCode(FILE* out, ParserTopNode* node) {
 
                         for (p = classnode->method.params; p != NULL; p = p->next) {
                             emitType(out, p->type);
+
+                            if (p == classnode->method.params)
+                                emitSelfAttributes(out, p->type);
+
                             PRINT(" ");
                             LLVMValue paramValue = getParameterStorage(p->name);
                             emitValue(out, paramValue);
@@ -474,38 +1835,26 @@ void emitCode(FILE* out, ParserTopNode* node) {
                                 PRINT(", ");
                         }
 
-                        PRINT(") {\n");
+                        PRINT(")%s {\n", getFunctionAttributes(getClassMethodEffects(classnode)));
+                        RootFrame frame = beginRoots();
                         raiseVariableScope();
 
-                        for (p = classnode->method.params; p != NULL; p = p->next) {
-                            LLVMValue l = getParameterStorage(p->name);
-                            PRINT("    ");
-                            LLVMValue variable = getLocalVariableStorage(p->name);
-                            emitValue(out, variable);
-                            PRINT(" = alloca ");
-                            emitType(out, p->type);
-                            PRINT("\n");
-                            PRINT("    store ");
-                            emitType(out, p->type);
-                            PRINT(" ");
-                            emitValue(out, l);
-                            PRINT(", ");
-                            emitType(out, p->type);
-                            PRINT("* ");
-                            emitValue(out, variable);
-                            PRINT("\n");
-                            registerVariable(p->name, variable);
-                        }
+                        for (p = classnode->method.params; p != NULL; p = p->next)
+                            bindParameter(out, p);
+
+                        emitBodySlots(out, classnode->method.block);
+                        enterRoots(out, frame);
 
                         emitBlock(out, classnode->method.block);
                         fallVariableScope();
 
                         if (!isVoid(classnode->method.returnType)) {
-                            UNARY("ret", node->method.returnType, getDefaultReturnType(node->method.returnType)); //implicit, fallthrough return in non-void function.
+                            UNARY("ret", classnode->method.returnType, getDefaultReturnType(classnode->method.returnType)); //implicit, fallthrough return in non-void function.
                         } else {
                             PRINT("    ret void\n");
                         }
 
+                        endRoots(out, frame);
                         PRINT("}\n\n");
                     }
                     break;
@@ -514,36 +1863,23 @@ void emitCode(FILE* out, ParserTopNode* node) {
                 }
             }
 
-            if (!constructor) {
-                PRINT("define fastcc void @_New_%s(%%_Class_%s* %%_Param_self) {\n", node->classdef.name, node->classdef.name);
-                raiseVariableScope();
-                LLVMValue l = getParameterStorage("self");
-                PRINT("    ");
-                LLVMValue variable = getLocalVariableStorage("self");
-                emitValue(out, variable);
-                PRINT(" = alloca ");
-                emitType(out, getNamedType(node->classdef.name));
-                PRINT("\n");
-                PRINT("    store ");
-                emitType(out, getNamedType(node->classdef.name));
-                PRINT(" ");
-                emitValue(out, l);
-                PRINT(", ");
+            if (!constructor && prototype)
+                emitPrototypeConstructor(out, node, NULL);
+            else if (!constructor) {
+                PRINT("define fastcc void @_New_%s(", node->classdef.name);
                 emitType(out, getNamedType(node->classdef.name));
-                PRINT("* ");
-                emitValue(out, variable);
-                PRINT("\n");
-                registerVariable("self", variable);
+                emitSelfAttributes(out, getNamedType(node->classdef.name));
+                PRINT(" %%_Param_self)%s {\n", getFunctionAttributes(ME_UNKNOWN));
+                RootFrame frame = beginRoots();
+                raiseVariableScope();
+                registerVariableValue("self", getParameterStorage("self")); //nothing can assign it, there is no body.
+                enterRoots(out, frame);
                 char* superName = getNamedTypeString(node->classdef.parent);
-                LLVMValue selfReference = fetchVariable("self");
-                LLVMValue deallocatedSelf = getTemporaryStorage(UNIQUE_IDENTIFIER);
-                PRINT("    ");
-                emitValue(out, deallocatedSelf);
-                PRINT(" = load ");
-                emitType(out, getNamedType(node->classdef.name));
-                PRINT("* ");
-                emitValue(out, selfReference);
-                PRINT("\n");
+
+                if (equalTypes(node->classdef.parent, TYPE_OBJECT))
+                    declareRuntime(RUNTIME_NEW_OBJECT);
+
+                LLVMValue deallocatedSelf = emitVariableRead(out, "self", getNamedType(node->classdef.name));
                 LLVMValue superValue;
                 CheshireType superType;
                 emitNonTypecheckedUpcast(out, &superValue, &superType, deallocatedSelf, getNamedType(node->classdef.name), node->classdef.parent);
@@ -553,6 +1889,7 @@ void emitCode(FILE* out, ParserTopNode* node) {
                 emitValue(out, superValue);
                 PRINT(")\n");
                 free(superName);
+                emitVTableStore(out, deallocatedSelf, getNamedType(node->classdef.name));
                 ClassList* subnode;
 
                 for (subnode = node->classdef.classlist; subnode != NULL; subnode = subnode->next) {
@@ -563,6 +1900,8 @@ void emitCode(FILE* out, ParserTopNode* node) {
                             PRINT("    ");
                             emitValue(out, var);
                             PRINT(" = getelementptr ");
+                            emitStructType(out, getNamedType(node->classdef.name));
+                            PRINT(", ");
                             emitType(out, getNamedType(node->classdef.name));
                             PRINT(" ");
                             emitValue(out, deallocatedSelf);
@@ -572,19 +1911,24 @@ void emitCode(FILE* out, ParserTopNode* node) {
                             PRINT(" ");
                             emitValue(out, defaultValue);
                             PRINT(", ");
-                            emitType(out, subnode->variable.defaultValue->determinedType);
-                            PRINT("* ");
+                            emitPointerType(out, subnode->variable.defaultValue->determinedType);
+                            PRINT(" ");
                             emitValue(out, var);
                             PRINT("\n");
                         }
                         break;
                         case CLT_METHOD: {
+                            if (getVTableElement(getNamedType(node->classdef.name), subnode->method.name) >= 0)
+                                break; //held by the vtable.
+
                             LLVMValue defaultValue = getClassMethodStorage(node->classdef.name, subnode->method.name);
                             LLVMValue classStorage = getTemporaryStorage(UNIQUE_IDENTIFIER);
                             CheshireType type = getLambdaType(subnode->method.returnType, subnode->method.params);
                             PRINT("    ");
                             emitValue(out, classStorage);
                             PRINT(" = getelementptr ");
+                            emitStructType(out, getNamedType(node->classdef.name));
+                            PRINT(", ");
                             emitType(out, getNamedType(node->classdef.name));
                             PRINT(" ");
                             emitValue(out, deallocatedSelf);
@@ -599,8 +1943,8 @@ void emitCode(FILE* out, ParserTopNode* node) {
                             PRINT(" ");
                             emitValue(out, defaultValue);
                             PRINT(", ");
-                            emitType(out, type);
-                            PRINT("* ");
+                            emitPointerType(out, type);
+                            PRINT(" ");
                             emitValue(out, classStorage);
                             PRINT("\n");
                         }
@@ -612,6 +1956,7 @@ void emitCode(FILE* out, ParserTopNode* node) {
 
                 fallVariableScope();
                 PRINT("    ret void\n");
+                endRoots(out, frame);
                 PRINT("}\n\n");
             }
         }
@@ -621,6 +1966,51 @@ void emitCode(FILE* out, ParserTopNode* node) {
     flushPreambles(out);
 }
 
+void emitGlobalRoots(FILE* out) {
+    int count = getGlobalRootCount(), i;
+    CheshireType type;
+
+    if (count == 0)
+        return;
+
+    for (i = 0; i < count; i++) {
+        char map[32];
+        getGlobalRoot(i, &type);
+        sprintf(map, "_RootMap_%d", i);
+        emitPointerMap(out, map, NULL, &type, 1);
+    }
+
+    declareRuntime(RUNTIME_GC);
+    PRINT("define internal void @_RegisterRoots()%s {\n", getFunctionAttributes(ME_UNKNOWN));
+
+    for (i = 0; i < count; i++) {
+        char map[32], *name = getGlobalRoot(i, &type);
+        sprintf(map, "_RootMap_%d", i);
+        PRINT("    call void @_cheshire_gc_add_roots(");
+
+        if (opaque_pointers)
+            PRINT("ptr @%s", name);
+        else {
+            PRINT("i8* bitcast (");
+            emitPointerType(out, type);
+            PRINT(" @%s to i8*)", name);
+        }
+
+        PRINT(", ");
+        emitPointerMapReference(out, map, 1);
+        PRINT(")\n");
+    }
+
+    PRINT("    ret void\n}\n\n");
+
+    if (opaque_pointers)
+        PRINT("@llvm.global_ctors = appending global [1 x {i32, ptr, ptr}] [{i32, ptr, ptr} {i32 65535, ptr @_RegisterRoots, ptr null}]\n\n");
+    else
+        PRINT("@llvm.global_ctors = appending global [1 x {i32, void ()*, i8*}] [{i32, void ()*, i8*} {i32 65535, void ()* @_RegisterRoots, i8* null}]\n\n");
+
+    flushPreambles(out);
+}
+
 void emitBlock(FILE* out, BlockList* node) {
     raiseVariableScope();
 
@@ -629,6 +2019,7 @@ void emitBlock(FILE* out, BlockList* node) {
         emitStatement(out, statement);
     }
 
+    endLocalLifetimes(out);
     fallVariableScope();
 }
 
@@ -639,22 +2030,24 @@ void emitStatement(FILE* out, StatementNode* statement) {
         case S_VARIABLE_DEF:
         case S_INFER_DEF: {
             LLVMValue l = emitExpression(out, statement->varDefinition.value);
-            PRINT("    ");
-            LLVMValue variable = getLocalVariableStorage(statement->varDefinition.variable);
-            emitValue(out, variable);
-            PRINT(" = alloca ");
-            emitType(out, statement->varDefinition.type);
-            PRINT("\n");
+
+            if (!statement->varDefinition.assigned) {
+                registerVariableValue(statement->varDefinition.variable, l);
+                break;
+            }
+
+            LLVMValue variable = takeEntrySlot(statement);
+            emitLifetimeMarker(out, TRUE, variable, statement->varDefinition.type);
             PRINT("    store ");
             emitType(out, statement->varDefinition.type);
             PRINT(" ");
             emitValue(out, l);
             PRINT(", ");
-            emitType(out, statement->varDefinition.type);
-            PRINT("* ");
+            emitPointerType(out, statement->varDefinition.type);
+            PRINT(" ");
             emitValue(out, variable);
             PRINT("\n");
-            registerVariable(statement->varDefinition.variable, variable);
+            registerLocalSlot(statement->varDefinition.variable, variable, statement->varDefinition.type);
         }
         break;
         case S_EXPRESSION: {
@@ -663,11 +2056,35 @@ void emitStatement(FILE* out, StatementNode* statement) {
         break;
         case S_ASSERT: {
             LLVMValue assertion = emitExpression(out, statement->expression);
-            PRINT("    call fastcc void _Assert(");
+            declareRuntime(RUNTIME_ASSERT);
+            PRINT("    call fastcc void @_Assert(i1 ");
             emitValue(out, assertion);
             PRINT(")\n");
         }
         break;
+        case S_DELETE: { //of null does nothing, and with garbage collection, of anything.
+            if (getGarbageCollection()) {
+                emitExpression(out, statement->expression);
+                break;
+            }
+
+            LLVMValue object = emitExpression(out, statement->expression), isnull = getTemporaryStorage(UNIQUE_IDENTIFIER);
+            int labeldelete = UNIQUE_IDENTIFIER, labelend = UNIQUE_IDENTIFIER;
+            PRINT("    ");
+            emitValue(out, isnull);
+            PRINT(" = icmp eq ");
+            emitType(out, statement->expression->determinedType);
+            PRINT(" ");
+            emitValue(out, object);
+            PRINT(", null\n    br i1 ");
+            emitValue(out, isnull);
+            PRINT(", label %%label%d, label %%label%d\n", labelend, labeldelete);
+            LABEL(labeldelete);
+            emitDelete(out, object, statement->expression->determinedType);
+            PRINT("    br label %%label%d\n", labelend);
+            LABEL(labelend);
+        }
+        break;
         case S_BLOCK: {
             emitBlock(out, statement->block);
         }
@@ -678,11 +2095,13 @@ void emitStatement(FILE* out, StatementNode* statement) {
             PRINT("    br i1 ");
             emitValue(out, branchfactor);
             PRINT(", label %%label%d, label %%label%d\n", labeltrue, labelfalse);
-            PRINT("label%d:\n", labeltrue);
+            LABEL(labeltrue);
             raiseVariableScope();
             emitStatement(out, statement->conditional.block);
+            endLocalLifetimes(out);
             fallVariableScope();
-            PRINT("label%d:\n", labelfalse);
+            PRINT("    br label %%label%d\n", labelfalse);
+            LABEL(labelfalse);
         }
         break;
         case S_IF_ELSE: {
@@ -691,33 +2110,36 @@ void emitStatement(FILE* out, StatementNode* statement) {
             PRINT("    br i1 ");
             emitValue(out, branchfactor);
             PRINT(", label %%label%d, label %%label%d\n", labeltrue, labelfalse);
-            PRINT("label%d:\n", labeltrue);
+            LABEL(labeltrue);
             raiseVariableScope();
             emitStatement(out, statement->conditional.block);
+            endLocalLifetimes(out);
             fallVariableScope();
             PRINT("    br label %%label%d\n", labelend);
-            PRINT("label%d:\n", labelfalse);
+            LABEL(labelfalse);
             raiseVariableScope();
             emitStatement(out, statement->conditional.elseBlock);
+            endLocalLifetimes(out);
             fallVariableScope();
             PRINT("    br label %%label%d\n", labelend);
-            PRINT("label%d:\n", labelend);
+            LABEL(labelend);
         }
         break;
         case S_WHILE: {
             int labelbegin = UNIQUE_IDENTIFIER, labeltrue = UNIQUE_IDENTIFIER, labelend = UNIQUE_IDENTIFIER;
             PRINT("    br label %%label%d\n", labelbegin);
-            PRINT("label%d:\n", labelbegin);
+            LABEL(labelbegin);
             LLVMValue branchfactor = emitExpression(out, statement->conditional.condition);
             PRINT("    br i1 ");
             emitValue(out, branchfactor);
             PRINT(", label %%label%d, label %%label%d\n", labeltrue, labelend);
-            PRINT("label%d:\n", labeltrue);
+            LABEL(labeltrue);
             raiseVariableScope();
             emitStatement(out, statement->conditional.block);
+            endLocalLifetimes(out);
             fallVariableScope();
             PRINT("    br label %%label%d\n", labelbegin);
-            PRINT("label%d:\n", labelend);
+            LABEL(labelend);
         }
         break;
         case S_RETURN: {
@@ -736,7 +2158,42 @@ void emitStatement(FILE* out, StatementNode* statement) {
     }
 }
 
+//with garbage collection, an object or closure is rooted where its value is produced: loaded from anything but a
+//name bound to a value, returned by a call, allocated (see OP_INSTANTIATION), or created with captures. A value
+//derived from it, by a cast, a choice or an assignment, shares its root, and an argument stays in the caller's. A
+//returned tail call is only marked in a caller without roots (see TailCalls.h), which passes its value on as is.
+static Boolean isRootedExpression(ExpressionNode* node) {
+    if (!getGarbageCollection() || !isTracedType(node->determinedType))
+        return FALSE;
+
+    switch (node->type) {
+        case OP_DEREFERENCE:
+            return node->unaryChild->type != OP_VARIABLE || !isVariableValue(node->unaryChild->string) ? TRUE : FALSE;
+        case OP_METHOD_CALL:
+            return node->methodcall.tailCall == TC_NONE ? TRUE : FALSE;
+        case OP_OBJECT_CALL:
+            return node->objectcall.tailCall == TC_NONE ? TRUE : FALSE;
+        case OP_STRING:
+            return TRUE;
+        case OP_CLOSURE:
+            return node->closure.usingList != NULL ? TRUE : FALSE;
+        default:
+            return FALSE;
+    }
+}
+
+static LLVMValue emitExpressionValue(FILE* out, ExpressionNode* node);
+
 LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
+    LLVMValue l = emitExpressionValue(out, node);
+
+    if (isRootedExpression(node))
+        emitRootStore(out, l, node->determinedType);
+
+    return l;
+}
+
+static LLVMValue emitExpressionValue(FILE* out, ExpressionNode* node) {
     switch (node->type) {
         case OP_NOP:
         case OP_LAMBDA: //gets converted...
@@ -758,13 +2215,18 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
         }
         break;
         case OP_DEREFERENCE: {
+            if (node->unaryChild->type == OP_VARIABLE)
+                return emitVariableRead(out, node->unaryChild->string, node->determinedType);
+
             LLVMValue child = emitExpression(out, node->unaryChild);
             LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER);
             PRINT("    ");
             emitValue(out, l);
             PRINT(" = load ");
             emitType(out, node->determinedType);
-            PRINT("* ");
+            PRINT(", ");
+            emitPointerType(out, node->determinedType);
+            PRINT(" ");
             emitValue(out, child);
             PRINT("\n");
             return l;
@@ -798,7 +2260,9 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             emitValue(out, deref);
             PRINT(" = load ");
             emitType(out, node->determinedType);
-            PRINT("* ");
+            PRINT(", ");
+            emitPointerType(out, node->determinedType);
+            PRINT(" ");
             emitValue(out, lval);
             PRINT("\n");
 
@@ -813,8 +2277,8 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             PRINT(" ");
             emitValue(out, plusone);
             PRINT(", ");
-            emitType(out, node->binary.left->determinedType);
-            PRINT("* ");
+            emitPointerType(out, node->binary.left->determinedType);
+            PRINT(" ");
             emitValue(out, lval);
             PRINT("\n");
             return deref;
@@ -827,7 +2291,9 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             emitValue(out, deref);
             PRINT(" = load ");
             emitType(out, node->determinedType);
-            PRINT("* ");
+            PRINT(", ");
+            emitPointerType(out, node->determinedType);
+            PRINT(" ");
             emitValue(out, lval);
             PRINT("\n");
 
@@ -842,8 +2308,8 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             PRINT(" ");
             emitValue(out, plusone);
             PRINT(", ");
-            emitType(out, node->binary.left->determinedType);
-            PRINT("* ");
+            emitPointerType(out, node->binary.left->determinedType);
+            PRINT(" ");
             emitValue(out, lval);
             PRINT("\n");
             return deref;
@@ -854,7 +2320,7 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER);
 
             if (isDecimal(node->binary.left->determinedType)) {
-                BINARY_STORE(l, "fcmp eq", node->binary.left->determinedType, a, b);
+                BINARY_STORE(l, "fcmp oeq", node->binary.left->determinedType, a, b);
             } else {
                 BINARY_STORE(l, "icmp eq", node->binary.left->determinedType, a, b);
             }
@@ -867,7 +2333,7 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER);
 
             if (isDecimal(node->binary.left->determinedType)) {
-                BINARY_STORE(l, "fcmp ne", node->binary.left->determinedType, a, b);
+                BINARY_STORE(l, "fcmp une", node->binary.left->determinedType, a, b);
             } else {
                 BINARY_STORE(l, "icmp ne", node->binary.left->determinedType, a, b);
             }
@@ -880,7 +2346,7 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER);
 
             if (isDecimal(node->binary.left->determinedType)) {
-                BINARY_STORE(l, "fcmp sge", node->binary.left->determinedType, a, b);
+                BINARY_STORE(l, "fcmp oge", node->binary.left->determinedType, a, b);
             } else {
                 BINARY_STORE(l, "icmp sge", node->binary.left->determinedType, a, b);
             }
@@ -893,7 +2359,7 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER);
 
             if (isDecimal(node->binary.left->determinedType)) {
-                BINARY_STORE(l, "fcmp sle", node->binary.left->determinedType, a, b);
+                BINARY_STORE(l, "fcmp ole", node->binary.left->determinedType, a, b);
             } else {
                 BINARY_STORE(l, "icmp sle", node->binary.left->determinedType, a, b);
             }
@@ -906,7 +2372,7 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER);
 
             if (isDecimal(node->binary.left->determinedType)) {
-                BINARY_STORE(l, "fcmp sgt", node->binary.left->determinedType, a, b);
+                BINARY_STORE(l, "fcmp ogt", node->binary.left->determinedType, a, b);
             } else {
                 BINARY_STORE(l, "icmp sgt", node->binary.left->determinedType, a, b);
             }
@@ -919,7 +2385,7 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER);
 
             if (isDecimal(node->binary.left->determinedType)) {
-                BINARY_STORE(l, "fcmp slt", node->binary.left->determinedType, a, b);
+                BINARY_STORE(l, "fcmp olt", node->binary.left->determinedType, a, b);
             } else {
                 BINARY_STORE(l, "icmp slt", node->binary.left->determinedType, a, b);
             }
@@ -930,15 +2396,17 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
         case OP_AND: {
             int enter = UNIQUE_IDENTIFIER, calculate = UNIQUE_IDENTIFIER, skip = UNIQUE_IDENTIFIER;
             PRINT("    br label %%label%d\n", enter);
-            PRINT("label%d:\n", enter);
+            LABEL(enter);
             LLVMValue firstcondition = emitExpression(out, node->binary.left);
+            int entered = current_label; //nested conditions may have moved on from enter.
             PRINT("    br i1 ");
             emitValue(out, firstcondition);
             PRINT(", label %%label%d, label %%label%d\n", calculate, skip);
-            PRINT("label%d:\n", calculate);
+            LABEL(calculate);
             LLVMValue secondcondition = emitExpression(out, node->binary.right);
+            int calculated = current_label;
             PRINT("    br label %%label%d\n", skip);
-            PRINT("label%d:\n", skip);
+            LABEL(skip);
             LLVMValue phi = getTemporaryStorage(UNIQUE_IDENTIFIER);
             PRINT("    ");
             emitValue(out, phi);
@@ -946,24 +2414,26 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             emitType(out, node->determinedType);
             PRINT(" [");
             emitValue(out, getBooleanLiteral(FALSE));
-            PRINT(", %%label%d], [", enter);
+            PRINT(", %%label%d], [", entered);
             emitValue(out, secondcondition);
-            PRINT(", %%label%d]\n", calculate);
+            PRINT(", %%label%d]\n", calculated);
             return phi;
         }
         break;
         case OP_OR: {
             int enter = UNIQUE_IDENTIFIER, calculate = UNIQUE_IDENTIFIER, skip = UNIQUE_IDENTIFIER;
-            PRINT("   br label %%label%d\n", enter);
-            PRINT("label%d:\n", enter);
+            PRINT("    br label %%label%d\n", enter);
+            LABEL(enter);
             LLVMValue firstcondition = emitExpression(out, node->binary.left);
+            int entered = current_label; //nested conditions may have moved on from enter.
             PRINT("    br i1 ");
             emitValue(out, firstcondition);
             PRINT(", label %%label%d, label %%label%d\n", skip, calculate);
-            PRINT("label%d:\n", calculate);
+            LABEL(calculate);
             LLVMValue secondcondition = emitExpression(out, node->binary.right);
+            int calculated = current_label;
             PRINT("    br label %%label%d\n", skip);
-            PRINT("label%d:\n", skip);
+            LABEL(skip);
             LLVMValue phi = getTemporaryStorage(UNIQUE_IDENTIFIER);
             PRINT("    ");
             emitValue(out, phi);
@@ -971,9 +2441,9 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             emitType(out, node->determinedType);
             PRINT(" [");
             emitValue(out, getBooleanLiteral(TRUE));
-            PRINT(", %%label%d], [", enter);
+            PRINT(", %%label%d], [", entered);
             emitValue(out, secondcondition);
-            PRINT(", %%label%d]\n", calculate);
+            PRINT(", %%label%d]\n", calculated);
             return phi;
         }
         break;
@@ -1049,18 +2519,36 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             PRINT(" ");
             emitValue(out, b);
             PRINT(", ");
-            emitType(out, node->binary.left->determinedType);
-            PRINT("* ");
+            emitPointerType(out, node->binary.left->determinedType);
+            PRINT(" ");
             emitValue(out, a);
             PRINT("\n");
             return b;
         }
         break;
         case OP_INSTANCEOF: {
-            //todo: call fastcc GC function to find allocated type
+            CheshireType from = node->instanceof.expression->determinedType;
+            LLVMValue object = emitExpression(out, node->instanceof.expression);
+
+            if (isNull(from))
+                return getBooleanLiteral(FALSE);
+
+            if (isCheckedCast(from, node->instanceof.type))
+                return emitNullableTypeTest(out, object, from, node->instanceof.type, FALSE);
+
+            LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER); //an upcast: anything but null is an instance.
+            PRINT("    ");
+            emitValue(out, l);
+            PRINT(" = icmp ne ");
+            emitType(out, from);
+            PRINT(" ");
+            emitValue(out, object);
+            PRINT(", null\n");
+            return l;
         }
         break;
-        case OP_VARIABLE: {
+        case OP_VARIABLE: { //an lval, so it must have a slot.
+            ERROR_IF(isVariableValue(node->string), "Fatal error: %s is never assigned, yet has no slot!", node->string);
             return fetchVariable(node->string);
         }
         break;
@@ -1108,19 +2596,30 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
                     PRINT("\n");
                     return l;
                 }
-            } else {
-                LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER);
-                PRINT("    ");
-                emitValue(out, l);
-                PRINT(" = bitcast ");
-                emitType(out, node->cast.child->determinedType);
-                PRINT(" ");
-                emitValue(out, child);
-                PRINT(" to ");
-                emitType(out, node->cast.type);
-                PRINT("\n");
-                return l;
             }
+
+            if (isCheckedCast(node->cast.child->determinedType, node->cast.type)) { //a downcast asserts the type, null passes.
+                LLVMValue instance = emitNullableTypeTest(out, child, node->cast.child->determinedType, node->cast.type, TRUE);
+                declareRuntime(RUNTIME_ASSERT);
+                PRINT("    call fastcc void @_Assert(i1 ");
+                emitValue(out, instance);
+                PRINT(")\n");
+            }
+
+            if (opaque_pointers) //object casts do not change a ptr.
+                return child;
+
+            LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER);
+            PRINT("    ");
+            emitValue(out, l);
+            PRINT(" = bitcast ");
+            emitType(out, node->cast.child->determinedType);
+            PRINT(" ");
+            emitValue(out, child);
+            PRINT(" to ");
+            emitType(out, node->cast.type);
+            PRINT("\n");
+            return l;
         }
         break;
         case OP_METHOD_CALL: {
@@ -1132,9 +2631,15 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             for (e = node->methodcall.params; e != NULL; e = e->next)
                 paramLength++;
 
-            LLVMValue fnptr = emitExpression(out, node->methodcall.callback);
-            LLVMValue* parameters = malloc(sizeof(LLVMValue) * paramLength);
-            CheshireType* parameterTypes = malloc(sizeof(CheshireType) * paramLength);
+            LLVMValue fnptr;
+
+            if (isDirectCall(node->methodcall.callback, isShadowedCallee(node->methodcall.callback)))
+                fnptr = getMethodExport(node->methodcall.callback->unaryChild->string);
+            else
+                fnptr = emitExpression(out, node->methodcall.callback);
+
+            LLVMValue* parameters = memAlloc(MC_EMITTER_TEMPORARIES, sizeof(LLVMValue) * paramLength);
+            CheshireType* parameterTypes = memAlloc(MC_EMITTER_TEMPORARIES, sizeof(CheshireType) * paramLength);
 
             for (e = node->methodcall.params, i = 0; e != NULL; e = e->next, i++) {
                 parameters[i] = emitExpression(out, e->parameter);
@@ -1151,8 +2656,11 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
                 PRINT(" = ");
             }
 
-            PRINT("call fastcc ");
-            emitType(out, node->methodcall.callback->determinedType);
+            if (node->methodcall.tailCall != TC_NONE)
+                countTailCall();
+
+            PRINT("%scall fastcc ", getTailCallMarker(node->methodcall.tailCall));
+            emitFunctionType(out, node->methodcall.callback->determinedType);
             PRINT(" ");
             emitValue(out, fnptr);
             PRINT("(");
@@ -1166,9 +2674,9 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
                     PRINT(", ");
             }
 
-            free(parameters);
-            free(parameterTypes);
-            PRINT(")\n");
+            memFree(parameters);
+            memFree(parameterTypes);
+            PRINT(")%s\n", getMemoryAttribute(getCallEffects(node)));
             return l;
         }
         break;
@@ -1194,6 +2702,8 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             PRINT("    ");
             emitValue(out, array);
             PRINT(" = getelementptr ");
+            emitStructType(out, node->access.expression->determinedType);
+            PRINT(", ");
             emitType(out, node->access.expression->determinedType);
             PRINT(" ");
             emitValue(out, a);
@@ -1201,15 +2711,25 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             PRINT("    ");
             emitValue(out, arrayderef);
             PRINT(" = load ");
-            emitType(out, node->determinedType);
-            PRINT("** ");
+            emitPointerType(out, node->determinedType);
+            PRINT(", ");
+
+            if (opaque_pointers) {
+                PRINT("ptr ");
+            } else {
+                emitType(out, node->determinedType);
+                PRINT("** ");
+            }
+
             emitValue(out, array);
             PRINT("\n");
             PRINT("    ");
             emitValue(out, element);
             PRINT(" = getelementptr ");
             emitType(out, node->determinedType);
-            PRINT("* ");
+            PRINT(", ");
+            emitPointerType(out, node->determinedType);
+            PRINT(" ");
             emitValue(out, arrayderef);
             PRINT(", i32 ");
             emitValue(out, b);
@@ -1227,11 +2747,24 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             LLVMValue temp = getTemporaryStorage(UNIQUE_IDENTIFIER);
             PRINT("    ");
             emitValue(out, temp);
-            PRINT(" = getelementptr inbounds [%d x i8]* @.tempstring%d, i32 0, i32 0\n", stringlength, tempident);
+            PRINT(" = getelementptr inbounds [%d x i8], ", stringlength);
+
+            if (opaque_pointers) {
+                PRINT("ptr");
+            } else {
+                PRINT("[%d x i8]*", stringlength);
+            }
+
+            PRINT(" @.tempstring%d, i32 0, i32 0\n", tempident);
             LLVMValue constructed = getTemporaryStorage(UNIQUE_IDENTIFIER);
+            declareRuntime(RUNTIME_NEW_STRING);
             PRINT("    ");
             emitValue(out, constructed);
-            PRINT(" = call %%_Class_String* @_New_String(i8* ");
+            PRINT(" = call ");
+            emitType(out, TYPE_STRING);
+            PRINT(" @_New_String(");
+            emitNamedPointerType(out, "i8");
+            PRINT(" ");
             emitValue(out, temp);
             PRINT(", i32 %d)\n", stringlength);
             return constructed;
@@ -1239,6 +2772,7 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
         break;
         case OP_CLOSURE: {
             int closure_id = UNIQUE_IDENTIFIER;
+            int enclosing_label = current_label; //the closure body is a function of its own.
 
             if (node->closure.usingList == NULL) { //basically just a function...
                 FILE* oldout = out;
@@ -1258,28 +2792,15 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
                         PRINT(", ");
                 }
 
-                PRINT(") {\n");
+                PRINT(")%s {\n", getFunctionAttributes(getClosureEffects(node)));
+                RootFrame frame = beginRoots();
                 raiseVariableScope();
 
-                for (p = node->closure.params; p != NULL; p = p->next) {
-                    LLVMValue l = getParameterStorage(p->name);
-                    PRINT("    ");
-                    LLVMValue variable = getLocalVariableStorage(p->name);
-                    emitValue(out, variable);
-                    PRINT(" = alloca ");
-                    emitType(out, p->type);
-                    PRINT("\n");
-                    PRINT("    store ");
-                    emitType(out, p->type);
-                    PRINT(" ");
-                    emitValue(out, l);
-                    PRINT(", ");
-                    emitType(out, p->type);
-                    PRINT("* ");
-                    emitValue(out, variable);
-                    PRINT("\n");
-                    registerVariable(p->name, variable);
-                }
+                for (p = node->closure.params; p != NULL; p = p->next)
+                    bindParameter(out, p);
+
+                emitBodySlots(out, node->closure.body);
+                enterRoots(out, frame);
 
                 emitBlock(out, node->closure.body);
                 fallVariableScope();
@@ -1290,8 +2811,10 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
                     PRINT("    ret void\n");
                 }
 
+                endRoots(out, frame);
                 PRINT("}\n");
                 out = oldout;
+                current_label = enclosing_label;
                 return getClosureMethod(closure_id);
             } else {
                 raiseVariableScope();
@@ -1314,7 +2837,7 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
                 PRINT("}");
                 fseek(out, 0, SEEK_END);
                 int filesize = ftell(out);
-                nesttype = malloc(filesize + 1);
+                nesttype = memAlloc(MC_EMITTER_TEMPORARIES, filesize + 1);
                 fseek(out, 0, SEEK_SET);
                 int i;
 
@@ -1326,7 +2849,9 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
                 out = olderout;
                 PRINT("define fastcc ");
                 emitType(out, node->closure.type);
-                PRINT(" @_ClosureBody_%d(%s* nest %%_Unpacked", bodyid, nesttype);
+                PRINT(" @_ClosureBody_%d(", bodyid);
+                emitNamedPointerType(out, nesttype);
+                PRINT(" nest %%_Unpacked");
                 ParameterList* p;
                 UsingList* u;
 
@@ -1344,61 +2869,66 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
                     }
                 }
 
-                PRINT(") {\n");
+                PRINT(")%s {\n", getFunctionAttributes(getClosureEffects(node)));
+                RootFrame frame = beginRoots();
                 raiseVariableScope();
                 int id = 0;
 
                 for (u = node->closure.usingList; u != NULL; u = u->next, id++) {
+                    Boolean direct = isVariableValue(u->variable); //of the captured name, which the body shares.
                     LLVMValue variable = getLocalVariableStorage(u->variable);
                     LLVMValue l = getTemporaryStorage(UNIQUE_IDENTIFIER);
                     LLVMValue unpacked = getTemporaryStorage(UNIQUE_IDENTIFIER);
-                    PRINT("    ");
-                    emitValue(out, variable);
-                    PRINT(" = alloca ");
-                    emitType(out, u->type);
-                    PRINT("\n");
+
+                    if (!direct) {
+                        PRINT("    ");
+                        emitValue(out, variable);
+                        PRINT(" = alloca ");
+                        emitType(out, u->type);
+                        PRINT("\n");
+                    }
+
                     PRINT("    ");
                     emitValue(out, l);
-                    PRINT(" = getelementptr %s* %%_Unpacked, i32 0, i32 %d\n", nesttype, id);
+                    PRINT(" = getelementptr %s, ", nesttype);
+                    emitNamedPointerType(out, nesttype);
+                    PRINT(" %%_Unpacked, i32 0, i32 %d\n", id);
                     PRINT("    ");
                     emitValue(out, unpacked);
                     PRINT(" = load ");
                     emitType(out, u->type);
-                    PRINT("* ");
+                    PRINT(", ");
+                    emitPointerType(out, u->type);
+                    PRINT(" ");
                     emitValue(out, l);
                     PRINT("\n");
+
+                    if (direct) {
+                        registerVariableValue(u->variable, unpacked);
+                        continue;
+                    }
+
                     PRINT("    store ");
                     emitType(out, u->type);
                     PRINT(" ");
                     emitValue(out, unpacked);
                     PRINT(", ");
-                    emitType(out, u->type);
-                    PRINT("* ");
+                    emitPointerType(out, u->type);
+                    PRINT(" ");
                     emitValue(out, variable);
                     PRINT("\n");
                     registerVariable(u->variable, variable);
-                }
 
-                for (p = node->closure.params; p != NULL; p = p->next) {
-                    LLVMValue variable = getLocalVariableStorage(p->name);
-                    LLVMValue l = getParameterStorage(p->name);
-                    PRINT("    ");
-                    emitValue(out, variable);
-                    PRINT(" = alloca ");
-                    emitType(out, p->type);
-                    PRINT("\n");
-                    PRINT("    store ");
-                    emitType(out, p->type);
-                    PRINT(" ");
-                    emitValue(out, l);
-                    PRINT(", ");
-                    emitType(out, p->type);
-                    PRINT("* ");
-                    emitValue(out, variable);
-                    PRINT("\n");
-                    registerVariable(p->name, variable);
+                    if (getGarbageCollection() && isTracedType(u->type))
+                        registerRoot(variable, u->type, RK_PARAMETER);
                 }
 
+                for (p = node->closure.params; p != NULL; p = p->next)
+                    bindParameter(out, p);
+
+                emitBodySlots(out, node->closure.body);
+                enterRoots(out, frame);
+
                 emitBlock(out, node->closure.body);
                 fallVariableScope();
 
@@ -1408,96 +2938,144 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
                     PRINT("    ret void\n");
                 }
 
+                endRoots(out, frame);
                 PRINT("}\n\n");
                 fallVariableScope();
                 out = oldout;
-                LLVMValue storage = getTemporaryStorage(UNIQUE_IDENTIFIER);
+                current_label = enclosing_label;
                 LLVMValue functioncast = getTemporaryStorage(UNIQUE_IDENTIFIER);
-                PRINT("    ");
-                emitValue(out, storage);
-                PRINT(" = call fastcc i8* @malloc(i32 10)\n"); //todo: determine sizes...
-                PRINT("    ");
-                emitValue(out, functioncast);
-                PRINT(" = bitcast ");
-                emitType(out, node->closure.type);
-                PRINT("(%s*", nesttype);
+                declareRuntime(RUNTIME_TRAMPOLINE);
+                Boolean collected = getGarbageCollection(); //the collector frees the trampoline and environment.
+                LLVMValue storage = emitAllocation(out, collected ? -1 : getSizeClass(TRAMPOLINE_SIZE), getIntegerLiteral(TRAMPOLINE_SIZE));
 
-                if (node->closure.params != NULL) {
-                    PRINT(", "); //put extra comma for %_Packed
+                if (!opaque_pointers) {
+                    PRINT("    ");
+                    emitValue(out, functioncast);
+                    PRINT(" = bitcast ");
+                    emitType(out, node->closure.type);
+                    PRINT("(%s*", nesttype);
 
-                    for (p = node->closure.params; p != NULL; p = p->next) {
-                        emitType(out, p->type);
+                    if (node->closure.params != NULL) {
+                        PRINT(", "); //put extra comma for %_Packed
 
-                        if (p->next != NULL)
-                            PRINT(", ");
+                        for (p = node->closure.params; p != NULL; p = p->next) {
+                            emitType(out, p->type);
+
+                            if (p->next != NULL)
+                                PRINT(", ");
+                        }
                     }
+
+                    PRINT(")* @_ClosureBody_%d to i8*\n", bodyid);
+                }
+
+                int sizeClass = collected ? -1 : getSizeClass(getEnvironmentSize(node->closure.usingList));
+                LLVMValue size = getIntegerLiteral(0);
+
+                if (sizeClass < 0) {
+                    LLVMValue sizeptr = getTemporaryStorage(UNIQUE_IDENTIFIER);
+                    size = getTemporaryStorage(UNIQUE_IDENTIFIER);
+                    PRINT("    ");
+                    emitValue(out, sizeptr);
+                    PRINT(" = getelementptr %s, ", nesttype);
+                    emitNamedPointerType(out, nesttype);
+                    PRINT(" null, i32 1\n");
+                    PRINT("    ");
+                    emitValue(out, size);
+                    PRINT(" = ptrtoint ");
+                    emitNamedPointerType(out, nesttype);
+                    PRINT(" ");
+                    emitValue(out, sizeptr);
+                    PRINT(" to i32\n");
+                }
+
+                LLVMValue nest = emitAllocation(out, sizeClass, size);
+                LLVMValue nestcast = nest;
+
+                if (!opaque_pointers) {
+                    nestcast = getTemporaryStorage(UNIQUE_IDENTIFIER);
+                    PRINT("    ");
+                    emitValue(out, nestcast);
+                    PRINT(" = bitcast i8* ");
+                    emitValue(out, nest);
+                    PRINT(" to %s*\n", nesttype);
                 }
 
-                PRINT(")* @_ClosureBody_%d to i8*\n", bodyid);
-                LLVMValue sizeptr = getTemporaryStorage(UNIQUE_IDENTIFIER);
-                LLVMValue size = getTemporaryStorage(UNIQUE_IDENTIFIER);
-                PRINT("    ");
-                emitValue(out, sizeptr);
-                PRINT(" = getelementptr %s* null, i32 1\n", nesttype);
-                PRINT("    ");
-                emitValue(out, size);
-                PRINT(" = ptrtoint %s* ", nesttype);
-                emitValue(out, sizeptr);
-                PRINT(" to i32\n");
-                LLVMValue nest = getTemporaryStorage(UNIQUE_IDENTIFIER);
-                PRINT("    ");
-                emitValue(out, nest);
-                PRINT(" = call fastcc i8* @malloc(i32 ");
-                emitValue(out, size);
-                PRINT(")\n");
-                LLVMValue nestcast = getTemporaryStorage(UNIQUE_IDENTIFIER);
-                PRINT("    ");
-                emitValue(out, nestcast);
-                PRINT(" = bitcast i8* ");
-                emitValue(out, nest);
-                PRINT(" to %s*\n", nesttype);
                 id = 0;
 
-                for (u = node->closure.usingList; u != NULL; u = u->next) {
+                for (u = node->closure.usingList; u != NULL; u = u->next, id++) {
                     LLVMValue element = getTemporaryStorage(UNIQUE_IDENTIFIER);
                     PRINT("    ");
                     emitValue(out, element);
-                    PRINT(" = getelementptr %s* ", nesttype);
+                    PRINT(" = getelementptr %s, ", nesttype);
+                    emitNamedPointerType(out, nesttype);
+                    PRINT(" ");
                     emitValue(out, nestcast);
                     PRINT(", i32 0, i32 %d\n", id);
-                    LLVMValue loaded = getTemporaryStorage(UNIQUE_IDENTIFIER);
-                    LLVMValue variable = fetchVariable(u->variable);
-                    PRINT("    ");
-                    emitValue(out, loaded);
-                    PRINT(" = load ");
-                    emitType(out, u->type);
-                    PRINT("* ");
-                    emitValue(out, variable);
-                    PRINT("\n");
+                    LLVMValue loaded = emitVariableRead(out, u->variable, u->type);
                     PRINT("    store ");
                     emitType(out, u->type);
                     PRINT(" ");
                     emitValue(out, loaded);
                     PRINT(", ");
-                    emitType(out, u->type);
-                    PRINT("* ");
+                    emitPointerType(out, u->type);
+                    PRINT(" ");
                     emitValue(out, element);
                     PRINT("\n");
                 }
 
-                PRINT("    call void @llvm.init.trampoline(i8* ");
+                const char* bytePointer = opaque_pointers ? "ptr" : "i8*";
+                PRINT("    call void @llvm.init.trampoline(%s ", bytePointer);
                 emitValue(out, storage);
-                PRINT(", i8* ");
-                emitValue(out, functioncast);
-                PRINT(", i8* ");
+                PRINT(", %s ", bytePointer);
+
+                if (opaque_pointers) {
+                    PRINT("@_ClosureBody_%d", bodyid);
+                } else {
+                    emitValue(out, functioncast);
+                }
+
+                PRINT(", %s ", bytePointer);
                 emitValue(out, nest);
                 PRINT(")\n");
                 LLVMValue outfunction = getTemporaryStorage(UNIQUE_IDENTIFIER);
                 PRINT("    ");
                 emitValue(out, outfunction);
-                PRINT(" = call i8* @llvm.adjust.trampoline(i8* ");
+                PRINT(" = call %s @llvm.adjust.trampoline(%s ", bytePointer, bytePointer);
                 emitValue(out, storage);
                 PRINT(")\n");
+
+                if (collected) { //its environment is traced, and freed with it, once nothing reaches the closure.
+                    CheshireType* types = memAlloc(MC_EMITTER_TEMPORARIES, sizeof(CheshireType) * id);
+                    char map[32];
+                    sprintf(map, "_EnvironmentMap_%d", bodyid);
+
+                    for (u = node->closure.usingList, i = 0; u != NULL; u = u->next, i++)
+                        types[i] = u->type;
+
+                    FILE* function = out;
+                    out = newPreamble();
+                    int entries = emitPointerMap(out, map, nesttype, types, id);
+                    out = function;
+                    memFree(types);
+                    declareRuntime(RUNTIME_GC);
+                    countPointerMap(TRUE, entries);
+                    PRINT("    call void @_cheshire_gc_add_closure(%s ", bytePointer);
+                    emitValue(out, outfunction);
+                    PRINT(", %s ", bytePointer);
+                    emitValue(out, storage);
+                    PRINT(", %s ", bytePointer);
+                    emitValue(out, nest);
+                    PRINT(", ");
+                    emitPointerMapReference(out, map, entries);
+                    PRINT(")\n");
+                }
+
+                memFree(nesttype);
+
+                if (opaque_pointers)
+                    return outfunction;
+
                 LLVMValue outfunctioncast = getTemporaryStorage(UNIQUE_IDENTIFIER);
                 PRINT("    ");
                 emitValue(out, outfunctioncast);
@@ -1506,35 +3084,43 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
                 PRINT(" to ");
                 emitType(out, node->determinedType);
                 PRINT("\n");
-                free(nesttype);
                 return outfunctioncast;
             }
         }
         break;
         case OP_INSTANTIATION: {
-            LLVMValue size = emitSizeOfClass(out, node->instantiate.type);
-            LLVMValue mallocated = getTemporaryStorage(UNIQUE_IDENTIFIER);
-            LLVMValue casted = getTemporaryStorage(UNIQUE_IDENTIFIER);
-            PRINT("    ");
-            emitValue(out, mallocated);
-            PRINT(" = call fastcc i8* @malloc(i32 ");
-            emitValue(out, size);
-            PRINT(")\n");
-            PRINT("    ");
-            emitValue(out, casted);
-            PRINT(" = bitcast i8* ");
-            emitValue(out, mallocated);
-            PRINT(" to ");
-            emitType(out, node->instantiate.type);
-            PRINT("\n");
+            LLVMValue casted;
+
+            if (isStackAllocated(node)) {
+                casted = takeEntryObject(node);
+
+                if (getGarbageCollection()) //traced from its root, like the collected objects, which start zeroed.
+                    emitStackObjectClear(out, casted, node->instantiate.type);
+            } else if (opaque_pointers) {
+                casted = emitObjectAllocation(out, node->instantiate.type);
+            } else {
+                LLVMValue mallocated = emitObjectAllocation(out, node->instantiate.type);
+                casted = getTemporaryStorage(UNIQUE_IDENTIFIER);
+                PRINT("    ");
+                emitValue(out, casted);
+                PRINT(" = bitcast i8* ");
+                emitValue(out, mallocated);
+                PRINT(" to ");
+                emitType(out, node->instantiate.type);
+                PRINT("\n");
+            }
+
+            if (getGarbageCollection()) //before its arguments and constructor, which may collect.
+                emitRootStore(out, casted, node->instantiate.type);
+
             int paramLength = 1;
             ExpressionList* e;
 
             for (e = node->instantiate.params; e != NULL; e = e->next)
                 paramLength++;
 
-            LLVMValue* parameters = malloc(sizeof(LLVMValue) * paramLength);
-            CheshireType* parameterTypes = malloc(sizeof(CheshireType) * paramLength);
+            LLVMValue* parameters = memAlloc(MC_EMITTER_TEMPORARIES, sizeof(LLVMValue) * paramLength);
+            CheshireType* parameterTypes = memAlloc(MC_EMITTER_TEMPORARIES, sizeof(CheshireType) * paramLength);
             parameters[0] = casted;
             parameterTypes[0] = node->instantiate.type;
             int i;
@@ -1545,6 +3131,10 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             }
 
             char* name = getNamedTypeString(node->instantiate.type);
+
+            if (equalTypes(node->instantiate.type, TYPE_OBJECT))
+                declareRuntime(RUNTIME_NEW_OBJECT);
+
             PRINT("    call fastcc void @_New_%s(", name);
             free(name);
 
@@ -1557,91 +3147,143 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
                     PRINT(", ");
             }
 
-            free(parameters);
-            free(parameterTypes);
+            memFree(parameters);
+            memFree(parameterTypes);
             PRINT(")\n");
             return casted;
         }
         break;
         case OP_OBJECT_CALL: {
-            LLVMValue l;
+            CheshireType objectType = node->objectcall.object->determinedType;
+            CheshireType methodType = getClassVariable(objectType, node->objectcall.method);
             LLVMValue object = emitExpression(out, node->objectcall.object);
+            int targets = getCallTargetCount(node);
+            LLVMValue fnptr;
             int i;
-            // -- DEALLOCATING FUNCTION POINTER FROM OBJECT -- //
-            LLVMValue fnptr_ptr = getTemporaryStorage(UNIQUE_IDENTIFIER);
-            LLVMValue fnptr = getTemporaryStorage(UNIQUE_IDENTIFIER);
-            PRINT("    ");
-            emitValue(out, fnptr_ptr);
-            PRINT(" = getelementptr ");
-            emitType(out, node->objectcall.object->determinedType);
-            PRINT(" ");
-            emitValue(out, object);
-            PRINT(", i32 0, i32 %d\n", getObjectElement(node->objectcall.object->determinedType, node->objectcall.method));
-            PRINT("    ");
-            emitValue(out, fnptr);
-            PRINT(" = load ");
-            emitType(out, getClassVariable(node->objectcall.object->determinedType, node->objectcall.method));
-            PRINT("* ");
-            emitValue(out, fnptr_ptr);
-            PRINT("\n");
+
+            if (targets != 1) {
+                // -- DEALLOCATING FUNCTION POINTER FROM OBJECT -- //
+                LLVMValue fnptr_ptr = emitMemberAddress(out, object, objectType, node->objectcall.method);
+                fnptr = getTemporaryStorage(UNIQUE_IDENTIFIER);
+                PRINT("    ");
+                emitValue(out, fnptr);
+                PRINT(" = load ");
+                emitType(out, methodType);
+                PRINT(", ");
+                emitPointerType(out, methodType);
+                PRINT(" ");
+                emitValue(out, fnptr_ptr);
+                PRINT("\n");
+            }
+
             int paramLength = 1;
             ExpressionList* e;
 
             for (e = node->objectcall.params; e != NULL; e = e->next)
                 paramLength++;
 
-            LLVMValue* parameters = malloc(sizeof(LLVMValue) * paramLength);
-            CheshireType* parameterTypes = malloc(sizeof(CheshireType) * paramLength);
-            emitNonTypecheckedUpcast(out, &(parameters[0]), &(parameterTypes[0]), object, node->objectcall.object->determinedType, getObjectSelfType(node->objectcall.object->determinedType, node->objectcall.method));
+            LLVMValue* parameters = memAlloc(MC_EMITTER_TEMPORARIES, sizeof(LLVMValue) * paramLength);
+            CheshireType* parameterTypes = memAlloc(MC_EMITTER_TEMPORARIES, sizeof(CheshireType) * paramLength);
 
             for (e = node->objectcall.params, i = 1; e != NULL; e = e->next, i++) {
                 parameters[i] = emitExpression(out, e->parameter);
                 parameterTypes[i] = e->parameter->determinedType;
             }
 
-            if (isVoid(node->determinedType)) {
-                l.type = LVT_VOID;
-                PRINT("    ");
-            } else {
-                l = getTemporaryStorage(UNIQUE_IDENTIFIER);
-                PRINT("    ");
-                emitValue(out, l);
-                PRINT(" = ");
+            if (targets == 0) {
+                emitNonTypecheckedUpcast(out, &(parameters[0]), &(parameterTypes[0]), object, objectType, getObjectSelfType(objectType, node->objectcall.method));
+                LLVMValue l = emitObjectCallArm(out, node, fnptr, methodType, parameters, parameterTypes, paramLength);
+                memFree(parameters);
+                memFree(parameterTypes);
+                return l;
             }
 
-            PRINT("call fastcc ");
-            emitType(out, node->determinedType);
-            PRINT(" ");
-            emitValue(out, fnptr);
-            PRINT("(");
+            //devirtualized: each target but the last is guarded by comparing it with the method in the vtable.
+            int labelexit = UNIQUE_IDENTIFIER;
+            LLVMValue* results = memAlloc(MC_EMITTER_TEMPORARIES, sizeof(LLVMValue) * targets);
+            int* labels = memAlloc(MC_EMITTER_TEMPORARIES, sizeof(int) * targets);
+
+            for (i = 0; i < targets; i++) {
+                CheshireType definer;
+                ClassList* method = getCallTarget(node, i, &definer);
+                CheshireType type = getLambdaType(method->method.returnType, method->method.params);
+                char* definerName = getNamedTypeString(definer);
+                LLVMValue target = getClassMethodStorage(definerName, method->method.name);
+                int labelnext = UNIQUE_IDENTIFIER;
+
+                if (i != targets - 1) {
+                    int labeltarget = UNIQUE_IDENTIFIER;
+                    LLVMValue matches = getTemporaryStorage(UNIQUE_IDENTIFIER);
+                    PRINT("    ");
+                    emitValue(out, matches);
+                    PRINT(" = icmp eq ");
+                    emitType(out, methodType);
+                    PRINT(" ");
+                    emitValue(out, fnptr);
+                    PRINT(", ");
 
-            for (i = 0; i < paramLength; i++) {
-                emitType(out, parameterTypes[i]);
-                PRINT(" ");
-                emitValue(out, parameters[i]);
+                    if (!opaque_pointers && !equalTypes(type, methodType)) {
+                        PRINT("bitcast (");
+                        emitType(out, type);
+                        PRINT(" ");
+                        emitValue(out, target);
+                        PRINT(" to ");
+                        emitType(out, methodType);
+                        PRINT(")");
+                    } else
+                        emitValue(out, target);
+
+                    PRINT("\n    br i1 ");
+                    emitValue(out, matches);
+                    PRINT(", label %%label%d, label %%label%d\n", labeltarget, labelnext);
+                    LABEL(labeltarget);
+                }
 
-                if (i != paramLength - 1)
-                    PRINT(", ");
+                emitNonTypecheckedUpcast(out, &(parameters[0]), &(parameterTypes[0]), object, objectType, definer);
+                results[i] = emitObjectCallArm(out, node, target, type, parameters, parameterTypes, paramLength);
+                labels[i] = current_label;
+                free(definerName);
+
+                if (targets > 1)
+                    PRINT("    br label %%label%d\n", labelexit);
+
+                if (i != targets - 1)
+                    LABEL(labelnext);
             }
 
-            free(parameters);
-            free(parameterTypes);
-            PRINT(")\n");
+            LLVMValue l = results[0];
+
+            if (targets > 1) {
+                LABEL(labelexit);
+
+                if (!isVoid(node->determinedType)) {
+                    l = getTemporaryStorage(UNIQUE_IDENTIFIER);
+                    PRINT("    ");
+                    emitValue(out, l);
+                    PRINT(" = phi ");
+                    emitType(out, node->determinedType);
+
+                    for (i = 0; i < targets; i++) {
+                        PRINT(i == 0 ? " [" : ", [");
+                        emitValue(out, results[i]);
+                        PRINT(", %%label%d]", labels[i]);
+                    }
+
+                    PRINT("\n");
+                }
+            }
+
+            memFree(results);
+            memFree(labels);
+            memFree(parameters);
+            memFree(parameterTypes);
             return l;
         }
         break;
         case OP_ACCESS: {
             // -- DEALLOCATING FUNCTION POINTER FROM OBJECT -- //
             LLVMValue object = emitExpression(out, node->access.expression);
-            LLVMValue var = getTemporaryStorage(UNIQUE_IDENTIFIER);
-            PRINT("    ");
-            emitValue(out, var);
-            PRINT(" = getelementptr ");
-            emitType(out, node->access.expression->determinedType);
-            PRINT(" ");
-            emitValue(out, object);
-            PRINT(", i32 0, i32 %d\n", getObjectElement(node->access.expression->determinedType, node->access.variable));
-            return var;
+            return emitMemberAddress(out, object, node->access.expression->determinedType, node->access.variable);
         }
         break;
         case OP_LENGTH: {
@@ -1651,13 +3293,17 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             PRINT("    ");
             emitValue(out, lptr);
             PRINT(" = getelementptr ");
+            emitStructType(out, node->unaryChild->determinedType);
+            PRINT(", ");
             emitType(out, node->unaryChild->determinedType);
             PRINT(" ");
             emitValue(out, child);
             PRINT(", i32 0, i32 0\n");
             PRINT("    ");
             emitValue(out, lderef);
-            PRINT(" = load i32* ");
+            PRINT(" = load i32, ");
+            emitNamedPointerType(out, "i32");
+            PRINT(" ");
             emitValue(out, lptr);
             PRINT("\n");
             return lderef;
@@ -1669,13 +3315,15 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             PRINT("    br i1 ");
             emitValue(out, condition);
             PRINT(", label %%label%d, label %%label%d\n", labeltrue, labelfalse);
-            PRINT("label%d:\n", labeltrue);
+            LABEL(labeltrue);
             LLVMValue iftrue = emitExpression(out, node->choose.iftrue);
+            int truelabel = current_label;
             PRINT("    br label %%label%d\n", labelexit);
-            PRINT("label%d:\n", labelfalse);
+            LABEL(labelfalse);
             LLVMValue iffalse = emitExpression(out, node->choose.iffalse);
+            int falselabel = current_label;
             PRINT("    br label %%label%d\n", labelexit);
-            PRINT("label%d:\n", labelexit);
+            LABEL(labelexit);
             LLVMValue phi = getTemporaryStorage(UNIQUE_IDENTIFIER);
             PRINT("    ");
             emitValue(out, phi);
@@ -1683,9 +3331,9 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
             emitType(out, node->choose.iffalse->determinedType);
             PRINT(" [");
             emitValue(out, iftrue);
-            PRINT(", %%label%d], [", labeltrue);
+            PRINT(", %%label%d], [", truelabel);
             emitValue(out, iffalse);
-            PRINT(", %%label%d]\n", labelfalse);
+            PRINT(", %%label%d]\n", falselabel);
             return phi;
         }
         break;
@@ -1696,19 +3344,23 @@ LLVMValue emitExpression(FILE* out, ExpressionNode* node) {
 
 void emitType(FILE* out, CheshireType type) { //object types have implicit *, remember. Object* not Object
     if (type.arrayNesting > 0) {
-        type.arrayNesting--;
-        PRINT("{i32, ");
-        emitType(out, type); //emit with one less nesting.
-        PRINT("*}*");
+        if (opaque_pointers) {
+            PRINT("ptr");
+        } else {
+            emitStructType(out, type);
+            PRINT("*");
+        }
+
         return;
     }
 
-    if (isNull(type)) {
+    if (opaque_pointers && (isNull(type) || isObjectType(type) || isLambdaType(type))) {
+        PRINT("ptr");
+    } else if (isNull(type)) {
         PRINT("i8*"); //nulltype eventually gets casted...
     } else if (isObjectType(type)) {
-        char* name = getNamedTypeString(type);
-        PRINT("%%_Class_%s*", name); //classname
-        free(name);
+        emitStructType(out, type);
+        PRINT("*");
     } else if (isNumericalType(type) || isBoolean(type)) {
         switch (type.typeKey) {
             case 1: //I8
@@ -1738,6 +3390,19 @@ void emitType(FILE* out, CheshireType type) { //object types have implicit *, re
         PANIC("Unknown type!");
 }
 
+void emitStructType(FILE* out, CheshireType type) { //what an object or array reference points to.
+    if (type.arrayNesting > 0) {
+        type.arrayNesting--;
+        PRINT("{i32, ");
+        emitPointerType(out, type); //emit with one less nesting.
+        PRINT("}");
+    } else {
+        char* name = getNamedTypeString(type);
+        PRINT("%%_Class_%s", name); //classname
+        free(name);
+    }
+}
+
 void emitValue(FILE* out, LLVMValue value) {
     switch (value.type) {
         case LVT_GLOBAL_VARIABLE:
@@ -1761,9 +3426,12 @@ void emitValue(FILE* out, LLVMValue value) {
         case LVT_INT_LITERAL:
             PRINT("%lld", value.value);
             break;
-        case LVT_DOUBLE_LITERAL:
-            PRINT("%.6le", value.decimal);
-            break;
+        case LVT_DOUBLE_LITERAL: { //hexadecimal is the only exact way to write a double.
+            uint64_t bits;
+            memcpy(&bits, &value.decimal, sizeof(bits));
+            PRINT("0x%016llX", (unsigned long long) bits);
+        }
+        break;
         case LVT_VOID:
             PRINT("void");
             break;
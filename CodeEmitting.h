@@ -9,11 +9,37 @@
 
 #include <stdio.h>
 #include "Structures.h"
+#include "Purity.h"
 
 #ifdef	__cplusplus
 extern "C" {
 #endif
 
+#define RUNTIME_MALLOC 1
+#define RUNTIME_NEW_STRING 2
+#define RUNTIME_ASSERT 4
+#define RUNTIME_TRAMPOLINE 8
+#define RUNTIME_CLASSES 16
+#define RUNTIME_NEW_OBJECT 32
+#define RUNTIME_LIFETIME 64
+#define RUNTIME_TYPE_DESCRIPTOR 128
+#define RUNTIME_MEMCPY 256
+#define RUNTIME_ALLOC 512
+#define RUNTIME_MEMSET 1024
+#define RUNTIME_GC 2048
+
+#define DEFAULT_OPTIMIZATION_LEVEL 2
+#define MAX_GUARDED_TARGETS 3
+#define COLD_ACCESS_RATIO 8
+#define SIZE_CLASS_GRANULE 16
+#define SIZE_CLASS_COUNT 16
+#define DELETED_POISON 0xA5
+#define GC_HEADER_SIZE 8
+#define GC_CLOSURE_NESTING 0x10000 //added to the nesting of a closure, or of an array of closures, in maps and roots.
+
+    typedef enum { FL_DECLARED, FL_PACKED, FL_HOT_COLD } FieldLayout;
+    typedef enum { RK_TEMPORARY, RK_LOCAL, RK_PARAMETER } RootKind; //allocated with the roots, in the entry block, or stored there.
+
     void forwardDefinition(ParserTopNode*);
     void emitCode(FILE*, ParserTopNode*);
     void emitBlock(FILE*, BlockList*);
@@ -22,17 +48,135 @@ extern "C" {
     void emitValue(FILE*, LLVMValue);
     void emitType(FILE*, CheshireType);
     void emitLambdaType(FILE*, CheshireType);
+    void emitFunctionType(FILE*, CheshireType);
+    void emitStructType(FILE*, CheshireType);
+    void emitPointerType(FILE*, CheshireType);
+    void emitNamedPointerType(FILE*, const char* type);
+
+    const char* getTailCallMarker(TailCallKind); //"tail " or "musttail " before a call, see TailCalls.h.
+    LLVMValue getMethodExport(char* name); //the @_MethodImpl_ held by a method's @_M_ constant, which calls use directly.
+    void registerTopMethod(ParserTopNode*); //of every top node, before markTailCalls.
+    Boolean isDirectCall(ExpressionNode* callback, Boolean shadowed); //through getMethodExport, unless a local shadows it.
+    int newUniqueIdentifier(void); //shared with the mid-level IR so value and label names never collide.
+    void declareRuntime(int function);
+    void emitLifetimeMarker(FILE*, Boolean start, LLVMValue slot, CheshireType);
+
+    void setOpaquePointers(Boolean);
+    Boolean usingOpaquePointers(void);
+
+    //-O0 leaves out lifetime markers and marks every function noinline optnone, so LLVM spends no time on them.
+    void setOptimizationLevel(int);
+    int getOptimizationLevel(void);
+    const char* getFunctionAttributes(MemoryEffects); //printed between a definition's parameters and its body.
+    void emitSelfAttributes(FILE*, CheshireType); //of the self parameter of class methods and constructors.
 
     void initCodeEmitting(void);
     void freeCodeEmitting(void);
     void raiseVariableScope(void);
     void fallVariableScope(void);
-    void registerVariable(char* name, LLVMValue);
+    void registerVariable(char* name, LLVMValue); //a slot, read with a load.
+    void registerVariableValue(char* name, LLVMValue); //a name that is never assigned, bound straight to its value.
     LLVMValue fetchVariable(char* name);
+    Boolean isVariableValue(char* name);
+    void registerLocalSlot(char* name, LLVMValue slot, CheshireType); //a slot whose lifetime ends with the scope.
+    void endLocalLifetimes(FILE*); //of the slots registered in the innermost scope, before it falls.
+
+    //slots of locals are allocated in the entry block, ahead of the body that defines them.
+    void registerEntrySlot(StatementNode* definition, LLVMValue slot);
+    LLVMValue takeEntrySlot(StatementNode* definition);
+
+    //and so are the objects of the instantiations Escape.h puts on the stack, which are then constructed in place.
+    LLVMValue emitStackObject(FILE*, CheshireType); //an alloca of the class's struct.
+    void registerEntryObject(ExpressionNode* instantiation, LLVMValue object);
+    LLVMValue takeEntryObject(ExpressionNode* instantiation);
 
+    //an object holds its vtable, its fields and the methods something assigns; every other method is a slot of the one
+    //constant vtable of its class, which starts with the slots of the parent's.
     ClassShape* getClassShape(CheshireType);
+    ClassShape* getVTableShape(CheshireType);
     int getObjectElement(CheshireType, const char* elementName);
+    int getVTableElement(CheshireType, const char* methodName); //-1 if the method is held by the object.
+    ClassList* getMethodImplementation(CheshireType, const char* methodName, CheshireType* definer);
+    int getObjectSize(CheshireType); //a lower bound: the sizes of the fields, without padding.
     CheshireType getObjectSelfType(CheshireType object, const char* methodname);
+    LLVMValue emitMemberAddress(FILE*, LLVMValue object, CheshireType, const char* name); //of a field or method slot.
+
+    //the first slot of every vtable points to its class's type descriptor, {depth, display, @_Delete_}: the display
+    //holds the descriptors of the class's ancestors and itself, indexed by depth (0 for a child of Object) and padded
+    //with null to the depth of the deepest class, so an instanceof test is three loads and a compare, with no bounds
+    //check.
+    int getClassDepth(CheshireType);
+    CheshireType getParentClass(CheshireType);
+    int getDisplaySize(void);
+    Boolean isCheckedCast(CheshireType from, CheshireType to); //a downcast to a class, which tests the type at runtime.
+    LLVMValue emitTypeTest(FILE*, LLVMValue object, CheshireType from, CheshireType to); //of an object that is not null.
+    void printClassLayoutReport(FILE*); //the object sizes and constructor stores of the classes emitted, and the savings.
+
+    //the members a class adds follow those it inherits, packed by default: each next is the one needing the least
+    //padding, the largest of those. FL_HOT_COLD first packs the members accessed at least 1/COLD_ACCESS_RATIO as often
+    //as the class's most accessed one (see getMemberAccesses), then the rest, so the hot ones share a cache line with
+    //the vtable. Members are aligned to their size, with 8 byte pointers.
+    void setFieldLayout(FieldLayout);
+
+    //a class whose fields (its own and inherited) all default to constants, and that holds no method slots, has a
+    //constant prototype object @_Proto_<class>: its @_New_ copies it over the new object and calls @_Init_, which runs
+    //the constructor bodies of the class and its ancestors, each after storing its class's vtable, without storing a
+    //single default. A class without any constructor in its chain has no @_Init_.
+    void setPrototypes(Boolean);
+    Boolean hasPrototype(CheshireType);
+    Boolean hasInitializer(CheshireType); //whether it or an ancestor has a constructor.
+    ExpressionNode* getPrototypeValue(CheshireType, const char* member); //the default of a field.
+
+    //with pooled allocation, objects, closure environments and trampolines of up to SIZE_CLASS_COUNT granules of
+    //SIZE_CLASS_GRANULE bytes come from the runtime's _cheshire_alloc(size class), which returns at least
+    //(class + 1) * SIZE_CLASS_GRANULE bytes from a free list of that class; everything else from malloc(size).
+    void setPooledAllocation(Boolean);
+    int getSizeClass(int size); //-1 for malloc.
+    int getAllocationSize(CheshireType); //of an object of a class, as laid out with 8 byte pointers, or -1 if unknown.
+    int getEnvironmentSize(UsingList* captures);
+
+    //"delete" puts an object on the free list of its class, which "new" of that class takes from first. Classes no
+    //delete can reach (see isDeletedClass) have no free list, and "new" allocates them directly.
+    LLVMValue emitObjectAllocation(FILE*, CheshireType); //an i8*.
+    void emitDelete(FILE*, LLVMValue object, CheshireType); //of an object that is not null.
+    Boolean isLeafClass(CheshireType); //no emitted class, or class of another module, inherits from it.
+    void setPoisonDeleted(Boolean); //fills deleted objects with DELETED_POISON, checked when they are reused.
+    Boolean getPoisonDeleted(void);
+
+    //with garbage collection, "new" bumps @_cheshire_gc_next up to @_cheshire_gc_limit, past a GC_HEADER_SIZE header
+    //holding the object's size, or calls the runtime's _cheshire_gc_allocate(size), which may collect; the memory is
+    //zeroed, and delete does nothing. A type descriptor is {depth, pointer map, display}, the map {count, [count x
+    //{offset, nesting}]}, where nesting is 0 for an object and that of an array of objects, plus GC_CLOSURE_NESTING
+    //for closures. Functions use LLVM's "shadow-stack" strategy, with a root, whose metadata is its nesting, for each
+    //traced slot and each traced value loaded, returned by a call or created; globals are passed to
+    //_cheshire_gc_add_roots(address, pointer map), and each closure with captures, with its malloc'd trampoline and
+    //environment and the environment's map, to _cheshire_gc_add_closure, which frees them once the closure is not
+    //reached. The collector, runtime/Collector.c, must not move objects, and traces those outside its heap without
+    //freeing them. Only a function without roots keeps its tail calls, see TailCalls.h.
+    void setGarbageCollection(Boolean);
+    Boolean getGarbageCollection(void);
+    Boolean isTracedType(CheshireType); //objects and closures, or arrays of them.
+    int getTracedNesting(CheshireType); //with GC_CLOSURE_NESTING for closures.
+    void raiseRootFrame(void); //of a function, whose roots are allocated after its body.
+    void fallRootFrame(void);
+    void registerRoot(LLVMValue slot, CheshireType, RootKind);
+    void countTailCall(void); //in the function being emitted, which must then have no roots.
+    int getTailCallCount(void);
+    int getRootCount(void); //of the innermost function.
+    LLVMValue getRoot(int index, CheshireType*, RootKind*);
+    void registerGlobalRoot(char* name, CheshireType);
+    int getGlobalRootCount(void);
+    char* getGlobalRoot(int index, CheshireType*);
+    void emitGlobalRoots(FILE*); //registers the module's traced globals from @llvm.global_ctors, after every node.
+    void countPointerMap(Boolean environment, int entries);
+    void printGarbageCollectionReport(FILE*);
+
+    //class hierarchy analysis of a whole program: an object call whose method no emitted subclass overrides, or that
+    //is final, calls the one implementation directly; one with up to MAX_GUARDED_TARGETS compares the vtable slot with
+    //each but the last. 0 targets is an indirect call through the slot.
+    void setDevirtualization(Boolean);
+    int getCallTargetCount(ExpressionNode* objectCall);
+    ClassList* getCallTarget(ExpressionNode* objectCall, int index, CheshireType* definer); //the index'th implementation, and the class defining it.
 
     FILE* newPreamble(void);
     void flushPreambles(FILE* out);
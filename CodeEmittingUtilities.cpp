@@ -1,21 +1,55 @@
 #include <unordered_map>
+#include <map>
+#include <string>
 #include <list>
+#include <vector>
+#include <algorithm>
 #include "TypeSystem.h"
 #include "TypeSystemUtilities.hpp"
 #include "CodeEmitting.h"
-
-typedef std::unordered_map<char*, LLVMValue, CStrHash, CStrEql> TypeScope;
-typedef std::unordered_map<CheshireType, ClassShape*, CheshireTypeHash, CheshireTypeEql> ClassShapes;
+#include "ConstantFolding.h"
+#include "DeadCode.h"
+#include "TimeReport.h"
+#include "MemReport.h"
+
+typedef struct {
+    LLVMValue value;
+    Boolean direct; //the value itself rather than a slot holding it.
+} VariableBinding;
+
+typedef std::unordered_map<char*, VariableBinding, CStrHash, CStrEql> TypeScope;
+typedef std::pair<LLVMValue, CheshireType> Lifetime;
+typedef std::pair<ClassList*, CheshireType> CallTarget; //an implementation, and the class defining it.
+typedef std::pair<LLVMValue, std::pair<CheshireType, RootKind> > Root;
+typedef std::unordered_map<CheshireType, ClassShape*, CheshireTypeHash, CheshireTypeEql,
+        MemReportAllocator<std::pair<const CheshireType, ClassShape*>, MC_CLASS_SHAPES> > ClassShapes;
 static std::list<TypeScope> scope;
+static std::list<std::vector<Lifetime> > lifetimes; //slots whose lifetime started in each scope, in order.
+static std::unordered_map<StatementNode*, LLVMValue> entrySlots;
+static std::unordered_map<ExpressionNode*, LLVMValue> entryObjects;
 static std::list<FILE*> preambleList;
 
 ClassShapes classShapes;
+static ClassShapes vtableShapes;
+static std::map<std::pair<TypeKey, std::string>, std::vector<CallTarget> > callTargets;
+static Boolean devirtualization = TRUE;
+static FieldLayout fieldLayout = FL_PACKED;
+static Boolean prototypes = TRUE;
+static Boolean pooledAllocation = FALSE;
+static Boolean poisonDeleted = FALSE;
+static Boolean garbageCollection = FALSE;
+static std::unordered_map<std::string, Boolean> topMethods; //declared or defined at the top level.
+static std::list<std::vector<Root> > rootFrames; //of the functions being emitted, innermost first.
+static std::list<int> frameTailCalls; //marked in each of rootFrames.
+static std::vector<std::pair<char*, CheshireType> > globalRoots;
+static int rootedFunctions = 0, stackRoots = 0, pointerMaps = 0, mapEntries = 0, environmentMaps = 0;
+static std::unordered_map<TypeKey, int> declaredEnds; //where each class's members would end in declaration order.
 extern ObjectMapping objectMapping;
 extern AncestryMap ancestryMap;
 extern KeyedLambdas keyedLambdas;
 
 static ClassShape* allocClassShape(CheshireType type, const char* name) {
-    ClassShape* ret = (ClassShape*) malloc(sizeof(ClassShape));
+    ClassShape* ret = (ClassShape*) memAlloc(MC_CLASS_SHAPES, sizeof(ClassShape));
 
     if (ret == NULL)
         PANIC_OR_RETURN_NULL;
@@ -58,32 +92,102 @@ void freeCodeEmitting() {
     for (ClassShapes::iterator i = classShapes.begin(); i != classShapes.end(); ++i) {
         deleteClassShape(i->second);
     }
+
+    for (ClassShapes::iterator i = vtableShapes.begin(); i != vtableShapes.end(); ++i) {
+        deleteClassShape(i->second);
+    }
+
+    callTargets.clear();
+    declaredEnds.clear();
 }
 
 void raiseVariableScope() {
     scope.push_front(TypeScope());
+    lifetimes.push_front(std::vector<Lifetime>());
 }
 
 void fallVariableScope(void) {
     scope.pop_front();
+    lifetimes.pop_front();
+}
+
+void registerLocalSlot(char* name, LLVMValue slot, CheshireType type) {
+    registerVariable(name, slot);
+    lifetimes.front().push_back(Lifetime(slot, type));
+}
+
+void endLocalLifetimes(FILE* out) {
+    std::vector<Lifetime>& started = lifetimes.front();
+
+    for (size_t i = started.size(); i > 0; i--)
+        emitLifetimeMarker(out, FALSE, started[i - 1].first, started[i - 1].second);
+}
+
+void registerEntrySlot(StatementNode* definition, LLVMValue slot) {
+    entrySlots[definition] = slot;
+}
+
+LLVMValue takeEntrySlot(StatementNode* definition) {
+    auto found = entrySlots.find(definition);
+    ERROR_IF(found == entrySlots.end(), "Fatal error: %s has no slot in the entry block!", definition->varDefinition.variable);
+    LLVMValue slot = found->second;
+    entrySlots.erase(found);
+    return slot;
+}
+
+void registerEntryObject(ExpressionNode* instantiation, LLVMValue object) {
+    entryObjects[instantiation] = object;
+}
+
+LLVMValue takeEntryObject(ExpressionNode* instantiation) {
+    auto found = entryObjects.find(instantiation);
+    ERROR_IF(found == entryObjects.end(), "Fatal error: a stack allocated object has no slot in the entry block!");
+    LLVMValue object = found->second;
+    entryObjects.erase(found);
+    return object;
 }
 
 void registerVariable(char* name, LLVMValue value) {
     //printf("registered variable %s", name);
-    scope.front()[name] = value;
+    VariableBinding binding = {value, FALSE};
+    scope.front()[name] = binding;
 }
 
-LLVMValue fetchVariable(char* name) {
+void registerVariableValue(char* name, LLVMValue value) {
+    VariableBinding binding = {value, TRUE};
+    scope.front()[name] = binding;
+}
+
+static VariableBinding& fetchBinding(char* name) {
     for (auto i = scope.begin(); i != scope.end(); ++i) {
-        if (i->find(name) != i->end()) {
-            return (*i)[name];
-        }
+        auto found = i->find(name);
+
+        if (found != i->end())
+            return found->second;
     }
 
     PANIC("Could not find variable %s!", name);
 }
 
+LLVMValue fetchVariable(char* name) {
+    return fetchBinding(name).value;
+}
+
+Boolean isVariableValue(char* name) {
+    return fetchBinding(name).direct;
+}
+
 void emitLambdaType(FILE* out, CheshireType type) {
+    if (usingOpaquePointers()) {
+        fprintf(out, "ptr");
+        return;
+    }
+
+    emitFunctionType(out, type);
+    fprintf(out, "*");
+}
+
+void emitFunctionType(FILE* out, CheshireType type) {
     LambdaType l = keyedLambdas[type];
     emitType(out, l.first);
     fprintf(out, "(");
@@ -96,7 +200,102 @@ void emitLambdaType(FILE* out, CheshireType type) {
             fprintf(out, ", ");
     }
 
-    fprintf(out, ")*");
+    fprintf(out, ")");
+}
+
+static int getTypeSize(CheshireType type) {
+    if (type.arrayNesting == 0 && (isNumericalType(type) || isBoolean(type))) {
+        switch (type.typeKey) {
+            case 1: //I8
+            case 6: //Boolean
+                return 1;
+            case 2: //I16
+                return 2;
+            case 3: //Int
+                return 4;
+        }
+    }
+
+    return 8; //I64, Decimal and pointers.
+}
+
+static int alignOffset(int offset, int size) { //every member is aligned to its size.
+    return (offset + size - 1) / size * size;
+}
+
+static int getShapeEnd(ClassShape* shape) {
+    int offset = 0;
+
+    for (; shape != NULL; shape = shape->next)
+        offset = alignOffset(offset, getTypeSize(shape->type)) + getTypeSize(shape->type);
+
+    return offset;
+}
+
+//takes the member that needs the least padding at the offset, the largest of those, in declaration order among equals.
+static ClassShape* packMembers(std::vector<ClassShape*> members, int* offset) {
+    ClassShape* packed = NULL;
+    ClassShape** bottom = &packed;
+
+    while (!members.empty()) {
+        size_t best = 0;
+
+        for (size_t i = 1; i < members.size(); i++) {
+            int size = getTypeSize(members[i]->type), bestSize = getTypeSize(members[best]->type);
+            int padding = alignOffset(*offset, size) - *offset, bestPadding = alignOffset(*offset, bestSize) - *offset;
+
+            if (padding < bestPadding || (padding == bestPadding && size > bestSize))
+                best = i;
+        }
+
+        ClassShape* member = members[best];
+        members.erase(members.begin() + best);
+        *offset = alignOffset(*offset, getTypeSize(member->type)) + getTypeSize(member->type);
+        member->next = NULL;
+        *bottom = member;
+        bottom = &(member->next);
+    }
+
+    return packed;
+}
+
+//orders the members a class adds after those it inherits, which stay a prefix so that upcasts remain bitcasts.
+static ClassShape* layoutMembers(ClassShape* members, int offset) {
+    if (fieldLayout == FL_DECLARED || members == NULL)
+        return members;
+
+    std::vector<ClassShape*> hot, cold;
+    int maxAccesses = 0;
+
+    for (ClassShape* c = members; c != NULL; c = c->next)
+        maxAccesses = std::max(maxAccesses, getMemberAccesses(c->name));
+
+    for (ClassShape* c = members; c != NULL; c = c->next) {
+        int accesses = getMemberAccesses(c->name);
+
+        if (fieldLayout == FL_HOT_COLD && accesses * COLD_ACCESS_RATIO < maxAccesses)
+            cold.push_back(c);
+        else
+            hot.push_back(c);
+    }
+
+    ClassShape* packed = packMembers(hot, &offset);
+    ClassShape** bottom = &packed;
+
+    for (ClassShape* temp = packed; temp != NULL; temp = temp->next) bottom = &(temp->next);
+
+    *bottom = packMembers(cold, &offset);
+    return packed;
+}
+
+void setFieldLayout(FieldLayout layout) {
+    fieldLayout = layout;
+}
+
+static CheshireType getParentType(CheshireType type) {
+    return (CheshireType) {
+        ancestryMap[type.typeKey], 0
+    };
 }
 
 ClassShape* getClassShape(CheshireType type) {
@@ -106,13 +305,14 @@ ClassShape* getClassShape(CheshireType type) {
     if (classShapes.find(type) != classShapes.end())
         return classShapes[type];
 
-    ClassShape* shape = cloneClassShape(getClassShape(((CheshireType) {
-        ancestryMap[type.typeKey], 0
-    })));
+    ClassShape* shape = cloneClassShape(getClassShape(getParentType(type)));
     ClassList* object = objectMapping[type.typeKey];
-    ClassShape** bottom = &shape;
 
-    for (ClassShape* temp = shape; temp != NULL; temp = temp->next) bottom = &(temp->next);
+    if (shape == NULL) //the header, every object starts with its vtable.
+        shape = allocClassShape(TYPE_NULL, "_vtable");
+
+    ClassShape* members = NULL;
+    ClassShape** bottom = &members;
 
     for (ClassList* c = object; c != NULL; c = c->next) {
         switch (c->type) {
@@ -124,7 +324,7 @@ ClassShape* getClassShape(CheshireType type) {
                 break;
             case CLT_METHOD:
 
-                if (!existsInClassShape(shape, c->method.name)) {
+                if (isAssignedMember(c->method.name) && !existsInClassShape(shape, c->method.name)) {
                     *bottom = allocClassShape(getLambdaType(c->method.returnType, c->method.params), c->method.name);
                     bottom = &((*bottom)->next);
                 }
@@ -133,10 +333,380 @@ ClassShape* getClassShape(CheshireType type) {
         }
     }
 
+    int end = getShapeEnd(shape);
+    CheshireType parent = getParentType(type);
+    int declaredEnd = equalTypes(parent, TYPE_OBJECT) ? end : declaredEnds[parent.typeKey];
+
+    for (ClassShape* c = members; c != NULL; c = c->next)
+        declaredEnd = alignOffset(declaredEnd, getTypeSize(c->type)) + getTypeSize(c->type);
+
+    declaredEnds[type.typeKey] = declaredEnd;
+    bottom = &shape;
+
+    for (ClassShape* temp = shape; temp != NULL; temp = temp->next) bottom = &(temp->next);
+
+    *bottom = layoutMembers(members, end);
     classShapes[type] = shape;
     return shape;
 }
 
+ClassShape* getVTableShape(CheshireType type) {
+    if (equalTypes(type, TYPE_OBJECT))
+        return NULL;
+
+    if (vtableShapes.find(type) != vtableShapes.end())
+        return vtableShapes[type];
+
+    ClassShape* shape = cloneClassShape(getVTableShape(getParentType(type)));
+
+    if (shape == NULL) //every vtable starts with its class's type descriptor.
+        shape = allocClassShape(TYPE_NULL, "_type");
+
+    ClassShape** bottom = &shape;
+
+    for (ClassShape* temp = shape; temp != NULL; temp = temp->next) bottom = &(temp->next);
+
+    for (ClassList* c = objectMapping[type.typeKey]; c != NULL; c = c->next) {
+        if (c->type == CLT_METHOD && !isAssignedMember(c->method.name) && !existsInClassShape(shape, c->method.name)) {
+            *bottom = allocClassShape(getLambdaType(c->method.returnType, c->method.params), c->method.name);
+            bottom = &((*bottom)->next);
+        }
+    }
+
+    vtableShapes[type] = shape;
+    return shape;
+}
+
+int getVTableElement(CheshireType type, const char* methodName) {
+    CStrEql streql;
+    int count = 0;
+
+    for (ClassShape* c = getVTableShape(type); c != NULL; c = c->next, count++)
+        if (streql(c->name, methodName))
+            return count;
+
+    return -1;
+}
+
+CheshireType getParentClass(CheshireType type) {
+    return getParentType(type);
+}
+
+int getClassDepth(CheshireType type) {
+    int depth = -1;
+
+    for (TypeKey t = type.typeKey; t != TYPE_OBJECT.typeKey; t = ancestryMap[t])
+        depth++;
+
+    return depth;
+}
+
+int getDisplaySize() {
+    int size = 0;
+
+    for (AncestryMap::iterator i = ancestryMap.begin(); i != ancestryMap.end(); ++i) {
+        int depth = getClassDepth((CheshireType) {i->first, 0});
+
+        if (depth >= size)
+            size = depth + 1;
+    }
+
+    return size;
+}
+
+Boolean isCheckedCast(CheshireType from, CheshireType to) {
+    if (from.arrayNesting != 0 || to.arrayNesting != 0 || !isObjectType(from) || !isObjectType(to) || isNull(from))
+        return FALSE;
+
+    if (equalTypes(to, TYPE_STRING))
+        return FALSE; //strings come from the runtime without a vtable, so there is nothing to test.
+
+    return isSuper(to, from) ? FALSE : TRUE;
+}
+
+ClassList* getMethodImplementation(CheshireType type, const char* methodName, CheshireType* definer) {
+    CStrEql streql;
+
+    for (; !equalTypes(type, TYPE_OBJECT); type = getParentType(type)) {
+        for (ClassList* c = objectMapping[type.typeKey]; c != NULL; c = c->next) {
+            if (c->type == CLT_METHOD && streql(c->method.name, methodName)) {
+                *definer = type;
+                return c;
+            }
+        }
+    }
+
+    PANIC("No implementation of method %s", methodName);
+}
+
+void setDevirtualization(Boolean devirtualize) {
+    devirtualization = devirtualize;
+}
+
+void setPrototypes(Boolean enabled) {
+    prototypes = enabled;
+}
+
+ExpressionNode* getPrototypeValue(CheshireType type, const char* member) {
+    CStrEql streql;
+
+    for (; !equalTypes(type, TYPE_OBJECT); type = getParentType(type)) {
+        for (ClassList* c = objectMapping[type.typeKey]; c != NULL; c = c->next) {
+            if (c->type == CLT_VARIABLE && streql(c->variable.name, member))
+                return c->variable.defaultValue;
+        }
+    }
+
+    return NULL;
+}
+
+static Boolean isConstantDefault(ExpressionNode* node) {
+    switch (node->type) {
+        case OP_INTEGER:
+        case OP_LONG_INTEGER:
+        case OP_CHAR:
+        case OP_DECIMAL:
+        case OP_RESERVED_LITERAL:
+            return TRUE;
+        case OP_CAST: //null, widened to the type of the field.
+            return node->cast.child->type == OP_RESERVED_LITERAL && node->cast.child->reserved == RL_NULL ? TRUE : FALSE;
+        default:
+            return FALSE;
+    }
+}
+
+Boolean hasPrototype(CheshireType type) {
+    if (!prototypes || equalTypes(type, TYPE_OBJECT) || equalTypes(type, TYPE_STRING))
+        return FALSE;
+
+    for (ClassShape* c = getClassShape(type)->next; c != NULL; c = c->next) {
+        ExpressionNode* value = getPrototypeValue(type, c->name);
+
+        if (value == NULL || !isConstantDefault(value)) //a method slot, or a default computed at runtime.
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+Boolean hasInitializer(CheshireType type) {
+    for (; !equalTypes(type, TYPE_OBJECT); type = getParentType(type)) {
+        for (ClassList* c = objectMapping[type.typeKey]; c != NULL; c = c->next) {
+            if (c->type == CLT_CONSTRUCTOR)
+                return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static Boolean inheritsFrom(TypeKey type, TypeKey ancestor) {
+    for (; type != TYPE_OBJECT.typeKey; type = ancestryMap[type])
+        if (type == ancestor)
+            return TRUE;
+
+    return FALSE;
+}
+
+//the distinct implementations of the method by the type and its emitted subclasses, empty if there are too many or
+//other modules can subclass it.
+static std::vector<CallTarget>& findCallTargets(CheshireType type, const char* methodName) {
+    std::pair<TypeKey, std::string> key(type.typeKey, methodName);
+    auto found = callTargets.find(key);
+
+    if (found != callTargets.end())
+        return found->second;
+
+    std::vector<CallTarget>& targets = callTargets[key];
+    CheshireType definer;
+    ClassList* method = getMethodImplementation(type, methodName, &definer);
+
+    if (method->method.final || isFinalClass(type)) { //nothing can override it.
+        targets.push_back(CallTarget(method, definer));
+        return targets;
+    }
+
+    if (!isWholeProgram()) //a subclass in another module could override it.
+        return targets;
+
+    std::map<TypeKey, ClassList*> classes(objectMapping.begin(), objectMapping.end()); //in definition order.
+
+    for (std::map<TypeKey, ClassList*>::iterator i = classes.begin(); i != classes.end(); ++i) {
+        CheshireType subclass = {i->first, 0};
+
+        if (!inheritsFrom(i->first, type.typeKey) || !isReachableClass(subclass))
+            continue;
+
+        method = getMethodImplementation(subclass, methodName, &definer);
+        Boolean seen = FALSE;
+
+        for (size_t j = 0; j < targets.size(); j++)
+            if (targets[j].first == method)
+                seen = TRUE;
+
+        if (!seen)
+            targets.push_back(CallTarget(method, definer));
+    }
+
+    if (targets.size() > MAX_GUARDED_TARGETS)
+        targets.clear();
+
+    return targets;
+}
+
+Boolean isLeafClass(CheshireType type) {
+    if (isFinalClass(type))
+        return TRUE;
+
+    if (!devirtualization || !isWholeProgram())
+        return FALSE;
+
+    for (ObjectMapping::iterator i = objectMapping.begin(); i != objectMapping.end(); ++i) {
+        CheshireType subclass = {i->first, 0};
+
+        if (i->first != type.typeKey && inheritsFrom(i->first, type.typeKey) && isReachableClass(subclass))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+void setPoisonDeleted(Boolean enabled) {
+    poisonDeleted = enabled;
+}
+
+Boolean getPoisonDeleted() {
+    return poisonDeleted;
+}
+
+void setGarbageCollection(Boolean enabled) {
+    garbageCollection = enabled;
+}
+
+Boolean getGarbageCollection() {
+    return garbageCollection;
+}
+
+void registerTopMethod(ParserTopNode* node) {
+    if (node->type == PRT_METHOD_DECLARATION || node->type == PRT_METHOD_DEFINITION)
+        topMethods[node->method.functionName] = TRUE;
+}
+
+//a call of a top-level method by name, unless a parameter, local or capture shadows it, calls the @_MethodImpl_ its
+//@_M_ constant holds directly, without loading, or with garbage collection rooting, the callee.
+Boolean isDirectCall(ExpressionNode* callback, Boolean shadowed) {
+    if (shadowed || callback->type != OP_DEREFERENCE || callback->unaryChild->type != OP_VARIABLE)
+        return FALSE;
+
+    return topMethods.count(callback->unaryChild->string) != 0 ? TRUE : FALSE;
+}
+
+Boolean isTracedType(CheshireType type) {
+    CheshireType element = type;
+    element.arrayNesting = 0;
+    return (isObjectType(type) && !isNull(type)) || isLambdaType(element) ? TRUE : FALSE;
+}
+
+int getTracedNesting(CheshireType type) {
+    CheshireType element = type;
+    element.arrayNesting = 0;
+    return type.arrayNesting + (isLambdaType(element) ? GC_CLOSURE_NESTING : 0);
+}
+
+void raiseRootFrame() {
+    rootFrames.push_front(std::vector<Root>());
+    frameTailCalls.push_front(0);
+}
+
+void fallRootFrame() {
+    if (!rootFrames.front().empty())
+        rootedFunctions++;
+
+    stackRoots += rootFrames.front().size();
+    rootFrames.pop_front();
+    frameTailCalls.pop_front();
+}
+
+void registerRoot(LLVMValue slot, CheshireType type, RootKind kind) {
+    ERROR_IF(rootFrames.empty(), "Fatal error: a root outside of any function!");
+    rootFrames.front().push_back(Root(slot, std::make_pair(type, kind)));
+}
+
+int getRootCount() {
+    return rootFrames.front().size();
+}
+
+void countTailCall() {
+    if (!frameTailCalls.empty())
+        frameTailCalls.front()++;
+}
+
+int getTailCallCount() {
+    return frameTailCalls.front();
+}
+
+LLVMValue getRoot(int index, CheshireType* type, RootKind* kind) {
+    Root& root = rootFrames.front()[index];
+    *type = root.second.first;
+    *kind = root.second.second;
+    return root.first;
+}
+
+void registerGlobalRoot(char* name, CheshireType type) {
+    globalRoots.push_back(std::make_pair(name, type));
+}
+
+int getGlobalRootCount() {
+    return globalRoots.size();
+}
+
+char* getGlobalRoot(int index, CheshireType* type) {
+    *type = globalRoots[index].second;
+    return globalRoots[index].first;
+}
+
+void countPointerMap(Boolean environment, int entries) {
+    if (environment)
+        environmentMaps++;
+    else
+        pointerMaps++;
+
+    mapEntries += entries;
+}
+
+void printGarbageCollectionReport(FILE* out) {
+    fprintf(out, "Emitted %d pointer maps of classes and %d of closure environments, with %d references\n",
+            pointerMaps, environmentMaps, mapEntries);
+    fprintf(out, "Rooted %d stack slots in %d functions, and %d globals\n", stackRoots, rootedFunctions, (int) globalRoots.size());
+}
+
+int getCallTargetCount(ExpressionNode* node) {
+    CheshireType type = node->objectcall.object->determinedType;
+
+    if (!devirtualization || type.arrayNesting != 0 || getVTableElement(type, node->objectcall.method) < 0)
+        return 0; //a field, or a method something assigns.
+
+    std::vector<CallTarget>& targets = findCallTargets(type, node->objectcall.method);
+    int count = targets.size();
+
+    //musttail needs the call right before the return, and the callee's signature to be the one called.
+    if (node->objectcall.tailCall == TC_MUSTTAIL) {
+        if (count > 1)
+            return 0;
+
+        if (count == 1 && !usingOpaquePointers() && !equalTypes(targets[0].second, getObjectSelfType(type, node->objectcall.method)))
+            return 0;
+    }
+
+    return count;
+}
+
+ClassList* getCallTarget(ExpressionNode* node, int index, CheshireType* definer) {
+    CallTarget& target = findCallTargets(node->objectcall.object->determinedType, node->objectcall.method)[index];
+    *definer = target.second;
+    return target.first;
+}
+
 int getObjectElement(CheshireType type, const char* elementName) {
     ClassShape* shape;
 
@@ -155,16 +725,54 @@ int getObjectElement(CheshireType type, const char* elementName) {
     PANIC("Could not find element %s", elementName);
 }
 
+void setPooledAllocation(Boolean enabled) {
+    pooledAllocation = enabled;
+}
+
+int getSizeClass(int size) {
+    if (!pooledAllocation || size < 0 || size > SIZE_CLASS_GRANULE * SIZE_CLASS_COUNT)
+        return -1;
+
+    return size == 0 ? 0 : (size - 1) / SIZE_CLASS_GRANULE;
+}
+
+int getAllocationSize(CheshireType type) {
+    if (equalTypes(type, TYPE_OBJECT) || equalTypes(type, TYPE_STRING)) //laid out by the runtime.
+        return -1;
+
+    return alignOffset(getShapeEnd(getClassShape(type)), 8);
+}
+
+int getEnvironmentSize(UsingList* captures) {
+    int offset = 0;
+
+    for (; captures != NULL; captures = captures->next)
+        offset = alignOffset(offset, getTypeSize(captures->type)) + getTypeSize(captures->type);
+
+    return alignOffset(offset, 8);
+}
+
+int getObjectSize(CheshireType type) {
+    int size = 0;
+
+    for (ClassShape* c = getClassShape(type); c != NULL; c = c->next)
+        size += getTypeSize(c->type);
+
+    return size;
+}
+
 CheshireType getObjectSelfType(CheshireType object, const char* methodname) {
-    ClassShape* classShape = getClassShape(object);
+    ClassShape* shapes[] = {getClassShape(object), getVTableShape(object)};
     CStrEql streql;
 
-    for (ClassShape* c = classShape; c != NULL; c = c->next) {
-        if (streql(methodname, c->name)) {
-            ERROR_IF(!isLambdaType(c->type), "Invalid lambda type!");
-            LambdaType l = keyedLambdas[c->type];
-            ERROR_IF(l.second.size() <= 0, "Error: not object call.");
-            return l.second[0];
+    for (int i = 0; i < 2; i++) {
+        for (ClassShape* c = shapes[i]; c != NULL; c = c->next) {
+            if (streql(methodname, c->name)) {
+                ERROR_IF(!isLambdaType(c->type), "Invalid lambda type!");
+                LambdaType l = keyedLambdas[c->type];
+                ERROR_IF(l.second.size() <= 0, "Error: not object call.");
+                return l.second[0];
+            }
         }
     }
 
@@ -176,7 +784,70 @@ void deleteClassShape(ClassShape* node) {
         return;
 
     deleteClassShape(node->next);
-    free(node);
+    memFree(node);
+}
+
+static int countShape(ClassShape* c) {
+    int count = 0;
+
+    for (; c != NULL; c = c->next)
+        count++;
+
+    return count;
+}
+
+void printClassLayoutReport(FILE* out) {
+    std::map<std::string, CheshireType> classes; //by name, so the report does not depend on hashing.
+
+    for (ClassShapes::iterator i = classShapes.begin(); i != classShapes.end(); ++i) {
+        char* name = getNamedTypeString(i->first);
+        classes[name] = i->first;
+        free(name);
+    }
+
+    int totalSize = 0, totalSlotSize = 0, totalStores = 0, totalSlotStores = 0, totalLayout = 0, totalDeclared = 0;
+
+    for (std::map<std::string, CheshireType>::iterator i = classes.begin(); i != classes.end(); ++i) {
+        int vtableSlots = countShape(getVTableShape(i->second)) - 1; //without the type descriptor.
+        int size = getObjectSize(i->second), slotSize = size - 8 + 8 * vtableSlots; //a slot per method, without the header.
+        int stores = 0, slotStores = 0; //by the constructors of the class and its ancestors.
+
+        for (CheshireType t = i->second; !equalTypes(t, TYPE_OBJECT); t = getParentType(t)) {
+            stores++; //the header.
+
+            for (ClassList* c = objectMapping[t.typeKey]; c != NULL; c = c->next) {
+                if (c->type == CLT_VARIABLE || (c->type == CLT_METHOD && isAssignedMember(c->method.name)))
+                    stores++;
+
+                if (c->type != CLT_CONSTRUCTOR)
+                    slotStores++;
+            }
+        }
+
+        int layout = alignOffset(getShapeEnd(getClassShape(i->second)), 8), declared = alignOffset(declaredEnds[i->second.typeKey], 8);
+        fprintf(out, "%s: %d bytes and %d stores per object, %d vtable slots (%d bytes and %d stores with a slot per method)\n",
+                i->first.c_str(), size, stores, vtableSlots, slotSize, slotStores);
+        fprintf(out, "  laid out in %d bytes (%d in declaration order)%s:\n", layout, declared, hasPrototype(i->second) ? ", copied from a prototype" : "");
+        int offset = 0;
+
+        for (ClassShape* c = getClassShape(i->second); c != NULL; c = c->next) { //the offset, size and name of each member.
+            offset = alignOffset(offset, getTypeSize(c->type));
+            fprintf(out, "    %d %d %s\n", offset, getTypeSize(c->type), c->name);
+            offset += getTypeSize(c->type);
+        }
+
+        totalLayout += layout;
+        totalDeclared += declared;
+        totalSize += size;
+        totalSlotSize += slotSize;
+        totalStores += stores;
+        totalSlotStores += slotStores;
+    }
+
+    //as deltas, since every constructor of a chain stores its own vtable pointer, which can cost more stores than it saves.
+    fprintf(out, "Vtables make one object of each of %d classes %d bytes instead of %d (%+d) and %d stores instead of %d (%+d)\n",
+            (int) classes.size(), totalSize, totalSlotSize, totalSize - totalSlotSize, totalStores, totalSlotStores, totalStores - totalSlotStores);
+    fprintf(out, "Field layout saved %d of %d bytes of padded objects\n", totalDeclared - totalLayout, totalDeclared);
 }
 
 FILE* newPreamble(void) {
@@ -186,6 +857,8 @@ FILE* newPreamble(void) {
 }
 
 void flushPreambles(FILE* out) {
+    beginPhase(TP_FLUSH_PREAMBLES);
+
     for (auto i = preambleList.begin(); i != preambleList.end(); ++i) {
         FILE* file = *i;
         fseek(file, 0, SEEK_SET);
@@ -200,5 +873,6 @@ void flushPreambles(FILE* out) {
     }
 
     preambleList.clear();
+    endPhase(NULL);
 }
 
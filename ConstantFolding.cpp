@@ -0,0 +1,798 @@
+/*
+ * File:   ConstantFolding.cpp
+ * Author: Michael Goulet
+ * Implements: ConstantFolding.h
+ */
+
+#include <cmath>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "ConstantFolding.h"
+#include "ParserNodes.h"
+#include "TypeSystem.h"
+#include "TypeSystemUtilities.hpp"
+#include "MemReport.h"
+
+typedef struct {
+    const char* name;
+    StatementNode* definition; //NULL for parameters.
+    ParameterList* param;
+} Binding;
+
+static std::vector<Binding> bindings; //a stack, methods only bind a handful of names.
+static std::vector<size_t> bindingScopes;
+static std::unordered_map<StatementNode*, ExpressionNode*> constants;
+static std::unordered_set<std::string> assignedMembers;
+static std::unordered_map<std::string, int> memberAccesses; //weighted by the loops around each access.
+static int loopDepth = 0;
+
+static ExpressionNode* foldExpression(ExpressionNode*);
+static StatementNode* foldStatement(StatementNode*);
+static void findAssignments(ExpressionNode*);
+static void findAssignmentsInStatement(StatementNode*);
+
+static void raiseBindingScope() {
+    bindingScopes.push_back(bindings.size());
+}
+
+static void fallBindingScope() {
+    bindings.resize(bindingScopes.back());
+    bindingScopes.pop_back();
+}
+
+static void bindVariable(const char* name, StatementNode* definition, ParameterList* param) {
+    Binding binding = {name, definition, param};
+    bindings.push_back(binding);
+}
+
+static void bindParameters(ParameterList* params) {
+    for (ParameterList* p = params; p != NULL; p = p->next)
+        bindVariable(p->name, NULL, p);
+}
+
+static Binding* resolveBinding(const char* name) {
+    CStrEql streql;
+
+    for (size_t i = bindings.size(); i > 0; i--) { //innermost first.
+        if (streql(bindings[i - 1].name, name))
+            return &bindings[i - 1];
+    }
+
+    return NULL; //globals are never folded.
+}
+
+static StatementNode* resolveVariable(const char* name) {
+    Binding* binding = resolveBinding(name);
+    return binding == NULL ? NULL : binding->definition;
+}
+
+//////////////// ASSIGNMENTS /////////////////
+
+static void countMemberAccess(const char* name) {
+    int weight = 1;
+
+    for (int i = 0; i < loopDepth && i < MAX_LOOP_WEIGHT_DEPTH; i++)
+        weight *= LOOP_ACCESS_WEIGHT;
+
+    memberAccesses[name] += weight;
+}
+
+static void findAssignmentsInList(ExpressionList* list) {
+    for (; list != NULL; list = list->next)
+        findAssignments(list->parameter);
+}
+
+static void findAssignmentsInBlock(BlockList* list) {
+    raiseBindingScope();
+
+    for (; list != NULL; list = list->next)
+        findAssignmentsInStatement(list->statement);
+
+    fallBindingScope();
+}
+
+static void findAssignments(ExpressionNode* node) {
+    switch (node->type) {
+        case OP_VARIABLE: { //every read is under an OP_DEREFERENCE, so this is an lval.
+            Binding* binding = resolveBinding(node->string);
+
+            if (binding != NULL && binding->definition != NULL)
+                binding->definition->varDefinition.assigned = TRUE;
+            else if (binding != NULL)
+                binding->param->assigned = TRUE;
+        }
+        break;
+        case OP_DEREFERENCE:
+            if (node->unaryChild->type == OP_ACCESS) {
+                countMemberAccess(node->unaryChild->access.variable);
+                findAssignments(node->unaryChild->access.expression);
+            }
+            else if (node->unaryChild->type != OP_VARIABLE)
+                findAssignments(node->unaryChild);
+
+            break;
+        case OP_NOT:
+        case OP_COMPL:
+        case OP_UNARY_MINUS:
+        case OP_PLUSONE:
+        case OP_MINUSONE:
+        case OP_LENGTH:
+            findAssignments(node->unaryChild);
+            break;
+        case OP_EQUALS:
+        case OP_NOT_EQUALS:
+        case OP_GRE_EQUALS:
+        case OP_LES_EQUALS:
+        case OP_GREATER:
+        case OP_LESS:
+        case OP_AND:
+        case OP_OR:
+        case OP_PLUS:
+        case OP_MINUS:
+        case OP_MULT:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_SET:
+        case OP_ARRAY_ACCESS:
+            findAssignments(node->binary.left);
+            findAssignments(node->binary.right);
+            break;
+        case OP_ACCESS: //like OP_VARIABLE, an lval unless under an OP_DEREFERENCE.
+            assignedMembers.insert(node->access.variable);
+            countMemberAccess(node->access.variable);
+            findAssignments(node->access.expression);
+            break;
+        case OP_INSTANCEOF:
+            findAssignments(node->instanceof.expression);
+            break;
+        case OP_CAST:
+            findAssignments(node->cast.child);
+            break;
+        case OP_METHOD_CALL:
+            findAssignments(node->methodcall.callback);
+            findAssignmentsInList(node->methodcall.params);
+            break;
+        case OP_INSTANTIATION:
+            findAssignmentsInList(node->instantiate.params);
+            break;
+        case OP_OBJECT_CALL: //reads the method's slot, which is a member when something assigns it.
+            countMemberAccess(node->objectcall.method);
+            findAssignments(node->objectcall.object);
+            findAssignmentsInList(node->objectcall.params);
+            break;
+        case OP_CHOOSE:
+            findAssignments(node->choose.condition);
+            findAssignments(node->choose.iftrue);
+            findAssignments(node->choose.iffalse);
+            break;
+        case OP_CLOSURE: //captured locals stay visible, so assignments to them inside the closure are found too.
+            raiseBindingScope();
+            bindParameters(node->closure.params);
+            findAssignmentsInBlock(node->closure.body);
+            fallBindingScope();
+            break;
+        case OP_LAMBDA:
+            raiseBindingScope();
+            bindParameters(node->lambda.params);
+            findAssignments(node->lambda.expression);
+            fallBindingScope();
+            break;
+        case OP_NOP:
+        case OP_INTEGER:
+        case OP_LONG_INTEGER:
+        case OP_DECIMAL:
+        case OP_CHAR:
+        case OP_RESERVED_LITERAL:
+        case OP_STRING:
+            break;
+    }
+}
+
+static void findAssignmentsInStatement(StatementNode* node) {
+    switch (node->type) {
+        case S_NOP:
+            break;
+        case S_VARIABLE_DEF:
+        case S_INFER_DEF:
+            findAssignments(node->varDefinition.value);
+            bindVariable(node->varDefinition.variable, node, NULL);
+            break;
+        case S_EXPRESSION:
+        case S_ASSERT:
+        case S_RETURN:
+        case S_DELETE:
+            findAssignments(node->expression);
+            break;
+        case S_BLOCK:
+            findAssignmentsInBlock(node->block);
+            break;
+        case S_IF:
+            findAssignments(node->conditional.condition);
+            raiseBindingScope();
+            findAssignmentsInStatement(node->conditional.block);
+            fallBindingScope();
+            break;
+        case S_WHILE: //the condition runs with the body.
+            loopDepth++;
+            findAssignments(node->conditional.condition);
+            raiseBindingScope();
+            findAssignmentsInStatement(node->conditional.block);
+            fallBindingScope();
+            loopDepth--;
+            break;
+        case S_IF_ELSE:
+            findAssignments(node->conditional.condition);
+            raiseBindingScope();
+            findAssignmentsInStatement(node->conditional.block);
+            fallBindingScope();
+            raiseBindingScope();
+            findAssignmentsInStatement(node->conditional.elseBlock);
+            fallBindingScope();
+            break;
+    }
+}
+
+//////////////// CONSTANTS /////////////////
+
+static Boolean isConstant(ExpressionNode* node) {
+    switch (node->type) {
+        case OP_INTEGER:
+        case OP_LONG_INTEGER:
+        case OP_CHAR:
+        case OP_DECIMAL:
+            return TRUE;
+        case OP_RESERVED_LITERAL:
+            return (Boolean) (node->reserved != RL_NULL);
+        default:
+            return FALSE;
+    }
+}
+
+static int64_t getIntegerValue(ExpressionNode* node) {
+    return node->type == OP_CHAR ? node->character : node->integer;
+}
+
+static double getDecimalValue(ExpressionNode* node) {
+    return node->type == OP_DECIMAL ? node->decimal : (double) getIntegerValue(node);
+}
+
+static Boolean getBooleanValue(ExpressionNode* node) {
+    return (Boolean) (node->reserved == RL_TRUE);
+}
+
+static int getIntegerBits(CheshireType type) {
+    if (equalTypes(type, TYPE_I8))
+        return 8;
+    else if (equalTypes(type, TYPE_I16))
+        return 16;
+    else if (equalTypes(type, TYPE_INT))
+        return 32;
+
+    return 64;
+}
+
+//wraps like the LLVM instruction would.
+static int64_t truncateInteger(int64_t value, CheshireType type) {
+    switch (getIntegerBits(type)) {
+        case 8:
+            return (int8_t) value;
+        case 16:
+            return (int16_t) value;
+        case 32:
+            return (int32_t) value;
+    }
+
+    return value;
+}
+
+static ExpressionNode* replaceWithInteger(ExpressionNode* node, int64_t value) {
+    CheshireType type = node->determinedType;
+    ExpressionNode* ret = equalTypes(type, TYPE_I64) ? createLongIntegerNode(value) : createIntegerNode(truncateInteger(value, type));
+    ret->determinedType = type;
+    deleteExpressionNode(node);
+    return ret;
+}
+
+static ExpressionNode* replaceWithDecimal(ExpressionNode* node, double value) {
+    ExpressionNode* ret = createDecimalNode(value);
+    ret->determinedType = TYPE_DECIMAL;
+    deleteExpressionNode(node);
+    return ret;
+}
+
+static ExpressionNode* replaceWithBoolean(ExpressionNode* node, Boolean value) {
+    ExpressionNode* ret = createReservedLiteralNode(value ? RL_TRUE : RL_FALSE);
+    ret->determinedType = TYPE_BOOLEAN;
+    deleteExpressionNode(node);
+    return ret;
+}
+
+static ExpressionNode* replaceWithChild(ExpressionNode* node, ExpressionNode** child) {
+    ExpressionNode* ret = *child;
+    *child = NULL; //so that deleting the node leaves it alone.
+    deleteExpressionNode(node);
+    return ret;
+}
+
+static ExpressionNode* copyConstant(ExpressionNode* constant) {
+    ExpressionNode* ret;
+
+    switch (constant->type) {
+        case OP_LONG_INTEGER:
+            ret = createLongIntegerNode(constant->integer);
+            break;
+        case OP_CHAR:
+            ret = createCharNode(constant->character);
+            break;
+        case OP_DECIMAL:
+            ret = createDecimalNode(constant->decimal);
+            break;
+        case OP_RESERVED_LITERAL:
+            ret = createReservedLiteralNode(constant->reserved);
+            break;
+        default:
+            ret = createIntegerNode(constant->integer);
+            break;
+    }
+
+    ret->determinedType = constant->determinedType;
+    return ret;
+}
+
+//////////////// FOLDING /////////////////
+
+static ExpressionNode* foldUnary(ExpressionNode* node) {
+    ExpressionNode* child = node->unaryChild;
+
+    if (!isConstant(child))
+        return node;
+
+    switch (node->type) {
+        case OP_NOT:
+            return replaceWithBoolean(node, (Boolean) !getBooleanValue(child));
+        case OP_COMPL:
+            return replaceWithInteger(node, ~getIntegerValue(child));
+        case OP_UNARY_MINUS:
+            if (isDecimal(node->determinedType))
+                return replaceWithDecimal(node, 0.0 - getDecimalValue(child)); //fsub from 0, so -(0.0) stays 0.0.
+
+            return replaceWithInteger(node, (int64_t) (0 - (uint64_t) getIntegerValue(child)));
+        default:
+            return node;
+    }
+}
+
+static ExpressionNode* foldArithmetic(ExpressionNode* node) {
+    ExpressionNode* left = node->binary.left, * right = node->binary.right;
+
+    if (!isConstant(left) || !isConstant(right) || !isNumericalType(node->determinedType))
+        return node;
+
+    if (isDecimal(node->determinedType)) {
+        double a = getDecimalValue(left), b = getDecimalValue(right);
+
+        switch (node->type) {
+            case OP_PLUS:
+                return replaceWithDecimal(node, a + b);
+            case OP_MINUS:
+                return replaceWithDecimal(node, a - b);
+            case OP_MULT:
+                return replaceWithDecimal(node, a * b);
+            case OP_DIV:
+                return replaceWithDecimal(node, a / b);
+            case OP_MOD:
+                return replaceWithDecimal(node, fmod(a, b)); //same as frem.
+            default:
+                return node;
+        }
+    }
+
+    int64_t a = getIntegerValue(left), b = getIntegerValue(right);
+    int bits = getIntegerBits(node->determinedType);
+    int64_t minimum = bits == 64 ? INT64_MIN : -((int64_t) 1 << (bits - 1));
+
+    switch (node->type) {
+        case OP_PLUS:
+            return replaceWithInteger(node, (int64_t) ((uint64_t) a + (uint64_t) b));
+        case OP_MINUS:
+            return replaceWithInteger(node, (int64_t) ((uint64_t) a - (uint64_t) b));
+        case OP_MULT:
+            return replaceWithInteger(node, (int64_t) ((uint64_t) a * (uint64_t) b));
+        case OP_DIV:
+        case OP_MOD:
+            if (b == 0 || (b == -1 && a == minimum)) //undefined for sdiv/srem, leave it to run time.
+                return node;
+
+            return replaceWithInteger(node, node->type == OP_DIV ? a / b : a % b);
+        default:
+            return node;
+    }
+}
+
+static ExpressionNode* foldComparison(ExpressionNode* node) {
+    ExpressionNode* left = node->binary.left, * right = node->binary.right;
+    CheshireType type = left->determinedType;
+
+    if (!isConstant(left) || !isConstant(right))
+        return node;
+
+    if (isBoolean(type)) { //i1 orders true below false, so only equality is folded.
+        if (node->type == OP_EQUALS)
+            return replaceWithBoolean(node, (Boolean) (getBooleanValue(left) == getBooleanValue(right)));
+        else if (node->type == OP_NOT_EQUALS)
+            return replaceWithBoolean(node, (Boolean) (getBooleanValue(left) != getBooleanValue(right)));
+
+        return node;
+    }
+
+    if (!isNumericalType(type))
+        return node;
+
+    if (isDecimal(type)) { //ordered comparisons, except une for !=.
+        double a = getDecimalValue(left), b = getDecimalValue(right);
+
+        switch (node->type) {
+            case OP_EQUALS:
+                return replaceWithBoolean(node, (Boolean) (a == b));
+            case OP_NOT_EQUALS:
+                return replaceWithBoolean(node, (Boolean) (a != b));
+            case OP_GRE_EQUALS:
+                return replaceWithBoolean(node, (Boolean) (a >= b));
+            case OP_LES_EQUALS:
+                return replaceWithBoolean(node, (Boolean) (a <= b));
+            case OP_GREATER:
+                return replaceWithBoolean(node, (Boolean) (a > b));
+            case OP_LESS:
+                return replaceWithBoolean(node, (Boolean) (a < b));
+            default:
+                return node;
+        }
+    }
+
+    int64_t a = getIntegerValue(left), b = getIntegerValue(right);
+
+    switch (node->type) {
+        case OP_EQUALS:
+            return replaceWithBoolean(node, (Boolean) (a == b));
+        case OP_NOT_EQUALS:
+            return replaceWithBoolean(node, (Boolean) (a != b));
+        case OP_GRE_EQUALS:
+            return replaceWithBoolean(node, (Boolean) (a >= b));
+        case OP_LES_EQUALS:
+            return replaceWithBoolean(node, (Boolean) (a <= b));
+        case OP_GREATER:
+            return replaceWithBoolean(node, (Boolean) (a > b));
+        case OP_LESS:
+            return replaceWithBoolean(node, (Boolean) (a < b));
+        default:
+            return node;
+    }
+}
+
+static ExpressionNode* foldCast(ExpressionNode* node) {
+    ExpressionNode* child = node->cast.child;
+    CheshireType from = child->determinedType, to = node->cast.type;
+
+    if (!isConstant(child) || !isNumericalType(from) || !isNumericalType(to))
+        return node;
+
+    if (isDecimal(to))
+        return replaceWithDecimal(node, getDecimalValue(child));
+
+    if (isDecimal(from)) {
+        double value = getDecimalValue(child);
+        double limit = ldexp(1.0, getIntegerBits(to) - 1);
+
+        if (!(value >= -limit && value < limit)) //fptosi out of range is poison.
+            return node;
+
+        return replaceWithInteger(node, (int64_t) value);
+    }
+
+    return replaceWithInteger(node, getIntegerValue(child)); //sext or trunc.
+}
+
+static void foldList(ExpressionList* list) {
+    for (; list != NULL; list = list->next)
+        list->parameter = foldExpression(list->parameter);
+}
+
+static void foldBlock(BlockList* list) {
+    raiseBindingScope();
+
+    for (; list != NULL; list = list->next)
+        list->statement = foldStatement(list->statement);
+
+    fallBindingScope();
+}
+
+static ExpressionNode* foldExpression(ExpressionNode* node) {
+    switch (node->type) {
+        case OP_DEREFERENCE:
+            if (node->unaryChild->type == OP_VARIABLE) {
+                StatementNode* definition = resolveVariable(node->unaryChild->string);
+                auto found = definition == NULL ? constants.end() : constants.find(definition);
+
+                if (found != constants.end()) {
+                    ExpressionNode* ret = copyConstant(found->second);
+                    deleteExpressionNode(node);
+                    return ret;
+                }
+            } else {
+                node->unaryChild = foldExpression(node->unaryChild);
+            }
+
+            return node;
+        case OP_NOT:
+        case OP_COMPL:
+        case OP_UNARY_MINUS:
+            node->unaryChild = foldExpression(node->unaryChild);
+            return foldUnary(node);
+        case OP_PLUSONE:
+        case OP_MINUSONE:
+        case OP_LENGTH:
+            node->unaryChild = foldExpression(node->unaryChild);
+            return node;
+        case OP_EQUALS:
+        case OP_NOT_EQUALS:
+        case OP_GRE_EQUALS:
+        case OP_LES_EQUALS:
+        case OP_GREATER:
+        case OP_LESS:
+            node->binary.left = foldExpression(node->binary.left);
+            node->binary.right = foldExpression(node->binary.right);
+            return foldComparison(node);
+        case OP_PLUS:
+        case OP_MINUS:
+        case OP_MULT:
+        case OP_DIV:
+        case OP_MOD:
+            node->binary.left = foldExpression(node->binary.left);
+            node->binary.right = foldExpression(node->binary.right);
+            return foldArithmetic(node);
+        case OP_AND:
+        case OP_OR:
+            node->binary.left = foldExpression(node->binary.left);
+            node->binary.right = foldExpression(node->binary.right);
+
+            if (isConstant(node->binary.left)) {
+                Boolean value = getBooleanValue(node->binary.left);
+
+                if (value == (node->type == OP_OR)) //short-circuits, the right side never runs.
+                    return replaceWithBoolean(node, value);
+
+                return replaceWithChild(node, &(node->binary.right));
+            }
+
+            return node;
+        case OP_SET:
+        case OP_ARRAY_ACCESS:
+            node->binary.left = foldExpression(node->binary.left);
+            node->binary.right = foldExpression(node->binary.right);
+            return node;
+        case OP_ACCESS:
+            node->access.expression = foldExpression(node->access.expression);
+            return node;
+        case OP_INSTANCEOF:
+            node->instanceof.expression = foldExpression(node->instanceof.expression);
+            return node;
+        case OP_CAST:
+            node->cast.child = foldExpression(node->cast.child);
+            return foldCast(node);
+        case OP_METHOD_CALL:
+            node->methodcall.callback = foldExpression(node->methodcall.callback);
+            foldList(node->methodcall.params);
+            return node;
+        case OP_INSTANTIATION:
+            foldList(node->instantiate.params);
+            return node;
+        case OP_OBJECT_CALL:
+            node->objectcall.object = foldExpression(node->objectcall.object);
+            foldList(node->objectcall.params);
+            return node;
+        case OP_CHOOSE:
+            node->choose.condition = foldExpression(node->choose.condition);
+            node->choose.iftrue = foldExpression(node->choose.iftrue);
+            node->choose.iffalse = foldExpression(node->choose.iffalse);
+
+            if (isConstant(node->choose.condition))
+                return replaceWithChild(node, getBooleanValue(node->choose.condition) ? &(node->choose.iftrue) : &(node->choose.iffalse));
+
+            return node;
+        case OP_CLOSURE:
+            raiseBindingScope();
+            bindParameters(node->closure.params);
+            foldBlock(node->closure.body);
+            fallBindingScope();
+            return node;
+        case OP_LAMBDA:
+            raiseBindingScope();
+            bindParameters(node->lambda.params);
+            node->lambda.expression = foldExpression(node->lambda.expression);
+            fallBindingScope();
+            return node;
+        case OP_NOP:
+        case OP_VARIABLE:
+        case OP_INTEGER:
+        case OP_LONG_INTEGER:
+        case OP_DECIMAL:
+        case OP_CHAR:
+        case OP_RESERVED_LITERAL:
+        case OP_STRING:
+            return node;
+    }
+
+    return node;
+}
+
+//frees a statement with a constant condition apart from the branch that runs, which stays a block of its own.
+static StatementNode* replaceConditional(StatementNode* node, StatementNode* kept) {
+    deleteExpressionNode(node->conditional.condition);
+
+    if (node->conditional.block != kept)
+        deleteStatementNode(node->conditional.block);
+
+    if (node->type == S_IF_ELSE && node->conditional.elseBlock != kept)
+        deleteStatementNode(node->conditional.elseBlock);
+
+    memFree(node);
+
+    if (kept == NULL)
+        return createBlockStatement(NULL);
+    else if (kept->type == S_BLOCK)
+        return kept;
+
+    return createBlockStatement(linkBlockList(kept, NULL));
+}
+
+static StatementNode* foldStatement(StatementNode* node) {
+    switch (node->type) {
+        case S_NOP:
+            break;
+        case S_VARIABLE_DEF:
+        case S_INFER_DEF:
+            node->varDefinition.value = foldExpression(node->varDefinition.value);
+
+            if (isConstant(node->varDefinition.value) && !node->varDefinition.assigned)
+                constants[node] = node->varDefinition.value;
+
+            bindVariable(node->varDefinition.variable, node, NULL);
+            break;
+        case S_EXPRESSION:
+        case S_RETURN:
+        case S_DELETE:
+            node->expression = foldExpression(node->expression);
+            break;
+        case S_ASSERT:
+            node->expression = foldExpression(node->expression);
+
+            if (isConstant(node->expression) && getBooleanValue(node->expression)) {
+                deleteStatementNode(node);
+                return createBlockStatement(NULL);
+            }
+
+            break;
+        case S_BLOCK:
+            foldBlock(node->block);
+            break;
+        case S_IF:
+        case S_WHILE:
+            node->conditional.condition = foldExpression(node->conditional.condition);
+            raiseBindingScope();
+            node->conditional.block = foldStatement(node->conditional.block);
+            fallBindingScope();
+
+            if (isConstant(node->conditional.condition)) {
+                if (!getBooleanValue(node->conditional.condition))
+                    return replaceConditional(node, NULL);
+                else if (node->type == S_IF)
+                    return replaceConditional(node, node->conditional.block);
+            }
+
+            break;
+        case S_IF_ELSE:
+            node->conditional.condition = foldExpression(node->conditional.condition);
+            raiseBindingScope();
+            node->conditional.block = foldStatement(node->conditional.block);
+            fallBindingScope();
+            raiseBindingScope();
+            node->conditional.elseBlock = foldStatement(node->conditional.elseBlock);
+            fallBindingScope();
+
+            if (isConstant(node->conditional.condition))
+                return replaceConditional(node, getBooleanValue(node->conditional.condition) ? node->conditional.block : node->conditional.elseBlock);
+
+            break;
+    }
+
+    return node;
+}
+
+static void markAssignedInMethod(ParameterList* params, ExpressionList* inheritsParams, BlockList* body) {
+    raiseBindingScope();
+    bindParameters(params);
+    findAssignmentsInList(inheritsParams);
+    findAssignmentsInBlock(body);
+    fallBindingScope();
+}
+
+Boolean isAssignedMember(const char* name) {
+    return assignedMembers.count(name) != 0 ? TRUE : FALSE;
+}
+
+int getMemberAccesses(const char* name) {
+    auto found = memberAccesses.find(name);
+    return found == memberAccesses.end() ? 0 : found->second;
+}
+
+void markAssignedVariables(ParserTopNode* node) {
+    switch (node->type) {
+        case PRT_METHOD_DEFINITION:
+            markAssignedInMethod(node->method.params, NULL, node->method.body);
+            break;
+        case PRT_CLASS_DEFINITION:
+            for (ClassList* c = node->classdef.classlist; c != NULL; c = c->next) {
+                switch (c->type) {
+                    case CLT_VARIABLE:
+                        findAssignments(c->variable.defaultValue);
+                        break;
+                    case CLT_METHOD:
+                        markAssignedInMethod(c->method.params, NULL, c->method.block);
+                        break;
+                    case CLT_CONSTRUCTOR:
+                        markAssignedInMethod(c->constructor.params, c->constructor.inheritsParams, c->constructor.block);
+                        break;
+                }
+            }
+
+            break;
+        case PRT_NONE:
+        case PRT_METHOD_DECLARATION:
+        case PRT_VARIABLE_DECLARATION:
+        case PRT_VARIABLE_DEFINITION:
+            break;
+    }
+}
+
+static void foldMethod(ParameterList* params, ExpressionList* inheritsParams, BlockList* body) {
+    raiseBindingScope();
+    bindParameters(params);
+    foldList(inheritsParams);
+    foldBlock(body);
+    fallBindingScope();
+
+    if (!constants.empty())
+        constants.clear();
+}
+
+void foldTopNode(ParserTopNode* node) {
+    switch (node->type) {
+        case PRT_METHOD_DEFINITION:
+            foldMethod(node->method.params, NULL, node->method.body);
+            break;
+        case PRT_CLASS_DEFINITION:
+            for (ClassList* c = node->classdef.classlist; c != NULL; c = c->next) {
+                switch (c->type) {
+                    case CLT_VARIABLE:
+                        c->variable.defaultValue = foldExpression(c->variable.defaultValue);
+                        break;
+                    case CLT_METHOD:
+                        foldMethod(c->method.params, NULL, c->method.block);
+                        break;
+                    case CLT_CONSTRUCTOR:
+                        foldMethod(c->constructor.params, c->constructor.inheritsParams, c->constructor.block);
+                        break;
+                }
+            }
+
+            break;
+        case PRT_NONE:
+        case PRT_METHOD_DECLARATION:
+        case PRT_VARIABLE_DECLARATION:
+        case PRT_VARIABLE_DEFINITION:
+            break;
+    }
+}
@@ -0,0 +1,40 @@
+/*
+ * File:   ConstantFolding.h
+ * Author: Michael Goulet
+ * Implementation: ConstantFolding.cpp
+ *
+ * Folds literal arithmetic, comparisons, choices and numerical casts in the typed syntax tree, propagates the values
+ * of locals that are defined with a literal and never assigned again, and drops if/while/assert statements whose
+ * condition folded to a constant. Runs after typeCheckTopNode, so every node already has its determinedType.
+ *
+ * markAssignedVariables sets the assigned flag of every local definition and parameter that is the target of OP_SET,
+ * ++ or --, including from inside a closure that captures it. It runs whether or not folding does: the emitters keep
+ * a stack slot only for assigned names and bind every other name straight to its value. It also records the names of
+ * the object members that are ever assigned, so that the methods no object assigns can live in the class's vtable,
+ * and counts the accesses of each member name, weighted by LOOP_ACCESS_WEIGHT for each loop around them (up to
+ * MAX_LOOP_WEIGHT_DEPTH loops), for the hot/cold field layout.
+ */
+
+#ifndef CONSTANTFOLDING_H
+#define	CONSTANTFOLDING_H
+
+#include "Structures.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define LOOP_ACCESS_WEIGHT 8
+#define MAX_LOOP_WEIGHT_DEPTH 4
+
+    void markAssignedVariables(ParserTopNode*);
+    Boolean isAssignedMember(const char* name); //after markAssignedVariables has seen every top node.
+    int getMemberAccesses(const char* name); //likewise, of the members of that name in any class.
+    void foldTopNode(ParserTopNode*); //after markAssignedVariables.
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* CONSTANTFOLDING_H */
+
@@ -0,0 +1,346 @@
+/*
+ * File:   DeadCode.cpp
+ * Author: Michael Goulet
+ * Implements: DeadCode.h
+ */
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "DeadCode.h"
+#include "TypeSystem.h"
+#include "TypeSystemUtilities.hpp"
+
+static std::string entryPoint = "main";
+static std::vector<ParserTopNode*> nodes;
+static std::unordered_map<std::string, ParserTopNode*> globals; //methods and global variables.
+static std::unordered_map<TypeKey, ParserTopNode*> classes;
+static std::unordered_set<ParserTopNode*> reachable;
+static std::unordered_set<CheshireType, CheshireTypeHash, CheshireTypeEql> visitedLambdas;
+static std::unordered_set<TypeKey> deletedTypes; //the static types of the objects reachable delete statements free.
+static std::vector<ParserTopNode*> worklist;
+static Boolean wholeProgram = FALSE;
+static Boolean marking = FALSE; //the walk of an unreachable node only counts its syntax tree nodes.
+static int walkedNodes = 0;
+
+extern KeyedLambdas keyedLambdas;
+
+static void visitExpression(ExpressionNode*);
+static void visitStatement(StatementNode*);
+
+void setEntryPoint(const char* name) {
+    entryPoint = name;
+}
+
+void addReachabilityNode(ParserTopNode* node) {
+    nodes.push_back(node);
+
+    switch (node->type) {
+        case PRT_METHOD_DECLARATION:
+        case PRT_METHOD_DEFINITION:
+            globals[node->method.functionName] = node;
+            break;
+        case PRT_VARIABLE_DECLARATION:
+        case PRT_VARIABLE_DEFINITION:
+            globals[node->variable.name] = node;
+            break;
+        case PRT_CLASS_DEFINITION:
+            classes[getNamedType(node->classdef.name).typeKey] = node;
+            break;
+        case PRT_NONE:
+            break;
+    }
+}
+
+static void reach(ParserTopNode* node) {
+    if (marking && reachable.insert(node).second)
+        worklist.push_back(node);
+}
+
+static void useName(const char* name) {
+    auto found = globals.find(name);
+
+    if (found != globals.end())
+        reach(found->second);
+}
+
+static void useType(CheshireType type) {
+    if (!marking)
+        return;
+
+    auto found = classes.find(type.typeKey);
+
+    if (found != classes.end()) {
+        reach(found->second);
+        return;
+    }
+
+    if (isLambdaType(type) && visitedLambdas.insert(type).second) {
+        LambdaType& lambda = keyedLambdas[type];
+        useType(lambda.first);
+
+        for (size_t i = 0; i < lambda.second.size(); i++)
+            useType(lambda.second[i]);
+    }
+}
+
+static void visitParameters(ParameterList* params) {
+    for (; params != NULL; params = params->next)
+        useType(params->type);
+}
+
+static void visitList(ExpressionList* list) {
+    for (; list != NULL; list = list->next)
+        visitExpression(list->parameter);
+}
+
+static void visitBlock(BlockList* list) {
+    for (; list != NULL; list = list->next)
+        visitStatement(list->statement);
+}
+
+static void visitExpression(ExpressionNode* node) {
+    walkedNodes++;
+    useType(node->determinedType);
+
+    switch (node->type) {
+        case OP_NOP:
+        case OP_INTEGER:
+        case OP_LONG_INTEGER:
+        case OP_DECIMAL:
+        case OP_CHAR:
+        case OP_RESERVED_LITERAL:
+        case OP_STRING:
+        case OP_LAMBDA: //converted into OP_CLOSURE by the type checker.
+            break;
+        case OP_VARIABLE:
+            useName(node->string);
+            break;
+        case OP_DEREFERENCE:
+        case OP_NOT:
+        case OP_COMPL:
+        case OP_UNARY_MINUS:
+        case OP_PLUSONE:
+        case OP_MINUSONE:
+        case OP_LENGTH:
+            visitExpression(node->unaryChild);
+            break;
+        case OP_EQUALS:
+        case OP_NOT_EQUALS:
+        case OP_GRE_EQUALS:
+        case OP_LES_EQUALS:
+        case OP_GREATER:
+        case OP_LESS:
+        case OP_AND:
+        case OP_OR:
+        case OP_PLUS:
+        case OP_MINUS:
+        case OP_MULT:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_SET:
+        case OP_ARRAY_ACCESS:
+            visitExpression(node->binary.left);
+            visitExpression(node->binary.right);
+            break;
+        case OP_INSTANCEOF:
+            useType(node->instanceof.type);
+            visitExpression(node->instanceof.expression);
+            break;
+        case OP_CAST:
+            useType(node->cast.type);
+            visitExpression(node->cast.child);
+            break;
+        case OP_ACCESS:
+            visitExpression(node->access.expression);
+            break;
+        case OP_METHOD_CALL:
+            visitExpression(node->methodcall.callback);
+            visitList(node->methodcall.params);
+            break;
+        case OP_OBJECT_CALL:
+            visitExpression(node->objectcall.object);
+            visitList(node->objectcall.params);
+            break;
+        case OP_INSTANTIATION:
+            useType(node->instantiate.type);
+            visitList(node->instantiate.params);
+            break;
+        case OP_CLOSURE:
+            useType(node->closure.type);
+            visitParameters(node->closure.params);
+
+            for (UsingList* u = node->closure.usingList; u != NULL; u = u->next)
+                useType(u->type);
+
+            visitBlock(node->closure.body);
+            break;
+        case OP_CHOOSE:
+            visitExpression(node->choose.condition);
+            visitExpression(node->choose.iftrue);
+            visitExpression(node->choose.iffalse);
+            break;
+    }
+}
+
+static void visitStatement(StatementNode* node) {
+    walkedNodes++;
+
+    switch (node->type) {
+        case S_NOP:
+            break;
+        case S_VARIABLE_DEF:
+        case S_INFER_DEF:
+            useType(node->varDefinition.type);
+            visitExpression(node->varDefinition.value);
+            break;
+        case S_DELETE:
+            if (marking)
+                deletedTypes.insert(node->expression->determinedType.typeKey);
+
+            visitExpression(node->expression);
+            break;
+        case S_EXPRESSION:
+        case S_ASSERT:
+            visitExpression(node->expression);
+            break;
+        case S_RETURN:
+            if (node->expression != NULL)
+                visitExpression(node->expression);
+
+            break;
+        case S_BLOCK:
+            visitBlock(node->block);
+            break;
+        case S_IF:
+        case S_WHILE:
+            visitExpression(node->conditional.condition);
+            visitStatement(node->conditional.block);
+            break;
+        case S_IF_ELSE:
+            visitExpression(node->conditional.condition);
+            visitStatement(node->conditional.block);
+            visitStatement(node->conditional.elseBlock);
+            break;
+    }
+}
+
+static void visitTopNode(ParserTopNode* node) {
+    walkedNodes++;
+
+    switch (node->type) {
+        case PRT_METHOD_DECLARATION:
+            useType(node->method.returnType);
+            visitParameters(node->method.params);
+            break;
+        case PRT_METHOD_DEFINITION:
+            useType(node->method.returnType);
+            visitParameters(node->method.params);
+            visitBlock(node->method.body);
+            break;
+        case PRT_VARIABLE_DECLARATION:
+        case PRT_VARIABLE_DEFINITION:
+            useType(node->variable.type);
+            break;
+        case PRT_CLASS_DEFINITION:
+            useType(node->classdef.parent); //its constructor calls the parent's.
+
+            for (ClassList* c = node->classdef.classlist; c != NULL; c = c->next) {
+                walkedNodes++;
+
+                switch (c->type) {
+                    case CLT_VARIABLE:
+                        useType(c->variable.type);
+                        visitExpression(c->variable.defaultValue);
+                        break;
+                    case CLT_METHOD:
+                        useType(c->method.returnType);
+                        visitParameters(c->method.params);
+                        visitBlock(c->method.block);
+                        break;
+                    case CLT_CONSTRUCTOR:
+                        visitParameters(c->constructor.params);
+                        visitList(c->constructor.inheritsParams);
+                        visitBlock(c->constructor.block);
+                        break;
+                }
+            }
+
+            break;
+        case PRT_NONE:
+            break;
+    }
+}
+
+void findReachableNodes() {
+    auto entry = globals.find(entryPoint);
+
+    if (entry == globals.end()) { //not a whole program.
+        reachable.insert(nodes.begin(), nodes.end());
+        return;
+    }
+
+    wholeProgram = marking = TRUE;
+    reach(entry->second);
+
+    while (!worklist.empty()) {
+        ParserTopNode* node = worklist.back();
+        worklist.pop_back();
+        visitTopNode(node);
+    }
+
+    marking = FALSE;
+}
+
+Boolean isReachableNode(ParserTopNode* node) {
+    return reachable.count(node) != 0 ? TRUE : FALSE;
+}
+
+Boolean isReachableClass(CheshireType type) {
+    auto found = classes.find(type.typeKey);
+    return !wholeProgram || found == classes.end() || isReachableNode(found->second) ? TRUE : FALSE;
+}
+
+Boolean isWholeProgram() {
+    return wholeProgram;
+}
+
+Boolean isDeletedClass(CheshireType type) {
+    if (!wholeProgram)
+        return TRUE;
+
+    for (auto i = deletedTypes.begin(); i != deletedTypes.end(); ++i) {
+        CheshireType deleted = {*i, 0};
+
+        if (isObjectType(deleted) && !isNull(deleted) && isSuper(deleted, type))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+void printDeadCodeReport(FILE* out) {
+    if (!wholeProgram) {
+        fprintf(out, "Removed nothing: the entry point %s is not defined\n", entryPoint.c_str());
+        return;
+    }
+
+    int kept = walkedNodes;
+    int removed[PRT_CLASS_DEFINITION + 1] = {0}, total[PRT_CLASS_DEFINITION + 1] = {0};
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        total[nodes[i]->type]++;
+
+        if (!isReachableNode(nodes[i])) {
+            removed[nodes[i]->type]++;
+            visitTopNode(nodes[i]);
+        }
+    }
+
+    fprintf(out, "Removed %d of %d methods, %d of %d classes and %d of %d globals unreachable from %s (%d of %d syntax tree nodes)\n",
+            removed[PRT_METHOD_DECLARATION] + removed[PRT_METHOD_DEFINITION], total[PRT_METHOD_DECLARATION] + total[PRT_METHOD_DEFINITION],
+            removed[PRT_CLASS_DEFINITION], total[PRT_CLASS_DEFINITION],
+            removed[PRT_VARIABLE_DECLARATION] + removed[PRT_VARIABLE_DEFINITION], total[PRT_VARIABLE_DECLARATION] + total[PRT_VARIABLE_DEFINITION],
+            entryPoint.c_str(), walkedNodes - kept, walkedNodes);
+}
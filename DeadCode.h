@@ -0,0 +1,39 @@
+/*
+ * File:   DeadCode.h
+ * Author: Michael Goulet
+ * Implementation: DeadCode.cpp
+ *
+ * Whole-program dead code elimination: starting from the entry point (main unless set), follows every name a method,
+ * closure or class reads and every class type it mentions, to find the top nodes the program can reach. A reachable
+ * class keeps its parent and all of its members, since its constructor fills every method slot. Names are not
+ * resolved against locals, so a local shadowing a global keeps that global alive. If the entry point is not defined,
+ * every node is reachable, and every class deleted, since another module could delete its objects.
+ *
+ * addReachabilityNode must see every top node before findReachableNodes runs. Runs after inlineTopNode, which can
+ * remove the last call of a method.
+ */
+
+#ifndef DEADCODE_H
+#define	DEADCODE_H
+
+#include <stdio.h>
+#include "Structures.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    void setEntryPoint(const char* name);
+    void addReachabilityNode(ParserTopNode*);
+    void findReachableNodes(void);
+    Boolean isReachableNode(ParserTopNode*);
+    Boolean isReachableClass(CheshireType); //whether its methods are emitted, so calls can name them directly.
+    Boolean isWholeProgram(void); //the entry point was found, so no other module can define a subclass.
+    Boolean isDeletedClass(CheshireType); //its objects can be deleted: it or an ancestor is deleted by reachable code.
+    void printDeadCodeReport(FILE*);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DEADCODE_H */
@@ -0,0 +1,742 @@
+/*
+ * File:   Escape.cpp
+ * Author: Michael Goulet
+ * Implements: Escape.h
+ */
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include "Escape.h"
+#include "DeadCode.h"
+#include "TypeSystem.h"
+#include "TypeSystemUtilities.hpp"
+
+//a node of the flow graph of the function being walked: an object created by a site, or a local or parameter.
+typedef struct {
+    ExpressionNode* site; //NULL for locals.
+    StatementNode* loop; //the innermost loop around a site.
+    std::vector<StatementNode*> loops; //around the definition of a local, outermost first.
+    std::vector<int> flowsTo; //the locals it is assigned to.
+    Boolean escapes;
+} EscapeValue;
+
+typedef struct {
+    const char* name;
+    StatementNode* definition; //NULL for parameters and captures.
+    int value; //-1 for captures, which the closure only holds a copy of.
+} EscapeBinding;
+
+typedef struct {
+    ParameterList* params;
+    UsingList* captures;
+    BlockList* body;
+    ParserTopNode* classdef; //of constructors.
+    ExpressionList* inheritsParams;
+    std::vector<Boolean> escapingParams; //self first, for class methods and constructors.
+} EscapeFunction;
+
+typedef std::vector<int> ValueSet;
+
+static std::vector<EscapeFunction> functions;
+static std::unordered_map<const void*, size_t> functionIndices; //by the node that defines each function.
+static std::unordered_map<TypeKey, size_t> constructors;
+static std::unordered_map<std::string, ParserTopNode*> globals; //methods.
+static std::unordered_set<std::string> assignedSlots; //object slots that are the target of an assignment somewhere.
+static std::unordered_map<BlockList*, std::vector<ExpressionNode*> > stackObjects;
+static std::unordered_set<ExpressionNode*> stackAllocated;
+static std::vector<EscapeValue> values;
+static std::vector<EscapeBinding> bindings;
+static std::vector<size_t> bindingScopes;
+static std::vector<StatementNode*> loops;
+static int totalSites = 0;
+
+extern ObjectMapping objectMapping;
+extern AncestryMap ancestryMap;
+
+static ValueSet walkExpression(ExpressionNode*);
+static void walkStatement(StatementNode*);
+static void collectExpression(ExpressionNode*);
+static void collectStatement(StatementNode*);
+
+//////////////// FUNCTIONS /////////////////
+
+static void addFunction(const void* owner, ParameterList* params, UsingList* captures, BlockList* body) {
+    EscapeFunction function = {params, captures, body, NULL, NULL, std::vector<Boolean>()};
+    functionIndices[owner] = functions.size();
+    functions.push_back(function);
+}
+
+static void collectList(ExpressionList* list) {
+    for (; list != NULL; list = list->next)
+        collectExpression(list->parameter);
+}
+
+static void collectBlock(BlockList* list) {
+    for (; list != NULL; list = list->next)
+        collectStatement(list->statement);
+}
+
+//finds the closures and the assigned slots.
+static void collectExpression(ExpressionNode* node) {
+    switch (node->type) {
+        case OP_NOP:
+        case OP_INTEGER:
+        case OP_LONG_INTEGER:
+        case OP_DECIMAL:
+        case OP_CHAR:
+        case OP_RESERVED_LITERAL:
+        case OP_STRING:
+        case OP_VARIABLE:
+        case OP_LAMBDA:
+            break;
+        case OP_DEREFERENCE:
+        case OP_NOT:
+        case OP_COMPL:
+        case OP_UNARY_MINUS:
+        case OP_LENGTH:
+            collectExpression(node->unaryChild);
+            break;
+        case OP_PLUSONE:
+        case OP_MINUSONE:
+            if (node->unaryChild->type == OP_ACCESS)
+                assignedSlots.insert(node->unaryChild->access.variable);
+
+            collectExpression(node->unaryChild);
+            break;
+        case OP_SET:
+            if (node->binary.left->type == OP_ACCESS)
+                assignedSlots.insert(node->binary.left->access.variable);
+            //fall through
+        case OP_EQUALS:
+        case OP_NOT_EQUALS:
+        case OP_GRE_EQUALS:
+        case OP_LES_EQUALS:
+        case OP_GREATER:
+        case OP_LESS:
+        case OP_AND:
+        case OP_OR:
+        case OP_PLUS:
+        case OP_MINUS:
+        case OP_MULT:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_ARRAY_ACCESS:
+            collectExpression(node->binary.left);
+            collectExpression(node->binary.right);
+            break;
+        case OP_INSTANCEOF:
+            collectExpression(node->instanceof.expression);
+            break;
+        case OP_CAST:
+            collectExpression(node->cast.child);
+            break;
+        case OP_ACCESS:
+            collectExpression(node->access.expression);
+            break;
+        case OP_METHOD_CALL:
+            collectExpression(node->methodcall.callback);
+            collectList(node->methodcall.params);
+            break;
+        case OP_OBJECT_CALL:
+            collectExpression(node->objectcall.object);
+            collectList(node->objectcall.params);
+            break;
+        case OP_INSTANTIATION:
+            collectList(node->instantiate.params);
+            break;
+        case OP_CLOSURE:
+            addFunction(node, node->closure.params, node->closure.usingList, node->closure.body);
+            collectBlock(node->closure.body);
+            break;
+        case OP_CHOOSE:
+            collectExpression(node->choose.condition);
+            collectExpression(node->choose.iftrue);
+            collectExpression(node->choose.iffalse);
+            break;
+    }
+}
+
+static void collectStatement(StatementNode* node) {
+    switch (node->type) {
+        case S_NOP:
+            break;
+        case S_VARIABLE_DEF:
+        case S_INFER_DEF:
+            collectExpression(node->varDefinition.value);
+            break;
+        case S_EXPRESSION:
+        case S_ASSERT:
+        case S_DELETE:
+            collectExpression(node->expression);
+            break;
+        case S_RETURN:
+            if (node->expression != NULL)
+                collectExpression(node->expression);
+
+            break;
+        case S_BLOCK:
+            collectBlock(node->block);
+            break;
+        case S_IF:
+        case S_WHILE:
+            collectExpression(node->conditional.condition);
+            collectStatement(node->conditional.block);
+            break;
+        case S_IF_ELSE:
+            collectExpression(node->conditional.condition);
+            collectStatement(node->conditional.block);
+            collectStatement(node->conditional.elseBlock);
+            break;
+    }
+}
+
+void addEscapeNode(ParserTopNode* node) {
+    switch (node->type) {
+        case PRT_METHOD_DECLARATION: //external, so every argument escapes.
+            globals[node->method.functionName] = node;
+            break;
+        case PRT_METHOD_DEFINITION:
+            globals[node->method.functionName] = node;
+            addFunction(node, node->method.params, NULL, node->method.body);
+            collectBlock(node->method.body);
+            break;
+        case PRT_VARIABLE_DECLARATION:
+        case PRT_VARIABLE_DEFINITION:
+            break;
+        case PRT_CLASS_DEFINITION: {
+            ClassList* constructor = NULL;
+
+            for (ClassList* c = node->classdef.classlist; c != NULL; c = c->next) {
+                switch (c->type) {
+                    case CLT_VARIABLE:
+                        collectExpression(c->variable.defaultValue);
+                        break;
+                    case CLT_METHOD:
+                        addFunction(c, c->method.params, NULL, c->method.block);
+                        collectBlock(c->method.block);
+                        break;
+                    case CLT_CONSTRUCTOR:
+                        constructor = c;
+                        collectList(c->constructor.inheritsParams);
+                        collectBlock(c->constructor.block);
+                        break;
+                }
+            }
+
+            EscapeFunction function = {NULL, NULL, NULL, node, NULL, std::vector<Boolean>()};
+
+            if (constructor != NULL) { //otherwise, the implicit one only takes self.
+                function.params = constructor->constructor.params;
+                function.body = constructor->constructor.block;
+                function.inheritsParams = constructor->constructor.inheritsParams;
+            }
+
+            constructors[getNamedType(node->classdef.name).typeKey] = functions.size();
+            functions.push_back(function);
+        }
+        break;
+        case PRT_NONE:
+            break;
+    }
+}
+
+//////////////// BINDINGS /////////////////
+
+static void raiseBindingScope() {
+    bindingScopes.push_back(bindings.size());
+}
+
+static void fallBindingScope() {
+    bindings.resize(bindingScopes.back());
+    bindingScopes.pop_back();
+}
+
+static int newValue(ExpressionNode* site) {
+    EscapeValue value = {site, loops.empty() ? NULL : loops.back(), std::vector<StatementNode*>(), std::vector<int>(), FALSE};
+
+    if (site == NULL)
+        value.loops = loops;
+
+    values.push_back(value);
+    return (int) values.size() - 1;
+}
+
+static void bindVariable(const char* name, StatementNode* definition, int value) {
+    EscapeBinding binding = {name, definition, value};
+    bindings.push_back(binding);
+}
+
+static EscapeBinding* resolveBinding(const char* name) {
+    CStrEql streql;
+
+    for (size_t i = bindings.size(); i > 0; i--) { //innermost first.
+        if (streql(bindings[i - 1].name, name))
+            return &bindings[i - 1];
+    }
+
+    return NULL; //a global, or a method.
+}
+
+//////////////// CALLEES /////////////////
+
+static ClassList* findClassMember(TypeKey type, const char* name) {
+    CStrEql streql;
+    auto found = objectMapping.find(type);
+
+    for (ClassList* c = found != objectMapping.end() ? found->second : NULL; c != NULL; c = c->next) {
+        if ((c->type == CLT_METHOD && streql(c->method.name, name)) || (c->type == CLT_VARIABLE && streql(c->variable.name, name)))
+            return c;
+    }
+
+    return NULL;
+}
+
+static TypeKey getParent(TypeKey type) {
+    auto found = ancestryMap.find(type);
+    return found != ancestryMap.end() ? found->second : type;
+}
+
+static Boolean inheritsFrom(TypeKey type, TypeKey ancestor) {
+    for (TypeKey t = type; t != getParent(t); t = getParent(t)) {
+        if (getParent(t) == ancestor)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static int getFunctionIndex(const void* owner) {
+    auto found = functionIndices.find(owner);
+    return found != functionIndices.end() ? (int) found->second : -1;
+}
+
+//whether the argument passed as the parameter at index escapes from the function, -1 for an unknown callee.
+static Boolean escapesThrough(int function, size_t index) {
+    if (function < 0)
+        return TRUE;
+
+    std::vector<Boolean>& escaping = functions[function].escapingParams;
+    return index >= escaping.size() || escaping[index] ? TRUE : FALSE;
+}
+
+//of every method an object of the type can call by the name, as getObjectMethodEffects; FALSE if any is unknown.
+static Boolean findObjectCallees(CheshireType type, const char* name, std::vector<int>& callees) {
+    if (!isObjectType(type) || type.arrayNesting != 0 || assignedSlots.count(name) != 0)
+        return FALSE;
+
+    ClassList* method = NULL;
+
+    for (TypeKey t = type.typeKey; method == NULL && t != TYPE_OBJECT.typeKey; t = getParent(t)) {
+        method = findClassMember(t, name);
+
+        if (t == getParent(t))
+            break;
+    }
+
+    if (method == NULL || method->type != CLT_METHOD) //a field holding a closure.
+        return FALSE;
+
+    if (!isWholeProgram() && !isFinalClass(type) && !isFinalMethod(type, name)) //another module could override it.
+        return FALSE;
+
+    callees.push_back(getFunctionIndex(method));
+
+    for (auto i = ancestryMap.begin(); i != ancestryMap.end(); ++i) {
+        if (!inheritsFrom(i->first, type.typeKey))
+            continue;
+
+        ClassList* override = findClassMember(i->first, name);
+
+        if (override != NULL)
+            callees.push_back(override->type == CLT_METHOD ? getFunctionIndex(override) : -1);
+    }
+
+    return TRUE;
+}
+
+static int findCallee(ExpressionNode* callback) {
+    if (callback->type == OP_CLOSURE)
+        return getFunctionIndex(callback);
+
+    if (callback->type != OP_DEREFERENCE || callback->unaryChild->type != OP_VARIABLE)
+        return -1;
+
+    EscapeBinding* binding = resolveBinding(callback->unaryChild->string);
+
+    if (binding != NULL) {
+        StatementNode* definition = binding->definition;
+
+        if (definition == NULL || definition->varDefinition.assigned || definition->varDefinition.value->type != OP_CLOSURE)
+            return -1;
+
+        return getFunctionIndex(definition->varDefinition.value);
+    }
+
+    auto found = globals.find(callback->unaryChild->string);
+    return found != globals.end() ? getFunctionIndex(found->second) : -1;
+}
+
+static int findConstructor(CheshireType type) {
+    auto found = constructors.find(type.typeKey);
+    return found != constructors.end() ? (int) found->second : -1;
+}
+
+//////////////// FLOW /////////////////
+
+static void escape(const ValueSet& set) {
+    for (size_t i = 0; i < set.size(); i++)
+        values[set[i]].escapes = TRUE;
+}
+
+static void flowInto(const ValueSet& set, int local) {
+    for (size_t i = 0; i < set.size(); i++)
+        values[set[i]].flowsTo.push_back(local);
+}
+
+static void walkBlock(BlockList* list) {
+    raiseBindingScope();
+
+    for (; list != NULL; list = list->next)
+        walkStatement(list->statement);
+
+    fallBindingScope();
+}
+
+//the arguments of a call of the functions, from the parameter at first on.
+static void walkArguments(ExpressionList* list, const std::vector<int>& callees, size_t first, Boolean tailCall) {
+    for (size_t i = first; list != NULL; list = list->next, i++) {
+        ValueSet argument = walkExpression(list->parameter);
+
+        for (size_t c = 0; c < callees.size(); c++) {
+            if (tailCall || escapesThrough(callees[c], i))
+                escape(argument);
+        }
+    }
+}
+
+//an lvalue that is assigned the values.
+static void walkAssigned(ExpressionNode* node, const ValueSet& assigned) {
+    switch (node->type) {
+        case OP_VARIABLE: {
+            EscapeBinding* binding = resolveBinding(node->string);
+
+            if (binding != NULL && binding->value >= 0)
+                flowInto(assigned, binding->value);
+            else //a global, or a capture.
+                escape(assigned);
+        }
+        break;
+        case OP_ACCESS: //storing into an object that does not escape is fine, but what is stored escapes.
+            walkExpression(node->access.expression);
+            escape(assigned);
+            break;
+        default:
+            walkExpression(node);
+            escape(assigned);
+            break;
+    }
+}
+
+static ValueSet walkExpression(ExpressionNode* node) {
+    ValueSet result;
+
+    switch (node->type) {
+        case OP_NOP:
+        case OP_INTEGER:
+        case OP_LONG_INTEGER:
+        case OP_DECIMAL:
+        case OP_CHAR:
+        case OP_RESERVED_LITERAL:
+        case OP_STRING:
+        case OP_VARIABLE:
+        case OP_LAMBDA:
+            break;
+        case OP_DEREFERENCE:
+            if (node->unaryChild->type == OP_VARIABLE) {
+                EscapeBinding* binding = resolveBinding(node->unaryChild->string);
+
+                if (binding != NULL && binding->value >= 0)
+                    result.push_back(binding->value);
+
+                break;
+            }
+
+            escape(walkExpression(node->unaryChild));
+            break;
+        case OP_NOT:
+        case OP_COMPL:
+        case OP_UNARY_MINUS:
+        case OP_LENGTH:
+            walkExpression(node->unaryChild);
+            break;
+        case OP_PLUSONE:
+        case OP_MINUSONE:
+            walkAssigned(node->unaryChild, result);
+            break;
+        case OP_SET:
+            result = walkExpression(node->binary.right);
+            walkAssigned(node->binary.left, result);
+            break;
+        case OP_EQUALS:
+        case OP_NOT_EQUALS:
+        case OP_GRE_EQUALS:
+        case OP_LES_EQUALS:
+        case OP_GREATER:
+        case OP_LESS:
+        case OP_AND:
+        case OP_OR:
+        case OP_PLUS:
+        case OP_MINUS:
+        case OP_MULT:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_ARRAY_ACCESS:
+            walkExpression(node->binary.left);
+            walkExpression(node->binary.right);
+            break;
+        case OP_INSTANCEOF:
+            walkExpression(node->instanceof.expression);
+            break;
+        case OP_CAST:
+            result = walkExpression(node->cast.child);
+            break;
+        case OP_ACCESS:
+            walkExpression(node->access.expression);
+            break;
+        case OP_METHOD_CALL: {
+            std::vector<int> callees(1, findCallee(node->methodcall.callback));
+            walkExpression(node->methodcall.callback);
+            walkArguments(node->methodcall.params, callees, 0, node->methodcall.tailCall != TC_NONE ? TRUE : FALSE);
+        }
+        break;
+        case OP_OBJECT_CALL: {
+            std::vector<int> callees;
+            Boolean tailCall = node->objectcall.tailCall != TC_NONE ? TRUE : FALSE;
+            ValueSet object = walkExpression(node->objectcall.object);
+
+            if (!findObjectCallees(node->objectcall.object->determinedType, node->objectcall.method, callees))
+                callees.assign(1, -1);
+
+            for (size_t c = 0; c < callees.size(); c++) {
+                if (tailCall || escapesThrough(callees[c], 0))
+                    escape(object);
+            }
+
+            walkArguments(node->objectcall.params, callees, 1, tailCall);
+        }
+        break;
+        case OP_INSTANTIATION: {
+            CheshireType type = node->instantiate.type;
+            std::vector<int> callees(1, findConstructor(type));
+            int site = newValue(node);
+            result.push_back(site);
+            totalSites++;
+
+            //Object and String are laid out by the runtime.
+            if (type.arrayNesting != 0 || equalTypes(type, TYPE_OBJECT) || equalTypes(type, TYPE_STRING) || escapesThrough(callees[0], 0))
+                escape(result);
+
+            walkArguments(node->instantiate.params, callees, 1, FALSE);
+        }
+        break;
+        case OP_CLOSURE: //its body is a function of its own, which holds copies of the captures.
+            for (UsingList* u = node->closure.usingList; u != NULL; u = u->next) {
+                EscapeBinding* binding = resolveBinding(u->variable);
+
+                if (binding != NULL && binding->value >= 0)
+                    values[binding->value].escapes = TRUE;
+            }
+
+            break;
+        case OP_CHOOSE: {
+            walkExpression(node->choose.condition);
+            result = walkExpression(node->choose.iftrue);
+            ValueSet iffalse = walkExpression(node->choose.iffalse);
+            result.insert(result.end(), iffalse.begin(), iffalse.end());
+        }
+        break;
+    }
+
+    return result;
+}
+
+static void walkStatement(StatementNode* node) {
+    switch (node->type) {
+        case S_NOP:
+            break;
+        case S_VARIABLE_DEF:
+        case S_INFER_DEF: {
+            ValueSet value = walkExpression(node->varDefinition.value);
+            int local = newValue(NULL);
+            flowInto(value, local);
+            bindVariable(node->varDefinition.variable, node, local);
+        }
+        break;
+        case S_EXPRESSION:
+        case S_ASSERT:
+            walkExpression(node->expression);
+            break;
+        case S_DELETE:
+        case S_RETURN:
+            if (node->expression != NULL)
+                escape(walkExpression(node->expression));
+
+            break;
+        case S_BLOCK:
+            walkBlock(node->block);
+            break;
+        case S_IF:
+            walkExpression(node->conditional.condition);
+            walkStatement(node->conditional.block);
+            break;
+        case S_WHILE:
+            loops.push_back(node);
+            walkExpression(node->conditional.condition);
+            walkStatement(node->conditional.block);
+            loops.pop_back();
+            break;
+        case S_IF_ELSE:
+            walkExpression(node->conditional.condition);
+            walkStatement(node->conditional.block);
+            walkStatement(node->conditional.elseBlock);
+            break;
+    }
+}
+
+//whether a site's object can reach a local defined outside its loop, which would see the next iteration's object.
+static Boolean outlivesIteration(int site) {
+    StatementNode* loop = values[site].loop;
+    std::vector<int> worklist(1, site);
+    std::unordered_set<int> visited(worklist.begin(), worklist.end());
+
+    if (loop == NULL)
+        return FALSE;
+
+    while (!worklist.empty()) {
+        EscapeValue& value = values[worklist.back()];
+        worklist.pop_back();
+
+        if (value.site == NULL && std::find(value.loops.begin(), value.loops.end(), loop) == value.loops.end())
+            return TRUE;
+
+        for (size_t i = 0; i < value.flowsTo.size(); i++) {
+            if (visited.insert(value.flowsTo[i]).second)
+                worklist.push_back(value.flowsTo[i]);
+        }
+    }
+
+    return FALSE;
+}
+
+//walks a function into a fresh flow graph, then spreads escapes backwards along it; returns the parameters' nodes.
+static std::vector<int> walkFunction(EscapeFunction& function) {
+    std::vector<int> params;
+    values.clear();
+    raiseBindingScope();
+
+    if (function.classdef != NULL && function.params == NULL) //the implicit constructor.
+        params.push_back(newValue(NULL));
+
+    for (ParameterList* p = function.params; p != NULL; p = p->next) {
+        params.push_back(newValue(NULL));
+        bindVariable(p->name, NULL, params.back());
+    }
+
+    for (UsingList* u = function.captures; u != NULL; u = u->next)
+        bindVariable(u->variable, NULL, -1);
+
+    if (function.classdef != NULL) { //runs the parent's constructor, then stores the defaults into the fields.
+        std::vector<int> callees(1, findConstructor(function.classdef->classdef.parent));
+
+        if (callees[0] >= 0 && escapesThrough(callees[0], 0))
+            values[params[0]].escapes = TRUE;
+
+        walkArguments(function.inheritsParams, callees, 1, FALSE);
+
+        for (ClassList* c = function.classdef->classdef.classlist; c != NULL; c = c->next) {
+            if (c->type == CLT_VARIABLE)
+                escape(walkExpression(c->variable.defaultValue));
+        }
+    }
+
+    walkBlock(function.body);
+    fallBindingScope();
+    Boolean changed = TRUE;
+
+    while (changed) { //a value escapes if a local it flows into does.
+        changed = FALSE;
+
+        for (size_t i = 0; i < values.size(); i++) {
+            for (size_t j = 0; !values[i].escapes && j < values[i].flowsTo.size(); j++) {
+                if (values[values[i].flowsTo[j]].escapes)
+                    changed = values[i].escapes = TRUE;
+            }
+        }
+    }
+
+    return params;
+}
+
+void analyzeEscapes() {
+    Boolean changed = TRUE;
+
+    while (changed) { //optimistically, no parameter escapes; escapes only ever grow.
+        changed = FALSE;
+        totalSites = 0;
+        stackObjects.clear();
+        stackAllocated.clear();
+
+        for (size_t i = 0; i < functions.size(); i++) {
+            std::vector<int> params = walkFunction(functions[i]);
+            std::vector<Boolean> escaping;
+
+            for (size_t p = 0; p < params.size(); p++)
+                escaping.push_back(values[params[p]].escapes);
+
+            if (escaping != functions[i].escapingParams) {
+                functions[i].escapingParams = escaping;
+                changed = TRUE;
+            }
+
+            for (size_t v = 0; v < values.size(); v++) {
+                //the slot goes in the entry block of the body, so a constructor without one keeps its sites on the heap.
+                if (values[v].site != NULL && !values[v].escapes && functions[i].body != NULL && !outlivesIteration(v)) {
+                    stackObjects[functions[i].body].push_back(values[v].site);
+                    stackAllocated.insert(values[v].site);
+                }
+            }
+        }
+    }
+}
+
+Boolean isStackAllocated(ExpressionNode* instantiation) {
+    return stackAllocated.count(instantiation) != 0 ? TRUE : FALSE;
+}
+
+int getStackObjectCount(BlockList* body) {
+    auto found = stackObjects.find(body);
+    return found != stackObjects.end() ? (int) found->second.size() : 0;
+}
+
+ExpressionNode* getStackObject(BlockList* body, int index) {
+    return stackObjects[body][index];
+}
+
+void printEscapeReport(FILE* out) {
+    int escapingParams = 0, params = 0;
+
+    for (size_t i = 0; i < functions.size(); i++) {
+        for (size_t p = 0; p < functions[i].escapingParams.size(); p++) {
+            params++;
+
+            if (functions[i].escapingParams[p])
+                escapingParams++;
+        }
+    }
+
+    fprintf(out, "Allocated %zu of %d objects created by new on the stack, in %zu of %zu functions; %d of %d parameters escape\n",
+            stackAllocated.size(), totalSites, stackObjects.size(), functions.size(), escapingParams, params);
+}
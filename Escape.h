@@ -0,0 +1,39 @@
+/*
+ * File:   Escape.h
+ * Author: Michael Goulet
+ * Implementation: Escape.cpp
+ *
+ * Escape analysis of the objects "new" creates, over the typed syntax tree: follows each object through the locals
+ * it is stored in, to a fixed point over the call graph, and finds whether it can outlive the call that creates it.
+ * An object escapes when it is returned, stored into a field, array element, global or capture, captured by a
+ * closure, deleted, or passed to a callee whose parameter escapes: a method, closure or constructor that is resolved
+ * as in Purity.h, whose summary says so, or any other callee, including external methods and tail calls. Objects
+ * that do not escape are allocated in the entry block of the function that creates them and constructed there, so a
+ * site in a loop reuses one slot: it is only converted when every local the object flows into is defined in that
+ * loop too, so no two iterations' objects are alive at once. Object's runtime constructor is assumed not to keep self.
+ *
+ * addEscapeNode must see every emitted top node before analyzeEscapes runs. Runs after markTailCalls.
+ */
+
+#ifndef ESCAPE_H
+#define	ESCAPE_H
+
+#include <stdio.h>
+#include "Structures.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    void addEscapeNode(ParserTopNode*);
+    void analyzeEscapes(void);
+    Boolean isStackAllocated(ExpressionNode* instantiation);
+    int getStackObjectCount(BlockList* body); //the converted sites of the function with this body.
+    ExpressionNode* getStackObject(BlockList* body, int index);
+    void printEscapeReport(FILE*);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* ESCAPE_H */
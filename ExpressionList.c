@@ -4,9 +4,10 @@
  */
 
 #include "ParserNodes.h"
+#include "MemReport.h"
 
 static ExpressionList* allocExpressionList(void) {
-    ExpressionList* node = (ExpressionList*) malloc(sizeof(ExpressionList));
+    ExpressionList* node = (ExpressionList*) memAlloc(MC_LIST_NODES, sizeof(ExpressionList));
     
     if (node == NULL)
         PANIC_OR_RETURN_NULL;
@@ -33,5 +34,5 @@ void deleteExpressionList(ExpressionList* node) {
     
     deleteExpressionNode(node->parameter);
     deleteExpressionList(node->next);
-    free(node);
+    memFree(node);
 }
\ No newline at end of file
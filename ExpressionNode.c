@@ -4,9 +4,10 @@
  */
 
 #include "ParserNodes.h"
+#include "MemReport.h"
 
 static ExpressionNode* allocExpressionNode(void) {
-    ExpressionNode* node = (ExpressionNode*) malloc(sizeof(ExpressionNode));
+    ExpressionNode* node = (ExpressionNode*) memAlloc(MC_EXPRESSION_NODES, sizeof(ExpressionNode));
 
     if (node == NULL)
         PANIC_OR_RETURN_NULL;
@@ -155,6 +156,7 @@ ExpressionNode* createMethodCall(ExpressionNode* callback, ExpressionList* param
     node->type = OP_METHOD_CALL;
     node->methodcall.callback = callback;
     node->methodcall.params = params;
+    node->methodcall.tailCall = TC_NONE;
     return node;
 }
 
@@ -239,6 +241,7 @@ ExpressionNode* createObjectCall(ExpressionNode* object, char* method, Expressio
     node->objectcall.object = object;
     node->objectcall.method = method;
     node->objectcall.params = params;
+    node->objectcall.tailCall = TC_NONE;
     return node;
 }
 
@@ -303,14 +306,14 @@ void deleteExpressionNode(ExpressionNode* node) {
             break;
         case OP_ACCESS:
             deleteExpressionNode(node->access.expression);
-            free(node->access.variable);
+            memFree(node->access.variable);
             break;
         case OP_INSTANCEOF:
             deleteExpressionNode(node->instanceof.expression);
             break;
         case OP_VARIABLE:
         case OP_STRING:
-            free(node->string);
+            memFree(node->string);
             break;
         case OP_CAST:
             deleteExpressionNode(node->cast.child);
@@ -329,7 +332,7 @@ void deleteExpressionNode(ExpressionNode* node) {
             break;
         case OP_OBJECT_CALL:
             deleteExpressionNode(node->objectcall.object);
-            free(node->objectcall.method);
+            memFree(node->objectcall.method);
             deleteExpressionList(node->objectcall.params);
             break;
         case OP_CHOOSE:
@@ -350,5 +353,5 @@ void deleteExpressionNode(ExpressionNode* node) {
             break;
     }
 
-    free(node);
+    memFree(node);
 }
@@ -0,0 +1,764 @@
+/*
+ * File:   Inlining.cpp
+ * Author: Michael Goulet
+ * Implements: Inlining.h
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include "Inlining.h"
+#include "ParserNodes.h"
+#include "LexerUtilities.h"
+#include "TypeSystem.h"
+#include "TypeSystemUtilities.hpp"
+#include "MemReport.h"
+
+#define NO_BINDING SIZE_MAX
+
+typedef struct {
+    const char* name;
+    StatementNode* definition; //NULL for parameters.
+    ParameterList* param;
+    int depth; //closures bind their captures again, at their own depth.
+} InlineBinding;
+
+typedef struct {
+    ParameterList* params; //self first, for object methods.
+    StatementNode* body; //the single statement of the body.
+    UsingList* captures;
+} Callee;
+
+typedef struct {
+    ParameterList* params;
+    UsingList* captures;
+    std::vector<int> uses; //of each parameter.
+    int nodes;
+    Boolean pure;
+    Boolean valid;
+} BodyScan;
+
+static int budget = DEFAULT_INLINE_BUDGET;
+static int inlinedCalls = 0, consideredCalls = 0;
+static Boolean collecting = FALSE; //findInlineCandidates walks the tree like inlineTopNode, without inlining.
+static int depth = 0;
+static std::vector<InlineBinding> bindings;
+static std::vector<size_t> bindingScopes;
+static std::unordered_map<std::string, ParserTopNode*> methods;
+static std::unordered_set<std::string> assignedSlots; //object slots that are the target of an assignment somewhere.
+static std::map<std::pair<TypeKey, std::string>, ClassList*> objectMethods;
+
+extern ObjectMapping objectMapping;
+extern AncestryMap ancestryMap;
+
+static ExpressionNode* inlineExpression(ExpressionNode*);
+static void inlineStatement(StatementNode*);
+
+void setInlineBudget(int nodes) {
+    budget = nodes;
+}
+
+void printInlineReport(FILE* out) {
+    fprintf(out, "Inlined %d of %d calls (budget %d nodes)\n", inlinedCalls, consideredCalls, budget);
+}
+
+static void raiseBindingScope() {
+    bindingScopes.push_back(bindings.size());
+}
+
+static void fallBindingScope() {
+    bindings.resize(bindingScopes.back());
+    bindingScopes.pop_back();
+}
+
+static void bindVariable(const char* name, StatementNode* definition, ParameterList* param) {
+    InlineBinding binding = {name, definition, param, depth};
+    bindings.push_back(binding);
+}
+
+static void bindParameters(ParameterList* params) {
+    for (ParameterList* p = params; p != NULL; p = p->next)
+        bindVariable(p->name, NULL, p);
+}
+
+static size_t resolveBinding(const char* name) {
+    CStrEql streql;
+
+    for (size_t i = bindings.size(); i > 0; i--) { //innermost first.
+        if (streql(bindings[i - 1].name, name))
+            return i - 1;
+    }
+
+    return NO_BINDING; //a global, or a method.
+}
+
+static Boolean isAssigned(const InlineBinding& binding) {
+    return binding.definition != NULL ? binding.definition->varDefinition.assigned : binding.param->assigned;
+}
+
+//////////////// CALLEES /////////////////
+
+static ClassList* findClassMember(TypeKey type, const char* name) {
+    CStrEql streql;
+    auto found = objectMapping.find(type);
+
+    for (ClassList* c = found != objectMapping.end() ? found->second : NULL; c != NULL; c = c->next) {
+        if ((c->type == CLT_METHOD && streql(c->method.name, name)) || (c->type == CLT_VARIABLE && streql(c->variable.name, name)))
+            return c;
+    }
+
+    return NULL;
+}
+
+static TypeKey getParent(TypeKey type) {
+    auto found = ancestryMap.find(type);
+    return found != ancestryMap.end() ? found->second : type;
+}
+
+static Boolean inheritsFrom(TypeKey type, TypeKey ancestor) {
+    for (TypeKey t = type; t != getParent(t); t = getParent(t)) {
+        if (getParent(t) == ancestor)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+//the method an object of the type calls, if no class below the type overrides it.
+static ClassList* resolveObjectMethod(TypeKey type, const char* name) {
+    std::pair<TypeKey, std::string> key(type, name);
+    auto found = objectMethods.find(key);
+
+    if (found != objectMethods.end())
+        return found->second;
+
+    ClassList* method = NULL;
+
+    for (TypeKey t = type; method == NULL && t != TYPE_OBJECT.typeKey; t = getParent(t)) {
+        method = findClassMember(t, name);
+
+        if (t == getParent(t))
+            break;
+    }
+
+    if (method != NULL && method->type != CLT_METHOD)
+        method = NULL;
+
+    for (auto i = ancestryMap.begin(); method != NULL && i != ancestryMap.end(); ++i) {
+        if (inheritsFrom(i->first, type) && findClassMember(i->first, name) != NULL)
+            method = NULL;
+    }
+
+    return objectMethods[key] = method;
+}
+
+static Boolean resolveClosure(ExpressionNode* closure, size_t holder, Callee* callee) {
+    if (holder != NO_BINDING) { //called later than created: the captures must still hold the values they had.
+        for (UsingList* u = closure->closure.usingList; u != NULL; u = u->next) {
+            size_t binding = resolveBinding(u->variable);
+
+            if (binding == NO_BINDING || binding > holder || bindings[binding].depth != depth || isAssigned(bindings[binding]))
+                return FALSE;
+        }
+    }
+
+    callee->params = closure->closure.params;
+    callee->body = closure->closure.body != NULL && closure->closure.body->next == NULL ? closure->closure.body->statement : NULL;
+    callee->captures = closure->closure.usingList;
+    return TRUE;
+}
+
+static Boolean resolveCallee(ExpressionNode* call, Callee* callee) {
+    callee->captures = NULL;
+
+    if (call->type == OP_OBJECT_CALL) {
+        CheshireType type = call->objectcall.object->determinedType;
+
+        if (!isObjectType(type) || type.arrayNesting != 0 || assignedSlots.count(call->objectcall.method) != 0)
+            return FALSE;
+
+        ClassList* method = resolveObjectMethod(type.typeKey, call->objectcall.method);
+
+        if (method == NULL)
+            return FALSE;
+
+        callee->params = method->method.params;
+        callee->body = method->method.block != NULL && method->method.block->next == NULL ? method->method.block->statement : NULL;
+        return TRUE;
+    }
+
+    ExpressionNode* callback = call->methodcall.callback;
+
+    if (callback->type == OP_CLOSURE)
+        return resolveClosure(callback, NO_BINDING, callee);
+
+    if (callback->type != OP_DEREFERENCE || callback->unaryChild->type != OP_VARIABLE)
+        return FALSE;
+
+    size_t binding = resolveBinding(callback->unaryChild->string);
+
+    if (binding != NO_BINDING) {
+        StatementNode* definition = bindings[binding].definition;
+
+        if (definition == NULL || definition->varDefinition.assigned || definition->varDefinition.value->type != OP_CLOSURE)
+            return FALSE;
+
+        return resolveClosure(definition->varDefinition.value, binding, callee);
+    }
+
+    auto found = methods.find(callback->unaryChild->string);
+
+    if (found == methods.end())
+        return FALSE;
+
+    ParserTopNode* method = found->second;
+    callee->params = method->method.params;
+    callee->body = method->method.body != NULL && method->method.body->next == NULL ? method->method.body->statement : NULL;
+    return TRUE;
+}
+
+//////////////// BODIES /////////////////
+
+static int getParameterIndex(ParameterList* params, const char* name) {
+    CStrEql streql;
+    int index = 0;
+
+    for (ParameterList* p = params; p != NULL; p = p->next, index++) {
+        if (streql(p->name, name))
+            return index;
+    }
+
+    return -1;
+}
+
+static Boolean isCaptured(UsingList* captures, const char* name) {
+    CStrEql streql;
+
+    for (UsingList* u = captures; u != NULL; u = u->next) {
+        if (streql(u->variable, name))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static void scanBody(ExpressionNode* node, BodyScan& scan);
+
+static void scanList(ExpressionList* list, BodyScan& scan) {
+    for (; list != NULL; list = list->next)
+        scanBody(list->parameter, scan);
+}
+
+static void scanBody(ExpressionNode* node, BodyScan& scan) {
+    scan.nodes++;
+
+    switch (node->type) {
+        case OP_NOP:
+        case OP_INTEGER:
+        case OP_LONG_INTEGER:
+        case OP_DECIMAL:
+        case OP_CHAR:
+        case OP_RESERVED_LITERAL:
+        case OP_STRING:
+            break;
+        case OP_VARIABLE: //every read is under an OP_DEREFERENCE, the body assigns a name.
+        case OP_CLOSURE:
+        case OP_LAMBDA:
+            scan.valid = FALSE;
+            break;
+        case OP_DEREFERENCE:
+            if (node->unaryChild->type == OP_VARIABLE) {
+                const char* name = node->unaryChild->string;
+                int index = getParameterIndex(scan.params, name);
+
+                if (index >= 0)
+                    scan.uses[index]++;
+                else if (!isCaptured(scan.captures, name) && resolveBinding(name) != NO_BINDING)
+                    scan.valid = FALSE; //a global the call site shadows.
+
+                break;
+            }
+
+            scanBody(node->unaryChild, scan);
+            break;
+        case OP_PLUSONE:
+        case OP_MINUSONE:
+            scan.pure = FALSE;
+            scanBody(node->unaryChild, scan);
+            break;
+        case OP_NOT:
+        case OP_COMPL:
+        case OP_UNARY_MINUS:
+        case OP_LENGTH:
+            scanBody(node->unaryChild, scan);
+            break;
+        case OP_SET:
+            scan.pure = FALSE;
+            scanBody(node->binary.left, scan);
+            scanBody(node->binary.right, scan);
+            break;
+        case OP_EQUALS:
+        case OP_NOT_EQUALS:
+        case OP_GRE_EQUALS:
+        case OP_LES_EQUALS:
+        case OP_GREATER:
+        case OP_LESS:
+        case OP_AND:
+        case OP_OR:
+        case OP_PLUS:
+        case OP_MINUS:
+        case OP_MULT:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_ARRAY_ACCESS:
+            scanBody(node->binary.left, scan);
+            scanBody(node->binary.right, scan);
+            break;
+        case OP_INSTANCEOF:
+            scanBody(node->instanceof.expression, scan);
+            break;
+        case OP_CAST:
+            scanBody(node->cast.child, scan);
+            break;
+        case OP_ACCESS:
+            scanBody(node->access.expression, scan);
+            break;
+        case OP_METHOD_CALL:
+            scan.pure = FALSE;
+            scanBody(node->methodcall.callback, scan);
+            scanList(node->methodcall.params, scan);
+            break;
+        case OP_OBJECT_CALL:
+            scan.pure = FALSE;
+            scanBody(node->objectcall.object, scan);
+            scanList(node->objectcall.params, scan);
+            break;
+        case OP_INSTANTIATION:
+            scan.pure = FALSE;
+            scanList(node->instantiate.params, scan);
+            break;
+        case OP_CHOOSE:
+            scanBody(node->choose.condition, scan);
+            scanBody(node->choose.iftrue, scan);
+            scanBody(node->choose.iffalse, scan);
+            break;
+    }
+}
+
+static Boolean isLiteral(ExpressionNode* node) {
+    switch (node->type) {
+        case OP_INTEGER:
+        case OP_LONG_INTEGER:
+        case OP_DECIMAL:
+        case OP_CHAR:
+        case OP_RESERVED_LITERAL:
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+static Boolean isPureArgument(ExpressionNode* node) {
+    BodyScan scan = {NULL, NULL, std::vector<int>(), 0, TRUE, TRUE};
+    scanBody(node, scan);
+    return scan.pure && scan.valid ? TRUE : FALSE; //the names it reads are the caller's, so none is "shadowed".
+}
+
+//an argument can replace its parameter if evaluating it where (and as often as) the body reads it changes nothing.
+static Boolean canSubstitute(ExpressionNode* argument, int uses, Boolean pureBody) {
+    if (isLiteral(argument))
+        return TRUE;
+
+    if (argument->type == OP_DEREFERENCE && argument->unaryChild->type == OP_VARIABLE) //locals can't change in the body.
+        return resolveBinding(argument->unaryChild->string) != NO_BINDING || pureBody ? TRUE : FALSE;
+
+    return uses == 1 && pureBody && isPureArgument(argument) ? TRUE : FALSE;
+}
+
+//////////////// COPIES /////////////////
+
+static ExpressionNode* cloneExpression(ExpressionNode* node, ParameterList* params, ExpressionList* arguments);
+
+static ExpressionList* cloneList(ExpressionList* list, ParameterList* params, ExpressionList* arguments) {
+    if (list == NULL)
+        return NULL;
+
+    ExpressionNode* parameter = cloneExpression(list->parameter, params, arguments);
+    return linkExpressionList(parameter, cloneList(list->next, params, arguments));
+}
+
+static ExpressionNode* castTo(ExpressionNode* node, CheshireType type) {
+    if (equalTypes(node->determinedType, type) || isNull(node->determinedType) || isVoid(type))
+        return node;
+
+    ExpressionNode* cast = createCastOperation(node, type);
+    cast->determinedType = type;
+    return cast;
+}
+
+static ExpressionNode* cloneArgument(const char* name, ParameterList* params, ExpressionList* arguments) {
+    int index = getParameterIndex(params, name);
+
+    if (index < 0)
+        return NULL;
+
+    for (; index > 0; index--) {
+        params = params->next;
+        arguments = arguments->next;
+    }
+
+    return castTo(cloneExpression(arguments->parameter, NULL, NULL), params->type);
+}
+
+//a deep copy, with the reads of the parameters replaced by copies of the arguments.
+static ExpressionNode* cloneExpression(ExpressionNode* node, ParameterList* params, ExpressionList* arguments) {
+    if (node->type == OP_DEREFERENCE && node->unaryChild->type == OP_VARIABLE) {
+        ExpressionNode* argument = cloneArgument(node->unaryChild->string, params, arguments);
+
+        if (argument != NULL)
+            return argument;
+    }
+
+    ExpressionNode* copy = (ExpressionNode*) memAlloc(MC_EXPRESSION_NODES, sizeof(ExpressionNode));
+    *copy = *node;
+
+    switch (node->type) {
+        case OP_VARIABLE:
+        case OP_STRING:
+            copy->string = saveIdentifierReturn(node->string);
+            break;
+        case OP_DEREFERENCE:
+        case OP_NOT:
+        case OP_COMPL:
+        case OP_UNARY_MINUS:
+        case OP_PLUSONE:
+        case OP_MINUSONE:
+        case OP_LENGTH:
+            copy->unaryChild = cloneExpression(node->unaryChild, params, arguments);
+            break;
+        case OP_EQUALS:
+        case OP_NOT_EQUALS:
+        case OP_GRE_EQUALS:
+        case OP_LES_EQUALS:
+        case OP_GREATER:
+        case OP_LESS:
+        case OP_AND:
+        case OP_OR:
+        case OP_PLUS:
+        case OP_MINUS:
+        case OP_MULT:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_SET:
+        case OP_ARRAY_ACCESS:
+            copy->binary.left = cloneExpression(node->binary.left, params, arguments);
+            copy->binary.right = cloneExpression(node->binary.right, params, arguments);
+            break;
+        case OP_INSTANCEOF:
+            copy->instanceof.expression = cloneExpression(node->instanceof.expression, params, arguments);
+            break;
+        case OP_CAST:
+            copy->cast.child = cloneExpression(node->cast.child, params, arguments);
+            break;
+        case OP_ACCESS:
+            copy->access.expression = cloneExpression(node->access.expression, params, arguments);
+            copy->access.variable = saveIdentifierReturn(node->access.variable);
+            break;
+        case OP_METHOD_CALL:
+            copy->methodcall.callback = cloneExpression(node->methodcall.callback, params, arguments);
+            copy->methodcall.params = cloneList(node->methodcall.params, params, arguments);
+            break;
+        case OP_OBJECT_CALL:
+            copy->objectcall.object = cloneExpression(node->objectcall.object, params, arguments);
+            copy->objectcall.method = saveIdentifierReturn(node->objectcall.method);
+            copy->objectcall.params = cloneList(node->objectcall.params, params, arguments);
+            break;
+        case OP_INSTANTIATION:
+            copy->instantiate.params = cloneList(node->instantiate.params, params, arguments);
+            break;
+        case OP_CHOOSE:
+            copy->choose.condition = cloneExpression(node->choose.condition, params, arguments);
+            copy->choose.iftrue = cloneExpression(node->choose.iftrue, params, arguments);
+            copy->choose.iffalse = cloneExpression(node->choose.iffalse, params, arguments);
+            break;
+        default: //literals; bodies with closures are never copied.
+            break;
+    }
+
+    return copy;
+}
+
+//////////////// INLINING /////////////////
+
+static ExpressionNode* inlineCall(ExpressionNode* call) {
+    Callee callee;
+
+    if (!resolveCallee(call, &callee) || callee.body == NULL)
+        return call;
+
+    StatementNode* statement = callee.body;
+    ExpressionNode* body;
+
+    if (statement->type == S_RETURN && statement->expression != NULL)
+        body = statement->expression;
+    else if (statement->type == S_EXPRESSION && isVoid(call->determinedType)) //a void method, called as a statement.
+        body = statement->expression;
+    else
+        return call;
+
+    ExpressionList self = {NULL, NULL}; //self is the first argument of a method.
+    ExpressionList* arguments = call->methodcall.params;
+
+    if (call->type == OP_OBJECT_CALL) {
+        self.parameter = call->objectcall.object;
+        self.next = call->objectcall.params;
+        arguments = &self;
+    }
+    BodyScan scan = {callee.params, callee.captures, std::vector<int>(), 0, TRUE, TRUE};
+    size_t parameters = 0, count = 0;
+
+    for (ParameterList* p = callee.params; p != NULL; p = p->next)
+        parameters++;
+
+    for (ExpressionList* e = arguments; e != NULL; e = e->next)
+        count++;
+
+    if (parameters != count)
+        return call;
+
+    scan.uses.resize(parameters, 0);
+    scanBody(body, scan);
+
+    if (!scan.valid || scan.nodes > budget)
+        return call;
+
+    ExpressionList* e = arguments;
+
+    for (size_t i = 0; i < parameters; i++, e = e->next) {
+        if (!canSubstitute(e->parameter, scan.uses[i], scan.pure))
+            return call;
+    }
+
+    ExpressionNode* inlined = castTo(cloneExpression(body, callee.params, arguments), call->determinedType);
+    deleteExpressionNode(call);
+    inlinedCalls++;
+    return inlined;
+}
+
+static void noteAssignedSlot(ExpressionNode* target) {
+    if (target->type == OP_ACCESS)
+        assignedSlots.insert(target->access.variable);
+}
+
+static void inlineList(ExpressionList* list) {
+    for (; list != NULL; list = list->next)
+        list->parameter = inlineExpression(list->parameter);
+}
+
+static void inlineBlock(BlockList* list) {
+    raiseBindingScope();
+
+    for (; list != NULL; list = list->next)
+        inlineStatement(list->statement);
+
+    fallBindingScope();
+}
+
+static void inlineClosure(ExpressionNode* node) {
+    raiseBindingScope();
+    std::vector<InlineBinding> captures;
+
+    for (UsingList* u = node->closure.usingList; u != NULL; u = u->next) {
+        size_t binding = resolveBinding(u->variable);
+
+        if (binding != NO_BINDING)
+            captures.push_back(bindings[binding]);
+    }
+
+    depth++;
+
+    for (size_t i = 0; i < captures.size(); i++)
+        bindVariable(captures[i].name, captures[i].definition, captures[i].param);
+
+    bindParameters(node->closure.params);
+    inlineBlock(node->closure.body);
+    depth--;
+    fallBindingScope();
+}
+
+static ExpressionNode* inlineExpression(ExpressionNode* node) {
+    switch (node->type) {
+        case OP_NOP:
+        case OP_INTEGER:
+        case OP_LONG_INTEGER:
+        case OP_DECIMAL:
+        case OP_CHAR:
+        case OP_VARIABLE:
+        case OP_RESERVED_LITERAL:
+        case OP_STRING:
+        case OP_LAMBDA: //converted into OP_CLOSURE by the type checker.
+            break;
+        case OP_PLUSONE:
+        case OP_MINUSONE:
+            if (collecting)
+                noteAssignedSlot(node->unaryChild);
+
+            node->unaryChild = inlineExpression(node->unaryChild);
+            break;
+        case OP_DEREFERENCE:
+        case OP_NOT:
+        case OP_COMPL:
+        case OP_UNARY_MINUS:
+        case OP_LENGTH:
+            node->unaryChild = inlineExpression(node->unaryChild);
+            break;
+        case OP_SET:
+            if (collecting)
+                noteAssignedSlot(node->binary.left);
+            //fallthrough
+        case OP_EQUALS:
+        case OP_NOT_EQUALS:
+        case OP_GRE_EQUALS:
+        case OP_LES_EQUALS:
+        case OP_GREATER:
+        case OP_LESS:
+        case OP_AND:
+        case OP_OR:
+        case OP_PLUS:
+        case OP_MINUS:
+        case OP_MULT:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_ARRAY_ACCESS:
+            node->binary.left = inlineExpression(node->binary.left);
+            node->binary.right = inlineExpression(node->binary.right);
+            break;
+        case OP_INSTANCEOF:
+            node->instanceof.expression = inlineExpression(node->instanceof.expression);
+            break;
+        case OP_CAST:
+            node->cast.child = inlineExpression(node->cast.child);
+            break;
+        case OP_ACCESS:
+            node->access.expression = inlineExpression(node->access.expression);
+            break;
+        case OP_METHOD_CALL:
+            node->methodcall.callback = inlineExpression(node->methodcall.callback);
+            inlineList(node->methodcall.params);
+            break;
+        case OP_OBJECT_CALL:
+            node->objectcall.object = inlineExpression(node->objectcall.object);
+            inlineList(node->objectcall.params);
+            break;
+        case OP_INSTANTIATION:
+            inlineList(node->instantiate.params);
+            break;
+        case OP_CLOSURE:
+            inlineClosure(node);
+            break;
+        case OP_CHOOSE:
+            node->choose.condition = inlineExpression(node->choose.condition);
+            node->choose.iftrue = inlineExpression(node->choose.iftrue);
+            node->choose.iffalse = inlineExpression(node->choose.iffalse);
+            break;
+    }
+
+    if (collecting || budget <= 0 || (node->type != OP_METHOD_CALL && node->type != OP_OBJECT_CALL))
+        return node;
+
+    consideredCalls++;
+    return inlineCall(node);
+}
+
+static void inlineStatement(StatementNode* node) {
+    switch (node->type) {
+        case S_NOP:
+            break;
+        case S_VARIABLE_DEF:
+        case S_INFER_DEF:
+            node->varDefinition.value = inlineExpression(node->varDefinition.value);
+            bindVariable(node->varDefinition.variable, node, NULL);
+            break;
+        case S_EXPRESSION:
+        case S_ASSERT:
+        case S_RETURN:
+        case S_DELETE:
+            node->expression = inlineExpression(node->expression);
+            break;
+        case S_BLOCK:
+            inlineBlock(node->block);
+            break;
+        case S_IF:
+        case S_WHILE:
+            node->conditional.condition = inlineExpression(node->conditional.condition);
+            raiseBindingScope();
+            inlineStatement(node->conditional.block);
+            fallBindingScope();
+            break;
+        case S_IF_ELSE:
+            node->conditional.condition = inlineExpression(node->conditional.condition);
+            raiseBindingScope();
+            inlineStatement(node->conditional.block);
+            fallBindingScope();
+            raiseBindingScope();
+            inlineStatement(node->conditional.elseBlock);
+            fallBindingScope();
+            break;
+    }
+}
+
+static void inlineMethod(ParameterList* params, ExpressionList* inheritsParams, BlockList* body) {
+    raiseBindingScope();
+    bindParameters(params);
+    inlineList(inheritsParams);
+    inlineBlock(body);
+    fallBindingScope();
+}
+
+static void walkTopNode(ParserTopNode* node) {
+    switch (node->type) {
+        case PRT_METHOD_DEFINITION:
+            inlineMethod(node->method.params, NULL, node->method.body);
+            break;
+        case PRT_CLASS_DEFINITION:
+            for (ClassList* c = node->classdef.classlist; c != NULL; c = c->next) {
+                switch (c->type) {
+                    case CLT_VARIABLE:
+                        c->variable.defaultValue = inlineExpression(c->variable.defaultValue);
+                        break;
+                    case CLT_METHOD:
+                        inlineMethod(c->method.params, NULL, c->method.block);
+                        break;
+                    case CLT_CONSTRUCTOR:
+                        inlineMethod(c->constructor.params, c->constructor.inheritsParams, c->constructor.block);
+                        break;
+                }
+            }
+
+            break;
+        case PRT_NONE:
+        case PRT_METHOD_DECLARATION:
+        case PRT_VARIABLE_DECLARATION:
+        case PRT_VARIABLE_DEFINITION:
+            break;
+    }
+}
+
+void findInlineCandidates(ParserTopNode* node) {
+    if (node->type == PRT_METHOD_DEFINITION)
+        methods[node->method.functionName] = node;
+
+    collecting = TRUE;
+    walkTopNode(node);
+    collecting = FALSE;
+}
+
+Boolean inlineTopNode(ParserTopNode* node) {
+    int before = inlinedCalls;
+    walkTopNode(node);
+    return inlinedCalls != before ? TRUE : FALSE;
+}
@@ -0,0 +1,37 @@
+/*
+ * File:   Inlining.h
+ * Author: Michael Goulet
+ * Implementation: Inlining.cpp
+ *
+ * Inlines calls of methods whose body is a single return statement (or, for void methods, a single expression
+ * statement) with an expression of at most the budget's number of nodes, into the typed syntax tree. Candidates are top-level methods called by name, object methods that
+ * no class overrides below the object's type (and that nothing assigns), closures called where they are created and
+ * closures held by a local that is never assigned. Parameters (and self) are replaced by the arguments, which must
+ * be literals or reads of a name, or used once by a body with no side effects; the body must not create closures or
+ * assign names, and the globals it reads must not be shadowed at the call.
+ *
+ * findInlineCandidates must see every top node before inlineTopNode runs on any of them. Runs after foldTopNode.
+ */
+
+#ifndef INLINING_H
+#define	INLINING_H
+
+#include <stdio.h>
+#include "Structures.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define DEFAULT_INLINE_BUDGET 16
+
+    void setInlineBudget(int nodes); //0 disables inlining.
+    void findInlineCandidates(ParserTopNode*);
+    Boolean inlineTopNode(ParserTopNode*); //TRUE if anything was inlined, so the node can be folded again.
+    void printInlineReport(FILE*);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* INLINING_H */
@@ -0,0 +1,1476 @@
+/*
+ * File:   LLVMEmitting.cpp
+ * Author: Michael Goulet
+ * Implements: LLVMEmitting.hpp
+ */
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#ifdef CHESHIRE_LLVM_BACKEND
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/raw_ostream.h>
+#else
+#include "BitcodeWriter.hpp"
+#endif
+#include "Structures.h"
+#include "TypeSystem.h"
+#include "TypeSystemUtilities.hpp"
+#include "LexerUtilities.h"
+#include "CodeEmitting.h"
+#include "Purity.h"
+#include "DeadCode.h"
+#include "Escape.h"
+#include "LLVMEmitting.hpp"
+
+#define TRAMPOLINE_SIZE 32 //large enough for the trampolines of every target we care about (x86-64 needs 23 bytes).
+
+typedef struct {
+    ir::Value* value;
+    Boolean direct; //the value itself of a name that is never assigned, rather than a slot holding it.
+} ValueBinding;
+
+typedef std::unordered_map<const char*, ValueBinding, CStrHash, CStrEql> ValueScope;
+typedef std::unordered_map<TypeKey, ir::StructType*> ClassStructs;
+
+#ifdef CHESHIRE_LLVM_BACKEND
+typedef llvm::IRBuilder<> IRBuilder;
+#else
+typedef bitcode::IRBuilder IRBuilder;
+#endif
+
+//////////////// STATICS /////////////////
+static ir::LLVMContext* context = NULL;
+static ir::Module* module = NULL;
+static IRBuilder* builder = NULL;
+static std::list<ValueScope> valueScope;
+static std::list<std::vector<ir::Value*> > lifetimes; //the slots defined in each scope, in order.
+static std::unordered_map<StatementNode*, ir::Value*> entrySlots;
+static std::unordered_map<ExpressionNode*, ir::Value*> stackObjects; //of the instantiations that do not escape.
+static ClassStructs classStructs;
+static ClassStructs vtableStructs;
+static std::unordered_map<TypeKey, ir::GlobalVariable*> vtables;
+static std::unordered_map<TypeKey, ir::GlobalVariable*> typeDescriptors;
+static std::unordered_map<TypeKey, ir::GlobalVariable*> prototypes;
+static ir::StructType* typeDescriptorStruct = NULL;
+static std::unordered_map<ir::Value*, ir::Function*> methodImplementations; //of each @_M_ constant, for direct calls.
+static int closureIdentifier = 0;
+
+extern ObjectMapping objectMapping;
+extern KeyedLambdas keyedLambdas;
+//////////////////////////////////////////
+
+static void raiseValueScope() {
+    valueScope.push_front(ValueScope());
+    lifetimes.push_front(std::vector<ir::Value*>());
+}
+
+static void fallValueScope() {
+    valueScope.pop_front();
+    lifetimes.pop_front();
+}
+
+static void endLocalLifetimes() {
+    std::vector<ir::Value*>& slots = lifetimes.front();
+
+    for (auto i = slots.rbegin(); i != slots.rend(); ++i)
+        builder->CreateLifetimeEnd(*i);
+}
+
+static void registerValue(const char* name, ir::Value* value, Boolean direct = FALSE) {
+    ValueBinding binding = {value, direct};
+    valueScope.front()[name] = binding;
+}
+
+static ValueBinding& fetchBinding(const char* name) {
+    for (auto i = valueScope.begin(); i != valueScope.end(); ++i) {
+        auto found = i->find(name);
+
+        if (found != i->end())
+            return found->second;
+    }
+
+    PANIC("Could not find variable %s!", name);
+}
+
+static ir::Value* fetchValue(const char* name) {
+    return fetchBinding(name).value;
+}
+
+static ir::Value* emitVariableRead(const char* name, ir::Type* type) {
+    ValueBinding& binding = fetchBinding(name);
+
+    if (binding.direct)
+        return binding.value;
+
+    return builder->CreateLoad(type, binding.value);
+}
+
+static std::string getClassName(CheshireType type) {
+    char* name = getNamedTypeString(type);
+    std::string ret = name;
+    free(name);
+    return ret;
+}
+
+static ir::StructType* getClassStruct(CheshireType type) {
+    type.arrayNesting = 0;
+    auto found = classStructs.find(type.typeKey);
+
+    if (found != classStructs.end())
+        return found->second;
+
+    ir::StructType* structType = ir::StructType::create(*context, "_Class_" + getClassName(type));
+    classStructs[type.typeKey] = structType; //register before laying out, so self-referencing classes resolve.
+
+    if (!equalTypes(type, TYPE_OBJECT) && !equalTypes(type, TYPE_STRING)) { //opaque here, their bodies are provided by the runtime.
+        std::vector<ir::Type*> elements;
+
+        for (ClassShape* c = getClassShape(type); c != NULL; c = c->next)
+            elements.push_back(llvmEmitType(c->type));
+
+        structType->setBody(elements);
+    }
+
+    return structType;
+}
+
+static ir::StructType* getVTableStruct(CheshireType type) {
+    auto found = vtableStructs.find(type.typeKey);
+
+    if (found != vtableStructs.end())
+        return found->second;
+
+    std::vector<ir::Type*> elements;
+
+    for (ClassShape* c = getVTableShape(type); c != NULL; c = c->next)
+        elements.push_back(llvmEmitType(c->type));
+
+    ir::StructType* structType = ir::StructType::create(*context, "_VTable_" + getClassName(type));
+    structType->setBody(elements);
+    return vtableStructs[type.typeKey] = structType;
+}
+
+static ir::FunctionType* getLambdaFunctionType(CheshireType type) {
+    LambdaType l = keyedLambdas[type];
+    std::vector<ir::Type*> parameters;
+
+    for (size_t i = 0; i < l.second.size(); i++)
+        parameters.push_back(llvmEmitType(l.second[i]));
+
+    return ir::FunctionType::get(llvmEmitType(l.first), parameters, false);
+}
+
+static ir::Function* getFunction(const std::string& name, ir::FunctionType* type, Boolean fastcc) {
+    ir::Function* function = module->getFunction(name);
+
+    if (function == NULL) {
+        function = ir::Function::Create(type, ir::Function::ExternalLinkage, name, module);
+
+        if (fastcc)
+            function->setCallingConv(ir::CallingConv::Fast);
+    }
+
+    return function;
+}
+
+static ir::Function* getCheshireFunction(const std::string& name, ir::FunctionType* type) {
+    return getFunction(name, type, TRUE);
+}
+
+static ir::Function* getRuntimeFunction(const std::string& name, ir::Type* returnType, std::vector<ir::Type*> parameters) {
+    return getFunction(name, ir::FunctionType::get(returnType, parameters, false), FALSE);
+}
+
+static ir::Type* getBytePointerType() {
+    return ir::PointerType::getUnqual(builder->getInt8Ty());
+}
+
+static ir::FunctionType* getDeleteFunctionType() {
+    return ir::FunctionType::get(builder->getVoidTy(), {getBytePointerType()}, false);
+}
+
+//{depth, display, @_Delete_}, as emitTypeDescriptor.
+static ir::StructType* getTypeDescriptorStruct() {
+    if (typeDescriptorStruct == NULL) {
+        typeDescriptorStruct = ir::StructType::create(*context, "_TypeDescriptor");
+        ir::Type* display = ir::ArrayType::get(ir::PointerType::getUnqual(typeDescriptorStruct), getDisplaySize());
+        typeDescriptorStruct->setBody({builder->getInt32Ty(), display, ir::PointerType::getUnqual(getDeleteFunctionType())});
+    }
+
+    return typeDescriptorStruct;
+}
+
+static ir::GlobalVariable* getTypeDescriptor(CheshireType type) {
+    auto found = typeDescriptors.find(type.typeKey);
+
+    if (found != typeDescriptors.end())
+        return found->second;
+
+    ir::StructType* descriptorStruct = getTypeDescriptorStruct();
+    ir::GlobalVariable* descriptor = new ir::GlobalVariable(*module, descriptorStruct, true, ir::GlobalValue::ExternalLinkage,
+            NULL, "_Type_" + getClassName(type));
+    typeDescriptors[type.typeKey] = descriptor; //before the ancestors, which never point back at it.
+    int depth = getClassDepth(type);
+    ir::PointerType* descriptorPointer = ir::PointerType::getUnqual(descriptorStruct);
+    std::vector<ir::Constant*> display(getDisplaySize(), ir::ConstantPointerNull::get(descriptorPointer));
+
+    for (CheshireType t = type; getClassDepth(t) >= 0; t = getParentClass(t))
+        display[getClassDepth(t)] = t.typeKey == type.typeKey ? descriptor : getTypeDescriptor(t);
+
+    ir::ArrayType* displayType = ir::ArrayType::get(descriptorPointer, display.size());
+    ir::Constant* deleter = ir::ConstantPointerNull::get(ir::PointerType::getUnqual(getDeleteFunctionType()));
+
+    if (isDeletedClass(type))
+        deleter = getCheshireFunction("_Delete_" + getClassName(type), getDeleteFunctionType());
+
+    descriptor->setInitializer(ir::ConstantStruct::get(descriptorStruct, {builder->getInt32(depth), ir::ConstantArray::get(displayType, display), deleter}));
+    return descriptor;
+}
+
+//the constant vtable of a class, as emitVTable: its type descriptor, then the implementation of each method the class
+//inherits or overrides.
+static ir::GlobalVariable* getVTable(CheshireType type) {
+    auto found = vtables.find(type.typeKey);
+
+    if (found != vtables.end())
+        return found->second;
+
+    ir::StructType* vtableStruct = getVTableStruct(type);
+    std::vector<ir::Constant*> elements(1, ir::ConstantExpr::getBitCast(getTypeDescriptor(type), getBytePointerType()));
+
+    for (ClassShape* c = getVTableShape(type)->next; c != NULL; c = c->next) {
+        CheshireType definer;
+        ClassList* method = getMethodImplementation(type, c->name, &definer);
+        CheshireType methodType = getLambdaType(method->method.returnType, method->method.params);
+        ir::Function* function = getCheshireFunction("_ClassMethod_" + getClassName(definer) + "_" + method->method.name, getLambdaFunctionType(methodType));
+        elements.push_back(ir::ConstantExpr::getBitCast(function, llvmEmitType(c->type))); //an override takes its own class as self.
+    }
+
+    return vtables[type.typeKey] = new ir::GlobalVariable(*module, vtableStruct, true, ir::GlobalValue::ExternalLinkage,
+            ir::ConstantStruct::get(vtableStruct, elements), "_VTable_" + getClassName(type));
+}
+
+//the address of a field or method slot, as emitMemberAddress.
+static ir::Value* emitMemberAddress(ir::Value* object, CheshireType type, const char* name) {
+    int slot = getVTableElement(type, name);
+
+    if (slot < 0)
+        return builder->CreateStructGEP(getClassStruct(type), object, getObjectElement(type, name));
+
+    ir::Value* header = builder->CreateStructGEP(getClassStruct(type), object, 0);
+    ir::Value* vtable = builder->CreateBitCast(builder->CreateLoad(getBytePointerType(), header), ir::PointerType::getUnqual(getVTableStruct(type)));
+    return builder->CreateStructGEP(getVTableStruct(type), vtable, slot);
+}
+
+static ir::Value* emitMalloc(ir::Value* size) {
+    ir::Function* malloc = module->getFunction("malloc");
+
+    if (malloc == NULL) {
+        malloc = getRuntimeFunction("malloc", getBytePointerType(), {builder->getInt32Ty()});
+        malloc->addRetAttr(ir::Attribute::NoAlias);
+        malloc->addFnAttr(ir::Attribute::NoUnwind);
+    }
+
+    return builder->CreateCall(malloc->getFunctionType(), malloc, {size});
+}
+
+//as emitAllocation, size is only used without a size class.
+static ir::Value* emitAllocation(int sizeClass, ir::Value* size) {
+    if (sizeClass < 0)
+        return emitMalloc(size);
+
+    ir::Function* alloc = module->getFunction("_cheshire_alloc");
+
+    if (alloc == NULL) {
+        alloc = getRuntimeFunction("_cheshire_alloc", getBytePointerType(), {builder->getInt32Ty()});
+        alloc->addRetAttr(ir::Attribute::NoAlias);
+        alloc->addFnAttr(ir::Attribute::NoUnwind);
+    }
+
+    return builder->CreateCall(alloc->getFunctionType(), alloc, {builder->getInt32(sizeClass)});
+}
+
+static ir::Value* emitSizeOf(ir::Type* type) {
+    //the classic "getelementptr null, 1" idiom, so we don't need to know the target's data layout.
+    ir::Value* end = builder->CreateGEP(type, ir::ConstantPointerNull::get(ir::PointerType::getUnqual(type)), builder->getInt32(1));
+    return builder->CreatePtrToInt(end, builder->getInt32Ty());
+}
+
+static ir::Value* emitNonTypecheckedUpcast(ir::Value* value, CheshireType selfType, CheshireType superType) {
+    if (equalTypes(selfType, superType))
+        return value;
+
+    return builder->CreateBitCast(value, llvmEmitType(superType));
+}
+
+//as getMemoryAttribute, for functions and calls.
+template <typename T> static void addMemoryAttributes(T* target, MemoryEffects effects) {
+    if (effects == 0)
+        target->setDoesNotAccessMemory();
+    else if (effects == ME_READS)
+        target->setOnlyReadsMemory();
+}
+
+static ir::Value* emitCall(ir::FunctionType* type, ir::Value* callee, std::vector<ir::Value*>& arguments, TailCallKind tailCall = TC_NONE, MemoryEffects effects = ME_UNKNOWN) {
+    ir::CallInst* call = builder->CreateCall(type, callee, arguments);
+    call->setCallingConv(ir::CallingConv::Fast);
+    addMemoryAttributes(call, effects);
+
+    if (tailCall != TC_NONE)
+        call->setTailCallKind(tailCall == TC_MUSTTAIL ? ir::CallInst::TCK_MustTail : ir::CallInst::TCK_Tail);
+
+    return call;
+}
+
+static ir::BasicBlock* createBlock(const char* name) {
+    return ir::BasicBlock::Create(*context, name, builder->GetInsertBlock()->getParent());
+}
+
+static void branchIfUnterminated(ir::BasicBlock* target) {
+    if (builder->GetInsertBlock()->getTerminator() == NULL)
+        builder->CreateBr(target);
+}
+
+//the type descriptor of the class of an object that is not null, from the first slot of its vtable.
+static ir::Value* emitDescriptorLoad(ir::Value* object) {
+    ir::Type* bytePointer = getBytePointerType();
+    ir::Value* header = builder->CreateBitCast(object, ir::PointerType::getUnqual(ir::PointerType::getUnqual(bytePointer)));
+    ir::Value* vtable = builder->CreateLoad(ir::PointerType::getUnqual(bytePointer), header);
+    return builder->CreateBitCast(builder->CreateLoad(bytePointer, vtable), ir::PointerType::getUnqual(getTypeDescriptorStruct()));
+}
+
+//whether an object that is not null is an instance of to, as emitTypeTest.
+static ir::Value* emitTypeTest(ir::Value* object, CheshireType from, CheshireType to) {
+    ir::PointerType* descriptorPointer = ir::PointerType::getUnqual(getTypeDescriptorStruct());
+    ir::Value* descriptor = emitDescriptorLoad(object);
+    ir::Value* entry = builder->CreateGEP(getTypeDescriptorStruct(), descriptor, {builder->getInt32(0), builder->getInt32(1), builder->getInt32(getClassDepth(to))});
+    return builder->CreateICmpEQ(builder->CreateLoad(descriptorPointer, entry), getTypeDescriptor(to));
+}
+
+//a type test of an object that may be null, which gives ifNull.
+static ir::Value* emitNullableTypeTest(ir::Value* object, CheshireType from, CheshireType to, bool ifNull) {
+    ir::BasicBlock* enter = builder->GetInsertBlock();
+    ir::BasicBlock* labeltest = createBlock("typetest.object");
+    ir::BasicBlock* labelend = createBlock("typetest.end");
+    ir::Value* isNull = builder->CreateICmpEQ(object, ir::ConstantPointerNull::get((ir::PointerType*) object->getType()));
+    builder->CreateCondBr(isNull, labelend, labeltest);
+    builder->SetInsertPoint(labeltest);
+    ir::Value* result = emitTypeTest(object, from, to);
+    labeltest = builder->GetInsertBlock();
+    builder->CreateBr(labelend);
+    builder->SetInsertPoint(labelend);
+    ir::PHINode* phi = builder->CreatePHI(builder->getInt1Ty(), 2);
+    phi->addIncoming(builder->getInt1(ifNull), enter);
+    phi->addIncoming(result, labeltest);
+    return phi;
+}
+
+//a parameter that is never assigned is used as it was passed, only the others are copied into a slot.
+static void bindParameter(ParameterList* p, ir::Argument* argument) {
+    argument->setName(std::string("_Param_") + p->name);
+
+    if (!p->assigned) {
+        registerValue(p->name, argument, TRUE);
+        return;
+    }
+
+    ir::Value* variable = builder->CreateAlloca(llvmEmitType(p->type), NULL, p->name);
+    builder->CreateStore(argument, variable);
+    registerValue(p->name, variable);
+}
+
+static void addFunctionAttributes(ir::Function* function, MemoryEffects effects) { //as getFunctionAttributes.
+    function->addFnAttr(ir::Attribute::NoUnwind);
+
+    if (getOptimizationLevel() == 0) {
+        function->addFnAttr(ir::Attribute::NoInline);
+        function->addFnAttr(ir::Attribute::OptimizeNone);
+        return;
+    }
+
+    addMemoryAttributes(function, effects);
+}
+
+static void addSelfAttributes(ir::Function* function, CheshireType type) { //as emitSelfAttributes.
+    if (getOptimizationLevel() == 0)
+        return;
+
+    function->addParamAttr(0, ir::Attribute::NonNull);
+    int size = getObjectSize(type);
+
+    if (size > 0)
+        function->addDereferenceableParamAttr(0, size);
+}
+
+static void emitFunctionPrologue(ir::Function* function, ParameterList* params, unsigned int firstArgument, MemoryEffects effects) {
+    addFunctionAttributes(function, effects);
+    builder->SetInsertPoint(ir::BasicBlock::Create(*context, "entry", function));
+    ir::Function::arg_iterator argument = function->arg_begin() + firstArgument;
+
+    for (ParameterList* p = params; p != NULL; p = p->next, ++argument)
+        bindParameter(p, &*argument);
+}
+
+//allocates the slots of every assigned local of a body in the entry block, so they are allocated once per call.
+static void emitEntrySlots(StatementNode* statement) {
+    switch (statement->type) {
+        case S_VARIABLE_DEF:
+        case S_INFER_DEF:
+            if (statement->varDefinition.assigned)
+                entrySlots[statement] = builder->CreateAlloca(llvmEmitType(statement->varDefinition.type), NULL, statement->varDefinition.variable);
+
+            break;
+        case S_BLOCK:
+            for (BlockList* list = statement->block; list != NULL; list = list->next)
+                emitEntrySlots(list->statement);
+
+            break;
+        case S_IF:
+        case S_WHILE:
+            emitEntrySlots(statement->conditional.block);
+            break;
+        case S_IF_ELSE:
+            emitEntrySlots(statement->conditional.block);
+            emitEntrySlots(statement->conditional.elseBlock);
+            break;
+        default:
+            break;
+    }
+}
+
+static void emitBodySlots(BlockList* body) {
+    for (int i = 0; i < getStackObjectCount(body); i++) {
+        ExpressionNode* instantiation = getStackObject(body, i);
+        stackObjects[instantiation] = builder->CreateAlloca(getClassStruct(instantiation->instantiate.type), NULL, "object");
+    }
+
+    for (; body != NULL; body = body->next)
+        emitEntrySlots(body->statement);
+}
+
+static void emitFunctionEpilogue(CheshireType returnType) {
+    if (builder->GetInsertBlock()->getTerminator() != NULL)
+        return;
+
+    if (isVoid(returnType))
+        builder->CreateRetVoid();
+    else
+        builder->CreateRet(ir::Constant::getNullValue(llvmEmitType(returnType))); //implicit, fallthrough return in non-void function.
+}
+
+//a global method called by name is called directly, rather than through the pointer in its @_M_ constant.
+static ir::Value* emitCallee(ExpressionNode* callback) {
+    if (callback->type == OP_DEREFERENCE && callback->unaryChild->type == OP_VARIABLE) {
+        ValueBinding& binding = fetchBinding(callback->unaryChild->string);
+        auto found = methodImplementations.find(binding.value);
+
+        if (!binding.direct && found != methodImplementations.end())
+            return found->second;
+    }
+
+    return llvmEmitExpression(callback);
+}
+
+static void emitArguments(std::vector<ir::Value*>& arguments, ExpressionList* params) {
+    for (ExpressionList* e = params; e != NULL; e = e->next)
+        arguments.push_back(llvmEmitExpression(e->parameter));
+}
+
+//@_FreeList_, @_Alloc_ and @_Delete_ of a class, as emitFreeList.
+static void emitFreeList(CheshireType type) {
+    std::string name = getClassName(type);
+    ir::PointerType* bytePointer = (ir::PointerType*) getBytePointerType();
+    ir::Type* linkPointer = ir::PointerType::getUnqual(bytePointer);
+    ir::Value* freeList = new ir::GlobalVariable(*module, bytePointer, false, ir::GlobalValue::ExternalLinkage,
+            ir::ConstantPointerNull::get(bytePointer), "_FreeList_" + name);
+    ir::Function* alloc = getCheshireFunction("_Alloc_" + name, ir::FunctionType::get(bytePointer, {}, false));
+    alloc->addRetAttr(ir::Attribute::NoAlias);
+    addFunctionAttributes(alloc, ME_UNKNOWN);
+    builder->SetInsertPoint(ir::BasicBlock::Create(*context, "entry", alloc));
+    ir::Value* head = builder->CreateLoad(bytePointer, freeList);
+    ir::BasicBlock* labelreuse = createBlock("alloc.reuse");
+    ir::BasicBlock* labelallocate = createBlock("alloc.new");
+    builder->CreateCondBr(builder->CreateICmpEQ(head, ir::ConstantPointerNull::get(bytePointer)), labelallocate, labelreuse);
+    builder->SetInsertPoint(labelreuse);
+    builder->CreateStore(builder->CreateLoad(bytePointer, builder->CreateBitCast(head, linkPointer)), freeList);
+
+    if (getPoisonDeleted()) { //every byte past a link of up to 8 bytes is still DELETED_POISON.
+        ir::FunctionType* assertType = ir::FunctionType::get(builder->getVoidTy(), {builder->getInt1Ty()}, false);
+        ir::Value* size = emitSizeOf(getClassStruct(type));
+        ir::BasicBlock* labelcheck = createBlock("alloc.check");
+        ir::BasicBlock* labelbody = createBlock("alloc.poisoned");
+        ir::BasicBlock* labelchecked = createBlock("alloc.checked");
+        builder->CreateBr(labelcheck);
+        builder->SetInsertPoint(labelcheck);
+        ir::PHINode* index = builder->CreatePHI(builder->getInt32Ty(), 2);
+        index->addIncoming(builder->getInt32(8), labelreuse);
+        builder->CreateCondBr(builder->CreateICmpSLT(index, size), labelbody, labelchecked);
+        builder->SetInsertPoint(labelbody);
+        ir::Value* byte = builder->CreateLoad(builder->getInt8Ty(), builder->CreateGEP(builder->getInt8Ty(), head, index));
+        std::vector<ir::Value*> arguments(1, builder->CreateICmpEQ(byte, builder->getInt8(DELETED_POISON)));
+        emitCall(assertType, getCheshireFunction("_Assert", assertType), arguments);
+        index->addIncoming(builder->CreateAdd(index, builder->getInt32(1)), labelbody);
+        builder->CreateBr(labelcheck);
+        builder->SetInsertPoint(labelchecked);
+    }
+
+    builder->CreateRet(head);
+    builder->SetInsertPoint(labelallocate);
+    int sizeClass = getSizeClass(getAllocationSize(type));
+    builder->CreateRet(emitAllocation(sizeClass, sizeClass < 0 ? emitSizeOf(getClassStruct(type)) : NULL));
+
+    ir::Function* deleter = getCheshireFunction("_Delete_" + name, getDeleteFunctionType());
+    addFunctionAttributes(deleter, ME_UNKNOWN);
+    builder->SetInsertPoint(ir::BasicBlock::Create(*context, "entry", deleter));
+    ir::Value* object = deleter->getArg(0);
+
+    if (getPoisonDeleted())
+        builder->CreateMemSet(object, builder->getInt8(DELETED_POISON), emitSizeOf(getClassStruct(type)), ir::MaybeAlign(8));
+
+    builder->CreateStore(builder->CreateLoad(bytePointer, freeList), builder->CreateBitCast(object, linkPointer));
+    builder->CreateStore(object, freeList);
+    builder->CreateRetVoid();
+}
+
+//an i8* for a new object of a class, as emitObjectAllocation.
+static ir::Value* emitObjectAllocation(CheshireType type) {
+    if (equalTypes(type, TYPE_OBJECT))
+        return emitMalloc(emitSizeOf(getClassStruct(type)));
+
+    if (!isDeletedClass(type)) {
+        int sizeClass = getSizeClass(getAllocationSize(type));
+        return emitAllocation(sizeClass, sizeClass < 0 ? emitSizeOf(getClassStruct(type)) : NULL);
+    }
+
+    std::vector<ir::Value*> arguments;
+    ir::FunctionType* allocType = ir::FunctionType::get(getBytePointerType(), {}, false);
+    return emitCall(allocType, getCheshireFunction("_Alloc_" + getClassName(type), allocType), arguments);
+}
+
+//of an object that is not null, as emitDelete.
+static void emitDelete(ir::Value* object, CheshireType type) {
+    std::vector<ir::Value*> arguments(1, builder->CreateBitCast(object, getBytePointerType()));
+    ir::FunctionType* deleteType = getDeleteFunctionType();
+
+    if (isLeafClass(type)) {
+        emitCall(deleteType, getCheshireFunction("_Delete_" + getClassName(type), deleteType), arguments);
+        return;
+    }
+
+    ir::Value* slot = builder->CreateStructGEP(getTypeDescriptorStruct(), emitDescriptorLoad(object), 2);
+    emitCall(deleteType, builder->CreateLoad(ir::PointerType::getUnqual(deleteType), slot), arguments);
+}
+
+//the constant object each instance of a class with a prototype starts as, as emitPrototype.
+static ir::GlobalVariable* getPrototype(CheshireType type) {
+    auto found = prototypes.find(type.typeKey);
+
+    if (found != prototypes.end())
+        return found->second;
+
+    ir::StructType* classStruct = getClassStruct(type);
+    std::vector<ir::Constant*> elements(1, ir::ConstantExpr::getBitCast(getVTable(type), getBytePointerType()));
+
+    for (ClassShape* c = getClassShape(type)->next; c != NULL; c = c->next) {
+        ExpressionNode* value = getPrototypeValue(type, c->name);
+
+        if (value->type == OP_CAST || (value->type == OP_RESERVED_LITERAL && value->reserved == RL_NULL))
+            elements.push_back(ir::Constant::getNullValue(llvmEmitType(c->type)));
+        else
+            elements.push_back((ir::Constant*) llvmEmitExpression(value)); //a literal, which emits no instructions.
+    }
+
+    return prototypes[type.typeKey] = new ir::GlobalVariable(*module, classStruct, true, ir::GlobalValue::ExternalLinkage,
+            ir::ConstantStruct::get(classStruct, elements), "_Proto_" + getClassName(type));
+}
+
+//@_New_ copies the prototype, then @_Init_ runs the constructor bodies of the chain, as emitPrototypeConstructor.
+static void emitPrototypeConstructor(ParserTopNode* node, ParameterList* params, ExpressionList* inheritsParams, BlockList* block) {
+    CheshireType classType = getNamedType(node->classdef.name);
+    ir::FunctionType* type = getLambdaFunctionType(getLambdaType(TYPE_VOID, params));
+    ir::Function* function = getCheshireFunction("_New_" + std::string(node->classdef.name), type);
+    addSelfAttributes(function, classType);
+    addFunctionAttributes(function, ME_UNKNOWN);
+    builder->SetInsertPoint(ir::BasicBlock::Create(*context, "entry", function));
+    ir::Value* self = function->getArg(0);
+    std::vector<ir::Value*> arguments(1, emitNonTypecheckedUpcast(self, classType, TYPE_OBJECT));
+    ir::FunctionType* objectType = ir::FunctionType::get(builder->getVoidTy(), {arguments[0]->getType()}, false);
+    emitCall(objectType, getCheshireFunction("_New_Object", objectType), arguments);
+    builder->CreateMemCpy(self, ir::MaybeAlign(8), getPrototype(classType), ir::MaybeAlign(8), emitSizeOf(getClassStruct(classType)));
+
+    if (!hasInitializer(classType)) {
+        builder->CreateRetVoid();
+        return;
+    }
+
+    ir::Function* initializer = getCheshireFunction("_Init_" + std::string(node->classdef.name), type);
+    arguments.clear();
+
+    for (ir::Function::arg_iterator argument = function->arg_begin(); argument != function->arg_end(); ++argument)
+        arguments.push_back(&*argument);
+
+    emitCall(type, initializer, arguments);
+    builder->CreateRetVoid();
+    raiseValueScope();
+    addSelfAttributes(initializer, classType);
+    emitFunctionPrologue(initializer, params, 0, ME_UNKNOWN);
+    emitBodySlots(block);
+    self = emitVariableRead("self", llvmEmitType(classType));
+    Boolean parentInitializer = hasInitializer(node->classdef.parent);
+
+    if (parentInitializer) {
+        arguments.assign(1, emitNonTypecheckedUpcast(self, classType, node->classdef.parent));
+        emitArguments(arguments, inheritsParams);
+        std::vector<ir::Type*> superParameters;
+
+        for (size_t i = 0; i < arguments.size(); i++)
+            superParameters.push_back(arguments[i]->getType());
+
+        ir::FunctionType* superType = ir::FunctionType::get(builder->getVoidTy(), superParameters, false);
+        emitCall(superType, getCheshireFunction("_Init_" + getClassName(node->classdef.parent), superType), arguments);
+    }
+
+    if (parentInitializer || block != NULL) //the parent's bodies ran with their own vtables, and this one calls through it.
+        builder->CreateStore(builder->CreateBitCast(getVTable(classType), getBytePointerType()), builder->CreateStructGEP(getClassStruct(classType), self, 0));
+
+    llvmEmitBlock(block);
+    emitFunctionEpilogue(TYPE_VOID);
+    fallValueScope();
+}
+
+static void emitClassConstructor(ParserTopNode* node, ParameterList* params, ExpressionList* inheritsParams, BlockList* block) {
+    CheshireType classType = getNamedType(node->classdef.name);
+
+    if (hasPrototype(classType)) {
+        emitPrototypeConstructor(node, params, inheritsParams, block);
+        return;
+    }
+
+    ir::Function* function = getCheshireFunction("_New_" + std::string(node->classdef.name), getLambdaFunctionType(getLambdaType(TYPE_VOID, params)));
+    raiseValueScope();
+    addSelfAttributes(function, classType);
+    emitFunctionPrologue(function, params, 0, ME_UNKNOWN);
+    emitBodySlots(block);
+    ir::Value* self = emitVariableRead("self", llvmEmitType(classType));
+    std::vector<ir::Value*> arguments;
+    arguments.push_back(emitNonTypecheckedUpcast(self, classType, node->classdef.parent));
+    emitArguments(arguments, inheritsParams);
+    std::vector<ir::Type*> superParameters;
+
+    for (size_t i = 0; i < arguments.size(); i++)
+        superParameters.push_back(arguments[i]->getType());
+
+    ir::FunctionType* superType = ir::FunctionType::get(builder->getVoidTy(), superParameters, false);
+    emitCall(superType, getCheshireFunction("_New_" + getClassName(node->classdef.parent), superType), arguments);
+    ir::StructType* classStruct = getClassStruct(classType);
+    builder->CreateStore(builder->CreateBitCast(getVTable(classType), getBytePointerType()), builder->CreateStructGEP(classStruct, self, 0));
+
+    for (ClassList* subnode = node->classdef.classlist; subnode != NULL; subnode = subnode->next) {
+        switch (subnode->type) {
+            case CLT_VARIABLE: {
+                ir::Value* defaultValue = llvmEmitExpression(subnode->variable.defaultValue);
+                ir::Value* var = builder->CreateStructGEP(classStruct, self, getObjectElement(classType, subnode->variable.name));
+                builder->CreateStore(defaultValue, var);
+            }
+            break;
+            case CLT_METHOD: {
+                if (getVTableElement(classType, subnode->method.name) >= 0)
+                    break; //held by the vtable.
+
+                CheshireType type = getLambdaType(subnode->method.returnType, subnode->method.params);
+                ir::Value* method = getCheshireFunction("_ClassMethod_" + std::string(node->classdef.name) + "_" + subnode->method.name, getLambdaFunctionType(type));
+                ir::Value* classStorage = builder->CreateStructGEP(classStruct, self, getObjectElement(classType, subnode->method.name));
+                CheshireType overridden = getClassVariable(node->classdef.parent, subnode->method.name);
+
+                if (!equalTypes(TYPE_VOID, overridden)) //overrides are stored as the type of the slot they override.
+                    method = builder->CreateBitCast(method, llvmEmitType(overridden));
+
+                builder->CreateStore(method, classStorage);
+            }
+            break;
+            case CLT_CONSTRUCTOR:
+                break;
+        }
+    }
+
+    llvmEmitBlock(block);
+    emitFunctionEpilogue(TYPE_VOID);
+    fallValueScope();
+}
+
+void initLLVMEmitting(const char* moduleName) {
+    context = new ir::LLVMContext();
+
+#if defined(CHESHIRE_LLVM_BACKEND) && LLVM_VERSION_MAJOR >= 17
+    if (!usingOpaquePointers())
+        PANIC("LLVM %d only supports opaque pointers", LLVM_VERSION_MAJOR);
+#elif defined(CHESHIRE_LLVM_BACKEND) && LLVM_VERSION_MAJOR >= 15
+    context->setOpaquePointers(usingOpaquePointers());
+#else
+    if (usingOpaquePointers())
+        context->enableOpaquePointers();
+#endif
+
+    module = new ir::Module(moduleName, *context);
+    builder = new IRBuilder(*context);
+    raiseValueScope();
+}
+
+void freeLLVMEmitting() {
+    fallValueScope();
+    classStructs.clear();
+    vtableStructs.clear();
+    vtables.clear();
+    typeDescriptors.clear();
+    prototypes.clear();
+    typeDescriptorStruct = NULL;
+    methodImplementations.clear();
+    delete builder;
+    delete module;
+    delete context;
+    builder = NULL;
+    module = NULL;
+    context = NULL;
+}
+
+void llvmForwardDefinition(ParserTopNode* node) {
+    switch (node->type) {
+        case PRT_METHOD_DECLARATION:
+        case PRT_METHOD_DEFINITION: {
+            ir::Type* type = llvmEmitType(getLambdaType(node->method.returnType, node->method.params));
+            ir::GlobalVariable* exportedMethod = new ir::GlobalVariable(*module, type, true, ir::GlobalValue::ExternalLinkage, NULL, std::string("_M_") + node->method.functionName);
+            registerValue(node->method.functionName, exportedMethod); //register before definition so it is usable.
+            methodImplementations[exportedMethod] = getCheshireFunction(std::string("_MethodImpl_") + node->method.functionName, getLambdaFunctionType(getLambdaType(node->method.returnType, node->method.params)));
+
+            if (node->type == PRT_METHOD_DECLARATION)
+                methodImplementations[exportedMethod]->addFnAttr(ir::Attribute::NoUnwind);
+        }
+        break;
+        case PRT_VARIABLE_DEFINITION:
+        case PRT_VARIABLE_DECLARATION: {
+            ir::GlobalVariable* global = new ir::GlobalVariable(*module, llvmEmitType(node->variable.type), false, ir::GlobalValue::ExternalLinkage, NULL, node->variable.name);
+            registerValue(node->variable.name, global);
+        }
+        break;
+        default:
+            break;
+    }
+}
+
+void llvmEmitCode(ParserTopNode* node) {
+    switch (node->type) {
+        case PRT_NONE:
+        case PRT_METHOD_DECLARATION:
+        case PRT_VARIABLE_DECLARATION:
+            break; //declarations were fully emitted by llvmForwardDefinition.
+        case PRT_METHOD_DEFINITION: {
+            ir::FunctionType* type = getLambdaFunctionType(getLambdaType(node->method.returnType, node->method.params));
+            ir::Function* function = getCheshireFunction(std::string("_MethodImpl_") + node->method.functionName, type);
+            ir::GlobalVariable* exportedMethod = (ir::GlobalVariable*) fetchValue(node->method.functionName);
+            exportedMethod->setInitializer(function);
+            raiseValueScope();
+            emitFunctionPrologue(function, node->method.params, 0, getMethodEffects(node));
+            emitBodySlots(node->method.body);
+            llvmEmitBlock(node->method.body);
+            emitFunctionEpilogue(node->method.returnType);
+            fallValueScope();
+        }
+        break;
+        case PRT_VARIABLE_DEFINITION: {
+            ir::GlobalVariable* global = (ir::GlobalVariable*) fetchValue(node->variable.name);
+            global->setLinkage(ir::GlobalValue::CommonLinkage);
+            global->setInitializer(ir::Constant::getNullValue(llvmEmitType(node->variable.type)));
+        }
+        break;
+        case PRT_CLASS_DEFINITION: {
+            CheshireType classType = getNamedType(node->classdef.name);
+            Boolean constructor = FALSE;
+            getClassStruct(classType);
+
+            for (ClassList* classnode = node->classdef.classlist; classnode != NULL; classnode = classnode->next) {
+                switch (classnode->type) {
+                    case CLT_CONSTRUCTOR:
+                        constructor = TRUE;
+                        emitClassConstructor(node, classnode->constructor.params, classnode->constructor.inheritsParams, classnode->constructor.block);
+                        break;
+                    case CLT_METHOD: {
+                        ir::FunctionType* type = getLambdaFunctionType(getLambdaType(classnode->method.returnType, classnode->method.params));
+                        ir::Function* function = getCheshireFunction("_ClassMethod_" + std::string(node->classdef.name) + "_" + classnode->method.name, type);
+                        raiseValueScope();
+                        addSelfAttributes(function, classnode->method.params->type);
+                        emitFunctionPrologue(function, classnode->method.params, 0, getClassMethodEffects(classnode));
+                        emitBodySlots(classnode->method.block);
+                        llvmEmitBlock(classnode->method.block);
+                        emitFunctionEpilogue(classnode->method.returnType);
+                        fallValueScope();
+                    }
+                    break;
+                    case CLT_VARIABLE:
+                        break;
+                }
+            }
+
+            if (!constructor) {
+                ParameterList* selfParam = linkParameterList(classType, saveIdentifierReturn("self"), NULL);
+                emitClassConstructor(node, selfParam, NULL, NULL);
+                deleteParameterList(selfParam);
+            }
+
+            if (isDeletedClass(classType))
+                emitFreeList(classType);
+        }
+        break;
+    }
+}
+
+void llvmEmitBlock(BlockList* node) {
+    raiseValueScope();
+
+    for (; node != NULL; node = node->next)
+        llvmEmitStatement(node->statement);
+
+    endLocalLifetimes();
+    fallValueScope();
+}
+
+void llvmEmitStatement(StatementNode* statement) {
+    switch (statement->type) {
+        case S_NOP:
+            break;
+        case S_VARIABLE_DEF:
+        case S_INFER_DEF: {
+            ir::Value* l = llvmEmitExpression(statement->varDefinition.value);
+
+            if (!statement->varDefinition.assigned) {
+                registerValue(statement->varDefinition.variable, l, TRUE);
+                break;
+            }
+
+            auto slot = entrySlots.find(statement);
+
+            if (slot == entrySlots.end())
+                PANIC("No entry slot for %s!", statement->varDefinition.variable);
+
+            ir::Value* variable = slot->second;
+            entrySlots.erase(slot);
+            if (getOptimizationLevel() > 0) {
+                builder->CreateLifetimeStart(variable);
+                lifetimes.front().push_back(variable);
+            }
+
+            builder->CreateStore(l, variable);
+            registerValue(statement->varDefinition.variable, variable);
+        }
+        break;
+        case S_EXPRESSION:
+            llvmEmitExpression(statement->expression);
+            break;
+        case S_ASSERT: {
+            ir::FunctionType* type = ir::FunctionType::get(builder->getVoidTy(), {builder->getInt1Ty()}, false);
+            std::vector<ir::Value*> arguments(1, llvmEmitExpression(statement->expression));
+            emitCall(type, getCheshireFunction("_Assert", type), arguments);
+        }
+        break;
+        case S_DELETE: { //of null does nothing.
+            ir::Value* object = llvmEmitExpression(statement->expression);
+            ir::BasicBlock* labeldelete = createBlock("delete.object");
+            ir::BasicBlock* labelend = createBlock("delete.end");
+            builder->CreateCondBr(builder->CreateICmpEQ(object, ir::ConstantPointerNull::get((ir::PointerType*) object->getType())), labelend, labeldelete);
+            builder->SetInsertPoint(labeldelete);
+            emitDelete(object, statement->expression->determinedType);
+            builder->CreateBr(labelend);
+            builder->SetInsertPoint(labelend);
+        }
+        break;
+        case S_BLOCK:
+            llvmEmitBlock(statement->block);
+            break;
+        case S_IF: {
+            ir::Value* branchfactor = llvmEmitExpression(statement->conditional.condition);
+            ir::BasicBlock* labeltrue = createBlock("if.true");
+            ir::BasicBlock* labelend = createBlock("if.end");
+            builder->CreateCondBr(branchfactor, labeltrue, labelend);
+            builder->SetInsertPoint(labeltrue);
+            raiseValueScope();
+            llvmEmitStatement(statement->conditional.block);
+            endLocalLifetimes();
+            fallValueScope();
+            branchIfUnterminated(labelend);
+            builder->SetInsertPoint(labelend);
+        }
+        break;
+        case S_IF_ELSE: {
+            ir::Value* branchfactor = llvmEmitExpression(statement->conditional.condition);
+            ir::BasicBlock* labeltrue = createBlock("if.true");
+            ir::BasicBlock* labelfalse = createBlock("if.false");
+            ir::BasicBlock* labelend = createBlock("if.end");
+            builder->CreateCondBr(branchfactor, labeltrue, labelfalse);
+            builder->SetInsertPoint(labeltrue);
+            raiseValueScope();
+            llvmEmitStatement(statement->conditional.block);
+            endLocalLifetimes();
+            fallValueScope();
+            branchIfUnterminated(labelend);
+            builder->SetInsertPoint(labelfalse);
+            raiseValueScope();
+            llvmEmitStatement(statement->conditional.elseBlock);
+            endLocalLifetimes();
+            fallValueScope();
+            branchIfUnterminated(labelend);
+            builder->SetInsertPoint(labelend);
+        }
+        break;
+        case S_WHILE: {
+            ir::BasicBlock* labelbegin = createBlock("while.cond");
+            ir::BasicBlock* labeltrue = createBlock("while.body");
+            ir::BasicBlock* labelend = createBlock("while.end");
+            builder->CreateBr(labelbegin);
+            builder->SetInsertPoint(labelbegin);
+            ir::Value* branchfactor = llvmEmitExpression(statement->conditional.condition);
+            builder->CreateCondBr(branchfactor, labeltrue, labelend);
+            builder->SetInsertPoint(labeltrue);
+            raiseValueScope();
+            llvmEmitStatement(statement->conditional.block);
+            endLocalLifetimes();
+            fallValueScope();
+            branchIfUnterminated(labelbegin);
+            builder->SetInsertPoint(labelend);
+        }
+        break;
+        case S_RETURN: {
+            if (isNull(statement->expression->determinedType)) {
+                builder->CreateRetVoid();
+            } else {
+                builder->CreateRet(llvmEmitExpression(statement->expression));
+            }
+
+            builder->SetInsertPoint(createBlock("unreachable")); //anything after a return still needs a block to live in.
+        }
+        break;
+    }
+}
+
+ir::Value* llvmEmitExpression(ExpressionNode* node) {
+    switch (node->type) {
+        case OP_NOP:
+        case OP_LAMBDA: //gets converted into OP_CLOSURE by the type checker.
+            break;
+        case OP_INSTANCEOF: {
+            CheshireType from = node->instanceof.expression->determinedType, to = node->instanceof.type;
+            ir::Value* object = llvmEmitExpression(node->instanceof.expression);
+
+            if (isNull(from))
+                return builder->getInt1(false);
+
+            if (isCheckedCast(from, to))
+                return emitNullableTypeTest(object, from, to, false);
+
+            return builder->CreateICmpNE(object, ir::ConstantPointerNull::get((ir::PointerType*) object->getType()));
+        }
+        case OP_LONG_INTEGER:
+        case OP_INTEGER:
+            return ir::ConstantInt::get(llvmEmitType(node->determinedType), node->integer, true);
+        case OP_DECIMAL:
+            return ir::ConstantFP::get(llvmEmitType(node->determinedType), node->decimal);
+        case OP_CHAR:
+            return ir::ConstantInt::get(llvmEmitType(node->determinedType), node->character, true);
+        case OP_DEREFERENCE: {
+            if (node->unaryChild->type == OP_VARIABLE)
+                return emitVariableRead(node->unaryChild->string, llvmEmitType(node->determinedType));
+
+            ir::Value* child = llvmEmitExpression(node->unaryChild);
+            return builder->CreateLoad(llvmEmitType(node->determinedType), child);
+        }
+        case OP_NOT:
+        case OP_COMPL: {
+            ir::Value* a = llvmEmitExpression(node->unaryChild);
+            return builder->CreateXor(a, ir::ConstantInt::get(llvmEmitType(node->determinedType), -1, true));
+        }
+        case OP_UNARY_MINUS: {
+            ir::Value* a = llvmEmitExpression(node->unaryChild);
+
+            if (isDecimal(node->determinedType))
+                return builder->CreateFNeg(a);
+
+            return builder->CreateSub(ir::ConstantInt::get(llvmEmitType(node->determinedType), 0), a);
+        }
+        case OP_PLUSONE:
+        case OP_MINUSONE: {
+            ir::Value* lval = llvmEmitExpression(node->unaryChild);
+            ir::Type* type = llvmEmitType(node->determinedType);
+            ir::Value* deref = builder->CreateLoad(type, lval);
+            ir::Value* changed;
+
+            if (isDecimal(node->determinedType)) {
+                ir::Value* one = ir::ConstantFP::get(type, 1.0);
+                changed = node->type == OP_PLUSONE ? builder->CreateFAdd(deref, one) : builder->CreateFSub(deref, one);
+            } else {
+                ir::Value* one = ir::ConstantInt::get(type, 1);
+                changed = node->type == OP_PLUSONE ? builder->CreateAdd(deref, one) : builder->CreateSub(deref, one);
+            }
+
+            builder->CreateStore(changed, lval);
+            return deref;
+        }
+        case OP_EQUALS:
+        case OP_NOT_EQUALS:
+        case OP_GRE_EQUALS:
+        case OP_LES_EQUALS:
+        case OP_GREATER:
+        case OP_LESS: {
+            ir::Value* a = llvmEmitExpression(node->binary.left), * b = llvmEmitExpression(node->binary.right);
+
+            if (isDecimal(node->binary.left->determinedType)) {
+                switch (node->type) {
+                    case OP_EQUALS:
+                        return builder->CreateFCmpOEQ(a, b);
+                    case OP_NOT_EQUALS:
+                        return builder->CreateFCmpUNE(a, b);
+                    case OP_GRE_EQUALS:
+                        return builder->CreateFCmpOGE(a, b);
+                    case OP_LES_EQUALS:
+                        return builder->CreateFCmpOLE(a, b);
+                    case OP_GREATER:
+                        return builder->CreateFCmpOGT(a, b);
+                    default:
+                        return builder->CreateFCmpOLT(a, b);
+                }
+            }
+
+            switch (node->type) {
+                case OP_EQUALS:
+                    return builder->CreateICmpEQ(a, b);
+                case OP_NOT_EQUALS:
+                    return builder->CreateICmpNE(a, b);
+                case OP_GRE_EQUALS:
+                    return builder->CreateICmpSGE(a, b);
+                case OP_LES_EQUALS:
+                    return builder->CreateICmpSLE(a, b);
+                case OP_GREATER:
+                    return builder->CreateICmpSGT(a, b);
+                default:
+                    return builder->CreateICmpSLT(a, b);
+            }
+        }
+        case OP_AND:
+        case OP_OR: {
+            ir::Value* firstcondition = llvmEmitExpression(node->binary.left);
+            ir::BasicBlock* enter = builder->GetInsertBlock();
+            ir::BasicBlock* calculate = createBlock(node->type == OP_AND ? "and.rhs" : "or.rhs");
+            ir::BasicBlock* skip = createBlock(node->type == OP_AND ? "and.end" : "or.end");
+
+            if (node->type == OP_AND)
+                builder->CreateCondBr(firstcondition, calculate, skip);
+            else
+                builder->CreateCondBr(firstcondition, skip, calculate);
+
+            builder->SetInsertPoint(calculate);
+            ir::Value* secondcondition = llvmEmitExpression(node->binary.right);
+            calculate = builder->GetInsertBlock(); //the right side may have branched, so use wherever it ended.
+            builder->CreateBr(skip);
+            builder->SetInsertPoint(skip);
+            ir::PHINode* phi = builder->CreatePHI(builder->getInt1Ty(), 2);
+            phi->addIncoming(builder->getInt1(node->type == OP_OR), enter);
+            phi->addIncoming(secondcondition, calculate);
+            return phi;
+        }
+        case OP_PLUS:
+        case OP_MINUS:
+        case OP_MULT:
+        case OP_DIV:
+        case OP_MOD: {
+            ir::Value* a = llvmEmitExpression(node->binary.left), * b = llvmEmitExpression(node->binary.right);
+
+            if (isDecimal(node->binary.left->determinedType)) {
+                switch (node->type) {
+                    case OP_PLUS:
+                        return builder->CreateFAdd(a, b);
+                    case OP_MINUS:
+                        return builder->CreateFSub(a, b);
+                    case OP_MULT:
+                        return builder->CreateFMul(a, b);
+                    case OP_DIV:
+                        return builder->CreateFDiv(a, b);
+                    default:
+                        return builder->CreateFRem(a, b);
+                }
+            }
+
+            switch (node->type) {
+                case OP_PLUS:
+                    return builder->CreateAdd(a, b);
+                case OP_MINUS:
+                    return builder->CreateSub(a, b);
+                case OP_MULT:
+                    return builder->CreateMul(a, b);
+                case OP_DIV:
+                    return builder->CreateSDiv(a, b);
+                default:
+                    return builder->CreateSRem(a, b);
+            }
+        }
+        case OP_SET: {
+            ir::Value* a = llvmEmitExpression(node->binary.left), * b = llvmEmitExpression(node->binary.right);
+            builder->CreateStore(b, a);
+            return b;
+        }
+        case OP_VARIABLE: //an lval, so it must have a slot.
+            ERROR_IF(fetchBinding(node->string).direct, "Fatal error: %s is never assigned, yet has no slot!", node->string);
+            return fetchValue(node->string);
+        case OP_CAST: {
+            ir::Value* child = llvmEmitExpression(node->cast.child);
+            ir::Type* type = llvmEmitType(node->cast.type);
+
+            if (isNumericalType(node->cast.type)) {
+                if (equalTypes(node->cast.type, node->cast.child->determinedType)) {
+                    return child; //no cast
+                } else if (node->cast.type.typeKey > node->cast.child->determinedType.typeKey) {
+                    return isDecimal(node->cast.type) ? builder->CreateSIToFP(child, type) : builder->CreateSExt(child, type);
+                } else {
+                    return isDecimal(node->cast.child->determinedType) ? builder->CreateFPToSI(child, type) : builder->CreateTrunc(child, type);
+                }
+            }
+
+            if (isCheckedCast(node->cast.child->determinedType, node->cast.type)) {
+                ir::FunctionType* assertType = ir::FunctionType::get(builder->getVoidTy(), {builder->getInt1Ty()}, false);
+                std::vector<ir::Value*> arguments(1, emitNullableTypeTest(child, node->cast.child->determinedType, node->cast.type, true));
+                emitCall(assertType, getCheshireFunction("_Assert", assertType), arguments);
+            }
+
+            return builder->CreateBitCast(child, type);
+        }
+        case OP_METHOD_CALL: {
+            ir::Value* fnptr = emitCallee(node->methodcall.callback);
+            std::vector<ir::Value*> arguments;
+            emitArguments(arguments, node->methodcall.params);
+            return emitCall(getLambdaFunctionType(node->methodcall.callback->determinedType), fnptr, arguments, node->methodcall.tailCall, getCallEffects(node));
+        }
+        case OP_RESERVED_LITERAL: {
+            switch (node->reserved) {
+                case RL_TRUE:
+                    return builder->getInt1(true);
+                case RL_FALSE:
+                    return builder->getInt1(false);
+                case RL_NULL:
+                    return ir::ConstantPointerNull::get((ir::PointerType*) getBytePointerType());
+            }
+        }
+        break;
+        case OP_ARRAY_ACCESS: {
+            ir::Value* a = llvmEmitExpression(node->binary.left), * b = llvmEmitExpression(node->binary.right);
+            ir::Type* elementType = llvmEmitType(node->determinedType);
+            ir::Type* arrayType = ir::StructType::get(*context, {builder->getInt32Ty(), ir::PointerType::getUnqual(elementType)});
+            ir::Value* array = builder->CreateStructGEP(arrayType, a, 1);
+            ir::Value* arrayderef = builder->CreateLoad(ir::PointerType::getUnqual(elementType), array);
+            return builder->CreateGEP(elementType, arrayderef, b);
+        }
+        case OP_STRING: {
+            ir::Constant* contents = ir::ConstantDataArray::getString(*context, node->string, false);
+            ir::GlobalVariable* string = new ir::GlobalVariable(*module, contents->getType(), true, ir::GlobalValue::PrivateLinkage, contents, ".tempstring");
+            string->setUnnamedAddr(ir::GlobalValue::UnnamedAddr::Global);
+            string->setAlignment(ir::MaybeAlign(1));
+            ir::Value* temp = builder->CreateInBoundsGEP(contents->getType(), string, {builder->getInt32(0), builder->getInt32(0)});
+            ir::Function* newString = getRuntimeFunction("_New_String", llvmEmitType(TYPE_STRING), {getBytePointerType(), builder->getInt32Ty()});
+            return builder->CreateCall(newString->getFunctionType(), newString, {temp, builder->getInt32(strlen(node->string))});
+        }
+        case OP_CLOSURE: {
+            int closure_id = closureIdentifier++;
+            std::vector<ir::Type*> parameters, captures;
+            UsingList* u;
+            ParameterList* p;
+
+            for (u = node->closure.usingList; u != NULL; u = u->next)
+                captures.push_back(llvmEmitType(u->type));
+
+            ir::StructType* nesttype = ir::StructType::get(*context, captures);
+
+            if (node->closure.usingList != NULL)
+                parameters.push_back(ir::PointerType::getUnqual(nesttype));
+
+            for (p = node->closure.params; p != NULL; p = p->next)
+                parameters.push_back(llvmEmitType(p->type));
+
+            ir::FunctionType* bodyType = ir::FunctionType::get(llvmEmitType(node->closure.type), parameters, false);
+            std::string name = (node->closure.usingList == NULL ? "_Closure_" : "_ClosureBody_") + std::to_string(closure_id);
+            ir::Function* body = ir::Function::Create(bodyType, ir::GlobalValue::InternalLinkage, name, module);
+            body->setCallingConv(ir::CallingConv::Fast);
+            IRBuilder::InsertPoint outer = builder->saveIP();
+            raiseValueScope();
+
+            if (node->closure.usingList == NULL) { //basically just a function...
+                emitFunctionPrologue(body, node->closure.params, 0, getClosureEffects(node));
+            } else {
+                body->addParamAttr(0, ir::Attribute::Nest);
+                addFunctionAttributes(body, getClosureEffects(node));
+                body->getArg(0)->setName("_Unpacked");
+                builder->SetInsertPoint(ir::BasicBlock::Create(*context, "entry", body));
+                unsigned int id = 0;
+
+                for (u = node->closure.usingList; u != NULL; u = u->next, id++) {
+                    ir::Type* type = llvmEmitType(u->type);
+                    Boolean direct = fetchBinding(u->variable).direct; //of the captured name, which the body shares.
+                    ir::Value* variable = direct ? NULL : builder->CreateAlloca(type, NULL, u->variable);
+                    ir::Value* unpacked = builder->CreateLoad(type, builder->CreateStructGEP(nesttype, body->getArg(0), id));
+
+                    if (direct) {
+                        registerValue(u->variable, unpacked, TRUE);
+                        continue;
+                    }
+
+                    builder->CreateStore(unpacked, variable);
+                    registerValue(u->variable, variable);
+                }
+
+                ir::Function::arg_iterator argument = body->arg_begin() + 1;
+
+                for (p = node->closure.params; p != NULL; p = p->next, ++argument)
+                    bindParameter(p, &*argument);
+            }
+
+            emitBodySlots(node->closure.body);
+            llvmEmitBlock(node->closure.body);
+            emitFunctionEpilogue(node->closure.type);
+            fallValueScope();
+            builder->restoreIP(outer);
+
+            if (node->closure.usingList == NULL)
+                return body;
+
+            ir::Value* storage = emitAllocation(getSizeClass(TRAMPOLINE_SIZE), builder->getInt32(TRAMPOLINE_SIZE));
+            ir::Value* functioncast = builder->CreateBitCast(body, getBytePointerType());
+            int sizeClass = getSizeClass(getEnvironmentSize(node->closure.usingList));
+            ir::Value* nest = emitAllocation(sizeClass, sizeClass < 0 ? emitSizeOf(nesttype) : NULL);
+            ir::Value* nestcast = builder->CreateBitCast(nest, ir::PointerType::getUnqual(nesttype));
+            unsigned int id = 0;
+
+            for (u = node->closure.usingList; u != NULL; u = u->next, id++) {
+                ir::Value* element = builder->CreateStructGEP(nesttype, nestcast, id);
+                ir::Value* loaded = emitVariableRead(u->variable, captures[id]);
+                builder->CreateStore(loaded, element);
+            }
+
+            ir::Function* initTrampoline = getRuntimeFunction("llvm.init.trampoline", builder->getVoidTy(), {getBytePointerType(), getBytePointerType(), getBytePointerType()});
+            ir::Function* adjustTrampoline = getRuntimeFunction("llvm.adjust.trampoline", getBytePointerType(), {getBytePointerType()});
+            builder->CreateCall(initTrampoline->getFunctionType(), initTrampoline, {storage, functioncast, nest});
+            ir::Value* outfunction = builder->CreateCall(adjustTrampoline->getFunctionType(), adjustTrampoline, {storage});
+            return builder->CreateBitCast(outfunction, llvmEmitType(node->determinedType));
+        }
+        case OP_INSTANTIATION: {
+            ir::Type* classType = llvmEmitType(node->instantiate.type);
+            auto slot = stackObjects.find(node);
+            ir::Value* casted;
+
+            if (slot != stackObjects.end()) {
+                casted = builder->CreateBitCast(slot->second, classType);
+                stackObjects.erase(slot);
+            } else {
+                casted = builder->CreateBitCast(emitObjectAllocation(node->instantiate.type), classType);
+            }
+
+            std::vector<ir::Value*> arguments(1, casted);
+            emitArguments(arguments, node->instantiate.params);
+            std::vector<ir::Type*> parameters;
+
+            for (size_t i = 0; i < arguments.size(); i++)
+                parameters.push_back(arguments[i]->getType());
+
+            ir::FunctionType* type = ir::FunctionType::get(builder->getVoidTy(), parameters, false);
+            emitCall(type, getCheshireFunction("_New_" + getClassName(node->instantiate.type), type), arguments);
+            return casted;
+        }
+        case OP_OBJECT_CALL: {
+            CheshireType objectType = node->objectcall.object->determinedType;
+            ir::Value* object = llvmEmitExpression(node->objectcall.object);
+            // -- DEALLOCATING FUNCTION POINTER FROM OBJECT -- //
+            CheshireType methodType = getClassVariable(objectType, node->objectcall.method);
+            int targets = getCallTargetCount(node);
+            ir::Value* fnptr = NULL;
+
+            if (targets != 1) {
+                ir::Value* fnptr_ptr = emitMemberAddress(object, objectType, node->objectcall.method);
+                fnptr = builder->CreateLoad(llvmEmitType(methodType), fnptr_ptr);
+            }
+
+            std::vector<ir::Value*> arguments(1, NULL);
+            emitArguments(arguments, node->objectcall.params);
+
+            if (targets == 0) {
+                arguments[0] = emitNonTypecheckedUpcast(object, objectType, getObjectSelfType(objectType, node->objectcall.method));
+                return emitCall(getLambdaFunctionType(methodType), fnptr, arguments, node->objectcall.tailCall, getCallEffects(node));
+            }
+
+            //devirtualized: each target but the last is guarded by comparing it with the method in the vtable.
+            ir::BasicBlock* labelexit = targets > 1 ? createBlock("devirt.end") : NULL;
+            std::vector<std::pair<ir::Value*, ir::BasicBlock*> > results;
+
+            for (int i = 0; i < targets; i++) {
+                CheshireType definer;
+                ClassList* method = getCallTarget(node, i, &definer);
+                CheshireType type = getLambdaType(method->method.returnType, method->method.params);
+                ir::FunctionType* functionType = getLambdaFunctionType(type);
+                ir::Function* target = getCheshireFunction("_ClassMethod_" + getClassName(definer) + "_" + method->method.name, functionType);
+
+                if (i != targets - 1) {
+                    ir::BasicBlock* labeltarget = createBlock("devirt.call");
+                    ir::BasicBlock* labelnext = createBlock("devirt.next");
+                    ir::Value* expected = equalTypes(type, methodType) ? (ir::Value*) target : builder->CreateBitCast(target, llvmEmitType(methodType));
+                    builder->CreateCondBr(builder->CreateICmpEQ(fnptr, expected), labeltarget, labelnext);
+                    builder->SetInsertPoint(labeltarget);
+                    arguments[0] = emitNonTypecheckedUpcast(object, objectType, definer);
+                    results.push_back(std::make_pair(emitCall(functionType, target, arguments, node->objectcall.tailCall, getCallEffects(node)), builder->GetInsertBlock()));
+                    builder->CreateBr(labelexit);
+                    builder->SetInsertPoint(labelnext);
+                } else {
+                    arguments[0] = emitNonTypecheckedUpcast(object, objectType, definer);
+                    results.push_back(std::make_pair(emitCall(functionType, target, arguments, node->objectcall.tailCall, getCallEffects(node)), builder->GetInsertBlock()));
+                }
+            }
+
+            if (targets == 1)
+                return results[0].first;
+
+            builder->CreateBr(labelexit);
+            builder->SetInsertPoint(labelexit);
+
+            if (isVoid(node->determinedType))
+                return results[0].first;
+
+            ir::PHINode* phi = builder->CreatePHI(llvmEmitType(node->determinedType), targets);
+
+            for (size_t i = 0; i < results.size(); i++)
+                phi->addIncoming(results[i].first, results[i].second);
+
+            return phi;
+        }
+        case OP_ACCESS: {
+            CheshireType objectType = node->access.expression->determinedType;
+            ir::Value* object = llvmEmitExpression(node->access.expression);
+            return emitMemberAddress(object, objectType, node->access.variable);
+        }
+        case OP_LENGTH: {
+            ir::Value* child = llvmEmitExpression(node->unaryChild);
+            CheshireType elementType = getArrayDereference(node->unaryChild->determinedType);
+            ir::Type* arrayType = ir::StructType::get(*context, {builder->getInt32Ty(), ir::PointerType::getUnqual(llvmEmitType(elementType))});
+            ir::Value* lptr = builder->CreateStructGEP(arrayType, child, 0);
+            return builder->CreateLoad(builder->getInt32Ty(), lptr);
+        }
+        case OP_CHOOSE: {
+            ir::Value* condition = llvmEmitExpression(node->choose.condition);
+            ir::BasicBlock* labeltrue = createBlock("choose.true");
+            ir::BasicBlock* labelfalse = createBlock("choose.false");
+            ir::BasicBlock* labelexit = createBlock("choose.end");
+            builder->CreateCondBr(condition, labeltrue, labelfalse);
+            builder->SetInsertPoint(labeltrue);
+            ir::Value* iftrue = llvmEmitExpression(node->choose.iftrue);
+            labeltrue = builder->GetInsertBlock();
+            builder->CreateBr(labelexit);
+            builder->SetInsertPoint(labelfalse);
+            ir::Value* iffalse = llvmEmitExpression(node->choose.iffalse);
+            labelfalse = builder->GetInsertBlock();
+            builder->CreateBr(labelexit);
+            builder->SetInsertPoint(labelexit);
+            ir::PHINode* phi = builder->CreatePHI(llvmEmitType(node->choose.iffalse->determinedType), 2);
+            phi->addIncoming(iftrue, labeltrue);
+            phi->addIncoming(iffalse, labelfalse);
+            return phi;
+        }
+    }
+
+    PANIC("Fatal error in code-emitting!");
+}
+
+ir::Type* llvmEmitType(CheshireType type) { //object types have implicit *, remember. Object* not Object
+    if (type.arrayNesting > 0) {
+        type.arrayNesting--;
+        ir::Type* elementPointer = ir::PointerType::getUnqual(llvmEmitType(type));
+        return ir::PointerType::getUnqual(ir::StructType::get(*context, {builder->getInt32Ty(), elementPointer}));
+    }
+
+    if (isNull(type)) {
+        return getBytePointerType(); //nulltype eventually gets casted...
+    } else if (isObjectType(type)) {
+        return ir::PointerType::getUnqual(getClassStruct(type));
+    } else if (isNumericalType(type) || isBoolean(type)) {
+        switch (type.typeKey) {
+            case 1: //I8
+                return builder->getInt8Ty();
+            case 2: //I16
+                return builder->getInt16Ty();
+            case 3: //Int
+                return builder->getInt32Ty();
+            case 4: //I64
+                return builder->getInt64Ty();
+            case 5: //Decimal
+                return builder->getDoubleTy();
+            case 6: //Boolean
+                return builder->getInt1Ty();
+        }
+    } else if (isLambdaType(type)) {
+        return ir::PointerType::getUnqual(getLambdaFunctionType(type));
+    } else if (isVoid(type)) {
+        return builder->getVoidTy();
+    }
+
+    PANIC("Unknown type!");
+}
+
+void llvmRunPasses(const char* pipeline) {
+#ifdef CHESHIRE_LLVM_BACKEND
+    llvm::PassBuilder passBuilder;
+    llvm::LoopAnalysisManager loopAnalysis;
+    llvm::FunctionAnalysisManager functionAnalysis;
+    llvm::CGSCCAnalysisManager cgsccAnalysis;
+    llvm::ModuleAnalysisManager moduleAnalysis;
+    passBuilder.registerModuleAnalyses(moduleAnalysis);
+    passBuilder.registerCGSCCAnalyses(cgsccAnalysis);
+    passBuilder.registerFunctionAnalyses(functionAnalysis);
+    passBuilder.registerLoopAnalyses(loopAnalysis);
+    passBuilder.crossRegisterProxies(loopAnalysis, functionAnalysis, cgsccAnalysis, moduleAnalysis);
+    llvm::ModulePassManager passes;
+
+    if (llvm::Error error = passBuilder.parsePassPipeline(passes, pipeline)) {
+        std::string message = llvm::toString(std::move(error));
+        PANIC("Invalid pass pipeline \"%s\": %s", pipeline, message.c_str());
+    }
+
+    passes.run(*module, moduleAnalysis);
+#else
+    PANIC("Running passes needs the LLVM backend (make llvm)");
+#endif
+}
+
+void llvmWriteModule(FILE* out, Boolean bitcode) {
+#ifdef CHESHIRE_LLVM_BACKEND
+    std::string errors;
+    llvm::raw_string_ostream errorStream(errors);
+
+    if (llvm::verifyModule(*module, &errorStream)) {
+        errorStream.flush();
+        PANIC("Emitted an invalid module:\n%s", errors.c_str());
+    }
+
+    fflush(out);
+    llvm::raw_fd_ostream stream(fileno(out), false);
+
+    if (bitcode)
+        llvm::WriteBitcodeToFile(*module, stream);
+    else
+        module->print(stream, NULL);
+
+    stream.flush();
+#else
+    if (!bitcode)
+        PANIC("Only bitcode can be written without the LLVM backend");
+
+    bitcode::WriteBitcodeToFile(*module, out);
+#endif
+}
@@ -0,0 +1,47 @@
+/*
+ * File:   LLVMEmitting.hpp
+ * Author: Michael Goulet
+ * Implementation: LLVMEmitting.cpp
+ *
+ * LLVMEmitting.hpp is the in-memory alternative to CodeEmitting.h: instead of printing textual IR, it builds a
+ * module with IRBuilder, following the same forwardDefinition/emitCode/emitExpression structure.
+ * The "llvm" target of the Makefile builds it against LLVM itself; otherwise it builds against BitcodeWriter.hpp,
+ * which can only write the module out as bitcode.
+ */
+
+#ifndef LLVMEMITTING_HPP
+#define	LLVMEMITTING_HPP
+
+#include <stdio.h>
+#include "Structures.h"
+
+#ifdef CHESHIRE_LLVM_BACKEND
+namespace llvm {
+    class Type;
+    class Value;
+}
+
+namespace ir = llvm;
+#else
+namespace bitcode {
+    class Type;
+    class Value;
+}
+
+namespace ir = bitcode;
+#endif
+
+void initLLVMEmitting(const char* moduleName);
+void freeLLVMEmitting(void);
+
+void llvmForwardDefinition(ParserTopNode*);
+void llvmEmitCode(ParserTopNode*);
+void llvmEmitBlock(BlockList*);
+void llvmEmitStatement(StatementNode*);
+ir::Value* llvmEmitExpression(ExpressionNode*);
+ir::Type* llvmEmitType(CheshireType);
+
+void llvmRunPasses(const char* pipeline);
+void llvmWriteModule(FILE* out, Boolean bitcode);
+
+#endif	/* LLVMEMITTING_HPP */
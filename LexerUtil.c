@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "LexerUtilities.h"
+#include "MemReport.h"
 #include "ParserEnums.h"
 
 void determineReservedLiteral(const char* string, ReservedLiteral* var) {
@@ -96,7 +97,7 @@ void determineOpType(const char* string, OperationType* var) {
 
 void saveIdentifier(const char* string, char** var) {
     int stringlen = strlen(string);
-    char* cpystring = malloc(sizeof(char) * (stringlen+1));
+    char* cpystring = memAlloc(MC_IDENTIFIERS, sizeof(char) * (stringlen+1));
     memcpy(cpystring, string, stringlen);
     cpystring[stringlen] = '\0';
     *var = cpystring;
@@ -115,7 +116,7 @@ void saveStringLiteral(const char* string, char** var) {
         interpretedLength++;
     }
 
-    char* newstring = malloc(interpretedLength + 1);
+    char* newstring = memAlloc(MC_STRING_LITERALS, interpretedLength + 1);
     newstring[interpretedLength] = '\0';
     int j; //i already defined.
 
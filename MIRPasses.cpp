@@ -0,0 +1,444 @@
+/*
+ * File:   MIRPasses.cpp
+ * Author: Michael Goulet
+ * Implements: MidLevelIR.h, MidLevelIR.hpp
+ *
+ * The pass manager of the mid-level IR, and its passes:
+ *   cse - block-local common subexpression elimination and load forwarding.
+ *   dce - removes unreachable blocks, slots that are only written, and unused side-effect free instructions.
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+#include "MidLevelIR.h"
+#include "MidLevelIR.hpp"
+#include "TypeSystem.h"
+#include "TypeSystemUtilities.hpp"
+
+typedef void (*MIRPass)(MIRFunction*);
+
+typedef struct {
+    const char* name;
+    MIRPass pass;
+} NamedPass;
+
+static void eliminateCommonSubexpressions(MIRFunction*);
+static void eliminateDeadCode(MIRFunction*);
+
+static const NamedPass availablePasses[] = {
+    {"cse", eliminateCommonSubexpressions},
+    {"dce", eliminateDeadCode}
+};
+
+static std::vector<MIRPass> pipeline = {eliminateCommonSubexpressions, eliminateDeadCode};
+
+void setMIRPasses(const char* list) {
+    pipeline.clear();
+
+    while (*list != '\0') {
+        size_t length = strcspn(list, ",");
+        size_t i;
+
+        for (i = 0; i < sizeof(availablePasses) / sizeof(NamedPass); i++) {
+            if (strlen(availablePasses[i].name) == length && strncmp(availablePasses[i].name, list, length) == 0)
+                break;
+        }
+
+        ERROR_IF(i == sizeof(availablePasses) / sizeof(NamedPass), "Unknown mid-level IR pass \"%.*s\"", (int) length, list);
+        pipeline.push_back(availablePasses[i].pass);
+        list += length;
+
+        if (*list == ',')
+            list++;
+    }
+}
+
+void runMIRPasses(MIRFunction* f) {
+    for (size_t i = 0; i < pipeline.size(); i++)
+        pipeline[i](f);
+}
+
+static void replaceOperands(MIRInstruction* instruction) {
+    for (size_t i = 0; i < instruction->operands.size(); i++) {
+        MIRInstruction* operand = instruction->operands[i].instruction;
+
+        if (operand != NULL && operand->removed)
+            instruction->operands[i] = operand->replacement;
+    }
+}
+
+static void removeInstructions(MIRFunction* f) {
+    for (size_t b = 0; b < f->blocks.size(); b++) {
+        MIRVector<MIRInstruction*>& instructions = f->blocks[b]->instructions;
+        size_t kept = 0;
+
+        for (size_t i = 0; i < instructions.size(); i++) {
+            if (instructions[i]->removed)
+                delete instructions[i];
+            else
+                instructions[kept++] = instructions[i];
+        }
+
+        instructions.resize(kept);
+    }
+}
+
+static Boolean isSlot(const MIRValue& value) {
+    return value.instruction != NULL && value.instruction->opcode == MIR_SLOT ? TRUE : FALSE;
+}
+
+static MIRValue getResult(MIRInstruction* instruction) {
+    MIRValue v;
+    v.instruction = instruction;
+    v.value.type = LVT_VOID;
+    return v;
+}
+
+//////////////// CSE /////////////////
+
+static size_t hashMIRValue(const MIRValue& value) {
+    if (value.instruction != NULL)
+        return std::hash<void*>()(value.instruction);
+
+    switch (value.value.type) {
+        case LVT_INT_LITERAL:
+            return std::hash<int64_t>()(value.value.value);
+        case LVT_LOCAL_VARIABLE:
+            return value.value.vardef.uid;
+        case LVT_GLOBAL_VARIABLE:
+        case LVT_GLOBAL_METHOD:
+        case LVT_PARAMETER_VARIABLE:
+            return CStrHash()(value.value.name);
+        default:
+            return value.value.type;
+    }
+}
+
+//what an instruction computes, and in which heap generation (-1 when it does not read the heap).
+typedef struct {
+    MIROpcode opcode;
+    const char* text;
+    CheshireType type, operandType;
+    MIRValue operands[2]; //computations that are reused have at most two.
+    size_t operandCount;
+    int generation;
+} Computation;
+
+static Computation describeComputation(MIRInstruction* instruction, int generation) {
+    Computation c;
+    c.opcode = instruction->opcode;
+    c.text = instruction->text;
+    c.type = instruction->type;
+    c.operandType = instruction->operandType;
+    c.operandCount = instruction->operands.size();
+    c.generation = generation;
+
+    for (size_t i = 0; i < c.operandCount; i++)
+        c.operands[i] = instruction->operands[i];
+
+    return c;
+}
+
+static size_t hashComputation(const Computation& c) {
+    size_t hash = c.opcode * 31 + c.generation;
+
+    for (size_t i = 0; i < c.operandCount; i++)
+        hash = hash * 31 + hashMIRValue(c.operands[i]);
+
+    return hash;
+}
+
+static Boolean sameComputation(const Computation& left, const Computation& right) {
+    CStrEql streql;
+
+    if (left.opcode != right.opcode || left.generation != right.generation || left.operandCount != right.operandCount)
+        return FALSE;
+
+    if (!equalTypes(left.type, right.type) || !equalTypes(left.operandType, right.operandType))
+        return FALSE;
+
+    if ((left.text == NULL) != (right.text == NULL) || (left.text != NULL && !streql(left.text, right.text)))
+        return FALSE;
+
+    for (size_t i = 0; i < left.operandCount; i++) {
+        if (!equalMIRValues(left.operands[i], right.operands[i]))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+class AvailableComputations {
+private:
+    typedef std::unordered_multimap<size_t, std::pair<Computation, MIRValue> > Table;
+    Table table;
+public:
+    Boolean find(const Computation& c, MIRValue* result) {
+        std::pair<Table::iterator, Table::iterator> range = table.equal_range(hashComputation(c));
+
+        for (Table::iterator i = range.first; i != range.second; ++i) {
+            if (sameComputation(i->second.first, c)) {
+                *result = i->second.second;
+                return TRUE;
+            }
+        }
+
+        return FALSE;
+    }
+
+    void insert(const Computation& c, MIRValue result) {
+        table.insert(Table::value_type(hashComputation(c), std::make_pair(c, result)));
+    }
+
+    void clear() {
+        if (!table.empty()) //clearing walks every bucket, even of an empty table.
+            table.clear();
+    }
+};
+
+static AvailableComputations available;
+static std::vector<std::pair<MIRInstruction*, MIRValue> > slotValues; //a method has only a handful of slots.
+
+//replaces the instruction with an equal computation that is already available, or makes it available.
+static void reuseComputation(MIRInstruction* instruction, int generation) {
+    Computation c = describeComputation(instruction, generation);
+
+    if (available.find(c, &instruction->replacement))
+        instruction->removed = TRUE;
+    else
+        available.insert(c, getResult(instruction));
+}
+
+static MIRValue* findSlotValue(MIRInstruction* slot) {
+    for (size_t i = 0; i < slotValues.size(); i++) {
+        if (slotValues[i].first == slot)
+            return &slotValues[i].second;
+    }
+
+    return NULL;
+}
+
+static void setSlotValue(MIRInstruction* slot, MIRValue value) {
+    MIRValue* known = findSlotValue(slot);
+
+    if (known != NULL)
+        *known = value;
+    else
+        slotValues.push_back(std::make_pair(slot, value));
+}
+
+//slots never escape (closures copy their captures), so only stores to the same slot change what a load of it reads.
+//Everything else in memory is the heap, and any store to it or call may change it; @_M_ constants never change.
+static void eliminateCommonSubexpressions(MIRFunction* f) {
+    for (size_t b = 0; b < f->blocks.size(); b++) {
+        MIRVector<MIRInstruction*>& instructions = f->blocks[b]->instructions;
+        int generation = 0;
+        available.clear();
+        slotValues.clear();
+
+        for (size_t i = 0; i < instructions.size(); i++) {
+            MIRInstruction* instruction = instructions[i];
+            replaceOperands(instruction);
+
+            switch (instruction->opcode) {
+                case MIR_BINARY:
+                case MIR_CAST:
+                case MIR_FIELD:
+                case MIR_INDEX:
+                case MIR_LENGTH: //the length of an array never changes.
+                    reuseComputation(instruction, -1);
+                    break;
+                case MIR_LOAD: {
+                    MIRValue address = instruction->operands[0];
+
+                    if (isSlot(address)) {
+                        MIRValue* known = findSlotValue(address.instruction);
+
+                        if (known != NULL) {
+                            instruction->replacement = *known;
+                            instruction->removed = TRUE;
+                        } else {
+                            setSlotValue(address.instruction, getResult(instruction));
+                        }
+                    } else {
+                        Boolean constant = address.instruction == NULL && address.value.type == LVT_GLOBAL_METHOD ? TRUE : FALSE;
+                        reuseComputation(instruction, constant ? -1 : generation);
+                    }
+                }
+                break;
+                case MIR_STORE: {
+                    MIRValue address = instruction->operands[0];
+
+                    if (isSlot(address)) {
+                        setSlotValue(address.instruction, instruction->operands[1]);
+                    } else { //a later load of the same address reads the stored value.
+                        generation++;
+                        Computation load;
+                        load.opcode = MIR_LOAD;
+                        load.text = NULL;
+                        load.type = instruction->type;
+                        load.operandType = TYPE_VOID;
+                        load.operands[0] = address;
+                        load.operandCount = 1;
+                        load.generation = generation;
+                        available.insert(load, instruction->operands[1]);
+                    }
+                }
+                break;
+                case MIR_CALL:
+                case MIR_OBJECT_CALL:
+                case MIR_NEW:
+                case MIR_DELETE: //writes the object's first word.
+                case MIR_STRING:
+                    generation++;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    for (size_t b = 0; b < f->blocks.size(); b++) { //uses in later blocks.
+        for (size_t i = 0; i < f->blocks[b]->instructions.size(); i++)
+            replaceOperands(f->blocks[b]->instructions[i]);
+    }
+
+    removeInstructions(f);
+}
+
+//////////////// DCE /////////////////
+
+#define MARK_REACHABLE 1
+#define MARK_READ 1
+#define MARK_LIVE 2
+
+static void removeUnreachableBlocks(MIRFunction* f) {
+    std::vector<MIRBlock*> worklist;
+
+    for (size_t b = 0; b < f->blocks.size(); b++)
+        f->blocks[b]->mark = 0;
+
+    f->blocks.front()->mark = MARK_REACHABLE;
+    worklist.push_back(f->blocks.front());
+
+    while (!worklist.empty()) {
+        MIRBlock* block = worklist.back();
+        worklist.pop_back();
+        MIRInstruction* terminator = block->instructions.back();
+
+        for (size_t i = 0; i < terminator->targets.size(); i++) {
+            if (terminator->targets[i]->mark == 0) {
+                terminator->targets[i]->mark = MARK_REACHABLE;
+                worklist.push_back(terminator->targets[i]);
+            }
+        }
+    }
+
+    for (size_t b = 0; b < f->blocks.size(); b++) { //phis lose the arms that came from unreachable blocks.
+        MIRVector<MIRInstruction*>& instructions = f->blocks[b]->instructions;
+
+        for (size_t i = 0; i < instructions.size() && f->blocks[b]->mark == MARK_REACHABLE; i++) {
+            MIRInstruction* phi = instructions[i];
+
+            if (phi->opcode != MIR_PHI)
+                continue;
+
+            size_t arms = 0;
+
+            for (size_t a = 0; a < phi->targets.size(); a++) {
+                if (phi->targets[a]->mark == MARK_REACHABLE) {
+                    phi->operands[arms] = phi->operands[a];
+                    phi->targets[arms++] = phi->targets[a];
+                }
+            }
+
+            phi->operands.resize(arms);
+            phi->targets.resize(arms);
+        }
+    }
+
+    size_t kept = 0;
+
+    for (size_t b = 0; b < f->blocks.size(); b++) {
+        MIRBlock* block = f->blocks[b];
+
+        if (block->mark == MARK_REACHABLE) {
+            f->blocks[kept++] = block;
+            continue;
+        }
+
+        for (size_t i = 0; i < block->instructions.size(); i++)
+            delete block->instructions[i];
+
+        delete block;
+    }
+
+    f->blocks.resize(kept);
+}
+
+static Boolean writesSlot(MIRInstruction* instruction) { //through its first operand, without reading it.
+    switch (instruction->opcode) {
+        case MIR_STORE:
+        case MIR_LIFETIME_START:
+        case MIR_LIFETIME_END:
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+static void eliminateDeadCode(MIRFunction* f) {
+    removeUnreachableBlocks(f);
+    std::vector<MIRInstruction*> worklist;
+
+    for (size_t b = 0; b < f->blocks.size(); b++) { //a slot only ever stored to is dead, and so are its stores and lifetime markers.
+        for (size_t i = 0; i < f->blocks[b]->instructions.size(); i++) {
+            MIRInstruction* instruction = f->blocks[b]->instructions[i];
+            instruction->mark = 0;
+
+            for (size_t o = writesSlot(instruction) ? 1 : 0; o < instruction->operands.size(); o++) {
+                if (isSlot(instruction->operands[o]))
+                    instruction->operands[o].instruction->mark |= MARK_READ;
+            }
+        }
+    }
+
+    for (size_t b = 0; b < f->blocks.size(); b++) {
+        for (size_t i = 0; i < f->blocks[b]->instructions.size(); i++) {
+            MIRInstruction* instruction = f->blocks[b]->instructions[i];
+
+            if (writesSlot(instruction) && isSlot(instruction->operands[0]) && !(instruction->operands[0].instruction->mark & MARK_READ))
+                continue;
+
+            if (hasSideEffects(instruction)) {
+                instruction->mark |= MARK_LIVE;
+                worklist.push_back(instruction);
+            }
+        }
+    }
+
+    while (!worklist.empty()) {
+        MIRInstruction* instruction = worklist.back();
+        worklist.pop_back();
+
+        for (size_t o = 0; o < instruction->operands.size(); o++) {
+            MIRInstruction* operand = instruction->operands[o].instruction;
+
+            if (operand != NULL && !(operand->mark & MARK_LIVE)) {
+                operand->mark |= MARK_LIVE;
+                worklist.push_back(operand);
+            }
+        }
+    }
+
+    for (size_t b = 0; b < f->blocks.size(); b++) {
+        for (size_t i = 0; i < f->blocks[b]->instructions.size(); i++) {
+            if (!(f->blocks[b]->instructions[i]->mark & MARK_LIVE))
+                f->blocks[b]->instructions[i]->removed = TRUE;
+        }
+    }
+
+    removeInstructions(f);
+}
@@ -0,0 +1,415 @@
+/*
+ * File:   MIRPrinting.cpp
+ * Author: Michael Goulet
+ * Implements: MidLevelIR.hpp
+ *
+ * Prints a mid-level IR function as LLVM IR, in the same shapes (and with the same names) as CodeEmitting.c.
+ */
+
+#include <stdio.h>
+#include "MidLevelIR.hpp"
+#include "CodeEmitting.h"
+#include "TypeSystem.h"
+
+#define PRINT(str, args...) fprintf(out, str , ##args)
+
+static LLVMValue getPrinted(const MIRValue& value) {
+    return value.instruction != NULL ? value.instruction->printed : value.value;
+}
+
+static void printOperand(FILE* out, const MIRValue& value) {
+    emitValue(out, getPrinted(value));
+}
+
+static LLVMValue newTemporary() {
+    LLVMValue l;
+    l.type = LVT_LOCAL_VALUE;
+    l.value = newUniqueIdentifier();
+    return l;
+}
+
+static void printResult(FILE* out, MIRInstruction* instruction) {
+    instruction->printed = newTemporary();
+    PRINT("    ");
+    emitValue(out, instruction->printed);
+    PRINT(" = ");
+}
+
+//a bitcast between object types, or nothing with opaque pointers.
+static LLVMValue printUpcast(FILE* out, LLVMValue value, CheshireType from, CheshireType to) {
+    if (usingOpaquePointers() || equalTypes(from, to))
+        return value;
+
+    LLVMValue l = newTemporary();
+    PRINT("    ");
+    emitValue(out, l);
+    PRINT(" = bitcast ");
+    emitType(out, from);
+    PRINT(" ");
+    emitValue(out, value);
+    PRINT(" to ");
+    emitType(out, to);
+    PRINT("\n");
+    return l;
+}
+
+static void printArguments(FILE* out, MIRInstruction* instruction, size_t first) {
+    for (size_t i = first; i < instruction->operands.size(); i++) {
+        emitType(out, instruction->argumentTypes[i - first]);
+        PRINT(" ");
+        printOperand(out, instruction->operands[i]);
+
+        if (i != instruction->operands.size() - 1)
+            PRINT(", ");
+    }
+}
+
+static void printCall(FILE* out, MIRInstruction* instruction) {
+    if (isVoid(instruction->type))
+        PRINT("    ");
+    else
+        printResult(out, instruction);
+
+    ExpressionNode* node = instruction->node; //an OP_OBJECT_CALL, when devirtualized.
+    PRINT("%scall fastcc ", getTailCallMarker(node->type == OP_OBJECT_CALL ? node->objectcall.tailCall : node->methodcall.tailCall));
+    emitFunctionType(out, instruction->operandType);
+    PRINT(" ");
+    printOperand(out, instruction->operands[0]);
+    PRINT("(");
+    printArguments(out, instruction, 1);
+    PRINT(")%s\n", getMemoryAttribute(getCallEffects(instruction->node)));
+}
+
+static void printObjectCall(FILE* out, MIRInstruction* instruction) {
+    CheshireType objectType = instruction->operandType;
+    CheshireType methodType = getClassVariable(objectType, instruction->text);
+    CheshireType selfType = getObjectSelfType(objectType, instruction->text);
+    LLVMValue object = getPrinted(instruction->operands[0]);
+    LLVMValue fnptr_ptr = emitMemberAddress(out, object, objectType, instruction->text), fnptr = newTemporary();
+    PRINT("    ");
+    emitValue(out, fnptr);
+    PRINT(" = load ");
+    emitType(out, methodType);
+    PRINT(", ");
+    emitPointerType(out, methodType);
+    PRINT(" ");
+    emitValue(out, fnptr_ptr);
+    PRINT("\n");
+    LLVMValue self = printUpcast(out, object, objectType, selfType);
+
+    if (isVoid(instruction->type))
+        PRINT("    ");
+    else
+        printResult(out, instruction);
+
+    PRINT("%scall fastcc ", getTailCallMarker(instruction->node->objectcall.tailCall));
+    emitFunctionType(out, methodType);
+    PRINT(" ");
+    emitValue(out, fnptr);
+    PRINT("(");
+    emitType(out, selfType);
+    PRINT(" ");
+    emitValue(out, self);
+
+    if (instruction->operands.size() > 1)
+        PRINT(", ");
+
+    printArguments(out, instruction, 1);
+    PRINT(")%s\n", getMemoryAttribute(getCallEffects(instruction->node)));
+}
+
+static void printNew(FILE* out, MIRInstruction* instruction) {
+    CheshireType type = instruction->type;
+    int arguments = 0;
+
+    if (instruction->node != NULL) { //constructed in its slot.
+        instruction->printed = getPrinted(instruction->operands[0]);
+        arguments = 1;
+    } else if (usingOpaquePointers()) {
+        instruction->printed = emitObjectAllocation(out, type);
+    } else {
+        LLVMValue mallocated = emitObjectAllocation(out, type);
+        instruction->printed = newTemporary();
+        PRINT("    ");
+        emitValue(out, instruction->printed);
+        PRINT(" = bitcast i8* ");
+        emitValue(out, mallocated);
+        PRINT(" to ");
+        emitType(out, type);
+        PRINT("\n");
+    }
+
+    if (equalTypes(type, TYPE_OBJECT))
+        declareRuntime(RUNTIME_NEW_OBJECT);
+
+    char* name = getNamedTypeString(type);
+    PRINT("    call fastcc void @_New_%s(", name);
+    free(name);
+    emitType(out, type);
+    PRINT(" ");
+    emitValue(out, instruction->printed);
+
+    if (instruction->operands.size() > (size_t) arguments)
+        PRINT(", ");
+
+    printArguments(out, instruction, arguments);
+    PRINT(")\n");
+}
+
+static void printIndex(FILE* out, MIRInstruction* instruction) {
+    LLVMValue array = newTemporary(), arrayderef = newTemporary();
+    PRINT("    ");
+    emitValue(out, array);
+    PRINT(" = getelementptr ");
+    emitStructType(out, instruction->operandType);
+    PRINT(", ");
+    emitType(out, instruction->operandType);
+    PRINT(" ");
+    printOperand(out, instruction->operands[0]);
+    PRINT(", i32 0, i32 1\n");
+    PRINT("    ");
+    emitValue(out, arrayderef);
+    PRINT(" = load ");
+    emitPointerType(out, instruction->type);
+    PRINT(", ");
+
+    if (usingOpaquePointers()) {
+        PRINT("ptr ");
+    } else {
+        emitType(out, instruction->type);
+        PRINT("** ");
+    }
+
+    emitValue(out, array);
+    PRINT("\n");
+    printResult(out, instruction);
+    PRINT("getelementptr ");
+    emitType(out, instruction->type);
+    PRINT(", ");
+    emitPointerType(out, instruction->type);
+    PRINT(" ");
+    emitValue(out, arrayderef);
+    PRINT(", i32 ");
+    printOperand(out, instruction->operands[1]);
+    PRINT("\n");
+}
+
+static void printLength(FILE* out, MIRInstruction* instruction) {
+    LLVMValue lptr = newTemporary();
+    PRINT("    ");
+    emitValue(out, lptr);
+    PRINT(" = getelementptr ");
+    emitStructType(out, instruction->operandType);
+    PRINT(", ");
+    emitType(out, instruction->operandType);
+    PRINT(" ");
+    printOperand(out, instruction->operands[0]);
+    PRINT(", i32 0, i32 0\n");
+    printResult(out, instruction);
+    PRINT("load i32, ");
+    emitNamedPointerType(out, "i32");
+    PRINT(" ");
+    emitValue(out, lptr);
+    PRINT("\n");
+}
+
+static Boolean isGlobalStorage(const MIRValue& value) {
+    return (Boolean) (value.instruction == NULL && (value.value.type == LVT_GLOBAL_VARIABLE || value.value.type == LVT_GLOBAL_METHOD));
+}
+
+//closures and strings are left to the syntax tree emitter, which finds captured names through the variable scope.
+static void printDelegated(FILE* out, MIRInstruction* instruction) {
+    raiseVariableScope();
+
+    if (instruction->opcode == MIR_MAKE_CLOSURE) {
+        UsingList* u = instruction->node->closure.usingList;
+
+        for (size_t i = 0; i < instruction->operands.size(); i++, u = u->next) {
+            MIRValue& operand = instruction->operands[i];
+
+            if (operand.instruction != NULL && operand.instruction->opcode == MIR_SLOT)
+                registerVariable(u->variable, getPrinted(operand));
+            else if (!isGlobalStorage(operand)) //globals are already in scope.
+                registerVariableValue(u->variable, getPrinted(operand));
+        }
+    }
+
+    instruction->printed = emitExpression(out, instruction->node);
+    fallVariableScope();
+}
+
+static void printInstruction(FILE* out, MIRInstruction* instruction) {
+    switch (instruction->opcode) {
+        case MIR_SLOT:
+            instruction->printed.type = LVT_LOCAL_VARIABLE;
+            instruction->printed.vardef.name = (char*) instruction->text;
+            instruction->printed.vardef.uid = newUniqueIdentifier();
+            PRINT("    ");
+            emitValue(out, instruction->printed);
+            PRINT(" = alloca ");
+            emitType(out, instruction->type);
+            PRINT("\n");
+            break;
+        case MIR_OBJECT_SLOT:
+            instruction->printed = emitStackObject(out, instruction->type);
+            break;
+        case MIR_LOAD:
+            printResult(out, instruction);
+            PRINT("load ");
+            emitType(out, instruction->type);
+            PRINT(", ");
+            emitPointerType(out, instruction->type);
+            PRINT(" ");
+            printOperand(out, instruction->operands[0]);
+            PRINT("\n");
+            break;
+        case MIR_STORE:
+            PRINT("    store ");
+            emitType(out, instruction->type);
+            PRINT(" ");
+            printOperand(out, instruction->operands[1]);
+            PRINT(", ");
+            emitPointerType(out, instruction->type);
+            PRINT(" ");
+            printOperand(out, instruction->operands[0]);
+            PRINT("\n");
+            break;
+        case MIR_LIFETIME_START:
+        case MIR_LIFETIME_END:
+            emitLifetimeMarker(out, (Boolean) (instruction->opcode == MIR_LIFETIME_START), getPrinted(instruction->operands[0]), instruction->type);
+            break;
+        case MIR_BINARY:
+            printResult(out, instruction);
+            PRINT("%s ", instruction->text);
+            emitType(out, instruction->operandType);
+            PRINT(" ");
+            printOperand(out, instruction->operands[0]);
+            PRINT(", ");
+            printOperand(out, instruction->operands[1]);
+            PRINT("\n");
+            break;
+        case MIR_CAST:
+            if (usingOpaquePointers() && !isNumericalType(instruction->type)) { //object casts do not change a ptr.
+                instruction->printed = getPrinted(instruction->operands[0]);
+                break;
+            }
+
+            printResult(out, instruction);
+            PRINT("%s ", instruction->text);
+            emitType(out, instruction->operandType);
+            PRINT(" ");
+            printOperand(out, instruction->operands[0]);
+            PRINT(" to ");
+            emitType(out, instruction->type);
+            PRINT("\n");
+            break;
+        case MIR_FIELD:
+            instruction->printed = emitMemberAddress(out, getPrinted(instruction->operands[0]), instruction->operandType, instruction->text);
+            break;
+        case MIR_INDEX:
+            printIndex(out, instruction);
+            break;
+        case MIR_LENGTH:
+            printLength(out, instruction);
+            break;
+        case MIR_TYPE_TEST: {
+            ExpressionNode* node = instruction->node;
+            CheshireType type = node->type == OP_INSTANCEOF ? node->instanceof.type : node->cast.type;
+            instruction->printed = emitTypeTest(out, getPrinted(instruction->operands[0]), instruction->operandType, type);
+        }
+        break;
+        case MIR_CALL:
+            printCall(out, instruction);
+            break;
+        case MIR_OBJECT_CALL:
+            printObjectCall(out, instruction);
+            break;
+        case MIR_NEW:
+            printNew(out, instruction);
+            break;
+        case MIR_DELETE:
+            emitDelete(out, getPrinted(instruction->operands[0]), instruction->type);
+            break;
+        case MIR_MAKE_CLOSURE:
+        case MIR_STRING:
+            printDelegated(out, instruction);
+            break;
+        case MIR_PHI:
+            printResult(out, instruction);
+            PRINT("phi ");
+            emitType(out, instruction->type);
+
+            for (size_t i = 0; i < instruction->operands.size(); i++) {
+                PRINT(i == 0 ? " [" : ", [");
+                printOperand(out, instruction->operands[i]);
+                PRINT(", %%label%d]", instruction->targets[i]->label);
+            }
+
+            PRINT("\n");
+            break;
+        case MIR_ASSERT:
+            declareRuntime(RUNTIME_ASSERT);
+            PRINT("    call fastcc void @_Assert(i1 ");
+            printOperand(out, instruction->operands[0]);
+            PRINT(")\n");
+            break;
+        case MIR_BRANCH:
+            PRINT("    br label %%label%d\n", instruction->targets[0]->label);
+            break;
+        case MIR_CONDITIONAL_BRANCH:
+            PRINT("    br i1 ");
+            printOperand(out, instruction->operands[0]);
+            PRINT(", label %%label%d, label %%label%d\n", instruction->targets[0]->label, instruction->targets[1]->label);
+            break;
+        case MIR_RETURN:
+            if (instruction->operands.empty()) {
+                PRINT("    ret void\n");
+                break;
+            }
+
+            PRINT("    ret ");
+            emitType(out, instruction->type);
+            PRINT(" ");
+            printOperand(out, instruction->operands[0]);
+            PRINT("\n");
+            break;
+    }
+}
+
+void printMIRFunction(FILE* out, MIRFunction* f, LLVMValue symbol, MemoryEffects effects) {
+    PRINT("define fastcc ");
+    emitType(out, f->returnType);
+    PRINT(" ");
+    emitValue(out, symbol);
+    PRINT("(");
+
+    for (ParameterList* p = f->params; p != NULL; p = p->next) {
+        LLVMValue param;
+        param.type = LVT_PARAMETER_VARIABLE;
+        param.name = p->name;
+        emitType(out, p->type);
+
+        if (symbol.type == LVT_CLASS_METHOD && p == f->params)
+            emitSelfAttributes(out, p->type);
+
+        PRINT(" ");
+        emitValue(out, param);
+
+        if (p->next != NULL)
+            PRINT(", ");
+    }
+
+    PRINT(")%s {\n", getFunctionAttributes(effects));
+
+    for (size_t b = 0; b < f->blocks.size(); b++) //labels first, branches and phis may refer forward.
+        f->blocks[b]->label = newUniqueIdentifier();
+
+    for (size_t b = 0; b < f->blocks.size(); b++) {
+        PRINT("label%d:\n", f->blocks[b]->label); //the entry block too, it can be a phi predecessor.
+
+        for (size_t i = 0; i < f->blocks[b]->instructions.size(); i++)
+            printInstruction(out, f->blocks[b]->instructions[i]);
+    }
+
+    PRINT("}\n\n");
+}
@@ -0,0 +1,98 @@
+/*
+ * File:   MemReport.cpp
+ * Author: Michael Goulet
+ * Implements: MemReport.h
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <unordered_map>
+#include <sys/resource.h>
+#include "MemReport.h"
+
+struct CategoryUsage {
+    uint64_t liveBytes, peakBytes;
+    uint64_t liveCount, peakCount;
+    uint64_t allocations;
+};
+
+struct Allocation {
+    size_t size;
+    MemCategory category;
+};
+
+static const char* categoryNames[MC_COUNT] = {
+    "expressionNodes", "statementNodes", "topNodes", "listNodes", "identifiers", "stringLiterals",
+    "namedObjects", "lambdaTypes", "keyedLambdas", "objectMapping", "classShapes", "emitterTemporaries",
+    "midLevelIR"
+};
+
+static Boolean enabled = FALSE;
+static CategoryUsage usage[MC_COUNT];
+static uint64_t liveBytes = 0, peakBytes = 0;
+static std::unordered_map<void*, Allocation>* allocations = NULL; //never freed, the type system's maps outlive main().
+
+void initMemReport() {
+    memset(usage, 0, sizeof(usage));
+    allocations = new std::unordered_map<void*, Allocation>;
+    enabled = TRUE;
+}
+
+void* memAlloc(MemCategory category, size_t size) {
+    void* ret = malloc(size);
+
+    if (!enabled || ret == NULL)
+        return ret;
+
+    Allocation allocation = {size, category};
+    (*allocations)[ret] = allocation;
+    CategoryUsage& u = usage[category];
+    u.allocations++;
+    u.liveBytes += size;
+    u.liveCount++;
+
+    if (u.liveBytes > u.peakBytes)
+        u.peakBytes = u.liveBytes;
+
+    if (u.liveCount > u.peakCount)
+        u.peakCount = u.liveCount;
+
+    liveBytes += size;
+
+    if (liveBytes > peakBytes)
+        peakBytes = liveBytes;
+
+    return ret;
+}
+
+void memFree(void* p) {
+    if (enabled && p != NULL) {
+        auto found = allocations->find(p);
+
+        if (found != allocations->end()) {
+            CategoryUsage& u = usage[found->second.category];
+            u.liveBytes -= found->second.size;
+            u.liveCount--;
+            liveBytes -= found->second.size;
+            allocations->erase(found);
+        }
+    }
+
+    free(p);
+}
+
+void writeMemReport(FILE* out) {
+    struct rusage self;
+    getrusage(RUSAGE_SELF, &self);
+    fprintf(out, "{\"peakRSSKiB\": %ld, \"liveBytes\": %llu, \"peakBytes\": %llu, \"categories\": {", self.ru_maxrss,
+            (unsigned long long) liveBytes, (unsigned long long) peakBytes);
+
+    for (int i = 0; i < MC_COUNT; i++) {
+        CategoryUsage& u = usage[i];
+        fprintf(out, "%s\n  \"%s\": {\"liveBytes\": %llu, \"peakBytes\": %llu, \"liveCount\": %llu, \"peakCount\": %llu, \"allocations\": %llu}",
+                i == 0 ? "" : ",", categoryNames[i], (unsigned long long) u.liveBytes, (unsigned long long) u.peakBytes,
+                (unsigned long long) u.liveCount, (unsigned long long) u.peakCount, (unsigned long long) u.allocations);
+    }
+
+    fprintf(out, "\n}}\n");
+}
@@ -0,0 +1,86 @@
+/*
+ * File:   MemReport.h
+ * Author: Michael Goulet
+ * Implementation: MemReport.cpp
+ *
+ * Memory accounting for -fmem-report. The compiler's own allocations go through memAlloc/memFree with a category,
+ * and at the end of a compile the live and peak bytes and object counts of each category (plus the process' peak RSS)
+ * are written out as JSON. Accounting is off unless initMemReport() was called, and then these are plain malloc/free.
+ */
+
+#ifndef MEMREPORT_H
+#define	MEMREPORT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "Structures.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    typedef enum {
+        MC_EXPRESSION_NODES, MC_STATEMENT_NODES, MC_TOP_NODES, MC_LIST_NODES, MC_IDENTIFIERS, MC_STRING_LITERALS,
+        MC_NAMED_OBJECTS, MC_LAMBDA_TYPES, MC_KEYED_LAMBDAS, MC_OBJECT_MAPPING, MC_CLASS_SHAPES, MC_EMITTER_TEMPORARIES,
+        MC_MID_LEVEL_IR, MC_COUNT
+    } MemCategory;
+
+    void initMemReport(void);
+    void* memAlloc(MemCategory, size_t);
+    void memFree(void*); //pointers not from memAlloc are simply freed.
+    void writeMemReport(FILE*);
+
+#ifdef	__cplusplus
+}
+
+//lets the type system's STL containers account their nodes and buckets.
+template<typename T, MemCategory C>
+class MemReportAllocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template<typename U>
+    struct rebind {
+        typedef MemReportAllocator<U, C> other;
+    };
+
+    MemReportAllocator() {
+    }
+
+    template<typename U>
+    MemReportAllocator(const MemReportAllocator<U, C>&) {
+    }
+
+    T* allocate(size_t n) {
+        T* ret = (T*) memAlloc(C, n * sizeof(T));
+
+        if (ret == NULL)
+            PANIC("Memory allocation error: ran out of memory!");
+
+        return ret;
+    }
+
+    void deallocate(T* p, size_t) {
+        memFree(p);
+    }
+
+    template<typename U>
+    bool operator==(const MemReportAllocator<U, C>&) const {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const MemReportAllocator<U, C>&) const {
+        return false;
+    }
+};
+#endif
+
+#endif	/* MEMREPORT_H */
+
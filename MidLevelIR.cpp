@@ -0,0 +1,853 @@
+/*
+ * File:   MidLevelIR.cpp
+ * Author: Michael Goulet
+ * Implements: MidLevelIR.h, MidLevelIR.hpp
+ *
+ * Lowers a typed method body into the mid-level IR, following the same shape as emitStatement/emitExpression.
+ */
+
+#include <string.h>
+#include <vector>
+#include "MidLevelIR.h"
+#include "MidLevelIR.hpp"
+#include "CodeEmitting.h"
+#include "TypeSystem.h"
+#include "TypeSystemUtilities.hpp"
+#include "Escape.h"
+
+typedef struct {
+    const char* name;
+    MIRValue value; //a slot, or the value itself of a name that is never assigned.
+    Boolean direct;
+} MIRBinding;
+
+static Boolean midLevelIR = FALSE;
+static MIRFunction* function = NULL;
+static MIRBlock* current = NULL;
+static size_t entrySlots = 0; //slots are kept at the front of the entry block.
+static Boolean unsupported = FALSE;
+static std::vector<MIRBinding> bindings;
+static std::vector<size_t> bindingScopes;
+
+static MIRValue lowerExpression(ExpressionNode*);
+static void lowerStatement(StatementNode*);
+
+void setMidLevelIR(Boolean enabled) {
+    midLevelIR = enabled;
+}
+
+Boolean usingMidLevelIR() {
+    return midLevelIR;
+}
+
+//////////////// INSTRUCTIONS /////////////////
+
+Boolean isTerminator(MIRInstruction* instruction) {
+    switch (instruction->opcode) {
+        case MIR_BRANCH:
+        case MIR_CONDITIONAL_BRANCH:
+        case MIR_RETURN:
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+Boolean hasSideEffects(MIRInstruction* instruction) {
+    switch (instruction->opcode) {
+        case MIR_STORE:
+        case MIR_LIFETIME_START:
+        case MIR_LIFETIME_END:
+        case MIR_CALL:
+        case MIR_OBJECT_CALL:
+        case MIR_NEW: //runs a constructor.
+        case MIR_DELETE:
+        case MIR_ASSERT:
+            return TRUE;
+        default:
+            return isTerminator(instruction);
+    }
+}
+
+Boolean equalMIRValues(const MIRValue& left, const MIRValue& right) {
+    CStrEql streql;
+
+    if (left.instruction != NULL || right.instruction != NULL)
+        return left.instruction == right.instruction ? TRUE : FALSE;
+
+    if (left.value.type != right.value.type)
+        return FALSE;
+
+    switch (left.value.type) {
+        case LVT_GLOBAL_VARIABLE:
+        case LVT_GLOBAL_METHOD:
+        case LVT_PARAMETER_VARIABLE:
+        case LVT_METHOD_EXPORT:
+            return streql(left.value.name, right.value.name) ? TRUE : FALSE;
+        case LVT_LOCAL_VARIABLE:
+            return left.value.vardef.uid == right.value.vardef.uid && streql(left.value.vardef.name, right.value.vardef.name) ? TRUE : FALSE;
+        case LVT_CLASS_METHOD:
+            return streql(left.value.classmethod.classname, right.value.classmethod.classname) && streql(left.value.classmethod.methodname, right.value.classmethod.methodname) ? TRUE : FALSE;
+        case LVT_DOUBLE_LITERAL:
+            return memcmp(&left.value.decimal, &right.value.decimal, sizeof(double)) == 0 ? TRUE : FALSE;
+        case LVT_VOID:
+        case LVT_NULL:
+            return TRUE;
+        default:
+            return left.value.value == right.value.value ? TRUE : FALSE;
+    }
+}
+
+void deleteMIRFunction(MIRFunction* f) {
+    for (size_t b = 0; b < f->blocks.size(); b++) {
+        for (size_t i = 0; i < f->blocks[b]->instructions.size(); i++)
+            delete f->blocks[b]->instructions[i];
+
+        delete f->blocks[b];
+    }
+
+    delete f;
+}
+
+static MIRValue getConstant(LLVMValue value) {
+    MIRValue v;
+    v.instruction = NULL;
+    v.value = value;
+    return v;
+}
+
+static MIRValue getIntegerConstant(int64_t literal) {
+    LLVMValue l;
+    l.type = LVT_INT_LITERAL;
+    l.value = literal;
+    return getConstant(l);
+}
+
+static MIRValue getDecimalConstant(double literal) {
+    LLVMValue l;
+    l.type = LVT_DOUBLE_LITERAL;
+    l.decimal = literal;
+    return getConstant(l);
+}
+
+static MIRValue getNullConstant() {
+    LLVMValue l;
+    l.type = LVT_NULL;
+    return getConstant(l);
+}
+
+static MIRValue getResult(MIRInstruction* instruction) {
+    MIRValue v;
+    v.instruction = instruction;
+    v.value.type = LVT_VOID;
+    return v;
+}
+
+static MIRBlock* createBlock() {
+    MIRBlock* block = new MIRBlock();
+    block->label = -1;
+    block->mark = 0;
+    return block;
+}
+
+static void startBlock(MIRBlock* block) {
+    function->blocks.push_back(block);
+    current = block;
+}
+
+static MIRInstruction* createInstruction(MIROpcode opcode, CheshireType type) {
+    MIRInstruction* instruction = new MIRInstruction();
+    instruction->opcode = opcode;
+    instruction->type = type;
+    instruction->operandType = TYPE_VOID;
+    instruction->text = NULL;
+    instruction->node = NULL;
+    instruction->printed.type = LVT_VOID;
+    instruction->removed = FALSE;
+    instruction->mark = 0;
+    return instruction;
+}
+
+static MIRInstruction* append(MIRInstruction* instruction) {
+    if (!current->instructions.empty() && isTerminator(current->instructions.back()))
+        startBlock(createBlock()); //code after a return is unreachable, but still needs a block.
+
+    current->instructions.push_back(instruction);
+    return instruction;
+}
+
+static MIRValue appendLoad(MIRValue address, CheshireType type) {
+    MIRInstruction* load = createInstruction(MIR_LOAD, type);
+    load->operands.push_back(address);
+    return getResult(append(load));
+}
+
+static void appendStore(MIRValue address, MIRValue value, CheshireType type) {
+    MIRInstruction* store = createInstruction(MIR_STORE, type);
+    store->operands.push_back(address);
+    store->operands.push_back(value);
+    append(store);
+}
+
+static MIRValue appendBinary(const char* opcode, CheshireType type, CheshireType operandType, MIRValue left, MIRValue right) {
+    MIRInstruction* binary = createInstruction(MIR_BINARY, type);
+    binary->text = opcode;
+    binary->operandType = operandType;
+    binary->operands.push_back(left);
+    binary->operands.push_back(right);
+    return getResult(append(binary));
+}
+
+static MIRValue appendCast(const char* opcode, CheshireType from, CheshireType to, MIRValue value) {
+    MIRInstruction* cast = createInstruction(MIR_CAST, to);
+    cast->text = opcode;
+    cast->operandType = from;
+    cast->operands.push_back(value);
+    return getResult(append(cast));
+}
+
+static void appendBranch(MIRBlock* target) {
+    MIRInstruction* branch = createInstruction(MIR_BRANCH, TYPE_VOID);
+    branch->targets.push_back(target);
+    append(branch);
+}
+
+static void appendLifetime(MIROpcode opcode, MIRValue slot) {
+    MIRInstruction* marker = createInstruction(opcode, slot.instruction->type);
+    marker->operands.push_back(slot);
+    append(marker);
+}
+
+static void appendConditionalBranch(MIRValue condition, MIRBlock* iftrue, MIRBlock* iffalse) {
+    MIRInstruction* branch = createInstruction(MIR_CONDITIONAL_BRANCH, TYPE_BOOLEAN);
+    branch->operands.push_back(condition);
+    branch->targets.push_back(iftrue);
+    branch->targets.push_back(iffalse);
+    append(branch);
+}
+
+static MIRValue appendPhi(CheshireType type, MIRValue first, MIRBlock* firstBlock, MIRValue second, MIRBlock* secondBlock) {
+    MIRInstruction* phi = createInstruction(MIR_PHI, type);
+    phi->operands.push_back(first);
+    phi->targets.push_back(firstBlock);
+    phi->operands.push_back(second);
+    phi->targets.push_back(secondBlock);
+    return getResult(append(phi));
+}
+
+static MIRValue appendSlot(const char* name, CheshireType type) {
+    MIRInstruction* slot = createInstruction(MIR_SLOT, type);
+    slot->text = name;
+    MIRVector<MIRInstruction*>& entry = function->blocks.front()->instructions;
+    entry.insert(entry.begin() + entrySlots, slot); //so a slot in a loop is not allocated on every iteration.
+    entrySlots++;
+    return getResult(slot);
+}
+
+static MIRValue appendObjectSlot(ExpressionNode* instantiation) {
+    MIRInstruction* slot = createInstruction(MIR_OBJECT_SLOT, instantiation->instantiate.type);
+    slot->node = instantiation;
+    MIRVector<MIRInstruction*>& entry = function->blocks.front()->instructions;
+    entry.insert(entry.begin() + entrySlots, slot);
+    entrySlots++;
+    return getResult(slot);
+}
+
+//////////////// BINDINGS /////////////////
+
+static void raiseBindingScope() {
+    bindingScopes.push_back(bindings.size());
+}
+
+static void fallBindingScope() {
+    bindings.resize(bindingScopes.back());
+    bindingScopes.pop_back();
+}
+
+static void fallLocalScope() { //the slots of the scope's locals are dead from here on.
+    for (size_t i = bindings.size(); i > bindingScopes.back(); i--) {
+        if (!bindings[i - 1].direct)
+            appendLifetime(MIR_LIFETIME_END, bindings[i - 1].value);
+    }
+
+    fallBindingScope();
+}
+
+static void bindVariable(const char* name, MIRValue value, Boolean direct) {
+    MIRBinding binding = {name, value, direct};
+    bindings.push_back(binding);
+}
+
+static MIRBinding resolveVariable(char* name) {
+    CStrEql streql;
+
+    for (size_t i = bindings.size(); i > 0; i--) { //innermost first.
+        if (streql(bindings[i - 1].name, name))
+            return bindings[i - 1];
+    }
+
+    MIRBinding global = {name, getConstant(fetchVariable(name)), FALSE}; //globals and methods, from forwardDefinition.
+    return global;
+}
+
+//////////////// EXPRESSIONS /////////////////
+
+static const char* getComparison(OperationType type, Boolean decimal) {
+    switch (type) {
+        case OP_EQUALS:
+            return decimal ? "fcmp oeq" : "icmp eq";
+        case OP_NOT_EQUALS:
+            return decimal ? "fcmp une" : "icmp ne";
+        case OP_GRE_EQUALS:
+            return decimal ? "fcmp oge" : "icmp sge";
+        case OP_LES_EQUALS:
+            return decimal ? "fcmp ole" : "icmp sle";
+        case OP_GREATER:
+            return decimal ? "fcmp ogt" : "icmp sgt";
+        case OP_LESS:
+            return decimal ? "fcmp olt" : "icmp slt";
+        default:
+            PANIC("Fatal error in lowering a comparison!");
+    }
+}
+
+static const char* getArithmetic(OperationType type, Boolean decimal) {
+    switch (type) {
+        case OP_PLUS:
+            return decimal ? "fadd" : "add";
+        case OP_MINUS:
+            return decimal ? "fsub" : "sub";
+        case OP_MULT:
+            return decimal ? "fmul" : "mul";
+        case OP_DIV:
+            return decimal ? "fdiv" : "sdiv";
+        case OP_MOD:
+            return decimal ? "frem" : "srem";
+        default:
+            PANIC("Fatal error in lowering arithmetic!");
+    }
+}
+
+static void lowerArguments(MIRInstruction* instruction, ExpressionList* params) {
+    for (ExpressionList* e = params; e != NULL; e = e->next) {
+        instruction->operands.push_back(lowerExpression(e->parameter));
+        instruction->argumentTypes.push_back(e->parameter->determinedType);
+    }
+}
+
+static MIRValue lowerCallee(ExpressionNode* callback) { //a global method is called through its @_MethodImpl_, not a load.
+    if (callback->type == OP_DEREFERENCE && callback->unaryChild->type == OP_VARIABLE) {
+        MIRBinding binding = resolveVariable(callback->unaryChild->string);
+
+        if (binding.value.instruction == NULL && binding.value.value.type == LVT_GLOBAL_METHOD)
+            return getConstant(getMethodExport(binding.value.value.name));
+    }
+
+    return lowerExpression(callback);
+}
+
+static MIRValue lowerIncrement(ExpressionNode* node, Boolean increment) {
+    MIRValue address = lowerExpression(node->unaryChild);
+    MIRValue old = appendLoad(address, node->determinedType);
+    Boolean decimal = isDecimal(node->unaryChild->determinedType);
+    const char* opcode = increment ? (decimal ? "fadd" : "add") : (decimal ? "fsub" : "sub");
+    MIRValue one = decimal ? getDecimalConstant(1) : getIntegerConstant(1);
+    MIRValue updated = appendBinary(opcode, node->determinedType, node->determinedType, old, one);
+    appendStore(address, updated, node->unaryChild->determinedType);
+    return old;
+}
+
+static MIRValue lowerShortCircuit(ExpressionNode* node, Boolean isAnd) {
+    MIRValue first = lowerExpression(node->binary.left);
+    MIRBlock* entered = current; //nested conditions may have moved on.
+    MIRBlock* calculate = createBlock();
+    MIRBlock* skip = createBlock();
+
+    if (isAnd)
+        appendConditionalBranch(first, calculate, skip);
+    else
+        appendConditionalBranch(first, skip, calculate);
+
+    startBlock(calculate);
+    MIRValue second = lowerExpression(node->binary.right);
+    MIRBlock* calculated = current;
+    appendBranch(skip);
+    startBlock(skip);
+    return appendPhi(node->determinedType, getIntegerConstant(isAnd ? 0 : 1), entered, second, calculated);
+}
+
+//the type test of an object that may be null, which is ifNull.
+static MIRValue lowerTypeTest(ExpressionNode* node, MIRValue object, CheshireType from, Boolean ifNull) {
+    MIRBlock* check = createBlock();
+    MIRBlock* exit = createBlock();
+    appendConditionalBranch(appendBinary("icmp eq", TYPE_BOOLEAN, from, object, getNullConstant()), exit, check);
+    MIRBlock* entered = current;
+    startBlock(check);
+    MIRInstruction* test = createInstruction(MIR_TYPE_TEST, TYPE_BOOLEAN);
+    test->operandType = from;
+    test->node = node;
+    test->operands.push_back(object);
+    MIRValue result = getResult(append(test));
+    appendBranch(exit);
+    startBlock(exit);
+    return appendPhi(TYPE_BOOLEAN, getIntegerConstant(ifNull ? 1 : 0), entered, result, check);
+}
+
+static MIRValue lowerCast(ExpressionNode* node) {
+    MIRValue child = lowerExpression(node->cast.child);
+    CheshireType from = node->cast.child->determinedType, to = node->cast.type;
+
+    if (!isNumericalType(to)) {
+        if (isCheckedCast(from, to)) { //a downcast asserts the type, null passes.
+            MIRInstruction* assertion = createInstruction(MIR_ASSERT, TYPE_BOOLEAN);
+            assertion->operands.push_back(lowerTypeTest(node, child, from, TRUE));
+            append(assertion);
+        }
+
+        return appendCast("bitcast", from, to, child); //printed as nothing with opaque pointers.
+    }
+
+    if (equalTypes(to, from))
+        return child;
+
+    if (to.typeKey > from.typeKey)
+        return appendCast(isDecimal(to) ? "sitofp" : "sext", from, to, child);
+
+    return appendCast(isDecimal(from) ? "fptosi" : "trunc", from, to, child);
+}
+
+//a direct MIR_CALL of each target, all but the last guarded by comparing it with the method in the object's vtable.
+static MIRValue lowerDevirtualizedCall(ExpressionNode* node) {
+    CheshireType objectType = node->objectcall.object->determinedType;
+    CheshireType methodType = getClassVariable(objectType, node->objectcall.method);
+    int targets = getCallTargetCount(node);
+    MIRValue object = lowerExpression(node->objectcall.object), fnptr;
+
+    if (targets > 1) {
+        MIRInstruction* field = createInstruction(MIR_FIELD, methodType);
+        field->operandType = objectType;
+        field->text = node->objectcall.method;
+        field->operands.push_back(object);
+        fnptr = appendLoad(getResult(append(field)), methodType);
+    }
+
+    MIRVector<MIRValue> arguments;
+    MIRVector<CheshireType> argumentTypes;
+
+    for (ExpressionList* e = node->objectcall.params; e != NULL; e = e->next) {
+        arguments.push_back(lowerExpression(e->parameter));
+        argumentTypes.push_back(e->parameter->determinedType);
+    }
+
+    MIRBlock* exit = targets > 1 ? createBlock() : NULL;
+    MIRInstruction* phi = createInstruction(MIR_PHI, node->determinedType);
+    MIRValue result;
+
+    for (int i = 0; i < targets; i++) {
+        CheshireType definer;
+        ClassList* method = getCallTarget(node, i, &definer);
+        CheshireType type = getLambdaType(method->method.returnType, method->method.params);
+        MIRBlock* next = NULL;
+        LLVMValue target;
+        target.type = LVT_CLASS_METHOD;
+        target.classmethod.classname = getClassNameReference(definer);
+        target.classmethod.methodname = method->method.name;
+
+        if (i != targets - 1) {
+            MIRBlock* guarded = createBlock();
+            next = createBlock();
+            MIRValue expected = equalTypes(type, methodType) ? getConstant(target) : appendCast("bitcast", type, methodType, getConstant(target));
+            appendConditionalBranch(appendBinary("icmp eq", TYPE_BOOLEAN, methodType, fnptr, expected), guarded, next);
+            startBlock(guarded);
+        }
+
+        MIRInstruction* call = createInstruction(MIR_CALL, node->determinedType);
+        call->operandType = type;
+        call->node = node;
+        call->operands.push_back(getConstant(target));
+        call->operands.push_back(appendCast("bitcast", objectType, definer, object));
+        call->argumentTypes.push_back(definer);
+        call->operands.insert(call->operands.end(), arguments.begin(), arguments.end());
+        call->argumentTypes.insert(call->argumentTypes.end(), argumentTypes.begin(), argumentTypes.end());
+        result = getResult(append(call));
+
+        if (targets > 1) {
+            phi->operands.push_back(result);
+            phi->targets.push_back(current);
+            appendBranch(exit);
+        }
+
+        if (next != NULL)
+            startBlock(next);
+    }
+
+    if (targets == 1 || isVoid(node->determinedType)) {
+        delete phi;
+
+        if (exit != NULL)
+            startBlock(exit);
+
+        return result;
+    }
+
+    startBlock(exit);
+    return getResult(append(phi));
+}
+
+static MIRValue lowerExpression(ExpressionNode* node) {
+    switch (node->type) {
+        case OP_LONG_INTEGER:
+        case OP_INTEGER:
+            return getIntegerConstant(node->integer);
+        case OP_DECIMAL:
+            return getDecimalConstant(node->decimal);
+        case OP_CHAR:
+            return getIntegerConstant(node->character);
+        case OP_RESERVED_LITERAL:
+            if (node->reserved == RL_NULL)
+                return getNullConstant();
+
+            return getIntegerConstant(node->reserved == RL_TRUE ? 1 : 0);
+        case OP_VARIABLE: { //an lval, reads are under an OP_DEREFERENCE.
+            MIRBinding binding = resolveVariable(node->string);
+            ERROR_IF(binding.direct, "Fatal error: %s is never assigned, yet has no slot!", node->string);
+            return binding.value;
+        }
+        case OP_DEREFERENCE:
+            if (node->unaryChild->type == OP_VARIABLE) {
+                MIRBinding binding = resolveVariable(node->unaryChild->string);
+
+                if (binding.direct)
+                    return binding.value;
+            }
+
+            return appendLoad(lowerExpression(node->unaryChild), node->determinedType);
+        case OP_NOT:
+        case OP_COMPL:
+            return appendBinary("xor", node->determinedType, node->determinedType, lowerExpression(node->unaryChild), getIntegerConstant(-1));
+        case OP_UNARY_MINUS: {
+            MIRValue child = lowerExpression(node->unaryChild);
+
+            if (isDecimal(node->determinedType))
+                return appendBinary("fsub", node->determinedType, node->determinedType, getDecimalConstant(0), child);
+
+            return appendBinary("sub", node->determinedType, node->determinedType, getIntegerConstant(0), child);
+        }
+        case OP_PLUSONE:
+            return lowerIncrement(node, TRUE);
+        case OP_MINUSONE:
+            return lowerIncrement(node, FALSE);
+        case OP_EQUALS:
+        case OP_NOT_EQUALS:
+        case OP_GRE_EQUALS:
+        case OP_LES_EQUALS:
+        case OP_GREATER:
+        case OP_LESS: {
+            MIRValue left = lowerExpression(node->binary.left), right = lowerExpression(node->binary.right);
+            CheshireType type = node->binary.left->determinedType;
+            return appendBinary(getComparison(node->type, isDecimal(type)), node->determinedType, type, left, right);
+        }
+        case OP_AND:
+            return lowerShortCircuit(node, TRUE);
+        case OP_OR:
+            return lowerShortCircuit(node, FALSE);
+        case OP_PLUS:
+        case OP_MINUS:
+        case OP_MULT:
+        case OP_DIV:
+        case OP_MOD: {
+            MIRValue left = lowerExpression(node->binary.left), right = lowerExpression(node->binary.right);
+            const char* opcode = getArithmetic(node->type, isDecimal(node->binary.left->determinedType));
+            return appendBinary(opcode, node->determinedType, node->determinedType, left, right);
+        }
+        case OP_SET: {
+            MIRValue address = lowerExpression(node->binary.left), value = lowerExpression(node->binary.right);
+            appendStore(address, value, node->binary.left->determinedType);
+            return value;
+        }
+        case OP_CAST:
+            return lowerCast(node);
+        case OP_METHOD_CALL: {
+            MIRInstruction* call = createInstruction(MIR_CALL, node->determinedType);
+            call->operandType = node->methodcall.callback->determinedType;
+            call->node = node;
+            call->operands.push_back(lowerCallee(node->methodcall.callback));
+            lowerArguments(call, node->methodcall.params);
+            return getResult(append(call));
+        }
+        case OP_OBJECT_CALL: {
+            if (getCallTargetCount(node) != 0)
+                return lowerDevirtualizedCall(node);
+
+            MIRInstruction* call = createInstruction(MIR_OBJECT_CALL, node->determinedType);
+            call->operandType = node->objectcall.object->determinedType;
+            call->node = node;
+            call->text = node->objectcall.method;
+            call->operands.push_back(lowerExpression(node->objectcall.object));
+            lowerArguments(call, node->objectcall.params);
+            return getResult(append(call));
+        }
+        case OP_INSTANTIATION: {
+            MIRInstruction* instantiation = createInstruction(MIR_NEW, node->instantiate.type);
+
+            if (isStackAllocated(node)) {
+                instantiation->node = node;
+                instantiation->operands.push_back(appendObjectSlot(node));
+            }
+
+            lowerArguments(instantiation, node->instantiate.params);
+            return getResult(append(instantiation));
+        }
+        case OP_ACCESS: {
+            MIRInstruction* field = createInstruction(MIR_FIELD, node->determinedType);
+            field->operandType = node->access.expression->determinedType;
+            field->text = node->access.variable;
+            field->operands.push_back(lowerExpression(node->access.expression));
+            return getResult(append(field));
+        }
+        case OP_ARRAY_ACCESS: {
+            MIRInstruction* index = createInstruction(MIR_INDEX, node->determinedType);
+            index->operandType = node->binary.left->determinedType;
+            index->operands.push_back(lowerExpression(node->binary.left));
+            index->operands.push_back(lowerExpression(node->binary.right));
+            return getResult(append(index));
+        }
+        case OP_LENGTH: {
+            MIRInstruction* length = createInstruction(MIR_LENGTH, TYPE_INT);
+            length->operandType = node->unaryChild->determinedType;
+            length->operands.push_back(lowerExpression(node->unaryChild));
+            return getResult(append(length));
+        }
+        case OP_CHOOSE: {
+            MIRValue condition = lowerExpression(node->choose.condition);
+            MIRBlock* iftrue = createBlock();
+            MIRBlock* iffalse = createBlock();
+            MIRBlock* exit = createBlock();
+            appendConditionalBranch(condition, iftrue, iffalse);
+            startBlock(iftrue);
+            MIRValue truevalue = lowerExpression(node->choose.iftrue);
+            MIRBlock* truelabel = current;
+            appendBranch(exit);
+            startBlock(iffalse);
+            MIRValue falsevalue = lowerExpression(node->choose.iffalse);
+            MIRBlock* falselabel = current;
+            appendBranch(exit);
+            startBlock(exit);
+            return appendPhi(node->choose.iffalse->determinedType, truevalue, truelabel, falsevalue, falselabel);
+        }
+        case OP_STRING: {
+            MIRInstruction* string = createInstruction(MIR_STRING, node->determinedType);
+            string->node = node;
+            return getResult(append(string));
+        }
+        case OP_CLOSURE: { //the body stays with the syntax tree emitter, only the captures are read here.
+            MIRInstruction* closure = createInstruction(MIR_MAKE_CLOSURE, node->determinedType);
+            closure->node = node;
+
+            for (UsingList* u = node->closure.usingList; u != NULL; u = u->next)
+                closure->operands.push_back(resolveVariable(u->variable).value);
+
+            return getResult(append(closure));
+        }
+        case OP_INSTANCEOF: {
+            CheshireType from = node->instanceof.expression->determinedType;
+            MIRValue object = lowerExpression(node->instanceof.expression);
+
+            if (isNull(from))
+                return getIntegerConstant(0);
+
+            if (isCheckedCast(from, node->instanceof.type))
+                return lowerTypeTest(node, object, from, FALSE);
+
+            return appendBinary("icmp ne", TYPE_BOOLEAN, from, object, getNullConstant()); //an upcast.
+        }
+        case OP_LAMBDA:
+        case OP_NOP:
+            break;
+    }
+
+    unsupported = TRUE;
+    return getNullConstant();
+}
+
+//////////////// STATEMENTS /////////////////
+
+static void lowerBlock(BlockList* list) {
+    raiseBindingScope();
+
+    for (; list != NULL; list = list->next)
+        lowerStatement(list->statement);
+
+    fallLocalScope();
+}
+
+static void lowerScopedStatement(StatementNode* node) {
+    raiseBindingScope();
+    lowerStatement(node);
+    fallLocalScope();
+}
+
+static void lowerStatement(StatementNode* node) {
+    switch (node->type) {
+        case S_NOP:
+            break;
+        case S_VARIABLE_DEF:
+        case S_INFER_DEF: {
+            MIRValue value = lowerExpression(node->varDefinition.value);
+
+            if (!node->varDefinition.assigned) {
+                bindVariable(node->varDefinition.variable, value, TRUE);
+                break;
+            }
+
+            MIRValue slot = appendSlot(node->varDefinition.variable, node->varDefinition.type);
+            appendLifetime(MIR_LIFETIME_START, slot);
+            appendStore(slot, value, node->varDefinition.type);
+            bindVariable(node->varDefinition.variable, slot, FALSE);
+        }
+        break;
+        case S_EXPRESSION:
+            lowerExpression(node->expression);
+            break;
+        case S_ASSERT: {
+            MIRInstruction* assertion = createInstruction(MIR_ASSERT, TYPE_BOOLEAN);
+            assertion->operands.push_back(lowerExpression(node->expression));
+            append(assertion);
+        }
+        break;
+        case S_DELETE: { //of null does nothing.
+            CheshireType type = node->expression->determinedType;
+            MIRValue object = lowerExpression(node->expression);
+            MIRBlock* nonnull = createBlock();
+            MIRBlock* exit = createBlock();
+            appendConditionalBranch(appendBinary("icmp eq", TYPE_BOOLEAN, type, object, getNullConstant()), exit, nonnull);
+            startBlock(nonnull);
+            MIRInstruction* deletion = createInstruction(MIR_DELETE, type);
+            deletion->operands.push_back(object);
+            append(deletion);
+            appendBranch(exit);
+            startBlock(exit);
+        }
+        break;
+        case S_BLOCK:
+            lowerBlock(node->block);
+            break;
+        case S_IF: {
+            MIRValue condition = lowerExpression(node->conditional.condition);
+            MIRBlock* iftrue = createBlock();
+            MIRBlock* exit = createBlock();
+            appendConditionalBranch(condition, iftrue, exit);
+            startBlock(iftrue);
+            lowerScopedStatement(node->conditional.block);
+            appendBranch(exit);
+            startBlock(exit);
+        }
+        break;
+        case S_IF_ELSE: {
+            MIRValue condition = lowerExpression(node->conditional.condition);
+            MIRBlock* iftrue = createBlock();
+            MIRBlock* iffalse = createBlock();
+            MIRBlock* exit = createBlock();
+            appendConditionalBranch(condition, iftrue, iffalse);
+            startBlock(iftrue);
+            lowerScopedStatement(node->conditional.block);
+            appendBranch(exit);
+            startBlock(iffalse);
+            lowerScopedStatement(node->conditional.elseBlock);
+            appendBranch(exit);
+            startBlock(exit);
+        }
+        break;
+        case S_WHILE: {
+            MIRBlock* begin = createBlock();
+            MIRBlock* body = createBlock();
+            MIRBlock* exit = createBlock();
+            appendBranch(begin);
+            startBlock(begin);
+            appendConditionalBranch(lowerExpression(node->conditional.condition), body, exit);
+            startBlock(body);
+            lowerScopedStatement(node->conditional.block);
+            appendBranch(begin);
+            startBlock(exit);
+        }
+        break;
+        case S_RETURN: {
+            MIRInstruction* ret = createInstruction(MIR_RETURN, node->expression->determinedType);
+
+            if (!isNull(node->expression->determinedType))
+                ret->operands.push_back(lowerExpression(node->expression));
+
+            append(ret);
+        }
+        break;
+    }
+}
+
+static MIRValue getDefaultReturnValue(CheshireType type) {
+    if (isDecimal(type))
+        return getDecimalConstant(0);
+    else if (isBoolean(type) || isNumericalType(type))
+        return getIntegerConstant(0);
+
+    return getNullConstant();
+}
+
+static MIRFunction* lowerMethod(CheshireType returnType, ParameterList* params, BlockList* body) {
+    function = new MIRFunction();
+    function->returnType = returnType;
+    function->params = params;
+    entrySlots = 0;
+    unsupported = FALSE;
+    startBlock(createBlock());
+    raiseBindingScope();
+
+    for (ParameterList* p = params; p != NULL; p = p->next) {
+        LLVMValue param;
+        param.type = LVT_PARAMETER_VARIABLE;
+        param.name = p->name;
+
+        if (!p->assigned) {
+            bindVariable(p->name, getConstant(param), TRUE);
+            continue;
+        }
+
+        MIRValue slot = appendSlot(p->name, p->type);
+        appendStore(slot, getConstant(param), p->type);
+        bindVariable(p->name, slot, FALSE);
+    }
+
+    lowerBlock(body);
+    fallBindingScope();
+
+    if (current->instructions.empty() || !isTerminator(current->instructions.back())) { //implicit, fallthrough return.
+        MIRInstruction* ret = createInstruction(MIR_RETURN, returnType);
+
+        if (!isVoid(returnType))
+            ret->operands.push_back(getDefaultReturnValue(returnType));
+
+        append(ret);
+    }
+
+    MIRFunction* lowered = function;
+    function = NULL;
+    current = NULL;
+
+    if (unsupported) {
+        deleteMIRFunction(lowered);
+        return NULL;
+    }
+
+    return lowered;
+}
+
+Boolean emitMethodMIR(FILE* out, LLVMValue symbol, MemoryEffects effects, CheshireType returnType, ParameterList* params, BlockList* body) {
+    MIRFunction* lowered = lowerMethod(returnType, params, body);
+
+    if (lowered == NULL)
+        return FALSE;
+
+    runMIRPasses(lowered);
+    printMIRFunction(out, lowered, symbol, effects);
+    deleteMIRFunction(lowered);
+    return TRUE;
+}
@@ -0,0 +1,34 @@
+/*
+ * File:   MidLevelIR.h
+ * Author: Michael Goulet
+ * Implementation: MidLevelIR.cpp, MIRPasses.cpp, MIRPrinting.cpp
+ *
+ * With -fmir, the text emitter lowers method bodies into a typed SSA mid-level IR (MidLevelIR.hpp), runs its pass
+ * pipeline over them and prints the result as LLVM IR, instead of printing straight from the syntax tree.
+ */
+
+#ifndef MIDLEVELIR_H
+#define	MIDLEVELIR_H
+
+#include <stdio.h>
+#include "Structures.h"
+#include "Purity.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    void setMidLevelIR(Boolean);
+    Boolean usingMidLevelIR(void);
+    void setMIRPasses(const char* pipeline); //comma separated, e.g. "cse,dce". PANICs on an unknown pass.
+
+    //prints "define fastcc ... symbol(params) { ... }", or prints nothing and returns FALSE if the body uses a construct
+    //the IR cannot express yet, so the syntax tree emitter can take over.
+    Boolean emitMethodMIR(FILE*, LLVMValue symbol, MemoryEffects, CheshireType returnType, ParameterList*, BlockList* body);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* MIDLEVELIR_H */
+
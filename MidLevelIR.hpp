@@ -0,0 +1,114 @@
+/*
+ * File:   MidLevelIR.hpp
+ * Author: Michael Goulet
+ * Implementation: MidLevelIR.cpp, MIRPasses.cpp, MIRPrinting.cpp
+ *
+ * The mid-level IR: a method body as a list of basic blocks, each a list of typed SSA instructions ending in a
+ * terminator. Names that are never assigned are bound to their values; the others live in MIR_SLOT stack slots and are
+ * read and written with MIR_LOAD/MIR_STORE, like the syntax tree emitter's allocas, so no phi construction is needed
+ * for them; phis only join the arms of &&, || and ?:.
+ * Unlike LLVM, the instructions still know what they mean in Cheshire: a field or array element address, an object
+ * call through its method slot, an instantiation, a closure, so passes can use facts LLVM cannot see (slots never
+ * escape, array lengths and @_M_ constants never change).
+ */
+
+#ifndef MIDLEVELIR_HPP
+#define	MIDLEVELIR_HPP
+
+#include <stdio.h>
+#include <vector>
+#include "Structures.h"
+#include "MemReport.h"
+#include "Purity.h"
+
+typedef enum {
+    MIR_SLOT,                   //stack slot of a local or parameter, text is its name.
+    MIR_OBJECT_SLOT,            //stack slot of an object that does not escape, of type; node is the OP_INSTANTIATION.
+    MIR_LOAD,                   //address
+    MIR_STORE,                  //address, value
+    MIR_LIFETIME_START,         //slot; where a local is defined.
+    MIR_LIFETIME_END,           //slot; where the scope of a local ends.
+    MIR_BINARY,                 //left, right; text is the LLVM opcode, e.g. "add" or "icmp slt".
+    MIR_CAST,                   //value; text is the LLVM cast, "bitcast" casts between objects.
+    MIR_FIELD,                  //object; address of the field or method slot named text, which may be in its vtable.
+    MIR_INDEX,                  //array, index; address of the element.
+    MIR_LENGTH,                 //array
+    MIR_TYPE_TEST,              //object, not null; whether it is an instance of the type of node, an OP_INSTANCEOF or OP_CAST.
+    MIR_CALL,                   //callee, arguments...; node is the OP_METHOD_CALL, or a devirtualized OP_OBJECT_CALL.
+    MIR_OBJECT_CALL,            //object, arguments...; calls the method named text, with the object as self; node is the OP_OBJECT_CALL.
+    MIR_NEW,                    //constructor arguments...; allocates and constructs a type. With a node, the OP_INSTANTIATION,
+                                //the first operand is its MIR_OBJECT_SLOT, which is constructed instead.
+    MIR_DELETE,                 //object, not null; puts it on the free list of its class, type.
+    MIR_MAKE_CLOSURE,           //one slot, global or value per captured name; node is the OP_CLOSURE.
+    MIR_STRING,                 //node is the OP_STRING.
+    MIR_PHI,                    //one value per predecessor in targets.
+    MIR_ASSERT,                 //condition
+    MIR_BRANCH,                 //targets[0]
+    MIR_CONDITIONAL_BRANCH,     //condition; targets[0] if true, else targets[1].
+    MIR_RETURN                  //value, or no operands for void.
+} MIROpcode;
+
+struct MIRInstruction;
+struct MIRBlock;
+
+typedef struct {
+    MIRInstruction* instruction; //NULL for literals, parameters and globals, which are held in value.
+    LLVMValue value;
+} MIRValue;
+
+template<typename T>
+using MIRVector = std::vector<T, MemReportAllocator<T, MC_MID_LEVEL_IR> >;
+
+struct MIRInstruction {
+    MIROpcode opcode;
+    CheshireType type; //of the result, or of what is stored, returned or compared.
+    CheshireType operandType; //of the first operand, for casts, fields, arrays and calls.
+    const char* text;
+    ExpressionNode* node;
+    MIRVector<MIRValue> operands;
+    MIRVector<CheshireType> argumentTypes; //of the arguments of calls and instantiations.
+    MIRVector<MIRBlock*> targets;
+    LLVMValue printed; //the name of the result, once printed.
+    Boolean removed; //scratch state of the passes, a removed instruction's uses become its replacement.
+    MIRValue replacement;
+    int mark;
+
+    static void* operator new(size_t size) {
+        return memAlloc(MC_MID_LEVEL_IR, size);
+    }
+
+    static void operator delete(void* p) {
+        memFree(p);
+    }
+};
+
+struct MIRBlock {
+    int label;
+    int mark;
+    MIRVector<MIRInstruction*> instructions;
+
+    static void* operator new(size_t size) {
+        return memAlloc(MC_MID_LEVEL_IR, size);
+    }
+
+    static void operator delete(void* p) {
+        memFree(p);
+    }
+};
+
+struct MIRFunction {
+    CheshireType returnType;
+    ParameterList* params;
+    MIRVector<MIRBlock*> blocks; //in printing order, entry first.
+};
+
+Boolean isTerminator(MIRInstruction*);
+Boolean hasSideEffects(MIRInstruction*);
+Boolean equalMIRValues(const MIRValue&, const MIRValue&);
+void deleteMIRFunction(MIRFunction*);
+
+void runMIRPasses(MIRFunction*);
+void printMIRFunction(FILE*, MIRFunction*, LLVMValue symbol, MemoryEffects);
+
+#endif	/* MIDLEVELIR_HPP */
+
@@ -4,15 +4,17 @@
  */
 
 #include "ParserNodes.h"
+#include "MemReport.h"
 
 static ParameterList* allocParameterList(void) {
-    ParameterList* node = (ParameterList*) malloc(sizeof(ParameterList));
+    ParameterList* node = (ParameterList*) memAlloc(MC_LIST_NODES, sizeof(ParameterList));
     
     if (node == NULL)
         PANIC_OR_RETURN_NULL;
     
     node->type.typeKey = -1;
     node->name = NULL;
+    node->assigned = FALSE;
     node->next = NULL;
     return node;
 }
@@ -33,7 +35,7 @@ void deleteParameterList(ParameterList* node) {
     if (node == NULL)
         return;
     
-    free(node->name);
+    memFree(node->name);
     deleteParameterList(node->next);
-    free(node);
+    memFree(node);
 }
\ No newline at end of file
@@ -27,6 +27,7 @@ extern "C" {
     typedef enum { RL_TRUE, RL_FALSE, RL_NULL } ReservedLiteral;
     typedef enum { FALSE = 0, TRUE = 1 } Boolean;
     typedef enum { CLT_METHOD, CLT_VARIABLE, CLT_CONSTRUCTOR } ClassListType;
+    typedef enum { TC_NONE, TC_TAIL, TC_MUSTTAIL } TailCallKind;
 
     typedef enum {
         OP_NOP,             //placeholder type: not used - hopefully - anywhere.
@@ -80,7 +81,8 @@ extern "C" {
         S_IF,
         S_IF_ELSE,
         S_WHILE,
-        S_RETURN
+        S_RETURN,
+        S_DELETE
     } StatementType;
 
     typedef enum {
@@ -47,6 +47,7 @@ extern "C" {
     StatementNode* createVariableDefinition(CheshireType, char* name, ExpressionNode* value);
     StatementNode* createInferDefinition(char* name, ExpressionNode* value);
     StatementNode* createReturnStatement(ExpressionNode*);
+    StatementNode* createDeleteStatement(ExpressionNode*);
 
 //defined in BlockList.c
     BlockList* linkBlockList(StatementNode*, BlockList*);
@@ -59,14 +60,14 @@ extern "C" {
     ParserTopNode* createMethodDefinition(CheshireType, char* name, ParameterList* params, BlockList* body);
     ParserTopNode* createGlobalVariableDeclaration(CheshireType type, char* name);
     ParserTopNode* createGlobalVariableDefinition(CheshireType type, char* name);
-    ParserTopNode* createClassDefinition(char* name, ClassList*, CheshireType parent);
+    ParserTopNode* createClassDefinition(char* name, ClassList*, CheshireType parent, Boolean final);
 
 //defined in ParameterList.c
     ParameterList* linkParameterList(CheshireType type, char* name, ParameterList* next);
 
 //defined in ClassList.c
     ClassList* linkClassVariable(CheshireType, char*, ExpressionNode* value, ClassList* next);
-    ClassList* linkClassMethod(CheshireType returns, ParameterList*, char*, BlockList*, ClassList* next);
+    ClassList* linkClassMethod(CheshireType returns, ParameterList*, char*, BlockList*, Boolean final, ClassList* next);
     ClassList* linkClassConstructor(ParameterList* params, ExpressionList* inherits, BlockList* block, ClassList* next);
 
 #ifdef __cplusplus
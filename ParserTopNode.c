@@ -4,9 +4,10 @@
  */
 
 #include "ParserNodes.h"
+#include "MemReport.h"
 
 static ParserTopNode* allocParserTopNode(void) {
-    ParserTopNode* node = (ParserTopNode*) malloc(sizeof(ParserTopNode));
+    ParserTopNode* node = (ParserTopNode*) memAlloc(MC_TOP_NODES, sizeof(ParserTopNode));
 
     if (node == NULL)
         PANIC_OR_RETURN_NULL;
@@ -66,7 +67,7 @@ ParserTopNode* createGlobalVariableDefinition(CheshireType type, char* name) {
     return node;
 }
 
-ParserTopNode* createClassDefinition(char* name, ClassList* classlist, CheshireType parent) {
+ParserTopNode* createClassDefinition(char* name, ClassList* classlist, CheshireType parent, Boolean final) {
     ParserTopNode* node = allocParserTopNode();
 
     if (node == NULL)
@@ -76,6 +77,7 @@ ParserTopNode* createClassDefinition(char* name, ClassList* classlist, CheshireT
     node->classdef.name = name;
     node->classdef.classlist = classlist;
     node->classdef.parent = parent;
+    node->classdef.final = final;
     return node;
 }
 
@@ -85,19 +87,19 @@ void deleteParserTopNode(ParserTopNode* node) {
             PANIC("No such statement as No-OP.");
             break;
         case PRT_METHOD_DECLARATION:
-            free(node->method.functionName);
+            memFree(node->method.functionName);
             deleteParameterList(node->method.params);
             break;
         case PRT_METHOD_DEFINITION:
-            free(node->method.functionName); //don't forget to free all of the ParserTopNode(s) -AFTER- code has been emitted from all of the things that depend on it.
+            memFree(node->method.functionName); //don't forget to free all of the ParserTopNode(s) -AFTER- code has been emitted from all of the things that depend on it.
             deleteBlockList(node->method.body);
             deleteParameterList(node->method.params);
             break;
         case PRT_VARIABLE_DECLARATION:
-            free(node->variable.name);
+            memFree(node->variable.name);
             break;
         case PRT_VARIABLE_DEFINITION:
-            free(node->variable.name);
+            memFree(node->variable.name);
             break;
         case PRT_CLASS_DEFINITION:
             //free(node->classdef.name);
@@ -105,5 +107,5 @@ void deleteParserTopNode(ParserTopNode* node) {
             break;
     }
 
-    free(node);
+    memFree(node);
 }
\ No newline at end of file
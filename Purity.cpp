@@ -0,0 +1,624 @@
+/*
+ * File:   Purity.cpp
+ * Author: Michael Goulet
+ * Implements: Purity.h
+ */
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "Purity.h"
+#include "TypeSystem.h"
+#include "TypeSystemUtilities.hpp"
+#include "DeadCode.h"
+#include "CodeEmitting.h"
+
+typedef struct {
+    const char* name;
+    StatementNode* definition; //NULL for parameters and captures.
+} PurityBinding;
+
+typedef struct {
+    ParameterList* params;
+    UsingList* captures;
+    BlockList* body;
+    ParserTopNode* classdef; //of constructors, which also run the field initializers.
+    ExpressionList* inheritsParams;
+    MemoryEffects effects;
+} PurityFunction;
+
+static std::vector<PurityFunction> functions;
+static std::unordered_map<const void*, size_t> functionIndices; //by the node that defines each function.
+static std::unordered_map<TypeKey, size_t> constructors;
+static std::unordered_map<std::string, ParserTopNode*> globals; //methods and global variables.
+static std::unordered_set<std::string> assignedSlots; //object slots that are the target of an assignment somewhere.
+static std::unordered_map<ExpressionNode*, MemoryEffects> callEffects;
+static std::vector<PurityBinding> bindings;
+static std::vector<size_t> bindingScopes;
+static MemoryEffects effects = 0; //of the function being walked.
+static Boolean inferred = FALSE;
+
+extern ObjectMapping objectMapping;
+extern AncestryMap ancestryMap;
+
+static void walkExpression(ExpressionNode*);
+static void walkStatement(StatementNode*);
+static void collectExpression(ExpressionNode*);
+static void collectStatement(StatementNode*);
+
+//////////////// FUNCTIONS /////////////////
+
+static void addFunction(const void* owner, ParameterList* params, UsingList* captures, BlockList* body) {
+    PurityFunction function = {params, captures, body, NULL, NULL, 0};
+    functionIndices[owner] = functions.size();
+    functions.push_back(function);
+}
+
+static MemoryEffects getEffects(const void* owner) {
+    auto found = functionIndices.find(owner);
+    return inferred && found != functionIndices.end() ? functions[found->second].effects : ME_UNKNOWN;
+}
+
+static MemoryEffects getConstructorEffects(CheshireType type) {
+    auto found = constructors.find(type.typeKey);
+    return found != constructors.end() ? functions[found->second].effects : ME_WRITES; //Object's, which has no fields.
+}
+
+static void collectList(ExpressionList* list) {
+    for (; list != NULL; list = list->next)
+        collectExpression(list->parameter);
+}
+
+static void collectBlock(BlockList* list) {
+    for (; list != NULL; list = list->next)
+        collectStatement(list->statement);
+}
+
+//finds the closures and the assigned slots.
+static void collectExpression(ExpressionNode* node) {
+    switch (node->type) {
+        case OP_NOP:
+        case OP_INTEGER:
+        case OP_LONG_INTEGER:
+        case OP_DECIMAL:
+        case OP_CHAR:
+        case OP_RESERVED_LITERAL:
+        case OP_STRING:
+        case OP_VARIABLE:
+        case OP_LAMBDA:
+            break;
+        case OP_DEREFERENCE:
+        case OP_NOT:
+        case OP_COMPL:
+        case OP_UNARY_MINUS:
+        case OP_LENGTH:
+            collectExpression(node->unaryChild);
+            break;
+        case OP_PLUSONE:
+        case OP_MINUSONE:
+            if (node->unaryChild->type == OP_ACCESS)
+                assignedSlots.insert(node->unaryChild->access.variable);
+
+            collectExpression(node->unaryChild);
+            break;
+        case OP_SET:
+            if (node->binary.left->type == OP_ACCESS)
+                assignedSlots.insert(node->binary.left->access.variable);
+            //fall through
+        case OP_EQUALS:
+        case OP_NOT_EQUALS:
+        case OP_GRE_EQUALS:
+        case OP_LES_EQUALS:
+        case OP_GREATER:
+        case OP_LESS:
+        case OP_AND:
+        case OP_OR:
+        case OP_PLUS:
+        case OP_MINUS:
+        case OP_MULT:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_ARRAY_ACCESS:
+            collectExpression(node->binary.left);
+            collectExpression(node->binary.right);
+            break;
+        case OP_INSTANCEOF:
+            collectExpression(node->instanceof.expression);
+            break;
+        case OP_CAST:
+            collectExpression(node->cast.child);
+            break;
+        case OP_ACCESS:
+            collectExpression(node->access.expression);
+            break;
+        case OP_METHOD_CALL:
+            collectExpression(node->methodcall.callback);
+            collectList(node->methodcall.params);
+            break;
+        case OP_OBJECT_CALL:
+            collectExpression(node->objectcall.object);
+            collectList(node->objectcall.params);
+            break;
+        case OP_INSTANTIATION:
+            collectList(node->instantiate.params);
+            break;
+        case OP_CLOSURE:
+            addFunction(node, node->closure.params, node->closure.usingList, node->closure.body);
+            collectBlock(node->closure.body);
+            break;
+        case OP_CHOOSE:
+            collectExpression(node->choose.condition);
+            collectExpression(node->choose.iftrue);
+            collectExpression(node->choose.iffalse);
+            break;
+    }
+}
+
+static void collectStatement(StatementNode* node) {
+    switch (node->type) {
+        case S_NOP:
+            break;
+        case S_VARIABLE_DEF:
+        case S_INFER_DEF:
+            collectExpression(node->varDefinition.value);
+            break;
+        case S_EXPRESSION:
+        case S_ASSERT:
+        case S_DELETE:
+            collectExpression(node->expression);
+            break;
+        case S_RETURN:
+            if (node->expression != NULL)
+                collectExpression(node->expression);
+
+            break;
+        case S_BLOCK:
+            collectBlock(node->block);
+            break;
+        case S_IF:
+        case S_WHILE:
+            collectExpression(node->conditional.condition);
+            collectStatement(node->conditional.block);
+            break;
+        case S_IF_ELSE:
+            collectExpression(node->conditional.condition);
+            collectStatement(node->conditional.block);
+            collectStatement(node->conditional.elseBlock);
+            break;
+    }
+}
+
+void addPurityNode(ParserTopNode* node) {
+    switch (node->type) {
+        case PRT_METHOD_DECLARATION: //external, so its effects stay unknown.
+            globals[node->method.functionName] = node;
+            break;
+        case PRT_METHOD_DEFINITION:
+            globals[node->method.functionName] = node;
+            addFunction(node, node->method.params, NULL, node->method.body);
+            collectBlock(node->method.body);
+            break;
+        case PRT_VARIABLE_DECLARATION:
+        case PRT_VARIABLE_DEFINITION:
+            globals[node->variable.name] = node;
+            break;
+        case PRT_CLASS_DEFINITION: {
+            ClassList* constructor = NULL;
+
+            for (ClassList* c = node->classdef.classlist; c != NULL; c = c->next) {
+                switch (c->type) {
+                    case CLT_VARIABLE:
+                        collectExpression(c->variable.defaultValue);
+                        break;
+                    case CLT_METHOD:
+                        addFunction(c, c->method.params, NULL, c->method.block);
+                        collectBlock(c->method.block);
+                        break;
+                    case CLT_CONSTRUCTOR:
+                        constructor = c;
+                        collectList(c->constructor.inheritsParams);
+                        collectBlock(c->constructor.block);
+                        break;
+                }
+            }
+
+            PurityFunction function = {NULL, NULL, NULL, node, NULL, 0};
+
+            if (constructor != NULL) { //otherwise, the implicit one only runs the field initializers.
+                function.params = constructor->constructor.params;
+                function.body = constructor->constructor.block;
+                function.inheritsParams = constructor->constructor.inheritsParams;
+            }
+
+            constructors[getNamedType(node->classdef.name).typeKey] = functions.size();
+            functions.push_back(function);
+        }
+        break;
+        case PRT_NONE:
+            break;
+    }
+}
+
+//////////////// BINDINGS /////////////////
+
+static void raiseBindingScope() {
+    bindingScopes.push_back(bindings.size());
+}
+
+static void fallBindingScope() {
+    bindings.resize(bindingScopes.back());
+    bindingScopes.pop_back();
+}
+
+static void bindVariable(const char* name, StatementNode* definition) {
+    PurityBinding binding = {name, definition};
+    bindings.push_back(binding);
+}
+
+static PurityBinding* resolveBinding(const char* name) {
+    CStrEql streql;
+
+    for (size_t i = bindings.size(); i > 0; i--) { //innermost first.
+        if (streql(bindings[i - 1].name, name))
+            return &bindings[i - 1];
+    }
+
+    return NULL; //a global, or a method.
+}
+
+//////////////// CALLEES /////////////////
+
+static ClassList* findClassMember(TypeKey type, const char* name) {
+    CStrEql streql;
+    auto found = objectMapping.find(type);
+
+    for (ClassList* c = found != objectMapping.end() ? found->second : NULL; c != NULL; c = c->next) {
+        if ((c->type == CLT_METHOD && streql(c->method.name, name)) || (c->type == CLT_VARIABLE && streql(c->variable.name, name)))
+            return c;
+    }
+
+    return NULL;
+}
+
+static TypeKey getParent(TypeKey type) {
+    auto found = ancestryMap.find(type);
+    return found != ancestryMap.end() ? found->second : type;
+}
+
+static Boolean inheritsFrom(TypeKey type, TypeKey ancestor) {
+    for (TypeKey t = type; t != getParent(t); t = getParent(t)) {
+        if (getParent(t) == ancestor)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+//of every method an object of the type can call by the name: the one the type inherits or defines, and overrides.
+static MemoryEffects getObjectMethodEffects(CheshireType type, const char* name) {
+    if (!isObjectType(type) || type.arrayNesting != 0 || assignedSlots.count(name) != 0)
+        return ME_UNKNOWN;
+
+    ClassList* method = NULL;
+
+    for (TypeKey t = type.typeKey; method == NULL && t != TYPE_OBJECT.typeKey; t = getParent(t)) {
+        method = findClassMember(t, name);
+
+        if (t == getParent(t))
+            break;
+    }
+
+    if (method == NULL || method->type != CLT_METHOD) //a field holding a closure.
+        return ME_UNKNOWN;
+
+    if (!isWholeProgram() && !isFinalClass(type) && !isFinalMethod(type, name)) //another module could override it.
+        return ME_UNKNOWN;
+
+    MemoryEffects called = getEffects(method);
+
+    for (auto i = ancestryMap.begin(); i != ancestryMap.end(); ++i) {
+        if (!inheritsFrom(i->first, type.typeKey))
+            continue;
+
+        ClassList* override = findClassMember(i->first, name);
+
+        if (override != NULL)
+            called |= override->type == CLT_METHOD ? getEffects(override) : ME_UNKNOWN;
+    }
+
+    return called;
+}
+
+static MemoryEffects getCalleeEffects(ExpressionNode* callback) {
+    if (callback->type == OP_CLOSURE)
+        return getEffects(callback);
+
+    if (callback->type != OP_DEREFERENCE || callback->unaryChild->type != OP_VARIABLE)
+        return ME_UNKNOWN;
+
+    PurityBinding* binding = resolveBinding(callback->unaryChild->string);
+
+    if (binding != NULL) {
+        StatementNode* definition = binding->definition;
+
+        if (definition == NULL || definition->varDefinition.assigned || definition->varDefinition.value->type != OP_CLOSURE)
+            return ME_UNKNOWN;
+
+        return getEffects(definition->varDefinition.value);
+    }
+
+    auto found = globals.find(callback->unaryChild->string);
+    return found != globals.end() ? getEffects(found->second) : ME_UNKNOWN;
+}
+
+//////////////// EFFECTS /////////////////
+
+static void walkList(ExpressionList* list) {
+    for (; list != NULL; list = list->next)
+        walkExpression(list->parameter);
+}
+
+static void walkBlock(BlockList* list) {
+    raiseBindingScope();
+
+    for (; list != NULL; list = list->next)
+        walkStatement(list->statement);
+
+    fallBindingScope();
+}
+
+static void useVariable(const char* name, MemoryEffects access) {
+    if (resolveBinding(name) != NULL)
+        return; //a local or parameter, captures were read on entry.
+
+    auto found = globals.find(name);
+
+    if (found == globals.end() || (found->second->type != PRT_METHOD_DECLARATION && found->second->type != PRT_METHOD_DEFINITION))
+        effects |= access; //a method is read from its constant.
+}
+
+//an lvalue that is assigned, or incremented.
+static void walkAssigned(ExpressionNode* node) {
+    if (node->type == OP_VARIABLE) {
+        useVariable(node->string, ME_READS | ME_WRITES);
+        return;
+    }
+
+    effects |= ME_WRITES;
+    walkExpression(node);
+}
+
+static void walkExpression(ExpressionNode* node) {
+    switch (node->type) {
+        case OP_NOP:
+        case OP_INTEGER:
+        case OP_LONG_INTEGER:
+        case OP_DECIMAL:
+        case OP_CHAR:
+        case OP_RESERVED_LITERAL:
+        case OP_VARIABLE: //an lvalue, only its use reads or writes.
+        case OP_LAMBDA:
+            break;
+        case OP_STRING:
+            effects |= ME_ALLOCATES;
+            break;
+        case OP_DEREFERENCE:
+            if (node->unaryChild->type == OP_VARIABLE) {
+                useVariable(node->unaryChild->string, ME_READS);
+                break;
+            }
+
+            effects |= ME_READS;
+            walkExpression(node->unaryChild);
+            break;
+        case OP_LENGTH:
+        case OP_INSTANCEOF:
+            effects |= ME_READS;
+            walkExpression(node->type == OP_LENGTH ? node->unaryChild : node->instanceof.expression);
+            break;
+        case OP_NOT:
+        case OP_COMPL:
+        case OP_UNARY_MINUS:
+            walkExpression(node->unaryChild);
+            break;
+        case OP_PLUSONE:
+        case OP_MINUSONE:
+            walkAssigned(node->unaryChild);
+            break;
+        case OP_SET:
+            walkAssigned(node->binary.left);
+            walkExpression(node->binary.right);
+            break;
+        case OP_ARRAY_ACCESS: //loads the elements pointer of the array.
+            effects |= ME_READS;
+            //fall through
+        case OP_EQUALS:
+        case OP_NOT_EQUALS:
+        case OP_GRE_EQUALS:
+        case OP_LES_EQUALS:
+        case OP_GREATER:
+        case OP_LESS:
+        case OP_AND:
+        case OP_OR:
+        case OP_PLUS:
+        case OP_MINUS:
+        case OP_MULT:
+        case OP_DIV:
+        case OP_MOD:
+            walkExpression(node->binary.left);
+            walkExpression(node->binary.right);
+            break;
+        case OP_CAST:
+            if (isCheckedCast(node->cast.child->determinedType, node->cast.type)) //reads the type descriptor, and can fail.
+                effects |= ME_READS | ME_WRITES;
+
+            walkExpression(node->cast.child);
+            break;
+        case OP_ACCESS:
+            walkExpression(node->access.expression);
+            break;
+        case OP_METHOD_CALL: {
+            MemoryEffects called = getCalleeEffects(node->methodcall.callback);
+
+            if (node->methodcall.callback->type != OP_CLOSURE) //the closure is created, but not by the call.
+                walkExpression(node->methodcall.callback);
+
+            walkList(node->methodcall.params);
+            callEffects[node] = called;
+            effects |= called;
+        }
+        break;
+        case OP_OBJECT_CALL: {
+            MemoryEffects called = getObjectMethodEffects(node->objectcall.object->determinedType, node->objectcall.method);
+            walkExpression(node->objectcall.object);
+            walkList(node->objectcall.params);
+            callEffects[node] = called;
+            effects |= ME_READS | called; //of the method slot.
+        }
+        break;
+        case OP_INSTANTIATION: {
+            effects |= ME_ALLOCATES | getConstructorEffects(node->instantiate.type);
+            walkList(node->instantiate.params);
+        }
+        break;
+        case OP_CLOSURE: //its body is a function of its own.
+            if (node->closure.usingList != NULL) //its trampoline and captures.
+                effects |= ME_ALLOCATES;
+
+            break;
+        case OP_CHOOSE:
+            walkExpression(node->choose.condition);
+            walkExpression(node->choose.iftrue);
+            walkExpression(node->choose.iffalse);
+            break;
+    }
+}
+
+static void walkStatement(StatementNode* node) {
+    switch (node->type) {
+        case S_NOP:
+            break;
+        case S_VARIABLE_DEF:
+        case S_INFER_DEF:
+            walkExpression(node->varDefinition.value);
+            bindVariable(node->varDefinition.variable, node);
+            break;
+        case S_ASSERT: //which can print and exit.
+        case S_DELETE:
+            effects |= ME_WRITES;
+            walkExpression(node->expression);
+            break;
+        case S_EXPRESSION:
+            walkExpression(node->expression);
+            break;
+        case S_RETURN:
+            if (node->expression != NULL)
+                walkExpression(node->expression);
+
+            break;
+        case S_BLOCK:
+            walkBlock(node->block);
+            break;
+        case S_IF:
+        case S_WHILE:
+            walkExpression(node->conditional.condition);
+            walkStatement(node->conditional.block);
+            break;
+        case S_IF_ELSE:
+            walkExpression(node->conditional.condition);
+            walkStatement(node->conditional.block);
+            walkStatement(node->conditional.elseBlock);
+            break;
+    }
+}
+
+static MemoryEffects walkFunction(PurityFunction& function) {
+    effects = 0;
+    raiseBindingScope();
+
+    if (function.classdef != NULL) { //stores the fields and method slots, after the parent's constructor.
+        effects |= ME_WRITES | getConstructorEffects(function.classdef->classdef.parent);
+    }
+
+    for (ParameterList* p = function.params; p != NULL; p = p->next)
+        bindVariable(p->name, NULL);
+
+    for (UsingList* u = function.captures; u != NULL; u = u->next) {
+        effects |= ME_READS;
+        bindVariable(u->variable, NULL);
+    }
+
+    walkList(function.inheritsParams);
+
+    for (ClassList* c = function.classdef != NULL ? function.classdef->classdef.classlist : NULL; c != NULL; c = c->next) {
+        if (c->type == CLT_VARIABLE)
+            walkExpression(c->variable.defaultValue);
+    }
+
+    walkBlock(function.body);
+    fallBindingScope();
+    return effects;
+}
+
+void inferPurity() {
+    inferred = TRUE; //optimistically, every function starts out pure.
+    Boolean changed = TRUE;
+
+    while (changed) {
+        changed = FALSE;
+
+        for (size_t i = 0; i < functions.size(); i++) {
+            MemoryEffects walked = walkFunction(functions[i]);
+
+            if (walked != functions[i].effects) { //effects only ever grow.
+                functions[i].effects = walked;
+                changed = TRUE;
+            }
+        }
+    }
+}
+
+MemoryEffects getMethodEffects(ParserTopNode* node) {
+    return getEffects(node);
+}
+
+MemoryEffects getClassMethodEffects(ClassList* method) {
+    return getEffects(method);
+}
+
+MemoryEffects getClosureEffects(ExpressionNode* closure) {
+    return getEffects(closure);
+}
+
+MemoryEffects getCallEffects(ExpressionNode* call) {
+    auto found = callEffects.find(call);
+    return inferred && found != callEffects.end() ? found->second : ME_UNKNOWN;
+}
+
+const char* getMemoryAttribute(MemoryEffects effects) {
+    if (effects == 0)
+        return " readnone";
+
+    return effects == ME_READS ? " readonly" : "";
+}
+
+void printPurityReport(FILE* out) {
+    int counts[3] = {0}, allocating = 0, attributedCalls = 0;
+
+    for (size_t i = 0; i < functions.size(); i++) {
+        MemoryEffects e = functions[i].effects;
+        counts[(e & ME_WRITES) != 0 ? 2 : (e & ME_READS) != 0 ? 1 : 0]++;
+
+        if ((e & ME_ALLOCATES) != 0)
+            allocating++;
+    }
+
+    for (auto i = callEffects.begin(); i != callEffects.end(); ++i) {
+        if (*getMemoryAttribute(i->second) != '\0')
+            attributedCalls++;
+    }
+
+    fprintf(out, "Inferred %d pure, %d read-only and %d writing of %zu functions (%d allocate); %d of %zu calls are readnone or readonly\n",
+            counts[0], counts[1], counts[2], functions.size(), allocating, attributedCalls, callEffects.size());
+}
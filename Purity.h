@@ -0,0 +1,48 @@
+/*
+ * File:   Purity.h
+ * Author: Michael Goulet
+ * Implementation: Purity.cpp
+ *
+ * Infers the memory effects of every top-level method, class method and closure from the typed syntax tree, to a
+ * fixed point over the call graph: whether it reads memory (globals, fields, array elements or its captures), writes
+ * it, or allocates. Locals and parameters are not memory, since nothing can take their address. A call is resolved
+ * to the method named, the closure created or held by a local that is never assigned, or for object calls to every
+ * method of that name that the object's type or one of its subclasses defines (unless something assigns the slot, or,
+ * outside a whole program, the method and class are not final); calls of anything else, and of external methods,
+ * write and allocate. Functions that neither write nor allocate
+ * are emitted readnone or readonly, as are the calls of them, so LLVM can hoist and merge them.
+ *
+ * addPurityNode must see every emitted top node before inferPurity runs. Runs after markTailCalls.
+ */
+
+#ifndef PURITY_H
+#define	PURITY_H
+
+#include <stdio.h>
+#include "Structures.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define ME_READS 1
+#define ME_WRITES 2
+#define ME_ALLOCATES 4
+#define ME_UNKNOWN (ME_READS | ME_WRITES | ME_ALLOCATES) //of anything not inferred.
+
+    typedef int MemoryEffects;
+
+    void addPurityNode(ParserTopNode*);
+    void inferPurity(void);
+    MemoryEffects getMethodEffects(ParserTopNode*);
+    MemoryEffects getClassMethodEffects(ClassList*);
+    MemoryEffects getClosureEffects(ExpressionNode*);
+    MemoryEffects getCallEffects(ExpressionNode*); //of everything an OP_METHOD_CALL or OP_OBJECT_CALL can call.
+    const char* getMemoryAttribute(MemoryEffects); //" readnone", " readonly" or "".
+    void printPurityReport(FILE*);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* PURITY_H */
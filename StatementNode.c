@@ -4,9 +4,10 @@
  */
 
 #include "ParserNodes.h"
+#include "MemReport.h"
 
 static StatementNode* allocStatementNode(void) {
-    StatementNode* node = (StatementNode*) malloc(sizeof(StatementNode));
+    StatementNode* node = (StatementNode*) memAlloc(MC_STATEMENT_NODES, sizeof(StatementNode));
 
     if (node == NULL)
         PANIC_OR_RETURN_NULL;
@@ -97,6 +98,7 @@ StatementNode* createVariableDefinition(CheshireType type, char* variable, Expre
     node->varDefinition.type = type;
     node->varDefinition.variable = variable;
     node->varDefinition.value = value;
+    node->varDefinition.assigned = FALSE;
     return node;
 }
 
@@ -110,6 +112,7 @@ StatementNode* createInferDefinition(char* variable, ExpressionNode* value) {
     node->varDefinition.type.typeKey = (TypeKey) -1;
     node->varDefinition.variable = variable;
     node->varDefinition.value = value;
+    node->varDefinition.assigned = FALSE;
     return node;
 }
 
@@ -124,6 +127,17 @@ StatementNode* createReturnStatement(ExpressionNode* expression) {
     return node;
 }
 
+StatementNode* createDeleteStatement(ExpressionNode* expression) {
+    StatementNode* node = allocStatementNode();
+
+    if (node == NULL)
+        return NULL;
+
+    node->type = S_DELETE;
+    node->expression = expression;
+    return node;
+}
+
 void deleteStatementNode(StatementNode* node) {
     switch (node->type) {
         case S_NOP:
@@ -132,6 +146,7 @@ void deleteStatementNode(StatementNode* node) {
         case S_EXPRESSION:
         case S_ASSERT:
         case S_RETURN:
+        case S_DELETE:
             deleteExpressionNode(node->expression);
             break;
         case S_BLOCK:
@@ -149,10 +164,10 @@ void deleteStatementNode(StatementNode* node) {
             break;
         case S_VARIABLE_DEF:
         case S_INFER_DEF:
-            free(node->varDefinition.variable);
+            memFree(node->varDefinition.variable);
             deleteExpressionNode(node->varDefinition.value);
             break;
     }
 
-    free(node);
+    memFree(node);
 }
@@ -72,6 +72,7 @@ extern "C" {
                 struct tagParameterList* params;
                 struct tagBlockList* block;
                 char* name;
+                Boolean final; //no subclass may override it, and nothing may assign its slot.
             } method;
 
             struct {
@@ -101,6 +102,7 @@ extern "C" {
                 char* name;
                 struct tagClassList* classlist;
                 CheshireType parent;
+                Boolean final; //no class may inherit it.
             } classdef;
         };
     } ParserTopNode;
@@ -108,6 +110,7 @@ extern "C" {
     typedef struct tagParameterList {
         CheshireType type;
         char* name;
+        Boolean assigned; //as for varDefinition.
         struct tagParameterList* next;
     } ParameterList;
 
@@ -152,6 +155,7 @@ extern "C" {
             struct {
                 struct tagExpressionNode* callback;
                 struct tagExpressionList* params;
+                TailCallKind tailCall; //of a returned call, set by markTailCalls.
             } methodcall;
 
             struct {
@@ -170,6 +174,7 @@ extern "C" {
                 struct tagExpressionNode* object;
                 char* method;
                 struct tagExpressionList* params;
+                TailCallKind tailCall;
             } objectcall;
 
             struct {
@@ -199,6 +204,7 @@ extern "C" {
                 CheshireType type;
                 char* variable;
                 struct tagExpressionNode* value;
+                Boolean assigned; //by OP_SET, ++ or -- anywhere in its scope, set by markAssignedVariables.
             } varDefinition;
         };
     } StatementNode;
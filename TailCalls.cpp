@@ -0,0 +1,371 @@
+/*
+ * File:   TailCalls.cpp
+ * Author: Michael Goulet
+ * Implements: TailCalls.h
+ */
+
+#include <string>
+#include <vector>
+#include "TailCalls.h"
+#include "CodeEmitting.h"
+#include "TypeSystem.h"
+#include "TypeSystemUtilities.hpp"
+
+typedef struct {
+    std::string name;
+    CheshireType prototype; //the lambda type of the method or closure.
+    Boolean nest; //a closure with captures takes them as an extra, first argument.
+    size_t scope; //where its names start.
+    Boolean rooted; //with garbage collection, it will hold roots on the shadow stack.
+    std::vector<ExpressionNode*> returned; //the calls it returns, marked as tail calls.
+} Caller;
+
+static Boolean diagnostics = FALSE;
+static std::vector<Caller> callers;
+static std::vector<std::pair<std::string, Boolean> > names; //in scope, and whether each is bound to a value, not a slot.
+static ExpressionNode* returnedCall = NULL; //of the return being marked, which the emitter does not root.
+
+extern KeyedLambdas keyedLambdas;
+
+static void markInExpression(ExpressionNode*);
+static void markInStatement(StatementNode*);
+
+void setTailCallDiagnostics(Boolean enabled) {
+    diagnostics = enabled;
+}
+
+static void reportMissedTailCall(const char* reason) {
+    if (diagnostics)
+        fprintf(stderr, "Warning: a call returned by %s is not a guaranteed tail call: %s.\n", callers.back().name.c_str(), reason);
+}
+
+static Boolean isCall(ExpressionNode* node) {
+    return (Boolean) (node->type == OP_METHOD_CALL || node->type == OP_OBJECT_CALL);
+}
+
+static CheshireType getCalleeType(ExpressionNode* call) {
+    if (call->type == OP_METHOD_CALL)
+        return call->methodcall.callback->determinedType;
+
+    return getClassVariable(call->objectcall.object->determinedType, call->objectcall.method); //self is its first parameter.
+}
+
+//objects are passed as pointers, whatever their class (self of an inherited or overriding method is one), and LLVM
+//lets musttail parameters differ in what they point to.
+static Boolean isSameParameterType(CheshireType caller, CheshireType callee) {
+    if (equalTypes(caller, callee))
+        return TRUE;
+
+    return (Boolean) (caller.arrayNesting == 0 && callee.arrayNesting == 0 && isObjectType(caller) && isObjectType(callee));
+}
+
+static Boolean isSameSignature(CheshireType caller, CheshireType callee) {
+    LambdaType& callerLambda = keyedLambdas[caller];
+    LambdaType& calleeLambda = keyedLambdas[callee];
+
+    if (!equalTypes(callerLambda.first, calleeLambda.first) || callerLambda.second.size() != calleeLambda.second.size())
+        return FALSE;
+
+    for (size_t i = 0; i < callerLambda.second.size(); i++)
+        if (!isSameParameterType(callerLambda.second[i], calleeLambda.second[i]))
+            return FALSE;
+
+    return TRUE;
+}
+
+static size_t findName(const char* name) { //0 for a global, or 1 + where it is bound in the caller.
+    for (size_t i = names.size(); i > callers.back().scope; i--)
+        if (names[i - 1].first == name)
+            return i;
+
+    return 0;
+}
+
+//whether the emitter binds a name of the caller to its value, which reading it does not root, see bindParameter.
+static Boolean isValueName(const char* name) {
+    size_t found = findName(name);
+    return found != 0 ? names[found - 1].second : FALSE; //a global is loaded from memory.
+}
+
+static Boolean isShadowedCallee(ExpressionNode* callback) { //by a name of the caller, see isDirectCall.
+    if (callback->type != OP_DEREFERENCE || callback->unaryChild->type != OP_VARIABLE)
+        return FALSE;
+
+    return findName(callback->unaryChild->string) != 0 ? TRUE : FALSE;
+}
+
+static void bindName(const char* name, CheshireType type, Boolean assigned) {
+    names.push_back(std::make_pair(std::string(name), (Boolean) !assigned));
+
+    if (assigned && isTracedType(type))
+        callers.back().rooted = TRUE; //its slot.
+}
+
+//mirrors isRootedExpression in CodeEmitting.c: the values the emitter stores into a temporary root.
+static void findRoot(ExpressionNode* node) {
+    if (node == returnedCall || (!isTracedType(node->determinedType) && node->type != OP_INSTANTIATION))
+        return;
+
+    switch (node->type) {
+        case OP_DEREFERENCE:
+            if (node->unaryChild->type != OP_VARIABLE || !isValueName(node->unaryChild->string))
+                callers.back().rooted = TRUE;
+
+            break;
+        case OP_METHOD_CALL:
+        case OP_OBJECT_CALL:
+        case OP_STRING:
+        case OP_INSTANTIATION:
+            callers.back().rooted = TRUE;
+            break;
+        case OP_CLOSURE:
+            if (node->closure.usingList != NULL)
+                callers.back().rooted = TRUE;
+
+            break;
+        default:
+            break;
+    }
+}
+
+static void markReturnedCall(ExpressionNode* returned) {
+    if (returned->type == OP_CAST && isCall(returned->cast.child)) {
+        reportMissedTailCall("its result is cast before it is returned");
+        return;
+    }
+
+    if (!isCall(returned))
+        return;
+
+    Caller& caller = callers.back();
+    TailCallKind kind = TC_MUSTTAIL;
+
+    if (caller.nest) {
+        kind = TC_TAIL;
+        reportMissedTailCall("the closure's captures make its signature differ from the callee's");
+    } else if (!isSameSignature(caller.prototype, getCalleeType(returned))) {
+        kind = TC_TAIL;
+        reportMissedTailCall("the callee's signature differs from the caller's");
+    }
+
+    if (returned->type == OP_METHOD_CALL)
+        returned->methodcall.tailCall = kind;
+    else
+        returned->objectcall.tailCall = kind;
+
+    caller.returned.push_back(returned);
+}
+
+//with garbage collection, a caller holding roots pops them from the shadow stack after its calls return.
+static void finishCaller() {
+    Caller& caller = callers.back();
+
+    if (getGarbageCollection() && caller.rooted) {
+        for (size_t i = 0; i < caller.returned.size(); i++) {
+            if (caller.returned[i]->type == OP_METHOD_CALL)
+                caller.returned[i]->methodcall.tailCall = TC_NONE;
+            else
+                caller.returned[i]->objectcall.tailCall = TC_NONE;
+
+            reportMissedTailCall("the caller holds garbage collection roots, which it pops from the shadow stack when it returns");
+        }
+    }
+
+    names.resize(caller.scope);
+    callers.pop_back();
+}
+
+static void markInList(ExpressionList* list) {
+    for (; list != NULL; list = list->next)
+        markInExpression(list->parameter);
+}
+
+static void markInBlock(BlockList* list) {
+    size_t scope = names.size();
+
+    for (; list != NULL; list = list->next)
+        markInStatement(list->statement);
+
+    names.resize(scope);
+}
+
+static void markInScope(StatementNode* node) { //the body of an if or a while.
+    size_t scope = names.size();
+    markInStatement(node);
+    names.resize(scope);
+}
+
+static void beginCaller(const std::string& name, CheshireType prototype, UsingList* captures, ParameterList* params) {
+    Caller caller = {name, prototype, (Boolean) (captures != NULL), names.size(), FALSE, std::vector<ExpressionNode*>()};
+    std::vector<Boolean> direct;
+
+    for (UsingList* u = captures; u != NULL; u = u->next)
+        direct.push_back(isValueName(u->variable)); //the body shares the captured value, or stores it in a slot.
+
+    callers.push_back(caller);
+
+    for (size_t i = 0; captures != NULL; captures = captures->next, i++)
+        bindName(captures->variable, captures->type, (Boolean) !direct[i]);
+
+    for (; params != NULL; params = params->next)
+        bindName(params->name, params->type, params->assigned);
+}
+
+static void markInMethod(const std::string& name, CheshireType prototype, UsingList* captures, ParameterList* params, BlockList* body) {
+    beginCaller(name, prototype, captures, params);
+    markInBlock(body);
+    finishCaller();
+}
+
+static void markInExpression(ExpressionNode* node) {
+    findRoot(node);
+
+    switch (node->type) {
+        case OP_NOP:
+        case OP_INTEGER:
+        case OP_LONG_INTEGER:
+        case OP_DECIMAL:
+        case OP_CHAR:
+        case OP_VARIABLE:
+        case OP_RESERVED_LITERAL:
+        case OP_STRING:
+        case OP_LAMBDA: //converted into OP_CLOSURE by the type checker.
+            break;
+        case OP_DEREFERENCE:
+        case OP_NOT:
+        case OP_COMPL:
+        case OP_UNARY_MINUS:
+        case OP_PLUSONE:
+        case OP_MINUSONE:
+        case OP_LENGTH:
+            markInExpression(node->unaryChild);
+            break;
+        case OP_EQUALS:
+        case OP_NOT_EQUALS:
+        case OP_GRE_EQUALS:
+        case OP_LES_EQUALS:
+        case OP_GREATER:
+        case OP_LESS:
+        case OP_AND:
+        case OP_OR:
+        case OP_PLUS:
+        case OP_MINUS:
+        case OP_MULT:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_SET:
+        case OP_ARRAY_ACCESS:
+            markInExpression(node->binary.left);
+            markInExpression(node->binary.right);
+            break;
+        case OP_INSTANCEOF:
+            markInExpression(node->instanceof.expression);
+            break;
+        case OP_CAST:
+            markInExpression(node->cast.child);
+            break;
+        case OP_ACCESS:
+            markInExpression(node->access.expression);
+            break;
+        case OP_METHOD_CALL:
+            if (!isDirectCall(node->methodcall.callback, isShadowedCallee(node->methodcall.callback))) //else not loaded.
+                markInExpression(node->methodcall.callback);
+
+            markInList(node->methodcall.params);
+            break;
+        case OP_OBJECT_CALL:
+            markInExpression(node->objectcall.object);
+            markInList(node->objectcall.params);
+            break;
+        case OP_INSTANTIATION:
+            markInList(node->instantiate.params);
+            break;
+        case OP_CLOSURE:
+            markInMethod("a closure in " + callers.back().name, getLambdaType(node->closure.type, node->closure.params), node->closure.usingList, node->closure.params, node->closure.body);
+            break;
+        case OP_CHOOSE:
+            markInExpression(node->choose.condition);
+            markInExpression(node->choose.iftrue);
+            markInExpression(node->choose.iffalse);
+            break;
+    }
+}
+
+static void markInStatement(StatementNode* node) {
+    switch (node->type) {
+        case S_NOP:
+            break;
+        case S_VARIABLE_DEF:
+        case S_INFER_DEF:
+            markInExpression(node->varDefinition.value);
+            bindName(node->varDefinition.variable, node->varDefinition.type, node->varDefinition.assigned);
+            break;
+        case S_EXPRESSION:
+        case S_ASSERT:
+        case S_DELETE:
+            markInExpression(node->expression);
+            break;
+        case S_RETURN:
+            returnedCall = isCall(node->expression) ? node->expression : NULL;
+            markInExpression(node->expression);
+            markReturnedCall(node->expression);
+            break;
+        case S_BLOCK:
+            markInBlock(node->block);
+            break;
+        case S_IF:
+        case S_WHILE:
+            markInExpression(node->conditional.condition);
+            markInScope(node->conditional.block);
+            break;
+        case S_IF_ELSE:
+            markInExpression(node->conditional.condition);
+            markInScope(node->conditional.block);
+            markInScope(node->conditional.elseBlock);
+            break;
+    }
+}
+
+void markTailCalls(ParserTopNode* node) {
+    switch (node->type) {
+        case PRT_METHOD_DEFINITION:
+            markInMethod(node->method.functionName, getLambdaType(node->method.returnType, node->method.params), NULL, node->method.params, node->method.body);
+            break;
+        case PRT_CLASS_DEFINITION: {
+            std::string name = std::string(node->classdef.name) + "::";
+            Boolean rootedDefaults = FALSE; //the constructor stores the default values, so it holds their roots.
+
+            for (ClassList* c = node->classdef.classlist; c != NULL; c = c->next) {
+                if (c->type == CLT_VARIABLE) { //closures in default values are created by the constructor.
+                    beginCaller(name + "new", TYPE_VOID, NULL, NULL);
+                    markInExpression(c->variable.defaultValue);
+                    rootedDefaults = (Boolean) (rootedDefaults || callers.back().rooted);
+                    finishCaller();
+                }
+            }
+
+            for (ClassList* c = node->classdef.classlist; c != NULL; c = c->next) {
+                switch (c->type) {
+                    case CLT_VARIABLE:
+                        break;
+                    case CLT_METHOD:
+                        markInMethod(name + c->method.name, getLambdaType(c->method.returnType, c->method.params), NULL, c->method.params, c->method.block);
+                        break;
+                    case CLT_CONSTRUCTOR:
+                        beginCaller(name + "new", getLambdaType(TYPE_VOID, c->constructor.params), NULL, c->constructor.params);
+                        callers.back().rooted = rootedDefaults;
+                        markInList(c->constructor.inheritsParams);
+                        markInBlock(c->constructor.block);
+                        finishCaller();
+                        break;
+                }
+            }
+        }
+        break;
+        case PRT_NONE:
+        case PRT_METHOD_DECLARATION:
+        case PRT_VARIABLE_DECLARATION:
+        case PRT_VARIABLE_DEFINITION:
+            break;
+    }
+}
@@ -0,0 +1,36 @@
+/*
+ * File:   TailCalls.h
+ * Author: Michael Goulet
+ * Implementation: TailCalls.cpp
+ *
+ * markTailCalls finds the calls that are returned as they are (return f(x). or return o::m(x).) and sets their
+ * tailCall: TC_MUSTTAIL when the callee has the same signature as the method or closure returning it, objects of any
+ * class counting as the same, so LLVM must reuse the caller's frame, otherwise TC_TAIL. Every Cheshire function is fastcc and no stack slot escapes (Escape.h
+ * keeps the objects passed to tail calls on the heap), so both are always safe. Runs after foldTopNode, which can
+ * change what a method returns.
+ *
+ * With garbage collection, a function holding roots pops them from the shadow stack after its calls return, so its
+ * returned calls are left unmarked. Whether it will hold any follows the emitter: an assigned object or closure
+ * parameter, local or capture, or an object or closure that is loaded other than from a name bound to its value,
+ * returned by a call that is not a tail call, allocated, or created with captures.
+ *
+ * With diagnostics on, it reports on stderr the returns that look like tail calls but are not guaranteed ones.
+ */
+
+#ifndef TAILCALLS_H
+#define	TAILCALLS_H
+
+#include "Structures.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    void setTailCallDiagnostics(Boolean);
+    void markTailCalls(ParserTopNode*);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* TAILCALLS_H */
@@ -0,0 +1,343 @@
+/*
+ * File:   TimeReport.cpp
+ * Author: Michael Goulet
+ * Implements: TimeReport.h
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include "TimeReport.h"
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#define COUNTERS 3 //cycles, instructions, cache misses.
+#define SLOWEST_NODES 10
+
+struct OpenPhase {
+    TimePhase phase;
+    uint64_t start, children;
+    uint64_t startCounters[COUNTERS], childCounters[COUNTERS];
+};
+
+struct PhaseTiming {
+    uint64_t self, total, calls;
+    uint64_t counters[COUNTERS]; //self, like the time.
+};
+
+struct NodeTiming {
+    std::string name;
+    uint64_t total;
+    uint64_t phases[TP_COUNT];
+};
+
+struct TraceEvent {
+    TimePhase phase;
+    uint64_t start, duration;
+    ParserTopNode* subject;
+    uint64_t counters[COUNTERS];
+};
+
+static const char* phaseNames[TP_COUNT] = {
+    "parse (yyparse)", "defineTopNode", "typeCheckTopNode", "markAssignedVariables", "foldTopNode", "inlineTopNode", "findReachableNodes", "markTailCalls", "inferPurity", "analyzeEscapes", "forwardDefinition", "emitCode", "flushPreambles", "runPasses", "writeModule"
+};
+
+static const char* shortNames[TP_COUNT] = {"parse", "define", "typecheck", "assigned", "fold", "inline", "deadcode", "tailcalls", "purity", "escape", "forward", "emit", "flush", "passes", "write"};
+
+static const char* counterNames[COUNTERS] = {"cycles", "instructions", "cache-misses"};
+
+static Boolean enabled = FALSE;
+static Boolean tracing = FALSE;
+static uint64_t epoch;
+static int counterFds[COUNTERS] = {-1, -1, -1};
+static std::vector<OpenPhase> openPhases;
+static PhaseTiming phaseTimings[TP_COUNT];
+static std::unordered_map<ParserTopNode*, size_t> nodeIndices;
+static std::vector<NodeTiming> nodeTimings;
+static std::vector<TraceEvent> traceEvents;
+
+static uint64_t now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+static void openCounters() {
+#ifdef __linux__
+    static const uint64_t configs[COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+
+    for (int i = 0; i < COUNTERS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.disabled = (i == 0); //the leader starts the whole group.
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        counterFds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : counterFds[0], 0);
+
+        if (counterFds[i] < 0) {
+            fprintf(stderr, "Warning: hardware counters are unavailable (perf_event_open %s), timing only.\n", counterNames[i]);
+
+            for (int j = 0; j < i; j++) {
+                close(counterFds[j]);
+                counterFds[j] = -1;
+            }
+
+            counterFds[i] = -1;
+            return;
+        }
+    }
+
+    ioctl(counterFds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(counterFds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+    fprintf(stderr, "Warning: hardware counters need perf_event_open (Linux), timing only.\n");
+#endif
+}
+
+static void readCounters(uint64_t* values) {
+    if (counterFds[0] < 0) {
+        memset(values, 0, sizeof(uint64_t) * COUNTERS);
+        return;
+    }
+
+    uint64_t group[1 + COUNTERS]; //PERF_FORMAT_GROUP: the count, then one value per counter.
+
+    if (read(counterFds[0], group, sizeof(group)) != sizeof(group)) {
+        memset(values, 0, sizeof(uint64_t) * COUNTERS);
+        return;
+    }
+
+    memcpy(values, group + 1, sizeof(uint64_t) * COUNTERS);
+}
+
+static std::string getTopNodeName(ParserTopNode* node) {
+    switch (node->type) {
+        case PRT_METHOD_DECLARATION:
+            return std::string("external def ") + node->method.functionName;
+        case PRT_METHOD_DEFINITION:
+            return std::string("def ") + node->method.functionName;
+        case PRT_VARIABLE_DECLARATION:
+            return std::string("external ") + node->variable.name;
+        case PRT_VARIABLE_DEFINITION:
+            return std::string("global ") + node->variable.name;
+        case PRT_CLASS_DEFINITION:
+            return std::string("class ") + node->classdef.name;
+        case PRT_NONE:
+            break;
+    }
+
+    return "(none)";
+}
+
+static void writeJSONString(FILE* out, const std::string& string) {
+    fputc('"', out);
+
+    for (size_t i = 0; i < string.size(); i++) {
+        char c = string[i];
+
+        if (c == '"' || c == '\\')
+            fputc('\\', out);
+
+        if ((unsigned char) c < 0x20)
+            fprintf(out, "\\u%04x", c);
+        else
+            fputc(c, out);
+    }
+
+    fputc('"', out);
+}
+
+void initTimeReport(Boolean counters, Boolean trace) {
+    enabled = TRUE;
+    tracing = trace;
+    memset(phaseTimings, 0, sizeof(phaseTimings));
+
+    if (counters)
+        openCounters();
+
+    epoch = now();
+}
+
+void freeTimeReport() {
+    for (int i = 0; i < COUNTERS; i++) {
+        if (counterFds[i] >= 0)
+            close(counterFds[i]);
+
+        counterFds[i] = -1;
+    }
+
+    enabled = FALSE;
+    openPhases.clear();
+    nodeIndices.clear();
+    nodeTimings.clear();
+    traceEvents.clear();
+}
+
+void beginPhase(TimePhase phase) {
+    if (!enabled)
+        return;
+
+    OpenPhase p;
+    p.phase = phase;
+    p.children = 0;
+    memset(p.childCounters, 0, sizeof(p.childCounters));
+    readCounters(p.startCounters);
+    p.start = now();
+    openPhases.push_back(p);
+}
+
+void endPhase(ParserTopNode* subject) {
+    if (!enabled)
+        return;
+
+    uint64_t end = now();
+    uint64_t endCounters[COUNTERS];
+    readCounters(endCounters);
+    OpenPhase p = openPhases.back();
+    openPhases.pop_back();
+    uint64_t total = end - p.start;
+    PhaseTiming& timing = phaseTimings[p.phase];
+    timing.self += total - p.children;
+    timing.total += total;
+    timing.calls++;
+    uint64_t counters[COUNTERS];
+
+    for (int i = 0; i < COUNTERS; i++) {
+        counters[i] = endCounters[i] - p.startCounters[i];
+        timing.counters[i] += counters[i] - p.childCounters[i];
+    }
+
+    if (!openPhases.empty()) { //nested, so the enclosing phase does not count this time as its own.
+        OpenPhase& parent = openPhases.back();
+        parent.children += total;
+
+        for (int i = 0; i < COUNTERS; i++)
+            parent.childCounters[i] += counters[i];
+    } else if (subject != NULL) {
+        auto found = nodeIndices.find(subject);
+        size_t index;
+
+        if (found == nodeIndices.end()) {
+            NodeTiming node;
+            node.name = getTopNodeName(subject);
+            node.total = 0;
+            memset(node.phases, 0, sizeof(node.phases));
+            index = nodeTimings.size();
+            nodeIndices[subject] = index;
+            nodeTimings.push_back(node);
+        } else {
+            index = found->second;
+        }
+
+        nodeTimings[index].total += total;
+        nodeTimings[index].phases[p.phase] += total;
+    }
+
+    if (tracing) {
+        TraceEvent event;
+        event.phase = p.phase;
+        event.start = p.start - epoch;
+        event.duration = total;
+        event.subject = subject;
+        memcpy(event.counters, counters, sizeof(counters));
+        traceEvents.push_back(event);
+    }
+}
+
+void printTimeReport(FILE* out) {
+    uint64_t wall = now() - epoch, measured = 0;
+    bool counters = counterFds[0] >= 0;
+    int phase, i;
+
+    for (phase = 0; phase < TP_COUNT; phase++)
+        measured += phaseTimings[phase].self;
+
+    fprintf(out, "\nExecution times (seconds, self excludes nested phases)\n");
+    fprintf(out, " %-21s %9s %6s %9s %8s", "phase", "self", "", "total", "calls");
+
+    if (counters)
+        for (i = 0; i < COUNTERS; i++)
+            fprintf(out, " %14s", counterNames[i]);
+
+    fprintf(out, "\n");
+
+    for (phase = 0; phase < TP_COUNT; phase++) {
+        PhaseTiming& timing = phaseTimings[phase];
+
+        if (timing.calls == 0)
+            continue;
+
+        fprintf(out, " %-21s %9.4f (%3.0f%%) %9.4f %8llu", phaseNames[phase], timing.self / 1e9, measured ? 100.0 * timing.self / measured : 0.0,
+                timing.total / 1e9, (unsigned long long) timing.calls);
+
+        if (counters)
+            for (i = 0; i < COUNTERS; i++)
+                fprintf(out, " %14llu", (unsigned long long) timing.counters[i]);
+
+        fprintf(out, "\n");
+    }
+
+    fprintf(out, " %-21s %9.4f\n", "TOTAL (phases)", measured / 1e9);
+    fprintf(out, " %-21s %9.4f\n", "TOTAL (wall)", wall / 1e9);
+
+    if (nodeTimings.empty())
+        return;
+
+    std::vector<NodeTiming> slowest(nodeTimings);
+    std::sort(slowest.begin(), slowest.end(), [](const NodeTiming& a, const NodeTiming& b) { return a.total > b.total; });
+
+    if (slowest.size() > SLOWEST_NODES)
+        slowest.resize(SLOWEST_NODES);
+
+    fprintf(out, "\nSlowest top nodes (seconds, of %zu)\n", nodeTimings.size());
+    fprintf(out, " %-32s %9s", "node", "total");
+
+    for (phase = TP_PARSE; phase <= TP_EMIT; phase++)
+        fprintf(out, " %9s", shortNames[phase]);
+
+    fprintf(out, "\n");
+
+    for (size_t n = 0; n < slowest.size(); n++) {
+        fprintf(out, " %-32.32s %9.4f", slowest[n].name.c_str(), slowest[n].total / 1e9);
+
+        for (phase = TP_PARSE; phase <= TP_EMIT; phase++)
+            fprintf(out, " %9.4f", slowest[n].phases[phase] / 1e9);
+
+        fprintf(out, "\n");
+    }
+}
+
+void writeTimeTrace(FILE* out) {
+    bool counters = counterFds[0] >= 0;
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(out, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"cheshirec\"}}");
+
+    for (size_t e = 0; e < traceEvents.size(); e++) { //complete ("X") events, timestamps in microseconds.
+        TraceEvent& event = traceEvents[e];
+        fprintf(out, ",\n{\"name\": ");
+        writeJSONString(out, event.subject != NULL ? std::string(phaseNames[event.phase]) + ": " + getTopNodeName(event.subject) : phaseNames[event.phase]);
+        fprintf(out, ", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"phase\": \"%s\"",
+                phaseNames[event.phase], event.start / 1e3, event.duration / 1e3, phaseNames[event.phase]);
+
+        if (counters)
+            for (int i = 0; i < COUNTERS; i++)
+                fprintf(out, ", \"%s\": %llu", counterNames[i], (unsigned long long) event.counters[i]);
+
+        fprintf(out, "}}");
+    }
+
+    fprintf(out, "\n]}\n");
+}
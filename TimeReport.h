@@ -0,0 +1,39 @@
+/*
+ * File:   TimeReport.h
+ * Author: Michael Goulet
+ * Implementation: TimeReport.cpp
+ *
+ * Phase timing for -ftime-report. Phases nest (flushPreambles runs inside emitCode), so each phase reports both
+ * its self time and its total time. Every top-level phase is attributed to the top node it worked on, and with
+ * -ftime-trace=<file> each phase becomes an event in a Chrome trace (chrome://tracing, Perfetto).
+ */
+
+#ifndef TIMEREPORT_H
+#define	TIMEREPORT_H
+
+#include <stdio.h>
+#include "Structures.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    typedef enum {
+        TP_PARSE, TP_DEFINE, TP_TYPECHECK, TP_ASSIGNMENTS, TP_FOLD, TP_INLINE, TP_DEAD_CODE, TP_TAIL_CALLS, TP_PURITY, TP_ESCAPE, TP_FORWARD_DEFINITION, TP_EMIT, TP_FLUSH_PREAMBLES, TP_RUN_PASSES, TP_WRITE_MODULE, TP_COUNT
+    } TimePhase;
+
+    void initTimeReport(Boolean counters, Boolean trace);
+    void freeTimeReport(void);
+
+    void beginPhase(TimePhase);
+    void endPhase(ParserTopNode* subject); //NULL when the phase did not work on one top node.
+
+    void printTimeReport(FILE*);
+    void writeTimeTrace(FILE*); //Chrome trace-event JSON, needs initTimeReport(..., TRUE).
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* TIMEREPORT_H */
+
@@ -147,7 +147,8 @@ void defineTopNode(CheshireScope* scope, ParserTopNode* node) {
             break;
         case PRT_CLASS_DEFINITION: {
             ERROR_IF(!isObjectType(node->classdef.parent), "Invalid parent type of class %s", node->classdef.name);
-            int typekey = defineClass(node->classdef.name, node->classdef.classlist, node->classdef.parent);
+            ERROR_IF(isFinalClass(node->classdef.parent), "Class %s cannot inherit from final class %s", node->classdef.name, getNamedTypeString(node->classdef.parent));
+            int typekey = defineClass(node->classdef.name, node->classdef.classlist, node->classdef.parent, node->classdef.final);
             CStrEql streql;
 
             for (ClassList* c = node->classdef.classlist; c != NULL; c = c->next) {
@@ -212,6 +213,8 @@ void defineTopNode(CheshireScope* scope, ParserTopNode* node) {
                                 if (c2->type == CLT_METHOD) {
                                     //check for override.
                                     if (streql(name, c2->method.name)) {
+                                        ERROR_IF(c2->method.final, "Invalid override of %s -- the method is final.", name);
+
                                         if (equalTypes(c->method.returnType, c2->method.returnType)) {
                                             for (ParameterList* a = c->method.params->next, * b = c2->method.params->next; true; a = a->next, b = b->next) {
                                                 if (a == NULL && b == NULL) {
@@ -324,6 +327,8 @@ CheshireType typeCheckExpressionNode(CheshireScope* scope, ExpressionNode* node)
         case OP_SET: {
             CheshireType left = typeCheckExpressionNode(scope, node->binary.left);
             CheshireType right = typeCheckExpressionNode(scope, node->binary.right);
+            ERROR_IF(node->binary.left->type == OP_ACCESS && isFinalMethod(node->binary.left->access.expression->determinedType, node->binary.left->access.variable),
+                    "Cannot assign final method %s", node->binary.left->access.variable);
             STORE_EXPRESSION_INTO_LVAL(left, right, node->binary.right, "Operator =");
             return node->determinedType = left;
         }
@@ -338,7 +343,7 @@ CheshireType typeCheckExpressionNode(CheshireScope* scope, ExpressionNode* node)
         case OP_INSTANCEOF: {
             CheshireType child = typeCheckExpressionNode(scope, node->instanceof.expression);
             ERROR_IF(!isObjectType(child) || !isObjectType(node->instanceof.type), "Expected object types for operation instanceof");
-            ERROR_IF(!isSuper(child, node->instanceof.type) || !isSuper(node->instanceof.type, child), "Instanceof may only compare type relationships that are possible!");
+            ERROR_IF(!isSuper(child, node->instanceof.type) && !isSuper(node->instanceof.type, child), "Instanceof may only compare type relationships that are possible!");
             return node->determinedType = TYPE_BOOLEAN;
         }
         case OP_VARIABLE: {
@@ -348,7 +353,7 @@ CheshireType typeCheckExpressionNode(CheshireScope* scope, ExpressionNode* node)
             } else {
                 CheshireType ret = searchShadowTypeScope(scope, node->string);
                 defineVariable(scope, node->string, ret);
-                scope->dependencies = linkUsingList(ret, node->string, scope->dependencies);
+                scope->dependencies = linkUsingList(ret, saveIdentifierReturn(node->string), scope->dependencies);
                 return node->determinedType = ret;
             }
         }
@@ -450,7 +455,7 @@ CheshireType typeCheckExpressionNode(CheshireScope* scope, ExpressionNode* node)
 
             for (UsingList* u = node->closure.usingList; u != NULL; u = u->next) {
                 if (!hasVariable(scope, u->variable)) {
-                    scope->dependencies = linkUsingList(u->type, u->variable, scope->dependencies);
+                    scope->dependencies = linkUsingList(u->type, saveIdentifierReturn(u->variable), scope->dependencies);
                 }
             }
 
@@ -629,6 +634,13 @@ void typeCheckStatementNode(CheshireScope* scope, StatementNode* node) {
             }
         }
         break;
+        case S_DELETE: {
+            CheshireType type = typeCheckExpressionNode(scope, node->expression);
+
+            if (type.arrayNesting != 0 || !isObjectType(type) || isNull(type) || equalTypes(type, TYPE_OBJECT) || equalTypes(type, TYPE_STRING))
+                PANIC("Expected an object of a class for delete statement");
+        }
+        break;
     }
 }
 
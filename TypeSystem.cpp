@@ -10,6 +10,7 @@
 #include "Structures.h"
 #include "TypeSystem.h"
 #include "LexerUtilities.h"
+#include "MemReport.h"
 //#include "CodeEmitting.h"
 
 using std::max;
@@ -23,6 +24,7 @@ static LambdaTypes lambdaTypes;
 ObjectMapping objectMapping;
 AncestryMap ancestryMap;
 static ClassNames classNames;
+static std::unordered_set<TypeKey> finalClasses;
 KeyedLambdas keyedLambdas;
 
 static CheshireType expectedType = TYPE_VOID;
@@ -91,7 +93,7 @@ void freeTypeSystem() {
     isInitialized = FALSE;
 
     for (AllocatedTypeStrings::iterator i = allocatedTypeStrings.begin(); i != allocatedTypeStrings.end(); ++i)
-        free(*i);
+        memFree(*i);
 
     allocatedTypeStrings.clear();
     namedObjects.clear();
@@ -100,6 +102,7 @@ void freeTypeSystem() {
     keyedLambdas.clear();
     ancestryMap.clear();
     classNames.clear();
+    finalClasses.clear();
     //typeKeys = 0;
 }
 
@@ -217,7 +220,7 @@ void reserveClassNameType(char* name) {
     classNames[typeID] = name;
 }
 
-int defineClass(char* name, ClassList* classlist, CheshireType parent) {
+int defineClass(char* name, ClassList* classlist, CheshireType parent, Boolean final) {
     reserveClassNameType(name);
 
     if (objectMapping[getNamedType(name).typeKey] != NULL)
@@ -228,9 +231,29 @@ int defineClass(char* name, ClassList* classlist, CheshireType parent) {
     objectMapping[typeID] = classlist;
     ancestryMap[typeID] = parent.typeKey;
     classNames[typeID] = name;
+
+    if (final)
+        finalClasses.insert(typeID);
+
     return typeID;
 }
 
+Boolean isFinalClass(CheshireType type) {
+    return type.arrayNesting == 0 && finalClasses.count(type.typeKey) != 0 ? TRUE : FALSE;
+}
+
+Boolean isFinalMethod(CheshireType type, const char* name) {
+    CStrEql streql;
+
+    for (TypeKey t = type.typeKey; t != TYPE_OBJECT.typeKey; t = ancestryMap[t]) {
+        for (ClassList* p = objectMapping[t]; p != NULL; p = p->next)
+            if (p->type == CLT_METHOD && p->method.final && streql(p->method.name, name))
+                return TRUE;
+    }
+
+    return FALSE;
+}
+
 CheshireType getClassVariable(CheshireType type, const char* variable) {
     CStrEql streql;
     ERROR_IF(!isObjectType(type), "Cannot fetch object variable from non-object type.");
@@ -287,6 +310,11 @@ char* getNamedTypeString(CheshireType type) {
     PANIC("Invalid class name!");
 }
 
+char* getClassNameReference(CheshireType type) {
+    ERROR_IF(!isObjectType(type) || type.arrayNesting != 0, "Invalid class name!");
+    return classNames[type.typeKey];
+}
+
 CheshireType getLambdaType(CheshireType returnType, ParameterList* parameters) {
     LambdaType l = prepareLambdaType(returnType, parameters);
 
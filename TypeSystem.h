@@ -34,12 +34,15 @@ extern "C" {
     void defineVariable(CheshireScope*, const char* name, CheshireType type);
     CheshireType getClassVariable(CheshireType, const char* variable);
     void reserveClassNameType(char* name); //"defines" a class so it can use its own name in its definition.
-    int defineClass(char* name, ClassList*, CheshireType parent);
+    int defineClass(char* name, ClassList*, CheshireType parent, Boolean final);
+    Boolean isFinalClass(CheshireType);
+    Boolean isFinalMethod(CheshireType, const char* name); //of the class, or inherited.
 
     Boolean isTypeName(const char*);
     CheshireType getLambdaType(CheshireType returnType, struct tagParameterList* parameters);
     CheshireType getNamedType(const char* name);
     char* getNamedTypeString(CheshireType);
+    char* getClassNameReference(CheshireType); //not a copy: lives as long as the type system.
     void printType(CheshireType);
 
     Boolean equalTypes(CheshireType left, CheshireType right);
@@ -14,6 +14,7 @@
 #include <unordered_set>
 #include "SyntaxTreeUtil.h"
 #include "Structures.h"
+#include "MemReport.h"
 
 class CStrHash;
 class CStrEql;
@@ -98,13 +99,17 @@ public:
 
 typedef std::pair<CheshireType, Array<CheshireType> > LambdaType;
 
-typedef std::unordered_map<const char*, TypeKey, CStrHash, CStrEql> NamedObjects;
+typedef std::unordered_map<const char*, TypeKey, CStrHash, CStrEql,
+        MemReportAllocator<std::pair<const char* const, TypeKey>, MC_NAMED_OBJECTS> > NamedObjects;
 typedef std::unordered_set<char*> AllocatedTypeStrings;
-typedef std::unordered_map<LambdaType, CheshireType, LambdaHash, LambdaEql> LambdaTypes;
-typedef std::unordered_map<TypeKey, ClassList*> ObjectMapping;
+typedef std::unordered_map<LambdaType, CheshireType, LambdaHash, LambdaEql,
+        MemReportAllocator<std::pair<const LambdaType, CheshireType>, MC_LAMBDA_TYPES> > LambdaTypes;
+typedef std::unordered_map<TypeKey, ClassList*, std::hash<TypeKey>, std::equal_to<TypeKey>,
+        MemReportAllocator<std::pair<const TypeKey, ClassList*>, MC_OBJECT_MAPPING> > ObjectMapping;
 typedef std::unordered_map<TypeKey, TypeKey> AncestryMap;
 typedef std::unordered_map<TypeKey, char*> ClassNames;
-typedef std::unordered_map<CheshireType, LambdaType, CheshireTypeHash, CheshireTypeEql> KeyedLambdas;
+typedef std::unordered_map<CheshireType, LambdaType, CheshireTypeHash, CheshireTypeEql,
+        MemReportAllocator<std::pair<const CheshireType, LambdaType>, MC_KEYED_LAMBDAS> > KeyedLambdas;
 
 class CStrHash {
 public:
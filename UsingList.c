@@ -4,9 +4,10 @@
  */
 
 #include "ParserNodes.h"
+#include "MemReport.h"
 
 static UsingList* allocUsingList(void) {
-    UsingList* node = (UsingList*) malloc(sizeof(UsingList));
+    UsingList* node = (UsingList*) memAlloc(MC_LIST_NODES, sizeof(UsingList));
 
     if (node == NULL)
         PANIC_OR_RETURN_NULL;
@@ -32,7 +33,7 @@ void deleteUsingList(UsingList* node) {
     if (node == NULL)
         return;
 
-    //free(node->variable); freed in other places.
+    memFree(node->variable);
     deleteUsingList(node->next);
-    free(node);
+    memFree(node);
 }
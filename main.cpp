@@ -9,9 +9,20 @@
 #include <cstdio>
 #include <list>
 #include <fstream>
+#include <cstring>
 #include "Structures.h"
 #include "TypeSystem.h"
 #include "CodeEmitting.h"
+#include "LLVMEmitting.hpp"
+#include "TimeReport.h"
+#include "MemReport.h"
+#include "ConstantFolding.h"
+#include "TailCalls.h"
+#include "Inlining.h"
+#include "DeadCode.h"
+#include "Purity.h"
+#include "Escape.h"
+#include "MidLevelIR.h"
 
 extern "C" {
 #include "CheshireParser.yy.h"
@@ -27,8 +38,158 @@ using namespace std;
  */
 int main(int argc, char** argv) {
     char* source;
+    Boolean emitBitcode = FALSE;
+    const char* passes = NULL;
+    Boolean timeReport = FALSE, counters = FALSE;
+    const char* tracePath = NULL;
+    Boolean memReport = FALSE;
+    Boolean foldConstants = TRUE;
+    Boolean midLevelIR = FALSE;
+    Boolean inlineReport = FALSE;
+    Boolean eliminateDeadCode = TRUE, deadCodeReport = FALSE;
+    Boolean purityReport = FALSE;
+    Boolean escapeAnalysis = TRUE, escapeReport = FALSE;
+    Boolean classLayoutReport = FALSE;
+    Boolean garbageCollection = FALSE, garbageCollectionReport = FALSE;
+    int optimizationLevel = -1, inlineBudget = -1; //-1 until given.
+    int fieldLayout = -1;
+    const char* memReportPath = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-emit-bc") == 0)
+            emitBitcode = TRUE;
+        else if (strcmp(argv[i], "-opaque-pointers") == 0)
+            setOpaquePointers(TRUE);
+        else if (strcmp(argv[i], "-typed-pointers") == 0)
+            setOpaquePointers(FALSE);
+        else if (strncmp(argv[i], "-passes=", 8) == 0)
+            passes = argv[i] + 8;
+        else if (strlen(argv[i]) == 3 && strncmp(argv[i], "-O", 2) == 0 && argv[i][2] >= '0' && argv[i][2] <= '3')
+            optimizationLevel = argv[i][2] - '0';
+        else if (strcmp(argv[i], "-ftime-report") == 0)
+            timeReport = TRUE;
+        else if (strcmp(argv[i], "-ftime-report-counters") == 0)
+            timeReport = counters = TRUE;
+        else if (strncmp(argv[i], "-ftime-trace=", 13) == 0)
+            tracePath = argv[i] + 13;
+        else if (strcmp(argv[i], "-fno-constant-folding") == 0)
+            foldConstants = FALSE;
+        else if (strncmp(argv[i], "-finline-budget=", 16) == 0)
+            inlineBudget = atoi(argv[i] + 16);
+        else if (strcmp(argv[i], "-finline-report") == 0)
+            inlineReport = TRUE;
+        else if (strncmp(argv[i], "-fentry=", 8) == 0)
+            setEntryPoint(argv[i] + 8);
+        else if (strcmp(argv[i], "-fno-dead-code-elimination") == 0)
+            eliminateDeadCode = FALSE;
+        else if (strcmp(argv[i], "-fdead-code-report") == 0)
+            deadCodeReport = TRUE;
+        else if (strcmp(argv[i], "-fpurity-report") == 0)
+            purityReport = TRUE;
+        else if (strcmp(argv[i], "-fno-escape-analysis") == 0)
+            escapeAnalysis = FALSE;
+        else if (strcmp(argv[i], "-fescape-report") == 0)
+            escapeReport = TRUE;
+        else if (strcmp(argv[i], "-fclass-layout-report") == 0)
+            classLayoutReport = TRUE;
+        else if (strcmp(argv[i], "-fno-devirtualize") == 0)
+            setDevirtualization(FALSE);
+        else if (strcmp(argv[i], "-fno-prototypes") == 0)
+            setPrototypes(FALSE);
+        else if (strcmp(argv[i], "-fpooled-alloc") == 0)
+            setPooledAllocation(TRUE);
+        else if (strcmp(argv[i], "-fpoison-deleted") == 0) {
+            setPoisonDeleted(TRUE);
+            escapeAnalysis = FALSE; //objects on the stack never come from the free lists, so nothing would check them.
+        }
+        else if (strcmp(argv[i], "-fgc") == 0)
+            garbageCollection = TRUE;
+        else if (strcmp(argv[i], "-fgc-report") == 0)
+            garbageCollectionReport = TRUE;
+        else if (strcmp(argv[i], "-ffield-layout=declared") == 0)
+            fieldLayout = FL_DECLARED;
+        else if (strcmp(argv[i], "-ffield-layout=packed") == 0)
+            fieldLayout = FL_PACKED;
+        else if (strcmp(argv[i], "-ffield-layout=hot") == 0)
+            fieldLayout = FL_HOT_COLD;
+        else if (strcmp(argv[i], "-Wtail-calls") == 0)
+            setTailCallDiagnostics(TRUE);
+        else if (strcmp(argv[i], "-fmir") == 0)
+            midLevelIR = TRUE;
+        else if (strncmp(argv[i], "-fmir-passes=", 13) == 0) {
+            midLevelIR = TRUE;
+            setMIRPasses(argv[i] + 13);
+        }
+        else if (strcmp(argv[i], "-fmem-report") == 0)
+            memReport = TRUE;
+        else if (strncmp(argv[i], "-fmem-report=", 13) == 0) {
+            memReport = TRUE;
+            memReportPath = argv[i] + 13;
+        }
+        else
+            PANIC("Unknown option %s", argv[i]);
+    }
+
+#ifdef CHESHIRE_LLVM_BACKEND
+    Boolean inMemory = TRUE;
+#else
+    Boolean inMemory = emitBitcode; //without LLVM, the in-memory module can only be written as bitcode.
+
+    if (passes != NULL)
+        PANIC("-passes= requires the LLVM backend (make llvm)");
+#endif
+
+    if (midLevelIR && inMemory)
+        PANIC("-fmir only applies to the textual IR emitter");
+
+    if (garbageCollection && (midLevelIR || inMemory))
+        PANIC("-fgc only applies to the textual IR emitter, without -fmir");
+
+    if (optimizationLevel >= 0) {
+        static const int inlineBudgets[] = {0, 8, DEFAULT_INLINE_BUDGET, 2 * DEFAULT_INLINE_BUDGET};
+        setOptimizationLevel(optimizationLevel);
+
+        if (optimizationLevel == 0) {
+            foldConstants = eliminateDeadCode = escapeAnalysis = FALSE;
+            setDevirtualization(FALSE);
+            setPrototypes(FALSE);
+
+            if (fieldLayout < 0)
+                fieldLayout = FL_DECLARED;
+        }
+
+        if (inlineBudget < 0)
+            inlineBudget = inlineBudgets[optimizationLevel];
+
+        if (optimizationLevel == 3 && !inMemory && !garbageCollection)
+            midLevelIR = TRUE;
+#ifdef CHESHIRE_LLVM_BACKEND
+        //the front end has already inlined, folded and removed dead code, so -O1 only cleans up what it emits.
+        static const char* pipelines[] = {NULL, "function(sroa,early-cse,instcombine,simplifycfg)", "default<O2>", "default<O3>"};
+
+        if (passes == NULL)
+            passes = pipelines[optimizationLevel];
+#endif
+    }
+
+    if (inlineBudget >= 0)
+        setInlineBudget(inlineBudget);
+
+    if (fieldLayout >= 0)
+        setFieldLayout((FieldLayout) fieldLayout);
+
+    setMidLevelIR(midLevelIR);
+    setGarbageCollection(garbageCollection);
+
+    if (timeReport || tracePath != NULL)
+        initTimeReport(counters, tracePath != NULL ? TRUE : FALSE);
+
+    if (memReport)
+        initMemReport();
+
     initTypeSystem();
     list<ParserTopNode*> topNodes;
+    list<ParserTopNode*> unreachableNodes; //not emitted, but the type system still points into them.
     CheshireScope* scope = allocateCheshireScope();
     yyscan_t scanner;
     YY_BUFFER_STATE state;
@@ -45,7 +206,9 @@ int main(int argc, char** argv) {
     //printf("Initialized, waiting for input!\n");
 
     while (true) {
+        beginPhase(TP_PARSE);
         ret = yyparse(&node, scanner);
+        endPhase(ret == 0 ? node : NULL);
 
         if (ret == 1)
             PANIC("Reached a fatal error in parsing!");
@@ -54,7 +217,9 @@ int main(int argc, char** argv) {
             break;
 
         if (node != NULL) {
+            beginPhase(TP_DEFINE);
             defineTopNode(scope, node);
+            endPhase(node);
             topNodes.push_back(node);
         }
     }
@@ -62,27 +227,188 @@ int main(int argc, char** argv) {
     //printf("Now type checking...\n");
 
     for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end(); ++i) {
+        beginPhase(TP_TYPECHECK);
         typeCheckTopNode(scope, *i);
+        endPhase(*i);
+    }
+
+    for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end(); ++i) {
+        beginPhase(TP_ASSIGNMENTS);
+        markAssignedVariables(*i);
+        endPhase(*i);
+    }
+
+    if (foldConstants) {
+        for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end(); ++i) {
+            beginPhase(TP_FOLD);
+            foldTopNode(*i);
+            endPhase(*i);
+        }
+    }
+
+    if (inlineBudget != 0) {
+        for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end(); ++i)
+            findInlineCandidates(*i);
+
+        for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end(); ++i) {
+            beginPhase(TP_INLINE);
+            Boolean inlined = inlineTopNode(*i);
+            endPhase(*i);
+
+            if (inlined && foldConstants) { //arguments can make the inlined bodies constant.
+                beginPhase(TP_FOLD);
+                foldTopNode(*i);
+                endPhase(*i);
+            }
+        }
+    }
+
+    if (inlineReport)
+        printInlineReport(stderr);
+
+    if (eliminateDeadCode) {
+        beginPhase(TP_DEAD_CODE);
+
+        for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end(); ++i)
+            addReachabilityNode(*i);
+
+        findReachableNodes();
+
+        for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end();) {
+            list<ParserTopNode*>::iterator next = i;
+            ++next;
+
+            if (!isReachableNode(*i))
+                unreachableNodes.splice(unreachableNodes.end(), topNodes, i);
+
+            i = next;
+        }
+
+        endPhase(NULL);
+
+        if (deadCodeReport)
+            printDeadCodeReport(stderr);
+    }
+
+    for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end(); ++i)
+        registerTopMethod(*i); //so markTailCalls knows the calls the emitter makes directly.
+
+    for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end(); ++i) {
+        beginPhase(TP_TAIL_CALLS);
+        markTailCalls(*i);
+        endPhase(*i);
+    }
+
+    if (optimizationLevel != 0 && !garbageCollection) { //-O0 emits no memory attributes, nor -fgc: any call may collect.
+        beginPhase(TP_PURITY);
+
+        for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end(); ++i)
+            addPurityNode(*i);
+
+        inferPurity();
+        endPhase(NULL);
+
+        if (purityReport)
+            printPurityReport(stderr);
+    }
+
+    if (escapeAnalysis) {
+        beginPhase(TP_ESCAPE);
+
+        for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end(); ++i)
+            addEscapeNode(*i);
+
+        analyzeEscapes();
+        endPhase(NULL);
+
+        if (escapeReport)
+            printEscapeReport(stderr);
     }
 
     //printf("Type checked successfully! Code emitting: \n");
     yy_delete_buffer(state, scanner);
     yylex_destroy(scanner);
-    initCodeEmitting();
+    initCodeEmitting(); //the LLVM backend shares the class shapes of the text emitter.
 
-    for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end(); ++i) {
-        forwardDefinition(*i);
+    if (inMemory) {
+        initLLVMEmitting("cheshire");
+
+        for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end(); ++i) {
+            beginPhase(TP_FORWARD_DEFINITION);
+            llvmForwardDefinition(*i);
+            endPhase(*i);
+        }
+
+        for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end(); ++i) {
+            beginPhase(TP_EMIT);
+            llvmEmitCode(*i);
+            endPhase(*i);
+        }
+
+        if (passes != NULL) {
+            beginPhase(TP_RUN_PASSES);
+            llvmRunPasses(passes);
+            endPhase(NULL);
+        }
+
+        beginPhase(TP_WRITE_MODULE);
+        llvmWriteModule(stdout, emitBitcode);
+        endPhase(NULL);
+        freeLLVMEmitting();
+    } else {
+        for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end(); ++i) {
+            beginPhase(TP_FORWARD_DEFINITION);
+            forwardDefinition(*i);
+            endPhase(*i);
+        }
+
+        for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end(); ++i) {
+            beginPhase(TP_EMIT);
+            emitCode(stdout, *i);
+            endPhase(*i);
+        }
+
+        if (garbageCollection)
+            emitGlobalRoots(stdout);
     }
 
-    for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end(); ++i) {
-        emitCode(stdout, *i);
+    if (garbageCollectionReport)
+        printGarbageCollectionReport(stderr);
+
+    if (classLayoutReport)
+        printClassLayoutReport(stderr);
+
+    freeCodeEmitting();
+
+    if (timeReport)
+        printTimeReport(stderr);
+
+    if (tracePath != NULL) {
+        FILE* trace = fopen(tracePath, "w");
+        ERROR_IF(trace == NULL, "Could not open %s for the time trace", tracePath);
+        writeTimeTrace(trace);
+        fclose(trace);
+    }
+
+    freeTimeReport();
+
+    if (memReportPath != NULL) {
+        FILE* report = fopen(memReportPath, "w");
+        ERROR_IF(report == NULL, "Could not open %s for the memory report", memReportPath);
+        writeMemReport(report);
+        fclose(report);
+    } else if (memReport) {
+        writeMemReport(stderr);
     }
 
     for (list<ParserTopNode*>::iterator i = topNodes.begin(); i != topNodes.end(); ++i) {
         deleteParserTopNode(*i);
     }
 
-    freeCodeEmitting();
+    for (list<ParserTopNode*>::iterator i = unreachableNodes.begin(); i != unreachableNodes.end(); ++i) {
+        deleteParserTopNode(*i);
+    }
+
     deleteCheshireScope(scope);
     freeTypeSystem();
     return 0;
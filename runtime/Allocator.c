@@ -0,0 +1,41 @@
+/*
+ * File:   Allocator.c
+ * Author: Michael Goulet
+ * Implements: Runtime.h
+ */
+
+#include <stdlib.h>
+#include "Runtime.h"
+
+static _Thread_local void* freeLists[SIZE_CLASS_COUNT]; //linked through the first word of each chunk.
+
+//hands out the slab's first chunk and links the rest into the class's list, which is empty.
+static void* refill(int32_t sizeClass) {
+    size_t size = (size_t) (sizeClass + 1) * SIZE_CLASS_GRANULE, count = SLAB_SIZE / size, i;
+    char* slab = malloc(SLAB_SIZE);
+
+    if (slab == NULL)
+        return NULL;
+
+    for (i = 1; i + 1 < count; i++)
+        *(void**) (slab + i * size) = slab + (i + 1) * size;
+
+    *(void**) (slab + (count - 1) * size) = NULL;
+    freeLists[sizeClass] = slab + size;
+    return slab;
+}
+
+void* _cheshire_alloc(int32_t sizeClass) {
+    void* chunk = freeLists[sizeClass];
+
+    if (chunk == NULL)
+        return refill(sizeClass);
+
+    freeLists[sizeClass] = *(void**) chunk;
+    return chunk;
+}
+
+void _cheshire_free(void* chunk, int32_t sizeClass) {
+    *(void**) chunk = freeLists[sizeClass];
+    freeLists[sizeClass] = chunk;
+}
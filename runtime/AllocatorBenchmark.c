@@ -0,0 +1,74 @@
+/*
+ * File:   AllocatorBenchmark.c
+ * Author: Michael Goulet
+ *
+ * Allocation throughput of _cheshire_alloc against malloc, built by "make benchmarks": for a few size classes, each
+ * round allocates a batch of chunks, writes to each, and frees them all, as a program that deletes its objects does.
+ * Usage: AllocatorBenchmark [rounds].
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Runtime.h"
+
+#define BATCH 4096
+
+static void* batch[BATCH];
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static double timePooled(int32_t sizeClass, int rounds) {
+    double start = now();
+    int r, i;
+
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < BATCH; i++) {
+            batch[i] = _cheshire_alloc(sizeClass);
+            *(volatile int*) batch[i] = i;
+        }
+
+        for (i = 0; i < BATCH; i++)
+            _cheshire_free(batch[i], sizeClass);
+    }
+
+    return now() - start;
+}
+
+static double timeMalloc(int32_t sizeClass, int rounds) {
+    size_t size = (size_t) (sizeClass + 1) * SIZE_CLASS_GRANULE;
+    double start = now();
+    int r, i;
+
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < BATCH; i++) {
+            batch[i] = malloc(size);
+            *(volatile int*) batch[i] = i;
+        }
+
+        for (i = 0; i < BATCH; i++)
+            free(batch[i]);
+    }
+
+    return now() - start;
+}
+
+int main(int argc, char** argv) {
+    static const int32_t sizeClasses[] = {0, 1, 3, 7, SIZE_CLASS_COUNT - 1};
+    int rounds = argc > 1 ? atoi(argv[1]) : 2000;
+    size_t i;
+
+    printf("%6s %14s %14s %8s\n", "bytes", "pooled Mop/s", "malloc Mop/s", "speedup");
+
+    for (i = 0; i < sizeof(sizeClasses) / sizeof(sizeClasses[0]); i++) {
+        double operations = (double) rounds * BATCH / 1e6;
+        double pooled = timePooled(sizeClasses[i], rounds), system = timeMalloc(sizeClasses[i], rounds);
+        printf("%6d %14.1f %14.1f %7.2fx\n", (sizeClasses[i] + 1) * SIZE_CLASS_GRANULE, operations / pooled, operations / system, system / pooled);
+    }
+
+    return 0;
+}
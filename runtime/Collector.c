@@ -0,0 +1,519 @@
+/*
+ * File:   Collector.c
+ * Author: Michael Goulet
+ * Implements: Runtime.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Runtime.h"
+
+typedef struct {
+    uint32_t size; //of the object, as "new" stores it; of the rest of the run, for free chunks.
+    uint32_t flags;
+} ChunkHeader;
+
+#define CHUNK_MARKED 1u
+#define CHUNK_FREE 2u
+#define CHUNK_SIZE(size) (((size_t) (size) + GC_HEADER_SIZE + 7) & ~(size_t) 7) //as the emitted bump path rounds.
+#define MIN_RUN_SIZE (GC_HEADER_SIZE + sizeof(char*)) //smaller free chunks cannot be linked, so wait to be merged.
+
+typedef struct {
+    int32_t offset, nesting;
+} MapEntry;
+
+typedef struct {
+    int32_t count;
+    MapEntry entries[];
+} PointerMap;
+
+typedef struct {
+    int32_t depth;
+    const PointerMap* map;
+} TypeDescriptor;
+
+typedef struct {
+    int32_t length;
+    void** elements;
+} ObjectArray;
+
+//LLVM's shadow stack: a frame map per function and an entry per activation, whose roots follow it.
+typedef struct {
+    int32_t rootCount, metaCount;
+    const void* meta[];
+} FrameMap;
+
+typedef struct StackEntry {
+    struct StackEntry* next;
+    const FrameMap* map;
+    void* roots[];
+} StackEntry;
+
+typedef struct {
+    char *start, *end;
+    Boolean large; //holds one object bigger than a block, and is freed with it.
+} HeapBlock;
+
+typedef struct {
+    char* address;
+    const PointerMap* map;
+} GlobalRoots;
+
+typedef struct {
+    void* value;
+    int32_t nesting;
+} MarkItem;
+
+typedef struct {
+    void *closure, *trampoline, *environment; //from malloc, freed once the closure is unreachable.
+    const PointerMap* map;
+    Boolean marked;
+} ClosureRecord;
+
+StackEntry* llvm_gc_root_chain __attribute__((weak)); //defined by every module with "shadow-stack" functions.
+char* _cheshire_gc_next = NULL;
+char* _cheshire_gc_limit = NULL;
+
+static HeapBlock* blocks = NULL; //sorted by address.
+static size_t blockCount = 0, blockCapacity = 0;
+static size_t heapBytes = 0, threshold = 0, initialHeap = 0, blockSize = GC_BLOCK_SIZE;
+static char* freeRuns = NULL; //chunks at least MIN_RUN_SIZE long, linked through their first word.
+static GlobalRoots* globalRoots = NULL;
+static size_t globalCount = 0, globalCapacity = 0;
+static MarkItem* markStack = NULL;
+static size_t markCount = 0, markCapacity = 0;
+static void** outside = NULL; //objects outside the heap visited by this collection, open addressed.
+static size_t outsideCount = 0, outsideCapacity = 0;
+static ClosureRecord* closures = NULL;
+static size_t closureCount = 0, closureCapacity = 0;
+static size_t* closureIndex = NULL; //1 + the record of each closure, open addressed.
+static size_t closureIndexCapacity = 0;
+static CollectorStatistics statistics;
+
+static void fail(const char* message) {
+    fprintf(stderr, "Cheshire collector: %s\n", message);
+    abort();
+}
+
+static void* grow(void* array, size_t* capacity, size_t element) {
+    *capacity = *capacity == 0 ? 64 : *capacity * 2;
+    array = realloc(array, *capacity * element);
+
+    if (array == NULL)
+        fail("out of memory for its own tables");
+
+    return array;
+}
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+static void printStatistics(void) {
+    fprintf(stderr, "Cheshire collector: %lld collections, %lld bytes freed, %lld live, %lld of heap, %lld closures freed, "
+            "pauses of %.3f ms at most and %.3f ms in total\n", (long long) statistics.collections,
+            (long long) statistics.freedBytes, (long long) statistics.liveBytes, (long long) statistics.heapBytes,
+            (long long) statistics.freedClosures, statistics.maxPause, statistics.totalPause);
+}
+
+static void initialize(void) {
+    const char* heap = getenv("CHESHIRE_GC_HEAP");
+    initialHeap = heap != NULL && atol(heap) > 0 ? (size_t) atol(heap) : GC_INITIAL_HEAP;
+    threshold = initialHeap;
+
+    if (initialHeap < blockSize) //a small heap is a few small blocks.
+        blockSize = initialHeap < 4096 ? 4096 : (initialHeap + 7) & ~(size_t) 7;
+
+    if (getenv("CHESHIRE_GC_STATS") != NULL)
+        atexit(printStatistics);
+}
+
+static void freeChunk(char* chunk, size_t total) {
+    ChunkHeader* header = (ChunkHeader*) chunk;
+    header->size = (uint32_t) (total - GC_HEADER_SIZE);
+    header->flags = CHUNK_FREE;
+
+    if (total >= MIN_RUN_SIZE) {
+        *(char**) (chunk + GC_HEADER_SIZE) = freeRuns;
+        freeRuns = chunk;
+    }
+}
+
+//ends the run "new" bumps through, turning what is left of it into a free chunk, so the heap can be walked.
+static void retireRun(void) {
+    if (_cheshire_gc_next != NULL && _cheshire_gc_next < _cheshire_gc_limit) {
+        ChunkHeader* header = (ChunkHeader*) _cheshire_gc_next;
+        header->size = (uint32_t) (_cheshire_gc_limit - _cheshire_gc_next - GC_HEADER_SIZE);
+        header->flags = CHUNK_FREE;
+    }
+
+    _cheshire_gc_next = _cheshire_gc_limit = NULL;
+}
+
+static Boolean takeRun(size_t total) {
+    char** link;
+
+    for (link = &freeRuns; *link != NULL; link = (char**) (*link + GC_HEADER_SIZE)) {
+        char* run = *link;
+
+        if (((ChunkHeader*) run)->size + GC_HEADER_SIZE >= total) {
+            *link = *(char**) (run + GC_HEADER_SIZE);
+            _cheshire_gc_next = run;
+            _cheshire_gc_limit = run + ((ChunkHeader*) run)->size + GC_HEADER_SIZE;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static char* addBlock(size_t size, Boolean large) {
+    char* start = malloc(size);
+    size_t i;
+
+    if (start == NULL)
+        fail("out of memory");
+
+    if (blockCount == blockCapacity)
+        blocks = grow(blocks, &blockCapacity, sizeof(HeapBlock));
+
+    for (i = blockCount++; i > 0 && blocks[i - 1].start > start; i--)
+        blocks[i] = blocks[i - 1];
+
+    blocks[i].start = start;
+    blocks[i].end = start + size;
+    blocks[i].large = large;
+    heapBytes += size;
+    statistics.heapBytes = heapBytes;
+    return start;
+}
+
+static HeapBlock* findBlock(const void* object) {
+    size_t low = 0, high = blockCount;
+
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+
+        if ((const char*) object < blocks[middle].start)
+            high = middle;
+        else if ((const char*) object >= blocks[middle].end)
+            low = middle + 1;
+        else
+            return &blocks[middle];
+    }
+
+    return NULL;
+}
+
+static size_t hashPointer(const void* pointer, size_t capacity) {
+    return ((uintptr_t) pointer >> 3) & (capacity - 1);
+}
+
+//whether an object outside the heap was already visited by this collection, marking it if not.
+static Boolean visitOutside(void* object) {
+    size_t i;
+
+    if (2 * (outsideCount + 1) > outsideCapacity) {
+        void** old = outside;
+        size_t oldCapacity = outsideCapacity;
+        outsideCapacity = oldCapacity == 0 ? 256 : oldCapacity * 2;
+        outside = calloc(outsideCapacity, sizeof(void*));
+
+        if (outside == NULL)
+            fail("out of memory for its own tables");
+
+        for (outsideCount = 0, i = 0; i < oldCapacity; i++) {
+            if (old[i] != NULL)
+                visitOutside(old[i]);
+        }
+
+        free(old);
+    }
+
+    for (i = hashPointer(object, outsideCapacity); outside[i] != NULL; i = (i + 1) & (outsideCapacity - 1)) {
+        if (outside[i] == object)
+            return TRUE;
+    }
+
+    outside[i] = object;
+    outsideCount++;
+    return FALSE;
+}
+
+static void indexClosure(size_t record) {
+    size_t i = hashPointer(closures[record].closure, closureIndexCapacity);
+
+    while (closureIndex[i] != 0)
+        i = (i + 1) & (closureIndexCapacity - 1);
+
+    closureIndex[i] = record + 1;
+}
+
+static void reindexClosures(void) {
+    size_t i;
+
+    while (2 * closureCount >= closureIndexCapacity)
+        closureIndexCapacity = closureIndexCapacity == 0 ? 256 : closureIndexCapacity * 2;
+
+    free(closureIndex);
+    closureIndex = calloc(closureIndexCapacity, sizeof(size_t));
+
+    if (closureIndex == NULL)
+        fail("out of memory for its own tables");
+
+    for (i = 0; i < closureCount; i++)
+        indexClosure(i);
+}
+
+static ClosureRecord* findClosure(const void* closure) {
+    size_t i;
+
+    if (closureIndexCapacity == 0)
+        return NULL;
+
+    for (i = hashPointer(closure, closureIndexCapacity); closureIndex[i] != 0; i = (i + 1) & (closureIndexCapacity - 1)) {
+        if (closures[closureIndex[i] - 1].closure == closure)
+            return &closures[closureIndex[i] - 1];
+    }
+
+    return NULL;
+}
+
+static void pushValue(void* value, int32_t nesting) {
+    if (value == NULL)
+        return;
+
+    if (markCount == markCapacity)
+        markStack = grow(markStack, &markCapacity, sizeof(MarkItem));
+
+    markStack[markCount].value = value;
+    markStack[markCount++].nesting = nesting;
+}
+
+static void pushMap(char* address, const PointerMap* map) {
+    int32_t i;
+
+    for (i = 0; i < map->count; i++)
+        pushValue(*(void**) (address + map->entries[i].offset), map->entries[i].nesting);
+}
+
+static void scanObject(char* object) {
+    HeapBlock* block = findBlock(object);
+
+    if (block != NULL) {
+        ChunkHeader* header = (ChunkHeader*) (object - GC_HEADER_SIZE);
+
+        if (header->flags & CHUNK_MARKED)
+            return;
+
+        header->flags |= CHUNK_MARKED;
+    } else if (visitOutside(object)) //on the stack, or made by the runtime: traced, never freed.
+        return;
+
+    void** vtable = *(void***) object; //null until the constructor stores it.
+
+    if (vtable != NULL && ((const TypeDescriptor*) vtable[0])->map != NULL)
+        pushMap(object, ((const TypeDescriptor*) vtable[0])->map);
+}
+
+//closures without captures, and methods, are plain functions that no record holds.
+static void scanClosure(void* closure) {
+    ClosureRecord* record = findClosure(closure);
+
+    if (record == NULL || record->marked)
+        return;
+
+    record->marked = TRUE;
+    pushMap(record->environment, record->map);
+}
+
+static void mark(void) {
+    StackEntry* entry;
+    size_t i;
+    int32_t r;
+
+    for (entry = llvm_gc_root_chain; entry != NULL; entry = entry->next) {
+        for (r = 0; r < entry->map->rootCount; r++)
+            pushValue(entry->roots[r], r < entry->map->metaCount ? (int32_t) (intptr_t) entry->map->meta[r] : 0);
+    }
+
+    for (i = 0; i < globalCount; i++)
+        pushMap(globalRoots[i].address, globalRoots[i].map);
+
+    while (markCount > 0) {
+        MarkItem item = markStack[--markCount];
+
+        if (item.nesting == 0) {
+            scanObject(item.value);
+            continue;
+        }
+
+        if (item.nesting == GC_CLOSURE_NESTING) {
+            scanClosure(item.value);
+            continue;
+        }
+
+        ObjectArray* array = item.value; //allocated outside the heap, by external methods.
+
+        for (r = 0; r < array->length; r++)
+            pushValue(array->elements[r], item.nesting - 1);
+    }
+
+    if (outsideCount > 0)
+        memset(outside, 0, outsideCapacity * sizeof(void*));
+
+    outsideCount = 0;
+}
+
+//frees every unmarked chunk, merging neighbouring free chunks into runs, and blocks of large objects that died.
+static void sweep(void) {
+    size_t i, kept = 0;
+    freeRuns = NULL;
+    statistics.liveBytes = 0;
+
+    for (i = 0; i < blockCount; i++) {
+        HeapBlock block = blocks[i];
+        char *chunk = block.start, *run = NULL;
+        Boolean live = FALSE;
+
+        while (chunk < block.end) {
+            ChunkHeader* header = (ChunkHeader*) chunk;
+            size_t total = CHUNK_SIZE(header->size);
+
+            if (header->flags & CHUNK_MARKED) {
+                header->flags = 0;
+                statistics.liveBytes += total;
+                live = TRUE;
+
+                if (run != NULL)
+                    freeChunk(run, chunk - run);
+
+                run = NULL;
+            } else {
+                if (!(header->flags & CHUNK_FREE))
+                    statistics.freedBytes += total;
+
+                if (run == NULL)
+                    run = chunk;
+            }
+
+            chunk += total;
+        }
+
+        if (block.large && !live) {
+            heapBytes -= block.end - block.start;
+            free(block.start);
+            continue;
+        }
+
+        if (run != NULL)
+            freeChunk(run, block.end - run);
+
+        blocks[kept++] = block;
+    }
+
+    blockCount = kept;
+    statistics.heapBytes = heapBytes;
+
+    for (i = 0, kept = 0; i < closureCount; i++) {
+        if (!closures[i].marked) {
+            free(closures[i].trampoline);
+            free(closures[i].environment);
+            statistics.freedClosures++;
+            continue;
+        }
+
+        closures[i].marked = FALSE;
+        closures[kept++] = closures[i];
+    }
+
+    closureCount = kept;
+    reindexClosures();
+}
+
+void _cheshire_gc_collect(void) {
+    double start = now();
+
+    if (initialHeap == 0)
+        initialize();
+
+    retireRun();
+    mark();
+    sweep();
+    threshold = (size_t) statistics.liveBytes * GC_HEAP_GROWTH;
+
+    if (threshold < initialHeap)
+        threshold = initialHeap;
+
+    double pause = now() - start;
+    statistics.collections++;
+    statistics.totalPause += pause;
+
+    if (pause > statistics.maxPause)
+        statistics.maxPause = pause;
+}
+
+void* _cheshire_gc_allocate(int32_t size) {
+    size_t total = CHUNK_SIZE(size);
+    char* chunk;
+
+    if (initialHeap == 0)
+        initialize();
+
+    retireRun();
+
+    if (total > blockSize / 4) {
+        if (heapBytes + total > threshold)
+            _cheshire_gc_collect();
+
+        chunk = addBlock(total, TRUE);
+    } else {
+        if (!takeRun(total) && heapBytes + blockSize > threshold)
+            _cheshire_gc_collect();
+
+        if (!takeRun(total)) {
+            char* block = addBlock(blockSize, FALSE);
+            _cheshire_gc_next = block;
+            _cheshire_gc_limit = block + blockSize;
+        }
+
+        chunk = _cheshire_gc_next;
+        _cheshire_gc_next += total;
+    }
+
+    memset(chunk, 0, total);
+    ((ChunkHeader*) chunk)->size = (uint32_t) size;
+    return chunk + GC_HEADER_SIZE;
+}
+
+void _cheshire_gc_add_roots(void* address, const void* map) {
+    if (globalCount == globalCapacity)
+        globalRoots = grow(globalRoots, &globalCapacity, sizeof(GlobalRoots));
+
+    globalRoots[globalCount].address = address;
+    globalRoots[globalCount++].map = map;
+}
+
+void _cheshire_gc_add_closure(void* closure, void* trampoline, void* environment, const void* map) {
+    if (closureCount == closureCapacity)
+        closures = grow(closures, &closureCapacity, sizeof(ClosureRecord));
+
+    closures[closureCount].closure = closure;
+    closures[closureCount].trampoline = trampoline;
+    closures[closureCount].environment = environment;
+    closures[closureCount].map = map;
+    closures[closureCount++].marked = FALSE;
+
+    if (2 * closureCount >= closureIndexCapacity)
+        reindexClosures();
+    else
+        indexClosure(closureCount - 1);
+}
+
+void _cheshire_gc_statistics(CollectorStatistics* out) {
+    *out = statistics;
+}
@@ -0,0 +1,120 @@
+/*
+ * File:   CollectorBenchmark.c
+ * Author: Michael Goulet
+ *
+ * Allocation rate and pause times of the -fgc collector, built by "make benchmarks". Objects are {vtable, next, value}
+ * and allocated as emitted code does: bumped inline, zeroed, and from _cheshire_gc_allocate when the run is used up.
+ * "garbage" drops every object at once, "lists" keeps a ring of RING lists of LIST_LENGTH objects alive, replacing one
+ * per round, so each collection marks the whole ring. Usage: CollectorBenchmark [rounds].
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Runtime.h"
+
+#define RING 1024
+#define LIST_LENGTH 64
+
+typedef struct Node {
+    const void* const* vtable;
+    struct Node* next;
+    int64_t value;
+} Node;
+
+extern char* _cheshire_gc_next;
+extern char* _cheshire_gc_limit;
+
+static const struct {
+    int32_t count;
+    int32_t entries[1][2];
+} nodeMap = {1, {{offsetof(Node, next), 0}}};
+
+static const struct {
+    int32_t depth;
+    const void* map;
+} nodeDescriptor = {0, &nodeMap};
+
+static const void* const nodeVTable[] = {&nodeDescriptor};
+
+static Node* ring[RING]; //registered with a pointer map of RING entries.
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static Node* newNode(Node* next, int64_t value) {
+    size_t total = (sizeof(Node) + GC_HEADER_SIZE + 7) & ~(size_t) 7;
+    Node* node;
+
+    if (_cheshire_gc_next != NULL && _cheshire_gc_next + total <= _cheshire_gc_limit) {
+        char* chunk = _cheshire_gc_next;
+        _cheshire_gc_next += total;
+        memset(chunk, 0, total);
+        *(int32_t*) chunk = sizeof(Node);
+        node = (Node*) (chunk + GC_HEADER_SIZE);
+    } else
+        node = _cheshire_gc_allocate(sizeof(Node));
+
+    node->vtable = nodeVTable;
+    node->next = next;
+    node->value = value;
+    return node;
+}
+
+static void report(const char* name, double seconds, long objects) {
+    static CollectorStatistics last;
+    CollectorStatistics s;
+    _cheshire_gc_statistics(&s);
+    long collections = (long) (s.collections - last.collections);
+    double pauses = s.totalPause - last.totalPause;
+    printf("%8s %12.1f %12ld %12.3f %12.3f %10.1f\n", name, objects / seconds / 1e6, collections,
+            collections > 0 ? pauses / collections : 0.0, s.maxPause, s.heapBytes / 1048576.0);
+    last = s;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+    struct {
+        int32_t count;
+        int32_t entries[RING][2];
+    }* ringMap = malloc(sizeof(*ringMap));
+    volatile int64_t sink = 0;
+    double start;
+    long r, i;
+
+    ringMap->count = RING;
+
+    for (i = 0; i < RING; i++) {
+        ringMap->entries[i][0] = (int32_t) (i * sizeof(Node*));
+        ringMap->entries[i][1] = 0;
+    }
+
+    _cheshire_gc_add_roots(ring, ringMap);
+    printf("%8s %12s %12s %12s %12s %10s\n", "", "Mobjects/s", "collections", "mean pause", "max pause", "heap MB");
+    start = now();
+
+    for (r = 0; r < (long) rounds * LIST_LENGTH; r++)
+        sink += newNode(NULL, r)->value;
+
+    report("garbage", now() - start, (long) rounds * LIST_LENGTH);
+    start = now();
+
+    for (r = 0; r < rounds; r++) {
+        Node* list = NULL;
+
+        for (i = 0; i < LIST_LENGTH; i++) {
+            list = newNode(list, i);
+            ring[r % RING] = list; //rooted while it grows.
+        }
+
+        sink += list->value;
+    }
+
+    report("lists", now() - start, (long) rounds * LIST_LENGTH);
+    return 0;
+}
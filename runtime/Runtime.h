@@ -0,0 +1,52 @@
+/*
+ * File:   Runtime.h
+ * Author: Michael Goulet
+ * Implementation: Allocator.c, Collector.c
+ *
+ * The allocators and the garbage collector that emitted code calls, built by "make runtime" into libcheshire.a. The
+ * constants and layouts they share with the emitter come from CodeEmitting.h.
+ */
+
+#ifndef RUNTIME_H
+#define	RUNTIME_H
+
+#include <stdint.h>
+#include "CodeEmitting.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define SLAB_SIZE (64 * 1024)
+#define GC_BLOCK_SIZE (1024 * 1024)
+#define GC_INITIAL_HEAP (4 * GC_BLOCK_SIZE) //unless CHESHIRE_GC_HEAP gives it in bytes; smaller heaps use smaller blocks.
+#define GC_HEAP_GROWTH 2 //the heap grows to this many times what survived the last collection before the next one.
+
+    typedef struct {
+        int64_t collections, freedBytes, liveBytes, heapBytes, freedClosures; //live as of the last collection.
+        double maxPause, totalPause; //in milliseconds.
+    } CollectorStatistics;
+
+    //with -fpooled-alloc: at least (sizeClass + 1) * SIZE_CLASS_GRANULE bytes, aligned to SIZE_CLASS_GRANULE, from the
+    //calling thread's free list of the class, which is refilled by carving a SLAB_SIZE slab from malloc into chunks.
+    void* _cheshire_alloc(int32_t sizeClass);
+    void _cheshire_free(void* chunk, int32_t sizeClass); //onto the calling thread's list, whichever allocated it.
+
+    //with -fgc: a non-moving mark-sweep collector over blocks of GC_BLOCK_SIZE from malloc, for a single thread. It
+    //hands "new" free runs of a block to bump through, and collects when none fits and growing the heap would pass
+    //its threshold. Marking follows llvm_gc_root_chain and the registered roots with an explicit stack, so long lists
+    //do not overflow; objects outside the blocks are traced once per collection and never freed, so those the runtime
+    //makes must start with a null word or a vtable. A closure with captures is traced through its environment, and
+    //its trampoline and environment are freed when it is not reached. Setting CHESHIRE_GC_STATS prints the statistics
+    //at exit.
+    void* _cheshire_gc_allocate(int32_t size); //zeroed, when the bump path does not fit.
+    void _cheshire_gc_add_roots(void* address, const void* map); //a pointer map, as in a type descriptor.
+    void _cheshire_gc_add_closure(void* closure, void* trampoline, void* environment, const void* map);
+    void _cheshire_gc_collect(void);
+    void _cheshire_gc_statistics(CollectorStatistics*);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* RUNTIME_H */